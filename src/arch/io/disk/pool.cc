@@ -33,11 +33,24 @@ void debug_print(printf_buffer_t *buf,
 
 pool_diskmgr_t::pool_diskmgr_t(linux_event_queue_t *queue,
                                passive_producer_t<action_t *> *_source,
-                               int max_concurrent_io_requests)
+                               int max_concurrent_io_requests,
+                               io_backend_t io_backend)
     : queue_depth(blocker_pool_queue_depth(max_concurrent_io_requests)),
       source(_source),
       blocker_pool(max_concurrent_io_requests, queue),
       n_pending(0) {
+    if (io_backend == io_backend_t::io_uring) {
+        uring = io_uring_t::create(queue, queue_depth);
+        if (uring.has()) {
+            // We never have more than `queue_depth` requests in flight, so the
+            // submission queue can't overflow.
+            guarantee(uring->get_entries() >= static_cast<size_t>(queue_depth));
+            uring->done_fun = std::bind(&pool_diskmgr_t::on_uring_done, this,
+                                        ph::_1, ph::_2);
+        } else {
+            logWRN("Falling back to the blocker pool for disk I/O.");
+        }
+    }
     if (source->available->get()) { pump(); }
     source->available->set_callback(this);
 }
@@ -220,10 +233,49 @@ void pool_diskmgr_t::on_source_availability_changed() {
 
 void pool_diskmgr_t::pump() {
     assert_thread();
+    bool submit_to_uring = false;
     while (source->available->get() && n_pending < queue_depth) {
         action_t *a = source->pop();
         a->parent = this;
         n_pending++;
+        if (can_use_uring(a)) {
+            iovec *vecs;
+            size_t vecs_len;
+            a->get_bufs(&vecs, &vecs_len);
+            const bool prepared = a->get_is_read()
+                ? uring->prepare_readv(a->fd, vecs, vecs_len, a->offset, a)
+                : uring->prepare_writev(a->fd, vecs, vecs_len, a->offset, a);
+            guarantee(prepared);
+            submit_to_uring = true;
+        } else {
+            blocker_pool.do_job(a);
+        }
+    }
+    if (submit_to_uring) {
+        uring->submit();
+    }
+}
+
+bool pool_diskmgr_t::can_use_uring(action_t *a) {
+    if (!uring.has() || a->get_is_resize() || a->get_has_datasyncs()) {
+        return false;
+    }
+    iovec *vecs;
+    size_t vecs_len;
+    a->get_bufs(&vecs, &vecs_len);
+    return vecs_len <= IOV_MAX;
+}
+
+void pool_diskmgr_t::on_uring_done(void *user_data, int64_t result) {
+    assert_thread();
+    action_t *a = static_cast<action_t *>(user_data);
+    if (result == static_cast<int64_t>(a->get_count())
+        || (result < 0 && result != -EINTR && result != -EAGAIN)) {
+        a->io_result = result;
+        a->done();
+    } else {
+        // A short read or write.  Let a blocker pool thread redo the whole request,
+        // which takes care of partial transfers and of logging what went wrong.
         blocker_pool.do_job(a);
     }
 }
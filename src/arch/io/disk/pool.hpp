@@ -9,6 +9,7 @@
 
 #include "arch/runtime/event_queue.hpp"
 #include "arch/io/blocker_pool.hpp"
+#include "arch/io/disk/uring.hpp"
 #include "arch/types.hpp"
 #include "concurrency/queue/passive_producer.hpp"
 #include "containers/scoped.hpp"
@@ -24,7 +25,10 @@ class pool_diskmgr_t;
 class printf_buffer_t;
 
 /* The pool disk manager uses a thread pool in conjunction with synchronous
-(blocking) IO calls to asynchronously run IO requests. */
+(blocking) IO calls to asynchronously run IO requests.  If asked to and if the kernel
+supports it, it instead submits plain reads and writes to an io_uring, and only uses
+the thread pool for resizes, datasyncs, and the rare request that the io_uring
+doesn't complete in one go. */
 
 struct pool_diskmgr_action_t
     : private blocker_pool_t::job_t {
@@ -80,6 +84,7 @@ struct pool_diskmgr_action_t
     bool get_is_write() const { return type == ACTION_WRITE; }
     bool get_is_resize() const { return type == ACTION_RESIZE; }
     bool get_is_read() const { return type == ACTION_READ; }
+    bool get_has_datasyncs() const { return ds_op != datasync_op::no_datasyncs; }
     fd_t get_fd() const { return fd; }
     void get_bufs(iovec **iovecs_out, size_t *iovecs_len_out) {
         if (buf_and_count.iov_base != nullptr) {
@@ -146,7 +151,7 @@ public:
     /* The `pool_diskmgr_t` will draw actions to run from `source`. It will call `done_fun`
     on each one when it's done. */
     pool_diskmgr_t(linux_event_queue_t *queue, passive_producer_t<action_t *> *source,
-                   int max_concurrent_io_requests);
+                   int max_concurrent_io_requests, io_backend_t io_backend);
     std::function<void(action_t *)> done_fun;
     ~pool_diskmgr_t();
 
@@ -154,11 +159,16 @@ private:
     const int queue_depth;
     passive_producer_t<action_t *> *source;
     blocker_pool_t blocker_pool;
+    // Empty unless we're using the io_uring backend.
+    scoped_ptr_t<io_uring_t> uring;
 
     void on_source_availability_changed();
     int n_pending;
     void pump();
 
+    bool can_use_uring(action_t *a);
+    void on_uring_done(void *user_data, int64_t result);
+
     DISABLE_COPYING(pool_diskmgr_t);
 };
 
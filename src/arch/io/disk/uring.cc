@@ -0,0 +1,227 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/io/disk/uring.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#if USE_IO_URING
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "errors.hpp"
+#include "logger.hpp"
+#include "utils.hpp"
+
+#if USE_IO_URING
+
+namespace {
+
+int sys_io_uring_setup(uint32_t entries, io_uring_params *params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int sys_io_uring_enter(fd_t ring_fd, uint32_t to_submit) {
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit, 0, 0, nullptr, 0);
+}
+
+int sys_io_uring_register(fd_t ring_fd, unsigned int opcode, const void *arg,
+                          unsigned int nr_args) {
+    return syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+template <class T>
+T *ring_field(void *ring, uint32_t offset) {
+    return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+
+void *map_ring(fd_t ring_fd, size_t size, off_t offset) {
+    void *res = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring_fd, offset);
+    guarantee_err(res != MAP_FAILED, "Could not map io_uring ring");
+    return res;
+}
+
+}  // namespace
+
+scoped_ptr_t<io_uring_t> io_uring_t::create(linux_event_queue_t *queue, int entries) {
+    guarantee(entries > 0);
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int fd = sys_io_uring_setup(entries, &params);
+    if (fd == -1) {
+        // Typically ENOSYS on kernels older than 5.1, or EPERM if io_uring is
+        // disabled by a seccomp filter or sysctl.
+        logNTC("io_uring is not available (%s).\n", errno_string(get_errno()).c_str());
+        return scoped_ptr_t<io_uring_t>();
+    }
+    scoped_ptr_t<io_uring_t> ring(new io_uring_t(queue, fd));
+
+    ring->sq_entries = params.sq_entries;
+    ring->cq_entries = params.cq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        ring->sq_ring_size = ring->cq_ring_size =
+            std::max(ring->sq_ring_size, ring->cq_ring_size);
+        ring->sq_ring = map_ring(fd, ring->sq_ring_size, IORING_OFF_SQ_RING);
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->sq_ring = map_ring(fd, ring->sq_ring_size, IORING_OFF_SQ_RING);
+        ring->cq_ring = map_ring(fd, ring->cq_ring_size, IORING_OFF_CQ_RING);
+    }
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes = map_ring(fd, ring->sqes_size, IORING_OFF_SQES);
+
+    ring->sq_head = ring_field<uint32_t>(ring->sq_ring, params.sq_off.head);
+    ring->sq_tail = ring_field<uint32_t>(ring->sq_ring, params.sq_off.tail);
+    ring->sq_mask = *ring_field<uint32_t>(ring->sq_ring, params.sq_off.ring_mask);
+    ring->sq_array = ring_field<uint32_t>(ring->sq_ring, params.sq_off.array);
+    ring->cq_head = ring_field<uint32_t>(ring->cq_ring, params.cq_off.head);
+    ring->cq_tail = ring_field<uint32_t>(ring->cq_ring, params.cq_off.tail);
+    ring->cq_mask = *ring_field<uint32_t>(ring->cq_ring, params.cq_off.ring_mask);
+    ring->cqes = ring_field<void>(ring->cq_ring, params.cq_off.cqes);
+
+    const int event_fd = ring->completion_event.get_notify_fd();
+    if (sys_io_uring_register(fd, IORING_REGISTER_EVENTFD, &event_fd, 1) != 0) {
+        logNTC("Could not register an eventfd with io_uring (%s).\n",
+               errno_string(get_errno()).c_str());
+        return scoped_ptr_t<io_uring_t>();
+    }
+    queue->watch_event(&ring->completion_event, ring.get());
+    ring->watching_completions = true;
+    return ring;
+}
+
+io_uring_t::io_uring_t(linux_event_queue_t *_queue, fd_t _ring_fd)
+    : queue(_queue), ring_fd(_ring_fd),
+      sq_ring(nullptr), sq_ring_size(0), cq_ring(nullptr), cq_ring_size(0),
+      sqes(nullptr), sqes_size(0),
+      sq_head(nullptr), sq_tail(nullptr), sq_mask(0), sq_array(nullptr),
+      sq_entries(0), cq_entries(0), cq_head(nullptr), cq_tail(nullptr), cq_mask(0),
+      cqes(nullptr), watching_completions(false), n_prepared(0) { }
+
+io_uring_t::~io_uring_t() {
+    assert_thread();
+    rassert(n_prepared == 0);
+    if (watching_completions) {
+        queue->forget_event(&completion_event, this);
+    }
+    if (sqes != nullptr) {
+        munmap(sqes, sqes_size);
+    }
+    if (cq_ring != nullptr && cq_ring != sq_ring) {
+        munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != nullptr) {
+        munmap(sq_ring, sq_ring_size);
+    }
+    int res = close(ring_fd);
+    guarantee_err(res == 0 || get_errno() == EINTR, "Could not close io_uring");
+}
+
+bool io_uring_t::prepare_readv(fd_t fd, const iovec *vecs, size_t count,
+                               int64_t offset, void *user_data) {
+    return prepare(IORING_OP_READV, fd, vecs, count, offset, user_data);
+}
+
+bool io_uring_t::prepare_writev(fd_t fd, const iovec *vecs, size_t count,
+                                int64_t offset, void *user_data) {
+    return prepare(IORING_OP_WRITEV, fd, vecs, count, offset, user_data);
+}
+
+bool io_uring_t::prepare(uint8_t opcode, fd_t fd, const iovec *vecs, size_t count,
+                         int64_t offset, void *user_data) {
+    assert_thread();
+    // Only we write the tail, but the kernel advances the head.
+    const uint32_t tail = *sq_tail;
+    const uint32_t head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= sq_entries) {
+        return false;
+    }
+
+    const uint32_t index = tail & sq_mask;
+    io_uring_sqe *sqe = static_cast<io_uring_sqe *>(sqes) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(vecs);
+    sqe->len = count;
+    sqe->user_data = reinterpret_cast<uint64_t>(user_data);
+    sq_array[index] = index;
+
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++n_prepared;
+    return true;
+}
+
+void io_uring_t::submit() {
+    assert_thread();
+    while (n_prepared > 0) {
+        const int res = sys_io_uring_enter(ring_fd, n_prepared);
+        if (res == -1) {
+            // We never have more requests in flight than the completion queue can
+            // hold, so EBUSY can't happen.
+            guarantee_err(get_errno() == EINTR || get_errno() == EAGAIN,
+                          "io_uring_enter failed");
+            continue;
+        }
+        n_prepared -= res;
+    }
+}
+
+void io_uring_t::on_event(DEBUG_VAR int events) {
+    assert_thread();
+    rassert(events == poll_event_in);
+    completion_event.consume_wakey_wakeys();
+
+    // Copy the completions out of the ring before calling `done_fun`, which may
+    // prepare new requests and submit them.
+    std::vector<std::pair<void *, int64_t> > completions;
+    const uint32_t tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    uint32_t head = *cq_head;
+    for (; head != tail; ++head) {
+        const io_uring_cqe *cqe = static_cast<io_uring_cqe *>(cqes) + (head & cq_mask);
+        completions.push_back(std::make_pair(reinterpret_cast<void *>(cqe->user_data),
+                                             static_cast<int64_t>(cqe->res)));
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+    for (const auto &completion : completions) {
+        done_fun(completion.first, completion.second);
+    }
+}
+
+#else  // USE_IO_URING
+
+scoped_ptr_t<io_uring_t> io_uring_t::create(linux_event_queue_t *, int) {
+    return scoped_ptr_t<io_uring_t>();
+}
+
+io_uring_t::~io_uring_t() {
+    unreachable();
+}
+
+bool io_uring_t::prepare_readv(fd_t, const iovec *, size_t, int64_t, void *) {
+    unreachable();
+}
+
+bool io_uring_t::prepare_writev(fd_t, const iovec *, size_t, int64_t, void *) {
+    unreachable();
+}
+
+void io_uring_t::submit() {
+    unreachable();
+}
+
+void io_uring_t::on_event(int) {
+    unreachable();
+}
+
+#endif  // USE_IO_URING
@@ -0,0 +1,100 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_DISK_URING_HPP_
+#define ARCH_IO_DISK_URING_HPP_
+
+#include <stdint.h>
+
+#include <functional>
+
+#include "arch/runtime/event_queue.hpp"
+#include "arch/runtime/system_event.hpp"
+#include "arch/types.hpp"
+#include "containers/scoped.hpp"
+#include "threading.hpp"
+
+// io_uring needs a recent Linux kernel, and we need its eventfd to get woken up by the
+// event queue.  We talk to the kernel through the raw system calls rather than
+// depending on liburing.
+#if defined(__linux) && !defined(NO_EVENTFD) && !defined(LEGACY_LINUX) \
+    && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define USE_IO_URING 1
+#endif
+#endif
+#ifndef USE_IO_URING
+#define USE_IO_URING 0
+#endif
+
+struct iovec;
+
+/* `io_uring_t` is a thin wrapper around a Linux io_uring instance that belongs to
+one thread's event queue.  Reads and writes get queued with `prepare_readv()` and
+`prepare_writev()` and handed to the kernel in one batch by `submit()`.  When a
+request completes, `done_fun` gets called on the event queue's thread with the
+request's `user_data` and its result (the number of bytes transferred, or a negated
+errno value). */
+class io_uring_t : private linux_event_callback_t, public home_thread_mixin_debug_only_t {
+public:
+    // Returns an empty pointer if io_uring is not supported by this build or by the
+    // running kernel.
+    static scoped_ptr_t<io_uring_t> create(linux_event_queue_t *queue, int entries);
+
+    ~io_uring_t();
+
+    std::function<void(void *user_data, int64_t result)> done_fun;
+
+    // The number of requests that can be prepared before calling `submit()`.
+    size_t get_entries() const { return sq_entries; }
+
+    // `vecs` must remain valid until the request completes.  Returns false if
+    // the submission queue is full.
+    MUST_USE bool prepare_readv(fd_t fd, const iovec *vecs, size_t count,
+                                int64_t offset, void *user_data);
+    MUST_USE bool prepare_writev(fd_t fd, const iovec *vecs, size_t count,
+                                 int64_t offset, void *user_data);
+
+    // Hands all prepared requests to the kernel.
+    void submit();
+
+private:
+    io_uring_t(linux_event_queue_t *queue, fd_t ring_fd);
+
+    MUST_USE bool prepare(uint8_t opcode, fd_t fd, const iovec *vecs, size_t count,
+                          int64_t offset, void *user_data);
+    void on_event(int events);
+
+    linux_event_queue_t *const queue;
+    const fd_t ring_fd;
+
+    // The kernel posts an event here whenever a request completes.
+    system_event_t completion_event;
+
+    // The memory mapped rings.  If the kernel supports it, the submission and
+    // completion rings share one mapping, in which case `cq_ring == sq_ring`.
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    void *sqes;
+    size_t sqes_size;
+
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t sq_mask;
+    uint32_t *sq_array;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t cq_mask;
+    void *cqes;
+
+    bool watching_completions;
+
+    // Requests that have been prepared but not submitted yet.
+    uint32_t n_prepared;
+
+    DISABLE_COPYING(io_uring_t);
+};
+
+#endif  // ARCH_IO_DISK_URING_HPP_
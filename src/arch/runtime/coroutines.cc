@@ -14,6 +14,7 @@
 #include "arch/runtime/context_switching.hpp"
 #include "arch/runtime/coro_profiler.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "arch/runtime/sampling_profiler.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "config/args.hpp"
 #include "debug.hpp"
@@ -167,6 +168,7 @@ coro_t::coro_t() :
     current_thread_(linux_thread_pool_t::get_thread_id()),
     notified_(false),
     waiting_(false),
+    stealable_(false),
     protected_stack_lru_entry_(this)
 #ifndef NDEBUG
     , selfname_number(get_thread_id().threadnum + MAX_THREADS *
@@ -274,7 +276,9 @@ void coro_t::run() {
         TLS_get_cglobals()->active_coroutines.insert(coro);
 #endif
         PROFILER_CORO_RESUME;
+        sampling_profiler_t::get_global_profiler().on_coro_resume();
         coro->action_wrapper.run();
+        sampling_profiler_t::get_global_profiler().on_coro_yield();
         PROFILER_CORO_YIELD(0);
 #ifndef NDEBUG
         TLS_get_cglobals()->running_coroutine_counts[coro->coroutine_type]--;
@@ -361,6 +365,7 @@ void coro_t::wait() {   /* class method */
     self()->waiting_ = true;
 
     PROFILER_CORO_YIELD(1);
+    sampling_profiler_t::get_global_profiler().on_coro_yield();
     if (TLS_get_cglobals()->prev_coro) {
         TLS_get_cglobals()->prev_coro->switch_to_coro_with_protection(
             &self()->stack.context);
@@ -368,6 +373,7 @@ void coro_t::wait() {   /* class method */
         switch_to_scheduler(&self()->stack.context, &TLS_get_cglobals()->scheduler);
     }
     PROFILER_CORO_RESUME;
+    sampling_profiler_t::get_global_profiler().on_coro_resume();
 
     rassert(self());
     rassert(self()->waiting_);
@@ -404,6 +410,7 @@ void coro_t::notify_now_deprecated() {
 
     if (coro_t::self() != nullptr) {
         PROFILER_CORO_YIELD(1);
+        sampling_profiler_t::get_global_profiler().on_coro_yield();
     }
     coro_t *prev_prev_coro = TLS_get_cglobals()->prev_coro;
     TLS_get_cglobals()->prev_coro = TLS_get_cglobals()->current_coro;
@@ -420,6 +427,7 @@ void coro_t::notify_now_deprecated() {
     TLS_get_cglobals()->prev_coro = prev_prev_coro;
     if (coro_t::self() != nullptr) {
         PROFILER_CORO_RESUME;
+        sampling_profiler_t::get_global_profiler().on_coro_resume();
     }
 
 #ifndef NDEBUG
@@ -447,6 +455,14 @@ void coro_t::notify_later_ordered() {
         this);
 }
 
+void coro_t::notify_stealable() {
+    rassert(!notified_);
+    rassert(current_thread_ == get_thread_id());
+    notified_ = true;
+    stealable_ = true;
+    linux_thread_pool_t::get_thread()->message_hub.store_message_stealable(this);
+}
+
 void coro_t::move_to_thread(threadnum_t thread) {
     assert_good_thread_id(thread);
     rassert(coro_t::self(), "coro_t::move_to_thread() called when not in a coroutine.");
@@ -474,6 +490,12 @@ void coro_t::on_thread_switch() {
     rassert(notified_);
     notified_ = false;
 
+    if (stealable_) {
+        // We might have been stolen by another thread.
+        current_thread_ = get_thread_id();
+        stealable_ = false;
+    }
+
     /* TODO: When `notify_now_deprecated()` is finally removed, just fold it
     into this function. */
     notify_now_deprecated();
@@ -530,6 +552,7 @@ coro_t * coro_t::get_coro() {
     coro->current_thread_ = get_thread_id();
     coro->notified_ = false;
     coro->waiting_ = true;
+    coro->stealable_ = false;
 
     ++pm_active_coroutines;
     return coro;
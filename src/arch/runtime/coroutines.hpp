@@ -91,6 +91,18 @@ public:
         return coro;
     }
 
+    /* Like `spawn_sometime()`, but if another thread runs out of work before this
+    thread gets to the coroutine, that thread may steal it and run it instead. The
+    coroutine stays on the thread that it first runs on. Only use this for actions that
+    don't care which thread they run on, and don't touch thread-local state of the
+    spawning thread. */
+    template<class callable_t>
+    static coro_t *spawn_stealable(callable_t &&action) {
+        coro_t *coro = get_and_init_coro(std::forward<callable_t>(action));
+        coro->notify_stealable();
+        return coro;
+    }
+
     // Use coro_t::spawn_*(std::bind(...)) for spawning with parameters.
 
     /* Pauses the current coroutine until it is notified */
@@ -217,6 +229,10 @@ private:
 
     virtual void on_thread_switch();
 
+    /* Schedules the coroutine to be run for the first time by whichever thread gets
+    to it first. Must be called on the coroutine's thread. */
+    void notify_stealable();
+
     coro_stack_t stack;
 
     threadnum_t current_thread_;
@@ -225,6 +241,10 @@ private:
     bool notified_;
     bool waiting_;
 
+    // True if the coroutine has been spawned with `spawn_stealable()` and hasn't
+    // started running yet.
+    bool stealable_;
+
     callable_action_wrapper_t action_wrapper;
 
     /* Used to eventually unprotect the coroutine if it has been inactive for a while. */
@@ -24,6 +24,10 @@ linux_message_hub_t::linux_message_hub_t(linux_event_queue_t *queue,
     : queue_(queue),
       thread_pool_(thread_pool),
       is_woken_up_(false),
+      incoming_messages_(nullptr),
+      poll_iterations_(MESSAGE_HUB_MIN_POLL_ITERATIONS),
+      num_stealable_messages_(0),
+      next_thief_(current_thread.threadnum),
       current_thread_(current_thread) {
 
 #ifndef NDEBUG
@@ -47,7 +51,8 @@ linux_message_hub_t::~linux_message_hub_t() {
         guarantee(get_priority_msg_list(p).empty());
     }
 
-    guarantee(incoming_messages_.empty());
+    guarantee(incoming_messages_.load() == nullptr);
+    guarantee(stealable_messages_.empty());
 }
 
 void linux_message_hub_t::do_store_message(threadnum_t nthread, linux_thread_message_t *msg) {
@@ -93,16 +98,73 @@ void linux_message_hub_t::store_message_sometime(threadnum_t nthread, linux_thre
 }
 
 
-void linux_message_hub_t::insert_external_message(linux_thread_message_t *msg) {
-    bool do_wake_up;
+void linux_message_hub_t::store_message_stealable(linux_thread_message_t *msg) {
+    rassert(!msg->is_ordered);
+#ifndef NDEBUG
+    msg->reloop_count_ = 0;
+#endif
+    size_t num_stealable;
     {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        do_wake_up = !check_and_set_is_woken_up();
-        incoming_messages_.push_back(msg);
+        spinlock_acq_t acq(&stealable_messages_lock_);
+        stealable_messages_.push_back(msg);
+        num_stealable = stealable_messages_.size();
+        num_stealable_messages_.store(num_stealable, std::memory_order_relaxed);
     }
 
+    if (num_stealable == 1) {
+        // Make sure that we get to the message ourselves if nobody steals it.
+        wake_up();
+    } else if (num_stealable % MESSAGE_HUB_STEAL_THRESHOLD == 0
+               && num_db_threads() > 1) {
+        // We are building up a backlog. Wake up another thread, so that it can steal
+        // some of it if it doesn't have anything else to do. The bigger the backlog
+        // gets, the more threads we wake up.
+        next_thief_ = (next_thief_ + 1) % num_db_threads();
+        if (next_thief_ == current_thread_.threadnum) {
+            next_thief_ = (next_thief_ + 1) % num_db_threads();
+        }
+        thread_pool_->threads[next_thief_]->message_hub.wake_up();
+    }
+}
+
+int linux_message_hub_t::num_db_threads() const {
+    // The last thread of the pool is the utility thread.
+    return thread_pool_->n_threads - 1;
+}
+
+void linux_message_hub_t::insert_external_message(linux_thread_message_t *msg) {
+    msg_list_t msgs;
+    msgs.push_back(msg);
+    push_incoming_messages(&msgs);
+}
+
+void linux_message_hub_t::push_incoming_messages(msg_list_t *msgs) {
+    rassert(!msgs->empty());
+
+    // Link the batch in reverse order, so that the newest message ends up on top.
+    linux_thread_message_t *oldest = msgs->head();
+    linux_thread_message_t *newest = nullptr;
+    while (linux_thread_message_t *m = msgs->head()) {
+        msgs->remove(m);
+        m->next_incoming = newest;
+        newest = m;
+    }
+
+    // These and the receiving thread's operations on `incoming_messages_` and
+    // `is_woken_up_` are sequentially consistent, so that either we see that it
+    // needs to be woken up, or it sees our messages.
+    linux_thread_message_t *top = incoming_messages_.load();
+    do {
+        oldest->next_incoming = top;
+    } while (!incoming_messages_.compare_exchange_weak(top, newest));
+
+    wake_up();
+}
+
+void linux_message_hub_t::wake_up() {
+    // We only need to do a wake up if we're the first people to do a wake up.
     // Wakey wakey eggs and bakey
-    if (do_wake_up) {
+    if (!is_woken_up_.exchange(true)) {
         event_.wakey_wakey();
     }
 }
@@ -122,9 +184,39 @@ void linux_message_hub_t::on_event(int events) {
     // up and so that poll-based event triggering doesn't infinite-loop.
     event_.consume_wakey_wakeys();
 
-    // Sort incoming messages into the respective priority_msg_lists_
-    sort_incoming_messages_by_priority();
+    // When we run out of messages, we try to steal some from another thread, or else
+    // poll for new ones. We only do that once, so that we return to the event queue
+    // regularly.
+    bool has_polled = false;
+    for (;;) {
+        // Sort incoming messages into the respective priority_msg_lists_
+        sort_incoming_messages_by_priority();
+        take_stealable_messages();
+
+        if (process_priority_msg_lists()
+            || num_stealable_messages_.load(std::memory_order_relaxed) != 0) {
+            // We left some messages unprocessed, so make sure we are called again.
+            // Place wakey_wakey and then yield to the event processing.
+            // It will wake us up again immediately, but can handle a few
+            // OS events (such as timers, network messages etc.) in the meantime.
+            wake_up();
+            return;
+        }
 
+        if (has_polled) {
+            return;
+        }
+        has_polled = true;
+        if (steal_messages()) {
+            // There might be more to steal after we've processed these.
+            wake_up();
+        } else if (!poll_for_incoming_messages()) {
+            return;
+        }
+    }
+}
+
+bool linux_message_hub_t::process_priority_msg_lists() {
     // Compute how many messages of MESSAGE_SCHEDULER_MAX_PRIORITY we process
     // before we check the incoming queues for new messages.
     // We call this the granularity of the message scheduler, and it is
@@ -172,87 +264,165 @@ void linux_message_hub_t::on_event(int events) {
     }
 
     // We might have left some messages unprocessed.
-    // Check if that is the case, and if yes, make sure we are called again.
     for (int i = 0; i < NUM_SCHEDULER_PRIORITIES; ++i) {
         if (!priority_msg_lists_[i].empty()) {
-            // Place wakey_wakey and then yield to the event processing.
-            // It will wake us up again immediately, but can handle a few
-            // OS events (such as timers, network messages etc.) in the meantime.
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&incoming_messages_lock_);
-                do_wake_up = !check_and_set_is_woken_up();
-            }
-            if (do_wake_up) {
-                event_.wakey_wakey();
-            }
-            break;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void spin_pause() {
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __builtin_ia32_pause();
+#endif
+}
+
+bool linux_message_hub_t::poll_for_incoming_messages() {
+    // If `event_` has already been signalled, we're going to get called again
+    // anyway. Otherwise this tells other threads that they don't need to signal it
+    // while we're polling.
+    if (is_woken_up_.exchange(true)) {
+        return false;
+    }
+
+    // The messages that we are waiting for are often replies to messages that we
+    // have just sent, so we need to send those off first.
+    push_messages();
+
+    for (int i = 0; i < poll_iterations_; ++i) {
+        if (incoming_messages_.load(std::memory_order_relaxed) != nullptr) {
+            poll_iterations_ = std::min(poll_iterations_ * 2,
+                                        MESSAGE_HUB_MAX_POLL_ITERATIONS);
+            return true;
         }
+        spin_pause();
     }
+    poll_iterations_ = std::max(poll_iterations_ / 2, MESSAGE_HUB_MIN_POLL_ITERATIONS);
+
+    // From now on, other threads need to signal `event_` again. A message might have
+    // arrived right before they noticed that, so we have to check one last time.
+    is_woken_up_.store(false);
+    return incoming_messages_.load() != nullptr;
 }
 
 void linux_message_hub_t::sort_incoming_messages_by_priority() {
-    // We do this in two steps to release the spinlock faster.
-    // append_and_clear is a very cheap operation, while
-    // assigning each message to a different priority queue
-    // is more expensive.
+    // 1. Pull the messages. Other threads have to signal `event_` for any message
+    // they push after this.
+    is_woken_up_.store(false);
+    linux_thread_message_t *newest = incoming_messages_.exchange(nullptr);
+
+    // 2. Reverse them, so that each thread's messages are in the order in which they
+    // were sent
+    linux_thread_message_t *oldest = nullptr;
+    while (newest != nullptr) {
+        linux_thread_message_t *next = newest->next_incoming;
+        newest->next_incoming = oldest;
+        oldest = newest;
+        newest = next;
+    }
 
-    // 1. Pull the messages
-    msg_list_t new_messages;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        new_messages.append_and_clear(&incoming_messages_);
-        is_woken_up_ = false;
+    // 3. Sort the messages into their respective priority queues
+    while (linux_thread_message_t *m = oldest) {
+        oldest = m->next_incoming;
+        m->next_incoming = nullptr;
+        add_to_priority_msg_list(m);
+    }
+}
+
+void linux_message_hub_t::add_to_priority_msg_list(linux_thread_message_t *m) {
+    int effective_priority = m->priority;
+    if (m->is_ordered) {
+        // Ordered messages are treated as if they had
+        // priority MESSAGE_SCHEDULER_ORDERED_PRIORITY.
+        // This ensures that they can never bypass another
+        // ordered message.
+        effective_priority = MESSAGE_SCHEDULER_ORDERED_PRIORITY;
+        m->is_ordered = false;
     }
+    get_priority_msg_list(effective_priority).push_back(m);
+}
 
-    // 2. Sort the messages into their respective priority queues
-    while (linux_thread_message_t *m = new_messages.head()) {
-        new_messages.remove(m);
-        int effective_priority = m->priority;
-        if (m->is_ordered) {
-            // Ordered messages are treated as if they had
-            // priority MESSAGE_SCHEDULER_ORDERED_PRIORITY.
-            // This ensures that they can never bypass another
-            // ordered message.
-            effective_priority = MESSAGE_SCHEDULER_ORDERED_PRIORITY;
-            m->is_ordered = false;
+void linux_message_hub_t::take_stealable_messages() {
+    if (num_stealable_messages_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    msg_list_t taken;
+    {
+        spinlock_acq_t acq(&stealable_messages_lock_);
+        // Like a thief, we only take our share at a time. Messages in
+        // priority_msg_lists_ can't be stolen anymore, and if we are busy, other
+        // threads might get to the rest first.
+        const size_t share = std::max<size_t>(
+            1, stealable_messages_.size() / num_db_threads());
+        for (size_t i = 0; i < share && i < MESSAGE_SCHEDULER_GRANULARITY; ++i) {
+            linux_thread_message_t *m = stealable_messages_.head();
+            if (m == nullptr) {
+                break;
+            }
+            stealable_messages_.remove(m);
+            taken.push_back(m);
         }
-        get_priority_msg_list(effective_priority).push_back(m);
+        num_stealable_messages_.store(stealable_messages_.size(),
+                                      std::memory_order_relaxed);
+    }
+    while (linux_thread_message_t *m = taken.head()) {
+        taken.remove(m);
+        add_to_priority_msg_list(m);
     }
 }
 
-bool linux_message_hub_t::check_and_set_is_woken_up() {
-    const bool was_woken_up = is_woken_up_;
-    is_woken_up_ = true;
-    return was_woken_up;
+bool linux_message_hub_t::steal_messages() {
+    if (current_thread_.threadnum >= num_db_threads()) {
+        // The utility thread doesn't steal.
+        return false;
+    }
+    for (int i = 1; i < num_db_threads(); ++i) {
+        linux_message_hub_t *victim = &thread_pool_->threads[
+            (current_thread_.threadnum + i) % num_db_threads()]->message_hub;
+        if (victim->num_stealable_messages_.load(std::memory_order_relaxed)
+            < MESSAGE_HUB_STEAL_THRESHOLD) {
+            continue;
+        }
+
+        msg_list_t stolen;
+        {
+            spinlock_acq_t acq(&victim->stealable_messages_lock_);
+            // Take the messages that the victim would have gotten to last. Stolen
+            // messages can't be stolen again, so we only take our share of them
+            // and leave the rest to the other threads.
+            const size_t available = victim->stealable_messages_.size();
+            size_t n = std::min<size_t>(
+                available, std::max<size_t>(1, available / num_db_threads()));
+            for (; n > 0; --n) {
+                linux_thread_message_t *m = victim->stealable_messages_.tail();
+                victim->stealable_messages_.remove(m);
+                stolen.push_front(m);
+            }
+            victim->num_stealable_messages_.store(victim->stealable_messages_.size(),
+                                                  std::memory_order_relaxed);
+        }
+        if (!stolen.empty()) {
+            while (linux_thread_message_t *m = stolen.head()) {
+                stolen.remove(m);
+                add_to_priority_msg_list(m);
+            }
+            return true;
+        }
+    }
+    return false;
 }
 
-// Pushes messages collected locally global lists available to all
+// Pushes messages collected locally onto the incoming messages of their
 // threads.
 void linux_message_hub_t::push_messages() {
     for (int i = 0; i < thread_pool_->n_threads; i++) {
-        // Append the local list for ith thread to that thread's global
-        // message list.
+        // Transfer the local list for ith thread to that thread's incoming
+        // messages.
         thread_queue_t *queue = &queues_[i];
         if (!queue->msg_local_list.empty()) {
-            // Transfer messages to the other core
-
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&thread_pool_->threads[i]->message_hub.incoming_messages_lock_);
-
-                // We only need to do a wake up if we're the first people to do a
-                // wake up.
-                do_wake_up =
-                    !thread_pool_->threads[i]->message_hub.check_and_set_is_woken_up();
-
-                thread_pool_->threads[i]->message_hub.incoming_messages_.append_and_clear(&queue->msg_local_list);
-            }
-
-            // Wakey wakey, perhaps eggs and bakey
-            if (do_wake_up) {
-                thread_pool_->threads[i]->message_hub.event_.wakey_wakey();
-            }
+            thread_pool_->threads[i]->message_hub.push_incoming_messages(
+                &queue->msg_local_list);
         }
     }
 }
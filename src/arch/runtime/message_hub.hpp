@@ -4,6 +4,8 @@
 
 #include <pthread.h>
 
+#include <atomic>
+
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime_utils.hpp"
 #include "arch/runtime/system_event.hpp"
@@ -44,6 +46,11 @@ public:
     // guaranteed to be called in the same order relative to one another.
     void store_message_sometime(threadnum_t nthread, linux_thread_message_t *msg);
 
+    // Schedules the given message to be delivered on this thread, unless another thread
+    // runs out of messages first, in which case that thread might steal it. Stealable
+    // messages aren't ordered relative to any other messages.
+    void store_message_stealable(linux_thread_message_t *msg);
+
     // Called by the thread pool when it needs to deliver a message from the main thread
     // (which does not have an event queue)
     void insert_external_message(linux_thread_message_t *msg);
@@ -55,10 +62,42 @@ private:
     // debug mode.
     void do_store_message(threadnum_t nthread, linux_thread_message_t *msg);
 
+    // Pushes the messages on `msgs` onto the incoming messages of this message hub,
+    // and wakes up its thread if necessary. Can be called from any thread.
+    void push_incoming_messages(msg_list_t *msgs);
+
+    // Signals `event_` unless it has been signalled already. Can be called from any
+    // thread.
+    void wake_up();
+
     // Moves messages from incoming_messages_ into the respective entries of
     // priority_msg_lists, depending on the messages' priorities.
     void sort_incoming_messages_by_priority();
 
+    // Puts `msg` onto the entry of priority_msg_lists_ for its priority.
+    void add_to_priority_msg_list(linux_thread_message_t *msg);
+
+    // Moves our share of our stealable messages into priority_msg_lists_, but no more
+    // than MESSAGE_SCHEDULER_GRANULARITY.
+    void take_stealable_messages();
+
+    // The number of threads that steal messages from one another, which excludes the
+    // utility thread.
+    int num_db_threads() const;
+
+    // Moves a share of the stealable messages of another thread into
+    // priority_msg_lists_.
+    // Returns false if there weren't any worth stealing.
+    bool steal_messages();
+
+    // Processes messages from priority_msg_lists_, up to the scheduler granularity.
+    // Returns true if there are messages left.
+    bool process_priority_msg_lists();
+
+    // Polls incoming_messages_ for a little while. Returns true if a message arrived.
+    // Other threads don't signal `event_` while we're polling.
+    bool poll_for_incoming_messages();
+
     msg_list_t &get_priority_msg_list(int priority);
 
     linux_event_queue_t *const queue_;
@@ -68,16 +107,33 @@ private:
     struct thread_queue_t {
         //TODO this doesn't need to be a class anymore
 
-        /* Messages are cached here before being pushed to the global list so that we don't
-        have to acquire the spinlock as often */
+        /* Messages are cached here before being pushed to the other thread, so that we
+        push them in batches */
         msg_list_t msg_local_list;
     } queues_[MAX_THREADS];
 
-    // Must only be used with acquired incoming_messages_lock_
-    bool check_and_set_is_woken_up();
-    bool is_woken_up_;
-    msg_list_t incoming_messages_;
-    spinlock_t incoming_messages_lock_;
+    // True if `event_` has been signalled (or if we're polling incoming_messages_),
+    // so that other threads don't need to signal it again.
+    std::atomic<bool> is_woken_up_;
+
+    // Messages from other threads, pushed onto this lock-free stack in batches. A
+    // batch is linked in reverse order through `next_incoming`, so that the stack
+    // holds each thread's messages from the most recent to the oldest one.
+    std::atomic<linux_thread_message_t *> incoming_messages_;
+
+    // The number of iterations for the next call to `poll_for_incoming_messages()`.
+    int poll_iterations_;
+
+    // Messages stored with `store_message_stealable()`. We take them from the front,
+    // while other threads steal them from the back. `num_stealable_messages_` mirrors
+    // `stealable_messages_.size()`, so that other threads can check it without
+    // taking the lock.
+    msg_list_t stealable_messages_;
+    spinlock_t stealable_messages_lock_;
+    std::atomic<size_t> num_stealable_messages_;
+
+    // The thread that we wake up next when we have stealable messages piling up.
+    int next_thief_;
 
     // Use `sort_incoming_messages_by_priority()` to sort incoming_messages_ into
     // these lists.
@@ -0,0 +1,167 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/sampling_profiler.hpp"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "arch/runtime/runtime.hpp"
+#include "backtrace.hpp"
+#include "rethinkdb_backtrace.hpp"
+#include "utils.hpp"
+
+sampling_profiler_t &sampling_profiler_t::get_global_profiler() {
+    // Singleton instance, like `coro_profiler_t`'s
+    static sampling_profiler_t profiler;
+    return profiler;
+}
+
+sampling_profiler_t::sampling_profiler_t() : interval_nanos_(0) { }
+
+void sampling_profiler_t::set_samples_per_sec(uint32_t samples_per_sec) {
+    const int64_t interval = samples_per_sec == 0
+        ? 0
+        : std::max<int64_t>(1, secs_to_ticks(1).nanos / samples_per_sec);
+    const int64_t old_interval = interval_nanos_.exchange(interval);
+    if (old_interval == 0 && interval != 0) {
+        clear();
+    }
+}
+
+uint32_t sampling_profiler_t::get_samples_per_sec() const {
+    const int64_t interval = interval_nanos_.load();
+    return interval == 0 ? 0 : secs_to_ticks(1).nanos / interval;
+}
+
+void sampling_profiler_t::record_resume() {
+    per_thread_samples_t *thread =
+        &per_thread_samples_[get_thread_id().threadnum].value;
+    thread->resumed_at = get_ticks().nanos;
+}
+
+void sampling_profiler_t::record_yield() {
+    per_thread_samples_t *thread =
+        &per_thread_samples_[get_thread_id().threadnum].value;
+    // `resumed_at` is 0 if the profiler got turned on while this coroutine was running.
+    if (thread->resumed_at == 0) {
+        return;
+    }
+    thread->run_nanos += get_ticks().nanos - thread->resumed_at;
+    thread->resumed_at = 0;
+
+    const int64_t interval = interval_nanos_.load(std::memory_order_relaxed);
+    if (interval != 0 && thread->run_nanos >= interval) {
+        // If the coroutine ran for more than one interval, it only gets one sample.
+        // Otherwise a single long-running coroutine could make us take more samples
+        // than we promised.
+        thread->run_nanos %= interval;
+        record_sample(thread);
+    }
+}
+
+void sampling_profiler_t::record_sample(per_thread_samples_t *thread) {
+    // We strip the frames inside `rethinkdb_backtrace()`, this function and
+    // `record_yield()`.
+    const int levels_to_strip = 2 + NUM_FRAMES_INSIDE_RETHINKDB_BACKTRACE;
+    void *stack_frames[SAMPLING_PROFILER_BACKTRACE_DEPTH + levels_to_strip];
+    const int backtrace_size = rethinkdb_backtrace(
+        stack_frames, SAMPLING_PROFILER_BACKTRACE_DEPTH + levels_to_strip);
+
+    trace_t trace;
+    trace.fill(nullptr);
+    for (int i = levels_to_strip; i < backtrace_size; ++i) {
+        trace[i - levels_to_strip] = stack_frames[i];
+    }
+
+    spinlock_acq_t acq(&thread->lock);
+    ++thread->num_samples;
+    auto it = thread->samples.find(trace);
+    if (it != thread->samples.end()) {
+        ++it->second;
+    } else if (thread->samples.size() < SAMPLING_PROFILER_MAX_STACKS_PER_THREAD) {
+        thread->samples.insert(std::make_pair(trace, 1));
+    } else {
+        // The empty trace stands for the samples that we had no space for.
+        trace.fill(nullptr);
+        ++thread->samples[trace];
+    }
+}
+
+std::string sampling_profiler_t::get_folded_stacks() {
+    std::map<trace_t, uint64_t> merged;
+    for (size_t i = 0; i < per_thread_samples_.size(); ++i) {
+        per_thread_samples_t *thread = &per_thread_samples_[i].value;
+        std::map<trace_t, uint64_t> samples;
+        {
+            spinlock_acq_t acq(&thread->lock);
+            samples = thread->samples;
+        }
+        for (const auto &pair : samples) {
+            merged[pair.first] += pair.second;
+        }
+    }
+
+    // Looking up symbols is slow, and most frames are shared by many stacks.
+    std::map<void *, std::string> frame_names;
+    std::string result;
+    for (const auto &pair : merged) {
+        std::vector<std::string> names;
+        for (void *addr : pair.first) {
+            if (addr == nullptr) {
+                break;
+            }
+            auto name_it = frame_names.find(addr);
+            if (name_it == frame_names.end()) {
+                backtrace_frame_t frame(addr);
+                frame.initialize_symbols();
+                std::string name;
+                try {
+                    name = frame.get_demangled_name();
+                } catch (const demangle_failed_exc_t &) {
+                    name = frame.get_name();
+                }
+                if (name.empty()) {
+                    name = strprintf("%p", addr);
+                }
+                // The folded format uses semicolons to separate frames.
+                std::replace(name.begin(), name.end(), ';', ':');
+                name_it = frame_names.insert(std::make_pair(addr, name)).first;
+            }
+            names.push_back(name_it->second);
+        }
+        if (names.empty()) {
+            names.push_back("[dropped]");
+        }
+
+        // The trace starts with the innermost frame, but the folded format starts
+        // with the outermost one.
+        for (auto it = names.rbegin(); it != names.rend(); ++it) {
+            if (it != names.rbegin()) {
+                result += ";";
+            }
+            result += *it;
+        }
+        result += strprintf(" %" PRIu64 "\n", pair.second);
+    }
+    return result;
+}
+
+uint64_t sampling_profiler_t::get_num_samples() {
+    uint64_t total = 0;
+    for (size_t i = 0; i < per_thread_samples_.size(); ++i) {
+        per_thread_samples_t *thread = &per_thread_samples_[i].value;
+        spinlock_acq_t acq(&thread->lock);
+        total += thread->num_samples;
+    }
+    return total;
+}
+
+void sampling_profiler_t::clear() {
+    for (size_t i = 0; i < per_thread_samples_.size(); ++i) {
+        per_thread_samples_t *thread = &per_thread_samples_[i].value;
+        spinlock_acq_t acq(&thread->lock);
+        thread->samples.clear();
+        thread->num_samples = 0;
+    }
+}
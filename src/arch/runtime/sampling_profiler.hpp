@@ -0,0 +1,101 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
+#define ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+
+#include "arch/compiler.hpp"
+#include "arch/spinlock.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
+#include "errors.hpp"
+#include "time.hpp"
+
+/* Number of stack frames that are recorded per sample. */
+#define SAMPLING_PROFILER_BACKTRACE_DEPTH       32
+
+/* Number of distinct stacks that are kept per thread. Samples of other stacks are
+counted as "[dropped]", so the profiler's memory use is bounded no matter how long it
+runs. */
+#define SAMPLING_PROFILER_MAX_STACKS_PER_THREAD 4096
+
+/* `sampling_profiler_t` is a low-overhead sampling profiler for coroutines that, unlike
+`coro_profiler_t`, is compiled into release builds and can be turned on and off while
+the server is running (through the `rethinkdb._debug_profiler` table).
+
+Every thread keeps track of how much time coroutines have spent running on it. Whenever
+another sampling interval's worth of running time has passed, the backtrace of the
+coroutine that is yielding gets recorded. So at most `samples_per_sec` samples are
+taken per second and thread, and a stack's sample count is roughly proportional to the
+CPU time that was spent in coroutines that ran into it. The samples are aggregated in
+memory per thread. `get_folded_stacks()` merges them into the "folded" format that
+flame graph tools take as input.
+
+When the profiler is off, the only overhead is a relaxed atomic load whenever a
+coroutine is resumed or yields. */
+class sampling_profiler_t {
+public:
+    static sampling_profiler_t &get_global_profiler();
+
+    // `samples_per_sec` of 0 turns the profiler off. Turning it on discards the
+    // samples from the last time it was on.
+    void set_samples_per_sec(uint32_t samples_per_sec);
+    uint32_t get_samples_per_sec() const;
+
+    // Called by `coro_t` whenever a coroutine starts or stops running.
+    void on_coro_resume() {
+        if (interval_nanos_.load(std::memory_order_relaxed) != 0) {
+            record_resume();
+        }
+    }
+    void on_coro_yield() {
+        if (interval_nanos_.load(std::memory_order_relaxed) != 0) {
+            record_yield();
+        }
+    }
+
+    // Returns one line of the form "outermost;...;innermost <count>" per stack.
+    std::string get_folded_stacks();
+    uint64_t get_num_samples();
+
+    // Discards all samples collected so far.
+    void clear();
+
+private:
+    typedef std::array<void *, SAMPLING_PROFILER_BACKTRACE_DEPTH> trace_t;
+
+    struct per_thread_samples_t {
+        per_thread_samples_t() : resumed_at(0), run_nanos(0), num_samples(0) { }
+
+        // Only accessed by the thread itself.
+        int64_t resumed_at;
+        int64_t run_nanos;
+
+        // Protects the fields below, which are read by `get_folded_stacks()`.
+        spinlock_t lock;
+        std::map<trace_t, uint64_t> samples;
+        uint64_t num_samples;
+    };
+
+    sampling_profiler_t();
+
+    void record_resume();
+    // These aren't inlined, so that `record_sample()` knows how many frames of the
+    // backtrace belong to the profiler.
+    NOINLINE void record_yield();
+    NOINLINE void record_sample(per_thread_samples_t *thread);
+
+    // The amount of coroutine running time between two samples, or 0 if the profiler
+    // is off.
+    std::atomic<int64_t> interval_nanos_;
+    std::array<cache_line_padded_t<per_thread_samples_t>, MAX_THREADS> per_thread_samples_;
+
+    DISABLE_COPYING(sampling_profiler_t);
+};
+
+#endif /* ARCH_RUNTIME_SAMPLING_PROFILER_HPP_ */
@@ -105,6 +105,13 @@ enum class file_direct_io_mode_t {
     buffered_desired
 };
 
+// How a thread's disk manager runs I/O requests: on a pool of threads making blocking
+// system calls, or (on Linux) by submitting them to an io_uring.
+enum class io_backend_t {
+    blocker_pool,
+    io_uring
+};
+
 enum class datasync_op { no_datasyncs, wrap_in_datasyncs, datasync_after };
 
 // A linux file.  It expects reads and writes and buffers to have an
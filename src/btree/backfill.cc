@@ -101,7 +101,7 @@ continue_bool_t btree_send_backfill_pre(
                     "pre-item leaf %" PRIu64, min_deletion_timestamp.longtime));
                 return pre_item_consumer->on_pre_item(std::move(pre_item));
             } else {
-                std::vector<const btree_key_t *> keys;
+                std::vector<store_key_t> keys;
                 leaf::visit_entries(
                     sizer, lnode, buf->lock.get_recency(),
                     [&](const btree_key_t *key, repli_timestamp_t timestamp,
@@ -121,14 +121,11 @@ continue_bool_t btree_send_backfill_pre(
                         }
                         backfill_debug_key(store_key_t(key), strprintf(
                             "pre-item key %" PRIu64, timestamp.longtime));
-                        keys.push_back(key);
+                        keys.push_back(store_key_t(key));
                         return continue_bool_t::CONTINUE;
                     });
-                std::sort(keys.begin(), keys.end(),
-                    [](const btree_key_t *k1, const btree_key_t *k2) {
-                        return btree_key_cmp(k1, k2) < 0;
-                    });
-                for (const btree_key_t *key : keys) {
+                std::sort(keys.begin(), keys.end());
+                for (const store_key_t &key : keys) {
                     backfill_pre_item_t pre_item;
                     pre_item.range = key_range_t::one_key(key);
                     if (continue_bool_t::ABORT ==
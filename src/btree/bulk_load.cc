@@ -0,0 +1,285 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "btree/bulk_load.hpp"
+
+#include <algorithm>
+
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+
+btree_bulk_loader_t::btree_bulk_loader_t(value_sizer_t *sizer,
+                                         superblock_t *superblock,
+                                         repli_timestamp_t timestamp)
+    : sizer_(sizer), superblock_(superblock), timestamp_(timestamp),
+      has_last_key_(false), appended_count_(0) {
+    const block_id_t root_id = superblock_->get_root_block_id();
+    if (root_id == NULL_BLOCK_ID) {
+        return;
+    }
+
+    // Acquire the right edge of the tree, from the root down to the rightmost leaf.
+    // Every key in the rightmost subtree of an internal node is greater than the
+    // node's last separator key.
+    std::vector<buf_lock_t> right_edge;
+    right_edge.push_back(buf_lock_t(superblock_->expose_buf(), root_id, access_t::write));
+    for (;;) {
+        block_id_t child_id;
+        {
+            buf_read_t read(&right_edge.back());
+            const node_t *node = static_cast<const node_t *>(read.get_data_read());
+            if (node::is_leaf(node)) {
+                break;
+            }
+            const internal_node_t *internal
+                = reinterpret_cast<const internal_node_t *>(node);
+            if (internal->npairs >= 2) {
+                last_key_.assign(
+                    &internal_node::get_pair_by_index(internal, internal->npairs - 2)->key);
+                has_last_key_ = true;
+            }
+            child_id
+                = internal_node::get_pair_by_index(internal, internal->npairs - 1)->lnode;
+        }
+        buf_lock_t child(&right_edge.back(), child_id, access_t::write);
+        right_edge.push_back(std::move(child));
+    }
+
+    {
+        buf_lock_t *leaf_buf = &right_edge.back();
+        buf_read_t read(leaf_buf);
+        const leaf_node_t *node = static_cast<const leaf_node_t *>(read.get_data_read());
+        leaf::visit_entries(
+            sizer_, node, leaf_buf->get_recency(),
+            [&](const btree_key_t *key, repli_timestamp_t, const void *) {
+                if (!has_last_key_ || btree_key_cmp(key, last_key_.btree_key()) > 0) {
+                    last_key_.assign(key);
+                    has_last_key_ = true;
+                }
+                return continue_bool_t::CONTINUE;
+            });
+    }
+
+    levels_.reserve(right_edge.size());
+    for (auto it = right_edge.rbegin(); it != right_edge.rend(); ++it) {
+        levels_.push_back(std::move(*it));
+    }
+}
+
+bool btree_bulk_loader_t::can_append(const btree_key_t *key) const {
+    return !has_last_key_ || btree_key_cmp(key, last_key_.btree_key()) > 0;
+}
+
+bool btree_bulk_loader_t::may_append(value_sizer_t *sizer,
+                                     superblock_t *superblock,
+                                     const btree_key_t *key) {
+    const block_id_t root_id = superblock->get_root_block_id();
+    if (root_id == NULL_BLOCK_ID) {
+        return true;
+    }
+
+    // This finds the same keys that the constructor compares `key` against.
+    buf_lock_t buf(superblock->expose_buf(), root_id, access_t::read);
+    for (;;) {
+        block_id_t child_id;
+        {
+            buf_read_t read(&buf);
+            const node_t *node = static_cast<const node_t *>(read.get_data_read());
+            if (node::is_leaf(node)) {
+                bool greater = true;
+                leaf::visit_entries(
+                    sizer, reinterpret_cast<const leaf_node_t *>(node),
+                    buf.get_recency(),
+                    [&](const btree_key_t *k, repli_timestamp_t, const void *) {
+                        if (btree_key_cmp(key, k) <= 0) {
+                            greater = false;
+                            return continue_bool_t::ABORT;
+                        }
+                        return continue_bool_t::CONTINUE;
+                    });
+                return greater;
+            }
+            const internal_node_t *internal
+                = reinterpret_cast<const internal_node_t *>(node);
+            if (internal->npairs >= 2
+                    && btree_key_cmp(key, &internal_node::get_pair_by_index(
+                           internal, internal->npairs - 2)->key) <= 0) {
+                return false;
+            }
+            child_id
+                = internal_node::get_pair_by_index(internal, internal->npairs - 1)->lnode;
+        }
+        buf_lock_t tmp(&buf, child_id, access_t::read);
+        buf = std::move(tmp);
+    }
+}
+
+buf_parent_t btree_bulk_loader_t::leaf() {
+    if (levels_.empty()) {
+        // The tree is empty, so we start it with a leaf root, like `get_root()` does.
+        buf_lock_t root(superblock_->expose_buf(), alt_create_t::create);
+        {
+            buf_write_t write(&root);
+            leaf::init(sizer_, static_cast<leaf_node_t *>(write.get_data_write()));
+        }
+        insert_root(root.block_id(), superblock_);
+        levels_.push_back(std::move(root));
+    }
+    return buf_parent_t(&levels_[0]);
+}
+
+void btree_bulk_loader_t::append(const btree_key_t *key,
+                                 const void *value,
+                                 const value_deleter_t *detacher) {
+    guarantee(can_append(key));
+    // Make sure that there's a leaf to append to.
+    leaf();
+
+    if (appended_count_ == 0) {
+        // Maintain the invariant that each node's recency is greater than or equal
+        // to that of any value in it. The internal nodes that we create below start
+        // out with `timestamp_` as their recency.
+        for (size_t level = 1; level < levels_.size(); ++level) {
+            levels_[level].set_recency(
+                superceding_recency(levels_[level].get_recency(), timestamp_));
+        }
+    }
+
+    bool is_full;
+    {
+        buf_read_t read(&levels_[0]);
+        is_full = leaf::is_full(sizer_,
+                                static_cast<const leaf_node_t *>(read.get_data_read()),
+                                key, value);
+    }
+    if (is_full) {
+        // The value was created with the old leaf as its parent.
+        detacher->delete_value(buf_parent_t(&levels_[0]), value);
+        start_new_leaf();
+    }
+
+    const repli_timestamp_t previous_leaf_recency = levels_[0].get_recency();
+    levels_[0].set_recency(superceding_recency(timestamp_, previous_leaf_recency));
+    {
+        buf_write_t write(&levels_[0]);
+        leaf::insert(sizer_,
+                     static_cast<leaf_node_t *>(write.get_data_write()),
+                     key,
+                     value,
+                     timestamp_,
+                     previous_leaf_recency,
+                     key_modification_proof_t::real_proof());
+    }
+
+    last_key_.assign(key);
+    has_last_key_ = true;
+    ++appended_count_;
+}
+
+void btree_bulk_loader_t::start_new_leaf() {
+    // A full leaf can't be empty, so `last_key_` is the greatest key in it.
+    guarantee(has_last_key_);
+    const store_key_t separator = last_key_;
+
+    buf_lock_t new_leaf(superblock_->expose_buf(), alt_create_t::create);
+    {
+        buf_write_t write(&new_leaf);
+        leaf::init(sizer_, static_cast<leaf_node_t *>(write.get_data_write()));
+    }
+
+    const block_id_t old_leaf_id = levels_[0].block_id();
+    const block_id_t new_leaf_id = new_leaf.block_id();
+    levels_[0] = std::move(new_leaf);
+    add_child(1, separator.btree_key(), old_leaf_id, new_leaf_id);
+}
+
+void btree_bulk_loader_t::add_child(size_t level,
+                                    const btree_key_t *separator,
+                                    block_id_t left_id,
+                                    block_id_t right_id) {
+    const block_size_t block_size = sizer_->block_size();
+
+    if (level == levels_.size()) {
+        // `left_id` is the root, so we need a new root above it.
+        superblock_->expose_buf().detach_child(left_id);
+        buf_lock_t root(superblock_->expose_buf(), alt_create_t::create);
+        {
+            buf_write_t write(&root);
+            internal_node_t *node
+                = static_cast<internal_node_t *>(write.get_data_write());
+            internal_node::init(block_size, node);
+            DEBUG_VAR bool success
+                = internal_node::insert(node, separator, left_id, right_id);
+            rassert(success);
+        }
+        root.set_recency(timestamp_);
+        insert_root(root.block_id(), superblock_);
+        levels_.push_back(std::move(root));
+        return;
+    }
+
+    buf_lock_t *parent = &levels_[level];
+    bool is_full;
+    {
+        buf_read_t read(parent);
+        is_full = internal_node::is_full(
+            static_cast<const internal_node_t *>(read.get_data_read()));
+    }
+    if (!is_full) {
+        buf_write_t write(parent);
+        DEBUG_VAR bool success = internal_node::insert(
+            static_cast<internal_node_t *>(write.get_data_write()),
+            separator, left_id, right_id);
+        rassert(success);
+        return;
+    }
+
+    // The parent is full, so it needs a right sibling too. We move `left_id` over to
+    // the sibling so that the sibling starts out with two children, and the parent
+    // then ends at the child before it.
+    store_key_t parent_separator;
+    {
+        buf_write_t write(parent);
+        internal_node_t *node = static_cast<internal_node_t *>(write.get_data_write());
+        rassert(node->npairs >= 3);
+        rassert(internal_node::get_pair_by_index(node, node->npairs - 1)->lnode
+                == left_id);
+        parent_separator.assign(
+            &internal_node::get_pair_by_index(node, node->npairs - 2)->key);
+        // `separator` is greater than every key in the node, so this removes the last
+        // pair and makes the one before it the special last pair.
+        internal_node::remove(block_size, node, separator);
+    }
+    parent->detach_child(left_id);
+
+    buf_lock_t sibling(superblock_->expose_buf(), alt_create_t::create);
+    {
+        buf_write_t write(&sibling);
+        internal_node_t *node = static_cast<internal_node_t *>(write.get_data_write());
+        internal_node::init(block_size, node);
+        DEBUG_VAR bool success
+            = internal_node::insert(node, separator, left_id, right_id);
+        rassert(success);
+    }
+    sibling.set_recency(timestamp_);
+
+    const block_id_t parent_id = parent->block_id();
+    const block_id_t sibling_id = sibling.block_id();
+    levels_[level] = std::move(sibling);
+    add_child(level + 1, parent_separator.btree_key(), parent_id, sibling_id);
+}
+
+void btree_bulk_loader_t::finish() {
+    // Update the stat block like `apply_keyvalue_change()` does.
+    const block_id_t stat_block_id = superblock_->get_stat_block_id();
+    if (appended_count_ != 0 && stat_block_id != NULL_BLOCK_ID) {
+        buf_lock_t stat_block(buf_parent_t(levels_[0].txn()),
+                              stat_block_id, access_t::write);
+        buf_write_t stat_block_write(&stat_block);
+        auto stat_block_buf = static_cast<btree_statblock_t *>(
+                stat_block_write.get_data_write(BTREE_STATBLOCK_SIZE));
+        stat_block_buf->population += appended_count_;
+    }
+    levels_.clear();
+    superblock_ = nullptr;
+}
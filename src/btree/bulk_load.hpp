@@ -0,0 +1,91 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef BTREE_BULK_LOAD_HPP_
+#define BTREE_BULK_LOAD_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "buffer_cache/alt.hpp"
+#include "repli_timestamp.hpp"
+
+class superblock_t;
+class value_deleter_t;
+class value_sizer_t;
+
+/* `btree_bulk_loader_t` appends key/value pairs to the right edge of a B-tree. Instead
+of walking down from the root and splitting leaves for every key, it packs the pairs
+into leaf nodes one after the other, and builds the internal nodes above them bottom-up
+as the leaves fill up. Every leaf and internal node is written once, and leaves end up
+full rather than half full.
+
+This only works if the keys are appended in ascending order, and if they are all greater
+than every key that is already in the tree (including deleted keys that still have a
+tombstone); use `can_append()` to check. That's always the case for an empty tree. The
+loader holds write locks on the right edge of the tree (and the caller must hold on to
+the superblock) until it's destroyed. */
+class btree_bulk_loader_t {
+public:
+    btree_bulk_loader_t(value_sizer_t *sizer,
+                        superblock_t *superblock,
+                        repli_timestamp_t timestamp);
+
+    // Returns true if `key` is greater than every key in the tree.
+    bool can_append(const btree_key_t *key) const;
+
+    // Like `can_append()`, but it can be called before creating a loader. It walks
+    // down the right edge of the tree with read locks and stops as soon as a node
+    // shows that `key` isn't greater than every key, which usually happens at the
+    // root. That way a batch that can't be appended doesn't have to wait for write
+    // locks on the right edge of the tree.
+    static bool may_append(value_sizer_t *sizer,
+                           superblock_t *superblock,
+                           const btree_key_t *key);
+
+    // The leaf node that the next value is going to be appended to (creating it if the
+    // tree is empty). Blobs that the value refers to should be created with this as
+    // their parent.
+    buf_parent_t leaf();
+
+    // Appends a pair to the tree. `can_append(key)` must be true. If the value doesn't
+    // fit into the current leaf anymore, it gets detached from it with `detacher` and
+    // goes into a new leaf.
+    void append(const btree_key_t *key,
+                const void *value,
+                const value_deleter_t *detacher);
+
+    // Updates the stat block and releases the tree. Nothing else may be called
+    // afterwards.
+    void finish();
+
+private:
+    // Replaces the full leaf with a new, empty right sibling.
+    void start_new_leaf();
+
+    // Adds `right_id` as the new rightmost child of the node at `level`, to the right
+    // of `left_id` (which is the node's current rightmost child). Keys that are less
+    // than or equal to `separator` belong to `left_id`.
+    void add_child(size_t level,
+                   const btree_key_t *separator,
+                   block_id_t left_id,
+                   block_id_t right_id);
+
+    value_sizer_t *const sizer_;
+    superblock_t *superblock_;
+    const repli_timestamp_t timestamp_;
+
+    // The right edge of the tree. `levels_[0]` is the rightmost leaf, and
+    // `levels_.back()` is the root. Empty if the tree is empty.
+    std::vector<buf_lock_t> levels_;
+
+    // The greatest key in the tree. Only meaningful if `has_last_key_` is true.
+    store_key_t last_key_;
+    bool has_last_key_;
+
+    int64_t appended_count_;
+
+    DISABLE_COPYING(btree_bulk_loader_t);
+};
+
+#endif  // BTREE_BULK_LOAD_HPP_
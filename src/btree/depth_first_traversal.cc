@@ -1,6 +1,8 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "btree/depth_first_traversal.hpp"
 
+#include <algorithm>
+
 #include "btree/internal_node.hpp"
 #include "btree/operations.hpp"
 #include "concurrency/interruptor.hpp"
@@ -17,7 +19,6 @@ scoped_key_value_t::scoped_key_value_t(scoped_key_value_t &&movee)
     : key_(movee.key_),
       value_(movee.value_),
       buf_(std::move(movee.buf_)) {
-    movee.key_ = nullptr;
     movee.value_ = nullptr;
 }
 
@@ -109,6 +110,9 @@ continue_bool_t btree_depth_first_traversal(
     }
 }
 
+// The most children of an internal node that we load ahead of the traversal.
+const int MAX_READ_AHEAD_CHILDREN = 16;
+
 void get_child_key_range(
         const internal_node_t *inode,
         int child_index,
@@ -180,8 +184,21 @@ continue_bool_t btree_depth_first_traversal(
             r.decrement();
             end_index = internal_node::get_offset_index(inode, r.btree_key()) + 1;
         }
-        for (int i = 0; i < end_index - start_index; ++i) {
-            int true_index = (direction == FORWARD ? start_index + i : (end_index - 1) - i);
+        const int num_children = end_index - start_index;
+        auto child_index = [&](int i) {
+            return direction == FORWARD ? start_index + i : (end_index - 1) - i;
+        };
+
+        // Once the traversal moves on from one child to the next, it's probably
+        // going to read the following ones too, so we start loading those in the
+        // background.  The read-ahead window doubles with every child, so that short
+        // scans don't load much that they don't need.  `next_read_ahead` is the first
+        // child (in traversal order) that we haven't loaded ahead yet.
+        int read_ahead_window = 0;
+        int next_read_ahead = 1;
+
+        for (int i = 0; i < num_children; ++i) {
+            int true_index = child_index(i);
             const btree_internal_pair *pair = internal_node::get_pair_by_index(inode, true_index);
 
             // Get the child key range
@@ -196,6 +213,20 @@ continue_bool_t btree_depth_first_traversal(
                 return continue_bool_t::ABORT;
             }
             if (!skip) {
+                if (i > 0) {
+                    read_ahead_window = std::min(std::max(1, 2 * read_ahead_window),
+                                                 MAX_READ_AHEAD_CHILDREN);
+                    const int read_ahead_end
+                        = std::min(i + 1 + read_ahead_window, num_children);
+                    for (next_read_ahead = std::max(next_read_ahead, i + 1);
+                         next_read_ahead < read_ahead_end;
+                         ++next_read_ahead) {
+                        block->lock.prefetch_child(
+                            internal_node::get_pair_by_index(
+                                inode, child_index(next_read_ahead))->lnode);
+                    }
+                }
+
                 counted_t<counted_buf_lock_and_read_t> lock;
                 {
                     PROFILE_STARTER_IF_ENABLED(
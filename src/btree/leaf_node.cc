@@ -81,6 +81,96 @@ const int SKIP_ENTRY_RESERVED = 251;
 // thorough.
 
 
+// Prefix-compressed leaf nodes store the longest prefix that all of their keys
+// have in common once, right after the header, and the keys in their entries
+// only contain what comes after it:
+//
+// [magic][num_pairs][live_size][frontmost][tstamp_cutpoint][prefix key][pad][off0][off1]...
+//
+// The prefix is stored like a btree key (a size byte followed by the
+// contents), padded with a zero byte to an even size so that the pair offsets
+// stay aligned.  We mark these nodes by setting the high bit of the last byte
+// of their magic, which never appears in the value-type-specific magics.
+// Nodes whose keys have no common prefix (including every node that was
+// written before we had prefix compression) don't have that bit set and keep
+// the original layout without a prefix record, so an empty prefix costs
+// nothing.
+//
+// Node-level operations (splitting, merging and leveling) may temporarily
+// shorten a node's prefix to that of its sibling so that entries can be moved
+// between the two nodes byte-for-byte, and grow the prefix again afterwards.
+
+const uint8_t PREFIX_COMPRESSED_MAGIC_BIT = 0x80;
+
+bool is_prefix_compressed(const leaf_node_t *node) {
+    return (node->magic.bytes[sizeof(node->magic.bytes) - 1]
+            & PREFIX_COMPRESSED_MAGIC_BIT) != 0;
+}
+
+block_magic_t prefix_compressed_magic(block_magic_t magic) {
+    char *last = &magic.bytes[sizeof(magic.bytes) - 1];
+    *last = static_cast<char>(*last | PREFIX_COMPRESSED_MAGIC_BIT);
+    return magic;
+}
+
+bool leaf_magic_matches(value_sizer_t *sizer, const leaf_node_t *node) {
+    return node->magic == sizer->btree_leaf_magic()
+        || node->magic == prefix_compressed_magic(sizer->btree_leaf_magic());
+}
+
+// The size of the prefix record for a prefix of `prefix_size` bytes, including
+// the padding.
+int prefix_record_size(int prefix_size) {
+    return (sizeof(uint8_t) + prefix_size + 1) & ~1;
+}
+
+const btree_key_t *get_prefix(const leaf_node_t *node) {
+    static const uint8_t empty_prefix = 0;
+    if (is_prefix_compressed(node)) {
+        return reinterpret_cast<const btree_key_t *>(
+            reinterpret_cast<const char *>(node) + offsetof(leaf_node_t, pair_offsets));
+    } else {
+        return reinterpret_cast<const btree_key_t *>(&empty_prefix);
+    }
+}
+
+int prefix_size(const leaf_node_t *node) {
+    return get_prefix(node)->size;
+}
+
+// The offset at which the pair offsets start, i.e. the size of the header
+// including the prefix record.
+int pair_offsets_offset(const leaf_node_t *node) {
+    return offsetof(leaf_node_t, pair_offsets)
+        + (is_prefix_compressed(node) ? prefix_record_size(prefix_size(node)) : 0);
+}
+
+const uint16_t *get_pair_offsets(const leaf_node_t *node) {
+    return reinterpret_cast<const uint16_t *>(
+        reinterpret_cast<const char *>(node) + pair_offsets_offset(node));
+}
+
+uint16_t *get_pair_offsets(leaf_node_t *node) {
+    return reinterpret_cast<uint16_t *>(
+        reinterpret_cast<char *>(node) + pair_offsets_offset(node));
+}
+
+// Returns the length of the longest common prefix of `left` and `right`.
+int common_prefix_size(const btree_key_t *left, const btree_key_t *right) {
+    int n = std::min(left->size, right->size);
+    int i = 0;
+    while (i < n && left->contents[i] == right->contents[i]) {
+        ++i;
+    }
+    return i;
+}
+
+bool has_prefix(const btree_key_t *key, const btree_key_t *prefix) {
+    return key->size >= prefix->size
+        && memcmp(key->contents, prefix->contents, prefix->size) == 0;
+}
+
+
 struct entry_t;
 struct value_t;
 
@@ -150,6 +240,81 @@ repli_timestamp_t get_timestamp(const leaf_node_t *node, int offset) {
     return *reinterpret_cast<const repli_timestamp_t *>(reinterpret_cast<const char *>(node) + offset);
 }
 
+// Entry keys only contain what comes after the node's prefix.  These return
+// or compare against the full key instead.
+
+void get_full_key(const leaf_node_t *node, const entry_t *ent, store_key_t *out) {
+    const btree_key_t *prefix = get_prefix(node);
+    const btree_key_t *suffix = entry_key(ent);
+    rassert(prefix->size + suffix->size <= MAX_KEY_SIZE);
+    out->set_size(prefix->size + suffix->size);
+    memcpy(out->contents(), prefix->contents, prefix->size);
+    memcpy(out->contents() + prefix->size, suffix->contents, suffix->size);
+}
+
+// Doesn't copy anything if the node's prefix is empty, in which case the
+// returned pointer points into the node rather than to `buf`.
+const btree_key_t *full_entry_key(const leaf_node_t *node, const entry_t *ent,
+                                  store_key_t *buf) {
+    if (prefix_size(node) == 0) {
+        return entry_key(ent);
+    }
+    get_full_key(node, ent, buf);
+    return buf->btree_key();
+}
+
+// Compares `key` with the full key of `ent`.
+int full_key_cmp(const leaf_node_t *node, const btree_key_t *key, const entry_t *ent) {
+    const btree_key_t *prefix = get_prefix(node);
+    const btree_key_t *suffix = entry_key(ent);
+    if (prefix->size != 0) {
+        int n = std::min(key->size, prefix->size);
+        int res = memcmp(key->contents, prefix->contents, n);
+        if (res != 0) {
+            return res;
+        }
+        if (key->size < prefix->size) {
+            return -1;
+        }
+    }
+    return sized_strcmp(key->contents + prefix->size, key->size - prefix->size,
+                        suffix->contents, suffix->size);
+}
+
+// Writes `key` without `node`'s prefix to `out` in the format of a btree key
+// and returns the number of bytes written.
+int write_key_suffix(const leaf_node_t *node, const btree_key_t *key, char *out) {
+    const int prefix_sz = prefix_size(node);
+    rassert(has_prefix(key, get_prefix(node)));
+    *reinterpret_cast<uint8_t *>(out) = key->size - prefix_sz;
+    memcpy(out + 1, key->contents + prefix_sz, key->size - prefix_sz);
+    return 1 + key->size - prefix_sz;
+}
+
+// Writes `ent`, an entry of `fro`, to `out` as an entry of `tow`, re-encoding
+// its key relative to tow's prefix.  Returns the size of the written entry.
+int copy_entry(value_sizer_t *sizer, const leaf_node_t *fro, const entry_t *ent,
+               const leaf_node_t *tow, char *out) {
+    if (prefix_size(fro) == prefix_size(tow)) {
+        rassert(prefix_size(fro) == 0 || has_prefix(get_prefix(fro), get_prefix(tow)));
+        int sz = entry_size(sizer, ent);
+        memmove(out, ent, sz);
+        return sz;
+    }
+    store_key_t key;
+    get_full_key(fro, ent, &key);
+    if (entry_is_live(ent)) {
+        int key_size = write_key_suffix(tow, key.btree_key(), out);
+        int value_size = sizer->size(entry_value(ent));
+        memcpy(out + key_size, entry_value(ent), value_size);
+        return key_size + value_size;
+    } else {
+        rassert(entry_is_deletion(ent));
+        *out = static_cast<char>(DELETE_ENTRY_CODE);
+        return 1 + write_key_suffix(tow, key.btree_key(), out + 1);
+    }
+}
+
 struct entry_iter_t {
     int offset;
 
@@ -194,16 +359,19 @@ std::string strprint_leaf(value_sizer_t *sizer, const leaf_node_t *node) {
     out += strprintf("Leaf(magic='%4.4s', num_pairs=%u, live_size=%u, frontmost=%u, tstamp_cutpoint=%u)\n",
             node->magic.bytes, node->num_pairs, node->live_size, node->frontmost, node->tstamp_cutpoint);
 
+    const btree_key_t *prefix = get_prefix(node);
+    out += strprintf("  Prefix: %.*s\n", static_cast<int>(prefix->size), prefix->contents);
+
     out += strprintf("  Offsets:");
     for (int i = 0; i < node->num_pairs; ++i) {
-        out += strprintf(" %d", node->pair_offsets[i]);
+        out += strprintf(" %d", get_pair_offsets(node)[i]);
     }
     out += strprintf("\n");
 
     out += strprintf("  By Key:");
     for (int i = 0; i < node->num_pairs; ++i) {
-        out += strprintf(" %d:", node->pair_offsets[i]);
-        strprint_entry(&out, sizer, get_entry(node, node->pair_offsets[i]));
+        out += strprintf(" %d:", get_pair_offsets(node)[i]);
+        strprint_entry(&out, sizer, get_entry(node, get_pair_offsets(node)[i]));
     }
     out += strprintf("\n");
 
@@ -247,17 +415,20 @@ void print(FILE *fp, value_sizer_t *sizer, const leaf_node_t *node) {
     fprintf(fp, "Leaf(magic='%4.4s', num_pairs=%u, live_size=%u, frontmost=%u, tstamp_cutpoint=%u)\n",
             node->magic.bytes, node->num_pairs, node->live_size, node->frontmost, node->tstamp_cutpoint);
 
+    const btree_key_t *prefix = get_prefix(node);
+    fprintf(fp, "  Prefix: %.*s\n", static_cast<int>(prefix->size), prefix->contents);
+
     fprintf(fp, "  Offsets:");
     for (int i = 0; i < node->num_pairs; ++i) {
-        fprintf(fp, " %d", node->pair_offsets[i]);
+        fprintf(fp, " %d", get_pair_offsets(node)[i]);
     }
     fprintf(fp, "\n");
     fflush(fp);
 
     fprintf(fp, "  By Key:");
     for (int i = 0; i < node->num_pairs; ++i) {
-        fprintf(fp, " %d:", node->pair_offsets[i]);
-        print_entry(fp, sizer, get_entry(node, node->pair_offsets[i]));
+        fprintf(fp, " %d:", get_pair_offsets(node)[i]);
+        print_entry(fp, sizer, get_entry(node, get_pair_offsets(node)[i]));
     }
     fprintf(fp, "\n");
 
@@ -306,12 +477,17 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
     // correct magic, that the keys are in order, that there are no
     // deletion entries after tstamp_cutpoint, and that
     // tstamp_cutpoint lies on an entry boundary, and that frontmost
-    // is not before the end of pair_offsets
+    // is not before the end of pair_offsets, and that the prefix together
+    // with any entry's key is not longer than a key may be
 
     // Basic sanity checks on fields' values.
-    if (failed(node->magic == sizer->btree_leaf_magic(),
+    if (failed(leaf_magic_matches(sizer, node),
                "bad leaf magic")
-        || failed(node->frontmost >= offsetof(leaf_node_t, pair_offsets) + node->num_pairs * sizeof(uint16_t),
+        || failed(prefix_size(node) <= MAX_KEY_SIZE,
+                  "prefix is too long")
+        || failed(!is_prefix_compressed(node) || prefix_size(node) > 0,
+                  "prefix-compressed node with an empty prefix")
+        || failed(node->frontmost >= pair_offsets_offset(node) + node->num_pairs * sizeof(uint16_t),
                   "frontmost offset is before the end of pair_offsets")
         || failed(node->live_size <= (sizer->block_size().value() - node->frontmost) + sizeof(uint16_t) * node->num_pairs,
                   "live_size is impossibly large")
@@ -325,7 +501,7 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
 
     // sizeof(offs) is guaranteed to be less than the block_size() thanks to assertions above.
     scoped_array_t<uint16_t> offs(node->num_pairs);
-    memcpy(offs.data(), node->pair_offsets, node->num_pairs * sizeof(uint16_t));
+    memcpy(offs.data(), get_pair_offsets(node), node->num_pairs * sizeof(uint16_t));
 
     std::sort(offs.data(), offs.data() + node->num_pairs);
 
@@ -372,17 +548,24 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
         }
 
         const entry_t *ent = get_entry(node, offset);
+        if (!entry_is_skip(ent)
+            && failed(prefix_size(node) + entry_key(ent)->size <= MAX_KEY_SIZE,
+                      "key is too long")) {
+            return false;
+        }
         if (entry_is_live(ent)) {
+            store_key_t key;
+            get_full_key(node, ent, &key);
             const void *value = entry_value(ent);
             int space = sizer->block_size().value() - (reinterpret_cast<const char *>(value) - reinterpret_cast<const char *>(node));
             if (!sizer->fits(value, space)) {
-                *msg_out = strprintf("problem with key %.*s: value does not fit\n", entry_key(ent)->size, entry_key(ent)->contents);
+                *msg_out = strprintf("problem with key %.*s: value does not fit\n", key.size(), key.contents());
                 return false;
             }
 
             std::string fscker_msg;
-            if (!fscker->fsck(sizer, entry_key(ent), value, &fscker_msg)) {
-                *msg_out = strprintf("Problem with key %.*s: %s\n", entry_key(ent)->size, entry_key(ent)->contents, fscker_msg.c_str());
+            if (!fscker->fsck(sizer, key.btree_key(), value, &fscker_msg)) {
+                *msg_out = strprintf("Problem with key %.*s: %s\n", key.size(), key.contents(), fscker_msg.c_str());
                 return false;
             }
 
@@ -419,9 +602,12 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
 
     // Entries look valid, check key ordering.
 
+    // We alternate between two buffers for the full keys.
+    store_key_t key_bufs[2];
     const btree_key_t *last = left_exclusive_or_null;
     for (int k = 0; k < node->num_pairs; ++k) {
-        const btree_key_t *key = entry_key(get_entry(node, node->pair_offsets[k]));
+        const btree_key_t *key = full_entry_key(
+            node, get_entry(node, get_pair_offsets(node)[k]), &key_bufs[k % 2]);
         if (failed(last == nullptr || btree_key_cmp(last, key) < 0,
                    "keys out of order")) {
             return false;
@@ -460,11 +646,36 @@ int free_space(value_sizer_t *sizer) {
     return sizer->block_size().value() - offsetof(leaf_node_t, pair_offsets);
 }
 
-// Returns the mandatory storage cost of the node, returning a value
-// in the closed interval [0, free_space(sizer)].  Outputs the offset
-// of the first entry for which storing a timestamp is not mandatory.
-int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_timestamps, int *tstamp_back_offset_out) {
-    int size = node->live_size;
+// The space that a prefix record of `prefix_size` bytes takes up in the node.
+int prefix_cost(int prefix_size) {
+    return prefix_size == 0 ? 0 : prefix_record_size(prefix_size);
+}
+
+int count_live_entries(const leaf_node_t *node) {
+    const uint16_t *offsets = get_pair_offsets(node);
+    int count = 0;
+    for (int i = 0; i < node->num_pairs; ++i) {
+        if (entry_is_live(get_entry(node, offsets[i]))) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Returns the mandatory storage cost the node would have if its keys were
+// stored relative to the first `new_prefix_size` bytes of its prefix (or of
+// its keys, if `new_prefix_size` is greater than the node's prefix size), the
+// cost of the prefix record included.  With a `new_prefix_size` of zero,
+// that's the cost of the node without any prefix compression.  Outputs the
+// offset of the first entry for which storing a timestamp is not mandatory.
+int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_timestamps, int new_prefix_size, int *tstamp_back_offset_out) {
+    // Every entry's key grows by this many bytes.
+    const int key_growth = prefix_size(node) - new_prefix_size;
+
+    int size = node->live_size + prefix_cost(new_prefix_size);
+    if (key_growth != 0) {
+        size += key_growth * count_live_entries(node);
+    }
 
     // node->live_size does not include deletion entries, deletion
     // entries' timestamps, and live entries' timestamps.  We add that
@@ -481,7 +692,7 @@ int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_t
                 break;
             }
 
-            int this_entry_cost = sizeof(uint16_t) + sizeof(repli_timestamp_t) + entry_size(sizer, ent);
+            int this_entry_cost = sizeof(uint16_t) + sizeof(repli_timestamp_t) + entry_size(sizer, ent) + key_growth;
             deletions_cost += this_entry_cost;
             size += this_entry_cost;
             ++count;
@@ -498,11 +709,31 @@ int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_t
     return size;
 }
 
+// Returns the mandatory storage cost of the node, returning a value
+// in the closed interval [0, free_space(sizer)].  Outputs the offset
+// of the first entry for which storing a timestamp is not mandatory.
+int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_timestamps, int *tstamp_back_offset_out) {
+    return mandatory_cost(sizer, node, required_timestamps, prefix_size(node),
+                          tstamp_back_offset_out);
+}
+
 int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_timestamps) {
     int ignored;
     return mandatory_cost(sizer, node, required_timestamps, &ignored);
 }
 
+// The mandatory storage cost of the node without prefix compression.  Decisions
+// about how to balance nodes are based on this rather than on the actual cost,
+// because a node's actual cost depends on which keys it ends up with.
+int uncompressed_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_timestamps, int *tstamp_back_offset_out) {
+    return mandatory_cost(sizer, node, required_timestamps, 0, tstamp_back_offset_out);
+}
+
+int uncompressed_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_timestamps) {
+    int ignored;
+    return uncompressed_cost(sizer, node, required_timestamps, &ignored);
+}
+
 int leaf_epsilon(value_sizer_t *sizer) {
     // Returns the maximum possible entry size, i.e. the key cost plus
     // the value cost plus pair_offsets plus timestamp cost.
@@ -521,6 +752,16 @@ bool is_empty(const leaf_node_t *node) {
     return node->num_pairs == 0;
 }
 
+// The size of the node's prefix once `key` has been inserted into it.  If the
+// key doesn't start with the current prefix, the prefix has to get shorter.
+// An empty node takes on the whole key as its prefix.
+int prefix_size_with_key(const leaf_node_t *node, const btree_key_t *key) {
+    if (node->num_pairs == 0) {
+        return key->size;
+    }
+    return common_prefix_size(get_prefix(node), key);
+}
+
 bool is_full(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, const void *value) {
 
     // Upon an insertion, we preserve `MANDATORY_TIMESTAMPS - 1`
@@ -534,13 +775,18 @@ bool is_full(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *k
     // be which allows us to get into a situation where is_full returns false
     // but when we call prepare_space_for_new_entry we fail with an insertion
     // because it doesn't actually fit.
-    int size = mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS);
+    //
+    // If the key doesn't share the node's prefix, all the other keys
+    // get longer too.
+    const int new_prefix_size = prefix_size_with_key(node, key);
+    int tstamp_back_offset;
+    int size = mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS, new_prefix_size, &tstamp_back_offset);
 
     // Add the space we'll need for the new key/value pair we would
     // insert.  We conservatively assume the key is not already
     // contained in the node.
 
-    size += sizeof(uint16_t) + sizeof(repli_timestamp_t) + key->full_size() + sizer->size(value);
+    size += sizeof(uint16_t) + sizeof(repli_timestamp_t) + key->full_size() - new_prefix_size + sizer->size(value);
 
     // The node is full if we can't fit all that data within the free space.
     return size > free_space(sizer);
@@ -561,8 +807,11 @@ bool is_underfull(value_sizer_t *sizer, const leaf_node_t *node) {
     // leaf_epsilon) / 2 - leaf_epsilon / 2.  Which is no less than is
     // free_space / 2 - leaf_epsilon.  We don't want an immediately
     // split node to be underfull, hence the threshold used below.
+    //
+    // We compare the cost without prefix compression, because that's what
+    // `split()` balances.
 
-    return mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS) < free_space(sizer) / 2 - leaf_epsilon(sizer);
+    return uncompressed_cost(sizer, node, MANDATORY_TIMESTAMPS) < free_space(sizer) / 2 - leaf_epsilon(sizer);
 }
 
 
@@ -592,7 +841,7 @@ void garbage_collect(
         indices[i] = i;
     }
 
-    std::sort(indices.data(), indices.data() + node->num_pairs, indirect_index_comparator_t(node->pair_offsets));
+    std::sort(indices.data(), indices.data() + node->num_pairs, indirect_index_comparator_t(get_pair_offsets(node)));
 
     int mand_offset;
     UNUSED int cost = mandatory_cost(sizer, node, num_tstamped, &mand_offset);
@@ -605,7 +854,7 @@ void garbage_collect(
     int w = sizer->block_size().value();
     int i = node->num_pairs - 1;
     for (; i >= 0; --i) {
-        int offset = node->pair_offsets[indices[i]];
+        int offset = get_pair_offsets(node)[indices[i]];
 
         if (offset < mand_offset) {
             break;
@@ -616,18 +865,18 @@ void garbage_collect(
             int sz = entry_size(sizer, ent);
             w -= sz;
             memmove(get_at_offset(node, w), ent, sz);
-            node->pair_offsets[indices[i]] = w;
+            get_pair_offsets(node)[indices[i]] = w;
         } else {
-            node->pair_offsets[indices[i]] = 0;
+            get_pair_offsets(node)[indices[i]] = 0;
         }
     }
 
-    // Either i < 0 or node->pair_offsets[indices[i]] < mand_offset.
+    // Either i < 0 or get_pair_offsets(node)[indices[i]] < mand_offset.
 
     node->tstamp_cutpoint = w;
 
     for (; i >= 0; --i) {
-        int offset = node->pair_offsets[indices[i]];
+        int offset = get_pair_offsets(node)[indices[i]];
         entry_t *ent = get_entry(node, offset);
         rassert(!entry_is_skip(ent));
 
@@ -637,7 +886,7 @@ void garbage_collect(
         w -= sz;
 
         memmove(get_at_offset(node, w), get_at_offset(node, offset), sz);
-        node->pair_offsets[indices[i]] = w;
+        get_pair_offsets(node)[indices[i]] = w;
     }
 
     node->frontmost = w;
@@ -649,8 +898,8 @@ void garbage_collect(
             *preserved_index = j;
         }
 
-        if (node->pair_offsets[k] != 0) {
-            node->pair_offsets[j] = node->pair_offsets[k];
+        if (get_pair_offsets(node)[k] != 0) {
+            get_pair_offsets(node)[j] = get_pair_offsets(node)[k];
 
             j += 1;
         }
@@ -671,6 +920,130 @@ void garbage_collect(value_sizer_t *sizer, leaf_node_t *node, int num_tstamped)
     rassert(ignore == 0);
 }
 
+// Stores the node's keys relative to `new_prefix` instead of its current
+// prefix.  Every key in the node must start with `new_prefix`, and the node
+// must fit with it (see `mandatory_cost()`).  Like `garbage_collect()`, this
+// compacts the entries and drops the timestamps and deletions that aren't
+// needed to keep `num_tstamped` timestamps.  Switches between the plain and the
+// prefix-compressed layout as needed.
+void set_prefix(value_sizer_t *sizer, leaf_node_t *node,
+                const btree_key_t *new_prefix, int num_tstamped) {
+    const int bs = sizer->block_size().value();
+    const int key_growth = prefix_size(node) - new_prefix->size;
+
+    int mand_offset;
+    DEBUG_VAR int cost = mandatory_cost(sizer, node, num_tstamped, new_prefix->size,
+                                        &mand_offset);
+    rassert(cost <= free_space(sizer));
+
+    // We go through the entries in the order of their offsets, so that the
+    // timestamped ones stay in front.
+    scoped_array_t<uint16_t> indices(node->num_pairs);
+    for (int i = 0; i < node->num_pairs; ++i) {
+        indices[i] = i;
+    }
+    const uint16_t *offsets = get_pair_offsets(node);
+    std::sort(indices.data(), indices.data() + node->num_pairs,
+              indirect_index_comparator_t(offsets));
+
+    // We build the new node in a separate buffer, since the entries might move
+    // in either direction.
+    scoped_array_t<char> buf(bs);
+    leaf_node_t *res = reinterpret_cast<leaf_node_t *>(buf.data());
+    if (new_prefix->size == 0) {
+        res->magic = sizer->btree_leaf_magic();
+    } else {
+        res->magic = prefix_compressed_magic(sizer->btree_leaf_magic());
+        char *prefix_record = buf.data() + offsetof(leaf_node_t, pair_offsets);
+        memset(prefix_record, 0, prefix_record_size(new_prefix->size));
+        memcpy(prefix_record, new_prefix, new_prefix->full_size());
+    }
+
+    int entries_size = 0;
+    for (int i = 0; i < node->num_pairs; ++i) {
+        int offset = offsets[indices[i]];
+        const entry_t *ent = get_entry(node, offset);
+        if (offset < mand_offset) {
+            entries_size += sizeof(repli_timestamp_t) + entry_size(sizer, ent) + key_growth;
+        } else if (entry_is_live(ent)) {
+            entries_size += entry_size(sizer, ent) + key_growth;
+        }
+    }
+
+    res->frontmost = bs - entries_size;
+    res->tstamp_cutpoint = bs;
+    res->live_size = 0;
+
+    // The new offsets, or zero for deletions that we drop.
+    scoped_array_t<uint16_t> new_offsets(node->num_pairs);
+    int w = res->frontmost;
+    for (int i = 0; i < node->num_pairs; ++i) {
+        int offset = offsets[indices[i]];
+        const entry_t *ent = get_entry(node, offset);
+        const bool has_tstamp = offset < mand_offset;
+        if (!has_tstamp && !entry_is_live(ent)) {
+            new_offsets[indices[i]] = 0;
+            continue;
+        }
+        if (!has_tstamp && res->tstamp_cutpoint == bs) {
+            res->tstamp_cutpoint = w;
+        }
+
+        new_offsets[indices[i]] = w;
+        if (has_tstamp) {
+            *reinterpret_cast<repli_timestamp_t *>(get_at_offset(res, w)) = get_timestamp(node, offset);
+            w += sizeof(repli_timestamp_t);
+        }
+
+        int sz = copy_entry(sizer, node, ent, res, get_at_offset(res, w));
+        if (entry_is_live(ent)) {
+            res->live_size += sizeof(uint16_t) + sz;
+        }
+        w += sz;
+    }
+    guarantee(w == bs);
+
+    uint16_t *res_offsets = get_pair_offsets(res);
+    int j = 0;
+    for (int k = 0; k < node->num_pairs; ++k) {
+        if (new_offsets[k] != 0) {
+            res_offsets[j] = new_offsets[k];
+            ++j;
+        }
+    }
+    res->num_pairs = j;
+    guarantee(pair_offsets_offset(res) + sizeof(uint16_t) * res->num_pairs <= res->frontmost);
+
+    memcpy(node, res, bs);
+
+    validate(sizer, node);
+}
+
+// Makes the node's prefix as long as its keys allow.  No keys have a longer
+// common prefix than the first and the last one.
+void grow_prefix(value_sizer_t *sizer, leaf_node_t *node) {
+    if (node->num_pairs == 0) {
+        return;
+    }
+    const uint16_t *offsets = get_pair_offsets(node);
+    store_key_t first, last;
+    get_full_key(node, get_entry(node, offsets[0]), &first);
+    get_full_key(node, get_entry(node, offsets[node->num_pairs - 1]), &last);
+    int new_prefix_size = common_prefix_size(first.btree_key(), last.btree_key());
+    if (new_prefix_size > prefix_size(node)) {
+        first.set_size(new_prefix_size);
+        set_prefix(sizer, node, first.btree_key(), MANDATORY_TIMESTAMPS);
+    }
+}
+
+// Makes sure that `node` has the given prefix, which all of its keys must
+// start with.
+void ensure_prefix(value_sizer_t *sizer, leaf_node_t *node, const btree_key_t *prefix) {
+    if (btree_key_cmp(get_prefix(node), prefix) != 0) {
+        set_prefix(sizer, node, prefix, MANDATORY_TIMESTAMPS);
+    }
+}
+
 void clean_entry(void *p, int sz) {
     rassert(sz > 0);
 
@@ -693,13 +1066,15 @@ void clean_entry(void *p, int sz) {
 }
 
 // Moves entries with pair_offsets indices in the clopen range [beg,
-// end) from fro to tow.
+// end) from fro to tow.  tow's prefix must be a prefix of fro's, and
+// `fro_copysize` must include the bytes that the moved keys grow by.
 void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
                    int wpoint, leaf_node_t *tow, int fro_copysize,
                    int fro_mand_offset,
                    std::vector<const void *> *moved_values_out) {
     rassert(is_underfull(sizer, tow));
     rassert(end >= beg);
+    rassert(has_prefix(get_prefix(fro), get_prefix(tow)));
 
     // This assertion is a bit loose.
     rassert(fro_copysize + mandatory_cost(sizer, tow, MANDATORY_TIMESTAMPS) <= free_space(sizer));
@@ -709,7 +1084,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
     garbage_collect(sizer, tow, MANDATORY_TIMESTAMPS, &wpoint);
 
     // Now resize and move tow's pair_offsets.
-    memmove(tow->pair_offsets + wpoint + (end - beg), tow->pair_offsets + wpoint, sizeof(uint16_t) * (tow->num_pairs - wpoint));
+    memmove(get_pair_offsets(tow) + wpoint + (end - beg), get_pair_offsets(tow) + wpoint, sizeof(uint16_t) * (tow->num_pairs - wpoint));
 
     tow->num_pairs += end - beg;
 
@@ -718,18 +1093,18 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
     // Now we're going to do something crazy.  Fill the new hole in
     // the pair offsets with the numbers in [0, end - beg).
     for (int i = 0; i < end - beg; ++i) {
-        tow->pair_offsets[wpoint + i] = i;
+        get_pair_offsets(tow)[wpoint + i] = i;
     }
 
     // We treat these numbers as indices into [beg, end) in fro, and
     // sort them so that we can access [beg, end) in order by
     // increasing offset.
-    std::sort(tow->pair_offsets + wpoint, tow->pair_offsets + wpoint + (end - beg), indirect_index_comparator_t(fro->pair_offsets + beg));
+    std::sort(get_pair_offsets(tow) + wpoint, get_pair_offsets(tow) + wpoint + (end - beg), indirect_index_comparator_t(get_pair_offsets(fro) + beg));
 
     int tow_offset = tow->frontmost;
 
     // The offset we read from (indirectly pointing to fro's [beg,
-    // end)) in tow->pair_offsets, and the offset at which we stop.
+    // end)) in get_pair_offsets(tow), and the offset at which we stop.
     int fro_index = wpoint;
     int fro_index_end = wpoint + (end - beg);
 
@@ -747,7 +1122,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
     int livesize = tow->live_size;
 
     for (int i = 0; i < wpoint; ++i) {
-        if (tow->pair_offsets[i] < tow->tstamp_cutpoint) {
+        if (get_pair_offsets(tow)[i] < tow->tstamp_cutpoint) {
             rassert(num_adjustable_tow_offsets < MANDATORY_TIMESTAMPS);
             adjustable_tow_offsets[num_adjustable_tow_offsets] = i;
             ++num_adjustable_tow_offsets;
@@ -755,7 +1130,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
     }
 
     for (int i = wpoint + (end - beg); i < tow->num_pairs; ++i) {
-        if (tow->pair_offsets[i] < tow->tstamp_cutpoint) {
+        if (get_pair_offsets(tow)[i] < tow->tstamp_cutpoint) {
             rassert(num_adjustable_tow_offsets < MANDATORY_TIMESTAMPS);
             adjustable_tow_offsets[num_adjustable_tow_offsets] = i;
             ++num_adjustable_tow_offsets;
@@ -771,7 +1146,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             break;
         }
 
-        int fro_offset = fro->pair_offsets[beg + tow->pair_offsets[fro_index]];
+        int fro_offset = get_pair_offsets(fro)[beg + get_pair_offsets(tow)[fro_index]];
 
         if (fro_offset >= fro_mand_offset) {
             // We have no more timestamped information to push.
@@ -785,11 +1160,14 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
         if (tow_tstamp < fro_tstamp) {
             entry_t *ent = get_entry(fro, fro_offset);
             int entsz = entry_size(sizer, ent);
-            int sz = sizeof(repli_timestamp_t) + entsz;
-            memmove(get_at_offset(tow, wri_offset), get_at_offset(fro, fro_offset), sz);
+            memmove(get_at_offset(tow, wri_offset), get_at_offset(fro, fro_offset),
+                    sizeof(repli_timestamp_t));
+            int towsz = copy_entry(sizer, fro, ent, tow,
+                                   get_at_offset(tow, wri_offset + sizeof(repli_timestamp_t)));
+            int sz = sizeof(repli_timestamp_t) + towsz;
 
             if (entry_is_live(ent)) {
-                livesize += entsz + sizeof(uint16_t);
+                livesize += towsz + sizeof(uint16_t);
                 fro_live_size_adjustment -= entsz + sizeof(uint16_t);
             }
 
@@ -798,7 +1176,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             // Update the pair offset in fro to be the offset in tow
             // -- we'll never use the old value again and we'll copy
             // the newer values to tow later.
-            fro->pair_offsets[beg + tow->pair_offsets[fro_index]] = wri_offset;
+            get_pair_offsets(fro)[beg + get_pair_offsets(tow)[fro_index]] = wri_offset;
 
             wri_offset += sz;
             actually_copied += sz;
@@ -812,8 +1190,8 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             int i;
             for (i = 0; i < num_adjustable_tow_offsets; ++i) {
                 int j = adjustable_tow_offsets[i];
-                if (tow->pair_offsets[j] == tow_offset) {
-                    tow->pair_offsets[j] = wri_offset;
+                if (get_pair_offsets(tow)[j] == tow_offset) {
+                    get_pair_offsets(tow)[j] = wri_offset;
                     break;
                 }
             }
@@ -830,25 +1208,25 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
 
     // Now we have some untimestamped entries to write.
     for (; fro_index < fro_index_end; ++fro_index) {
-        int fro_offset = fro->pair_offsets[beg + tow->pair_offsets[fro_index]];
+        int fro_offset = get_pair_offsets(fro)[beg + get_pair_offsets(tow)[fro_index]];
         entry_t *ent = get_entry(fro, fro_offset);
         if (entry_is_live(ent)) {
             int sz = entry_size(sizer, ent);
-            memmove(get_at_offset(tow, wri_offset), ent, sz);
+            int towsz = copy_entry(sizer, fro, ent, tow, get_at_offset(tow, wri_offset));
             clean_entry(ent, sz);
             fro_live_size_adjustment -= sz + sizeof(uint16_t);
 
-            fro->pair_offsets[beg + tow->pair_offsets[fro_index]] = wri_offset;
+            get_pair_offsets(fro)[beg + get_pair_offsets(tow)[fro_index]] = wri_offset;
 
-            wri_offset += sz;
-            livesize += sz + sizeof(uint16_t);
-            actually_copied += sz;
+            wri_offset += towsz;
+            livesize += towsz + sizeof(uint16_t);
+            actually_copied += towsz;
             rassert(wri_offset <= tow_offset);
         } else {
             rassert(entry_is_deletion(ent));
 
             // This is a dead entry.  We'll need to squash this dead entry later.
-            fro->pair_offsets[beg + tow->pair_offsets[fro_index]] = 0;
+            get_pair_offsets(fro)[beg + get_pair_offsets(tow)[fro_index]] = 0;
 
             int sz = entry_size(sizer, ent);
             clean_entry(ent, sz);
@@ -872,8 +1250,8 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             int i;
             for (i = 0; i < num_adjustable_tow_offsets; ++i) {
                 int j = adjustable_tow_offsets[i];
-                if (tow->pair_offsets[j] == tow_offset) {
-                    tow->pair_offsets[j] = wri_offset;
+                if (get_pair_offsets(tow)[j] == tow_offset) {
+                    get_pair_offsets(tow)[j] = wri_offset;
                     break;
                 }
             }
@@ -889,8 +1267,8 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             int i;
             for (i = 0; i < num_adjustable_tow_offsets; ++i) {
                 int j = adjustable_tow_offsets[i];
-                if (tow->pair_offsets[j] == tow_offset) {
-                    tow->pair_offsets[j] = 0;
+                if (get_pair_offsets(tow)[j] == tow_offset) {
+                    get_pair_offsets(tow)[j] = 0;
                 }
             }
         }
@@ -912,9 +1290,9 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
 
     // Copy the valid tow offsets from [beg, end) to the wpoint point
     // in tow, and move fro entries.
-    memcpy(tow->pair_offsets + wpoint, fro->pair_offsets + beg,
+    memcpy(get_pair_offsets(tow) + wpoint, get_pair_offsets(fro) + beg,
            sizeof(uint16_t) * (end - beg));
-    memmove(fro->pair_offsets + beg, fro->pair_offsets + end, sizeof(uint16_t) * (fro->num_pairs - end));
+    memmove(get_pair_offsets(fro) + beg, get_pair_offsets(fro) + end, sizeof(uint16_t) * (fro->num_pairs - end));
     fro->num_pairs -= end - beg;
 
     tow->frontmost = new_frontmost;
@@ -930,7 +1308,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
         moved_values_out->clear();
         moved_values_out->reserve(end - beg);
         for (int pair_idx = wpoint; pair_idx < wpoint + (end - beg); ++pair_idx) {
-            const int offset = tow->pair_offsets[pair_idx];
+            const int offset = get_pair_offsets(tow)[pair_idx];
             // Skip dead entries
             if (offset != 0) {
                 const entry_t *entry = get_entry(tow, offset);
@@ -947,8 +1325,8 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
         // for, and that we removed from tow, as well.
         int j, k;
         for (j = 0, k = 0; k < tow->num_pairs; ++k) {
-            if (tow->pair_offsets[k] != 0) {
-                tow->pair_offsets[j] = tow->pair_offsets[k];
+            if (get_pair_offsets(tow)[k] != 0) {
+                get_pair_offsets(tow)[j] = get_pair_offsets(tow)[k];
 
                 j += 1;
             }
@@ -961,8 +1339,13 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
 }
 
 void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_key_t *median_out) {
+    // We balance the costs without prefix compression, which don't depend on
+    // how the keys get distributed.  Each entry costs this much more than what
+    // it takes up in the node.
+    const int key_growth = prefix_size(node);
+
     int tstamp_back_offset;
-    int mandatory = mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS, &tstamp_back_offset);
+    int mandatory = uncompressed_cost(sizer, node, MANDATORY_TIMESTAMPS, &tstamp_back_offset);
 
     guarantee(mandatory >= free_space(sizer) - leaf_epsilon(sizer));
 
@@ -973,7 +1356,7 @@ void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_ke
     int prev_rcost = 0;
     int rcost = 0;
     while (i >= 0 && rcost < mandatory / 2) {
-        int offset = node->pair_offsets[i];
+        int offset = get_pair_offsets(node)[i];
         entry_t *ent = get_entry(node, offset);
 
         // We only take mandatory entries' costs into consideration,
@@ -984,7 +1367,7 @@ void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_ke
 
         if (entry_is_live(ent)) {
             prev_rcost = rcost;
-            rcost += entry_size(sizer, ent) + sizeof(uint16_t) + (offset < tstamp_back_offset ? sizeof(repli_timestamp_t) : 0);
+            rcost += entry_size(sizer, ent) + key_growth + sizeof(uint16_t) + (offset < tstamp_back_offset ? sizeof(repli_timestamp_t) : 0);
 
             ++num_mandatories;
         } else {
@@ -992,7 +1375,7 @@ void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_ke
 
             if (offset < tstamp_back_offset) {
                 prev_rcost = rcost;
-                rcost += entry_size(sizer, ent) + sizeof(uint16_t) + sizeof(repli_timestamp_t);
+                rcost += entry_size(sizer, ent) + key_growth + sizeof(uint16_t) + sizeof(repli_timestamp_t);
 
                 ++num_mandatories;
             }
@@ -1026,14 +1409,21 @@ void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_ke
     guarantee(mandatory - end_rcost >= free_space(sizer) / 2 - leaf_epsilon(sizer));
 
     // Now we wish to move the elements at indices [s, num_pairs) to rnode.
+    // They can be moved as they are if rnode has the same prefix.
 
     init(sizer, rnode);
+    ensure_prefix(sizer, rnode, get_prefix(node));
 
-    int node_copysize = end_rcost - num_mandatories * sizeof(uint16_t);
+    int node_copysize = end_rcost - num_mandatories * (sizeof(uint16_t) + key_growth);
     move_elements(sizer, node, s, node->num_pairs, 0, rnode, node_copysize,
                   tstamp_back_offset, nullptr);
 
-    keycpy(median_out, entry_key(get_entry(node, node->pair_offsets[s - 1])));
+    store_key_t median;
+    get_full_key(node, get_entry(node, get_pair_offsets(node)[s - 1]), &median);
+    keycpy(median_out, median.btree_key());
+
+    grow_prefix(sizer, node);
+    grow_prefix(sizer, rnode);
 }
 
 void merge(value_sizer_t *sizer, leaf_node_t *left, leaf_node_t *right) {
@@ -1042,22 +1432,56 @@ void merge(value_sizer_t *sizer, leaf_node_t *left, leaf_node_t *right) {
     rassert(is_underfull(sizer, left));
     rassert(is_underfull(sizer, right));
 
+    // Both nodes need the same prefix so that we can move the entries as they
+    // are.  Since they're both underfull even without prefix compression, they
+    // fit into one node with their common prefix.
+    {
+        store_key_t common_prefix(get_prefix(left));
+        common_prefix.set_size(common_prefix_size(get_prefix(left), get_prefix(right)));
+        ensure_prefix(sizer, left, common_prefix.btree_key());
+        ensure_prefix(sizer, right, common_prefix.btree_key());
+    }
+
     int tstamp_back_offset;
     int mandatory = mandatory_cost(sizer, left, MANDATORY_TIMESTAMPS, &tstamp_back_offset);
 
-    int left_copysize = mandatory;
+    // The prefix record stays behind.
+    int left_copysize = mandatory - prefix_cost(prefix_size(left));
     // Uncount the uint16_t cost of mandatory entries.  Sigh.
     // This includes deletion entries *before* the `tstamp_back_offset`, as well
     // as all non-deletion entries.
     for (int i = 0; i < left->num_pairs; ++i) {
-        if (left->pair_offsets[i] < tstamp_back_offset
-            || !entry_is_deletion(get_entry(left, left->pair_offsets[i]))) {
+        if (get_pair_offsets(left)[i] < tstamp_back_offset
+            || !entry_is_deletion(get_entry(left, get_pair_offsets(left)[i]))) {
             left_copysize -= sizeof(uint16_t);
         }
     }
 
     move_elements(sizer, left, 0, left->num_pairs, 0, right, left_copysize,
                   tstamp_back_offset, nullptr);
+
+    grow_prefix(sizer, right);
+}
+
+// Collects pointers to the values of the first `count` live entries of `node`
+// (or of the last `count` ones, if `from_back` is true).
+void collect_live_values(const leaf_node_t *node, size_t count, bool from_back,
+                         std::vector<const void *> *values_out) {
+    values_out->clear();
+    values_out->reserve(count);
+    const uint16_t *offsets = get_pair_offsets(node);
+    int i = from_back ? node->num_pairs - 1 : 0;
+    while (values_out->size() < count) {
+        guarantee(i >= 0 && i < node->num_pairs);
+        const entry_t *ent = get_entry(node, offsets[i]);
+        if (entry_is_live(ent)) {
+            values_out->push_back(entry_value(ent));
+        }
+        i += from_back ? -1 : 1;
+    }
+    if (from_back) {
+        std::reverse(values_out->begin(), values_out->end());
+    }
 }
 
 // We move keys out of sibling and into node.
@@ -1071,16 +1495,36 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
     rassert(is_underfull(sizer, node));
     rassert(!is_underfull(sizer, sibling));
 
+    // The entries that we move keep their keys relative to node's prefix, so
+    // node's prefix must be one of sibling's.  That's fine because node is
+    // underfull, so it fits with any prefix.  Sibling keeps its prefix, which
+    // might not fit with a shorter one.
+    store_key_t common_prefix(get_prefix(node));
+    common_prefix.set_size(common_prefix_size(get_prefix(node), get_prefix(sibling)));
+    if (node->num_pairs == 0) {
+        common_prefix.assign(get_prefix(sibling));
+    }
+    ensure_prefix(sizer, node, common_prefix.btree_key());
+
+    // Like `split()`, we balance the costs without prefix compression.
+    const int sibling_prefix_size = prefix_size(sibling);
+
     // First figure out the inclusive range [beg, end] of elements we want to move
     // from sibling.
     int beg, end, *w, wstep;
 
-    int node_weight = mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS);
+    int node_weight = uncompressed_cost(sizer, node, MANDATORY_TIMESTAMPS);
     int tstamp_back_offset;
-    int sibling_weight = mandatory_cost(sizer, sibling, MANDATORY_TIMESTAMPS,
-                                        &tstamp_back_offset);
+    int sibling_weight = uncompressed_cost(sizer, sibling, MANDATORY_TIMESTAMPS,
+                                           &tstamp_back_offset);
+
+    if (node_weight >= sibling_weight) {
+        grow_prefix(sizer, node);
+        return false;
+    }
 
-    guarantee(node_weight < sibling_weight);
+    // The actual cost of node, which must not exceed the free space.
+    int node_cost = mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS);
 
     if (nodecmp_node_with_sib < 0) {
         // node is to the left of sibling, so we want to move elements
@@ -1106,13 +1550,34 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
     int weight_movement = 0;
     int num_mandatories = 0;
     int prev_diff = sizer->block_size().value();  // some impossibly large value
+    bool node_is_full = false;
     for (;;) {
-        int offset = sibling->pair_offsets[*w];
+        int offset = get_pair_offsets(sibling)[*w];
         entry_t *ent = get_entry(sibling, offset);
 
         // We only take mandatory entries' costs into consideration.
+        int sz = 0;
         if (entry_is_live(ent)) {
-            int sz = entry_size(sizer, ent) + sizeof(uint16_t) + (offset < tstamp_back_offset ? sizeof(repli_timestamp_t) : 0);
+            sz = entry_size(sizer, ent) + sibling_prefix_size + sizeof(uint16_t) + (offset < tstamp_back_offset ? sizeof(repli_timestamp_t) : 0);
+        } else {
+            rassert(entry_is_deletion(ent));
+
+            if (offset < tstamp_back_offset) {
+                sz = entry_size(sizer, ent) + sibling_prefix_size + sizeof(uint16_t) + sizeof(repli_timestamp_t);
+            }
+        }
+
+        if (sz != 0) {
+            // With a lot of prefix compression in sibling, balancing the
+            // uncompressed costs could move more into node than it can hold.
+            const int node_sz = sz - common_prefix.size();
+            if (node_cost + node_sz > free_space(sizer)) {
+                *w -= wstep;
+                node_is_full = true;
+                break;
+            }
+            node_cost += node_sz;
+
             prev_diff = sibling_weight - node_weight;
             prev_weight_movement = weight_movement;
             weight_movement += sz;
@@ -1120,19 +1585,6 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
             sibling_weight -= sz;
 
             ++num_mandatories;
-        } else {
-            rassert(entry_is_deletion(ent));
-
-            if (offset < tstamp_back_offset) {
-                int sz = entry_size(sizer, ent) + sizeof(uint16_t) + sizeof(repli_timestamp_t);
-                prev_diff = sibling_weight - node_weight;
-                prev_weight_movement = weight_movement;
-                weight_movement += sz;
-                node_weight += sz;
-                sibling_weight -= sz;
-
-                ++num_mandatories;
-            }
         }
 
         if (end - beg == sibling->num_pairs - 1 || node_weight >= sibling_weight) {
@@ -1144,7 +1596,7 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
 
     guarantee(end - beg < sibling->num_pairs - 1);
 
-    if (prev_diff <= sibling_weight - node_weight) {
+    if (!node_is_full && prev_diff <= sibling_weight - node_weight) {
         *w -= wstep;
         --num_mandatories;
         weight_movement = prev_weight_movement;
@@ -1153,10 +1605,11 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
     if (end < beg) {
         // Alas, there is no actual leveling to do.
         guarantee(end + 1 == beg);
+        grow_prefix(sizer, node);
         return false;
     }
 
-    int sib_copysize = weight_movement - num_mandatories * sizeof(uint16_t);
+    int sib_copysize = weight_movement - num_mandatories * (sizeof(uint16_t) + common_prefix.size());
     move_elements(sizer, sibling, beg, end + 1,
                   nodecmp_node_with_sib < 0 ? node->num_pairs : 0, node,
                   sib_copysize, tstamp_back_offset, moved_values_out);
@@ -1164,10 +1617,22 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
     guarantee(node->num_pairs > 0);
     guarantee(sibling->num_pairs > 0);
 
+    store_key_t replacement_key;
     if (nodecmp_node_with_sib < 0) {
-        keycpy(replacement_key_out, entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1])));
+        get_full_key(node, get_entry(node, get_pair_offsets(node)[node->num_pairs - 1]), &replacement_key);
     } else {
-        keycpy(replacement_key_out, entry_key(get_entry(sibling, sibling->pair_offsets[sibling->num_pairs - 1])));
+        get_full_key(sibling, get_entry(sibling, get_pair_offsets(sibling)[sibling->num_pairs - 1]), &replacement_key);
+    }
+    keycpy(replacement_key_out, replacement_key.btree_key());
+
+    grow_prefix(sizer, sibling);
+    grow_prefix(sizer, node);
+    if (moved_values_out != nullptr) {
+        // Growing node's prefix moved its entries around.  The moved values
+        // are at node's end if it's to the left of sibling, at its front
+        // otherwise.
+        collect_live_values(node, moved_values_out->size(), nodecmp_node_with_sib < 0,
+                            moved_values_out);
     }
 
     return true;
@@ -1180,7 +1645,27 @@ bool is_mergable(value_sizer_t *sizer, const leaf_node_t *node, const leaf_node_
 // Sets *index_out to the index for the live entry or deletion entry
 // for the key, or to the index the key would have if it were
 // inserted.  Returns true if the key at said index is actually equal.
-bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
+template <bool check_first_byte>
+bool find_key_impl(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
+    // All of the node's keys start with its prefix, so we only need to compare
+    // `key` with the prefix once.  After that, we compare the rest of `key`
+    // with the keys in the entries.
+    const btree_key_t *prefix = get_prefix(node);
+    if (prefix->size != 0) {
+        int res = memcmp(key->contents, prefix->contents,
+                         std::min(key->size, prefix->size));
+        if (res == 0 && key->size < prefix->size) {
+            res = -1;
+        }
+        if (res != 0) {
+            *index_out = res < 0 ? 0 : node->num_pairs;
+            return false;
+        }
+    }
+    const uint8_t *suffix = key->contents + prefix->size;
+    const int suffix_size = key->size - prefix->size;
+    const uint16_t *offsets = get_pair_offsets(node);
+
     int beg = 0;
     int end = node->num_pairs;
 
@@ -1191,9 +1676,16 @@ bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
         // when (end - beg) > 0, (end - beg) / 2 is always less than (end - beg).  So beg <= test_point < end.
         int test_point = beg + (end - beg) / 2;
 
-        const btree_key_t *ek = entry_key(get_entry(node, node->pair_offsets[test_point]));
+        const btree_key_t *ek = entry_key(get_entry(node, offsets[test_point]));
 
-        int res = btree_key_cmp(key, ek);
+        // Most probes are decided by the first byte, so we check that before
+        // doing a full comparison.
+        int res;
+        if (check_first_byte && suffix_size != 0 && ek->size != 0 && suffix[0] != ek->contents[0]) {
+            res = suffix[0] < ek->contents[0] ? -1 : 1;
+        } else {
+            res = sized_strcmp(suffix, suffix_size, ek->contents, ek->size);
+        }
 
         if (res < 0) {
             // key < *test_point.
@@ -1215,10 +1707,19 @@ bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
     return false;
 }
 
+bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
+    return find_key_impl<true>(node, key, index_out);
+}
+
+bool find_key_full_compare(const leaf_node_t *node, const btree_key_t *key,
+                           int *index_out) {
+    return find_key_impl<false>(node, key, index_out);
+}
+
 bool lookup(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, void *value_out) {
     int index;
     if (find_key(node, key, &index)) {
-        const entry_t *ent = get_entry(node, node->pair_offsets[index]);
+        const entry_t *ent = get_entry(node, get_pair_offsets(node)[index]);
         if (entry_is_live(ent)) {
             const void *val = entry_value(ent);
             memcpy(value_out, val, sizer->size(val));
@@ -1237,11 +1738,13 @@ where the new entry should go. `prepare_space_for_new_entry()` takes care of
 updating `pair_offsets` and `num_pairs`, moving around other entries as needed
 to maintain timestamp ordering, putting a timestamp on the new entry if
 appropriate, and maintaining `frontmost` and `tstamp_cutpoint`. The caller is
-responsible for writing the actual entry itself (including the key) and for
-updating `live_size` if the newly created entry is live.
+responsible for writing the actual entry itself (including the key, without
+the node's prefix) and for updating `live_size` if the newly created entry is
+live. If `key` doesn't start with the node's prefix, the prefix gets shortened
+first.
 
-`new_entry_size` is the total size of the new entry, including key, value,
-and/or code byte, but not including repli timestamp.
+`non_key_size` is the size of the new entry apart from its key, i.e. the size of
+the value or of the code byte, but not including repli timestamp.
 
 It is an error to put a deletion entry after `tstamp_cutpoint`. If the caller
 intends to insert a deletion entry, it should pass `false` for
@@ -1255,7 +1758,7 @@ MUST_USE bool prepare_space_for_new_entry(
         value_sizer_t *sizer,
         leaf_node_t *node,
         const btree_key_t *key,
-        int new_entry_size,
+        int non_key_size,
         repli_timestamp_t tstamp,
         /* Used to derive the highest possible timestamp that non-timestamped
         entries might have. Usually the recency of the buf_t that node is in. */
@@ -1263,6 +1766,29 @@ MUST_USE bool prepare_space_for_new_entry(
         bool allow_after_tstamp_cutpoint,
         char **space_out) {
 
+    /* Keys are stored relative to the node's prefix, so if `key` doesn't start
+    with it, we have to shorten the prefix first. That makes the other entries
+    bigger, which `is_full()` takes into account. Like `garbage_collect()` below,
+    we only need to keep `MANDATORY_TIMESTAMPS - 1` timestamps. */
+    const int new_prefix_size = prefix_size_with_key(node, key);
+    if (new_prefix_size != prefix_size(node) || !has_prefix(key, get_prefix(node))) {
+        int tstamp_back_offset;
+        if (mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS - 1, new_prefix_size,
+                           &tstamp_back_offset) > free_space(sizer)) {
+            /* Deletions are written without checking `is_full()` first, so the
+            node might not even fit with the shorter prefix. Since `key` isn't
+            in the node, we recover like we do further down, by dropping all
+            existing timestamps and discarding the deletion entry. */
+            guarantee(!allow_after_tstamp_cutpoint);
+            erase_deletions(sizer, node, optional<repli_timestamp_t>());
+            return false;
+        }
+        const store_key_t new_prefix(new_prefix_size, key->contents);
+        set_prefix(sizer, node, new_prefix.btree_key(), MANDATORY_TIMESTAMPS - 1);
+    }
+
+    const int new_entry_size = non_key_size + key->full_size() - prefix_size(node);
+
     /* Get an upper bound for the timestamp cutoff point in case we later call
     `garbage_collect()`. We want to make sure that garbage collection cleans up
     *at least* as much space as it would clean up now. This is crucial, because
@@ -1288,7 +1814,7 @@ MUST_USE bool prepare_space_for_new_entry(
     bool found = find_key(node, key, &index);
 
     if (found) {
-        int offset = node->pair_offsets[index];
+        int offset = get_pair_offsets(node)[index];
         entry_t *ent = get_entry(node, offset);
 
         int sz = entry_size(sizer, ent);
@@ -1319,7 +1845,7 @@ MUST_USE bool prepare_space_for_new_entry(
     We check for this condition further down, and recover from it by dropping
     all existing timestamps and discarding the delete entry by returning `false`. */
 
-    if (offsetof(leaf_node_t, pair_offsets) +
+    if (pair_offsets_offset(node) +
             sizeof(uint16_t) * (node->num_pairs + (found ? 0 : 1)) +
             sizeof(repli_timestamp_t) +
             new_entry_size >
@@ -1329,8 +1855,8 @@ MUST_USE bool prepare_space_for_new_entry(
             /* We can't re-use an existing index if we're garbage collecting. */
             found = false;
             memmove(
-                node->pair_offsets + index,
-                node->pair_offsets + index + 1,
+                get_pair_offsets(node) + index,
+                get_pair_offsets(node) + index + 1,
                 sizeof(uint16_t) * (node->num_pairs - index - 1));
             --node->num_pairs;
         }
@@ -1398,7 +1924,7 @@ MUST_USE bool prepare_space_for_new_entry(
     bool drop_timestamps = false;
     if (actually_create_entry
         && !allow_after_tstamp_cutpoint
-        && offsetof(leaf_node_t, pair_offsets)
+        && pair_offsets_offset(node)
            + sizeof(uint16_t) * (node->num_pairs + (found ? 0 : 1))
            + new_entry_size
            + sizeof(repli_timestamp_t)
@@ -1413,8 +1939,8 @@ MUST_USE bool prepare_space_for_new_entry(
             a new one; close the gap in `pair_offsets`. `index` is the location
             of the open slot. */
             memmove(
-                node->pair_offsets + index,
-                node->pair_offsets + index + 1,
+                get_pair_offsets(node) + index,
+                get_pair_offsets(node) + index + 1,
                 sizeof(uint16_t) * (node->num_pairs - index - 1));
             --node->num_pairs;
         }
@@ -1433,8 +1959,8 @@ MUST_USE bool prepare_space_for_new_entry(
 
     if (!found) {
         memmove(
-            node->pair_offsets + index + 1,
-            node->pair_offsets + index,
+            get_pair_offsets(node) + index + 1,
+            get_pair_offsets(node) + index,
             sizeof(uint16_t) * (node->num_pairs - index));
         ++node->num_pairs;
     }
@@ -1459,14 +1985,14 @@ MUST_USE bool prepare_space_for_new_entry(
         the entries */
         for (int i = 0; i < node->num_pairs; ++i) {
             if (i == index) continue;
-            if (node->pair_offsets[i] < end_of_where_new_entry_should_go) {
-                node->pair_offsets[i] -= total_space_for_new_entry;
+            if (get_pair_offsets(node)[i] < end_of_where_new_entry_should_go) {
+                get_pair_offsets(node)[i] -= total_space_for_new_entry;
             }
         }
     }
 
     node->frontmost -= total_space_for_new_entry;
-    guarantee(offsetof(leaf_node_t, pair_offsets)
+    guarantee(pair_offsets_offset(node)
               + sizeof(uint16_t) * node->num_pairs <= node->frontmost);
 
     /* Write the timestamp if we need one, and update `node->tstamp_cutpoint` if
@@ -1482,7 +2008,7 @@ MUST_USE bool prepare_space_for_new_entry(
 
     /* Record the offset in `pair_offsets` */
 
-    node->pair_offsets[index] = start_of_where_new_entry_should_go;
+    get_pair_offsets(node)[index] = start_of_where_new_entry_should_go;
 
     /* Fill output variable */
 
@@ -1512,18 +2038,18 @@ void insert(
 
     char *location_to_write_data;
     bool should_write = prepare_space_for_new_entry(sizer, node,
-        key, key->full_size() + sizer->size(value), tstamp, maximum_existing_tstamp,
+        key, sizer->size(value), tstamp, maximum_existing_tstamp,
         true,
         &location_to_write_data);
     guarantee(should_write);
 
     /* Now copy the data into the node itself */
 
-    memcpy(location_to_write_data, key, key->full_size());
-    location_to_write_data += key->full_size();
+    int key_size = write_key_suffix(node, key, location_to_write_data);
+    location_to_write_data += key_size;
     memcpy(location_to_write_data, value, sizer->size(value));
 
-    node->live_size += sizeof(uint16_t) + key->full_size() + sizer->size(value);
+    node->live_size += sizeof(uint16_t) + key_size + sizer->size(value);
 
     validate(sizer, node);
 }
@@ -1543,14 +2069,14 @@ void remove(
     char *location_to_write_data;
     if (prepare_space_for_new_entry(sizer, node,
             key,
-            1 + key->full_size(),   /* 1 for `DELETE_ENTRY_CODE` */
+            1,   /* for `DELETE_ENTRY_CODE` */
             tstamp,
             maximum_existing_tstamp,
             false,
             &location_to_write_data)) {
         *location_to_write_data = static_cast<char>(DELETE_ENTRY_CODE);
         ++location_to_write_data;
-        memcpy(location_to_write_data, key, key->full_size());
+        write_key_suffix(node, key, location_to_write_data);
     }
 
     validate(sizer, node);
@@ -1561,7 +2087,7 @@ void erase_presence(value_sizer_t *sizer, leaf_node_t *node, const btree_key_t *
     int index;
     bool found = find_key(node, key, &index);
     if (found) {
-        int offset = node->pair_offsets[index];
+        int offset = get_pair_offsets(node)[index];
         entry_t *ent = get_entry(node, offset);
 
         int sz = entry_size(sizer, ent);
@@ -1571,7 +2097,7 @@ void erase_presence(value_sizer_t *sizer, leaf_node_t *node, const btree_key_t *
 
         clean_entry(ent, sz);
 
-        memmove(node->pair_offsets + index, node->pair_offsets + index + 1, (node->num_pairs - (index + 1)) * sizeof(uint16_t));
+        memmove(get_pair_offsets(node) + index, get_pair_offsets(node) + index + 1, (node->num_pairs - (index + 1)) * sizeof(uint16_t));
         node->num_pairs -= 1;
     }
 
@@ -1653,13 +2179,13 @@ void erase_deletions(
     int src = 0, dst = 0;
     int num_deleted = deletion_offsets.size();
     for (; src < node->num_pairs; ++src) {
-        uint16_t off = node->pair_offsets[src];
+        uint16_t off = get_pair_offsets(node)[src];
         auto it = deletion_offsets.find(off);
         if (it == deletion_offsets.end()) {
             if (off >= new_tstamp_cutpoint && off < old_tstamp_cutpoint) {
                 off += sizeof(repli_timestamp_t);
             }
-            node->pair_offsets[dst++] = off;
+            get_pair_offsets(node)[dst++] = off;
         } else {
             guarantee(off >= new_tstamp_cutpoint && off < old_tstamp_cutpoint);
             deletion_offsets.erase(it);
@@ -1685,6 +2211,7 @@ continue_bool_t visit_entries(
             const void *value   /* null for deletion */
             )> &cb) {
     repli_timestamp_t earliest_so_far = maximum_existing_timestamp;
+    store_key_t key_buf;
     for (entry_iter_t iter = entry_iter_t::make(node);
             !iter.done(sizer); iter.step(sizer, node)) {
         repli_timestamp_t tstamp;
@@ -1701,7 +2228,7 @@ continue_bool_t visit_entries(
             continue;
         }
 
-        if (continue_bool_t::ABORT == cb(entry_key(ent), tstamp, entry_value(ent))) {
+        if (continue_bool_t::ABORT == cb(full_entry_key(node, ent, &key_buf), tstamp, entry_value(ent))) {
             return continue_bool_t::ABORT;
         }
     }
@@ -1717,8 +2244,8 @@ iterator::iterator(const leaf_node_t *node, int index)
 std::pair<const btree_key_t *, const void *> iterator::operator*() const {
     guarantee(index_ < static_cast<int>(node_->num_pairs));
     guarantee(index_ >= 0);
-    const entry_t *entree = get_entry(node_, node_->pair_offsets[index_]);
-    return std::make_pair(entry_key(entree), entry_value(entree));
+    const entry_t *entree = get_entry(node_, get_pair_offsets(node_)[index_]);
+    return std::make_pair(full_entry_key(node_, entree, &key_), entry_value(entree));
 }
 
 iterator &iterator::operator++() {
@@ -1726,7 +2253,7 @@ iterator &iterator::operator++() {
               "Trying to increment past the end of an iterator.");
     do {
         ++index_;
-    } while (index_ < node_->num_pairs && !entry_is_live(get_entry(node_, node_->pair_offsets[index_])));
+    } while (index_ < node_->num_pairs && !entry_is_live(get_entry(node_, get_pair_offsets(node_)[index_])));
     return *this;
 }
 
@@ -1734,7 +2261,7 @@ iterator &iterator::operator--() {
     guarantee(index_ > -1, "Trying to decrement past the beginning of an iterator.");
     do {
         --index_;
-    } while (index_ >= 0 && !entry_is_live(get_entry(node_, node_->pair_offsets[index_])));
+    } while (index_ >= 0 && !entry_is_live(get_entry(node_, get_pair_offsets(node_)[index_])));
     return *this;
 }
 
@@ -1797,7 +2324,7 @@ leaf::iterator inclusive_lower_bound(const btree_key_t *key, const leaf_node_t &
     int index;
     leaf::find_key(&leaf_node, key, &index);
     if (index == leaf_node.num_pairs ||
-        entry_is_live(leaf::get_entry(&leaf_node, leaf_node.pair_offsets[index]))) {
+        entry_is_live(leaf::get_entry(&leaf_node, get_pair_offsets(&leaf_node)[index]))) {
         return leaf_node_t::iterator(&leaf_node, index);
     } else {
         return ++leaf_node_t::iterator(&leaf_node, index);
@@ -1808,10 +2335,9 @@ leaf::reverse_iterator exclusive_upper_bound(const btree_key_t *key, const leaf_
     int index;
     leaf::find_key(&leaf_node, key, &index);
     if (index < leaf_node.num_pairs) {
-        const leaf::entry_t *entry = leaf::get_entry(&leaf_node, leaf_node.pair_offsets[index]);
-        const btree_key_t *ekey = leaf::entry_key(entry);
+        const leaf::entry_t *entry = leaf::get_entry(&leaf_node, get_pair_offsets(&leaf_node)[index]);
         if (entry_is_live(entry) &&
-            btree_key_cmp(ekey, key) == 0) {
+            full_key_cmp(&leaf_node, key, entry) == 0) {
             // We have to skip this entry to make the iterator exclusive,
             // hence the ++.
             return ++leaf_node_t::reverse_iterator(&leaf_node, index);
@@ -7,12 +7,12 @@
 #include <vector>
 
 #include "arch/compiler.hpp"
+#include "btree/keys.hpp"
 #include "btree/types.hpp"
 #include "buffer_cache/types.hpp"
 #include "containers/optional.hpp"
 
 class value_sizer_t;
-struct btree_key_t;
 class repli_timestamp_t;
 
 // TODO: Could key_modification_proof_t not go in this file?
@@ -41,6 +41,7 @@ class reverse_iterator;
 ATTR_PACKED(struct leaf_node_t {
     // The value-type-specific magic value.  It's a bit of a hack, but
     // it's possible to construct a value_sizer_t based on this value.
+    // Prefix-compressed nodes have the high bit of its last byte set.
     block_magic_t magic;
 
     // The size of pair_offsets.
@@ -57,7 +58,8 @@ ATTR_PACKED(struct leaf_node_t {
     // The first offset whose entry is not accompanied by a timestamp.
     uint16_t tstamp_cutpoint;
 
-    // The pair offsets.
+    // The pair offsets.  In prefix-compressed nodes, the prefix that all
+    // keys in the node share comes first, and the pair offsets follow it.
     uint16_t pair_offsets[];
 
     //Iteration
@@ -143,6 +145,12 @@ bool is_mergable(value_sizer_t *sizer, const leaf_node_t *node, const leaf_node_
 
 bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out);
 
+// The same as `find_key()`, except that every probe does a full key comparison instead
+// of checking the first byte first. Only the tests in `unittest/leaf_node_test.cc` use
+// it, to measure what the first byte check gains.
+bool find_key_full_compare(const leaf_node_t *node, const btree_key_t *key,
+                           int *index_out);
+
 bool lookup(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, void *value_out);
 
 void insert(
@@ -186,7 +194,8 @@ void erase_deletions(
 
 /* Calls `cb` on every entry in the node, whether a real entry or a deletion. The calls
 will be in order from most recent to least recent. For entries with no timestamp, the
-callback will get `min_deletion_timestamp() - 1`. */
+callback will get `min_deletion_timestamp() - 1`. The key is only valid during the
+call. */
 continue_bool_t visit_entries(
     value_sizer_t *sizer,
     const leaf_node_t *node,
@@ -202,6 +211,9 @@ class iterator {
 public:
     iterator();
     iterator(const leaf_node_t *node, int index);
+    // The key might be assembled in the iterator itself (if the node has a
+    // non-empty prefix), so it's only valid until the iterator changes.  The
+    // value is valid as long as the node is.
     std::pair<const btree_key_t *, const void *> operator*() const;
     iterator &operator++();
     iterator &operator--();
@@ -216,6 +228,7 @@ private:
     int cmp(const iterator &other) const;
     const leaf_node_t *node_;
     int index_;
+    mutable store_key_t key_;
 };
 
 class reverse_iterator {
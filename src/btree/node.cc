@@ -9,19 +9,17 @@ const block_magic_t internal_node_t::expected_magic = { { 'i', 'n', 't', 'e' } }
 namespace node {
 
 bool is_underfull(value_sizer_t *sizer, const node_t *node) {
-    if (node->magic == sizer->btree_leaf_magic()) {
+    if (is_leaf(node)) {
         return leaf::is_underfull(sizer, reinterpret_cast<const leaf_node_t *>(node));
     } else {
-        rassert(is_internal(node));
         return internal_node::is_underfull(sizer->block_size(), reinterpret_cast<const internal_node_t *>(node));
     }
 }
 
 bool is_mergable(value_sizer_t *sizer, const node_t *node, const node_t *sibling, const internal_node_t *parent) {
-    if (sizer->btree_leaf_magic() == node->magic) {
+    if (is_leaf(node)) {
         return leaf::is_mergable(sizer, reinterpret_cast<const leaf_node_t *>(node), reinterpret_cast<const leaf_node_t *>(sibling));
     } else {
-        rassert(is_internal(node));
         return internal_node::is_mergable(sizer->block_size(), reinterpret_cast<const internal_node_t *>(node), reinterpret_cast<const internal_node_t *>(sibling), parent);
     }
 }
@@ -47,12 +45,11 @@ void merge(value_sizer_t *sizer, node_t *node, node_t *rnode, const internal_nod
 
 void validate(DEBUG_VAR value_sizer_t *sizer, DEBUG_VAR const node_t *node) {
 #ifndef NDEBUG
-    if (node->magic == sizer->btree_leaf_magic()) {
-        leaf::validate(sizer, reinterpret_cast<const leaf_node_t *>(node));
-    } else if (node->magic == internal_node_t::expected_magic) {
+    if (is_internal(node)) {
         internal_node::validate(sizer->block_size(), reinterpret_cast<const internal_node_t *>(node));
     } else {
-        unreachable("Invalid leaf node type.");
+        // This checks the magic, which also tells apart the leaf node formats.
+        leaf::validate(sizer, reinterpret_cast<const leaf_node_t *>(node));
     }
 #endif
 }
@@ -750,6 +750,12 @@ void buf_lock_t::detach_child(block_id_t child_id) {
             child_id);
 }
 
+bool buf_lock_t::prefetch_child(block_id_t child_id) {
+    ASSERT_FINITE_CORO_WAITING;
+    guarantee(!empty());
+    return cache()->page_cache_.prefetch_block(child_id, txn_->account());
+}
+
 repli_timestamp_t buf_lock_t::get_recency() const {
     guarantee(!empty());
     current_page_acq_t *cpa = current_page_acq();
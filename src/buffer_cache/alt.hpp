@@ -204,6 +204,10 @@ public:
 
     void detach_child(block_id_t child_id);
 
+    // Starts loading the child block `child_id` into the cache in the background,
+    // without acquiring it.  Returns true if that started a load.
+    bool prefetch_child(block_id_t child_id);
+
     block_id_t block_id() const {
         guarantee(txn_ != nullptr);
         return current_page_acq()->block_id();
@@ -24,8 +24,10 @@ alt_cache_balancer_t::cache_data_t::cache_data_t(alt::evicter_t *_evicter) :
     access_count(evicter->access_count()) { }
 
 alt_cache_balancer_t::alt_cache_balancer_t(
-        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable) :
+        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable,
+        cache_eviction_policy_t _eviction_policy) :
     total_cache_size_watchable(_total_cache_size_watchable),
+    eviction_policy_(_eviction_policy),
     rebalance_timer(make_scoped<repeating_timer_t>(rebalance_check_interval_ms, this)),
     rebalance_timer_state(rebalance_timer_state_t::normal),
     last_rebalance_time{0},
@@ -1,10 +1,13 @@
 #include "buffer_cache/evicter.hpp"
 
+#include <algorithm>
+
 #include "arch/runtime/coroutines.hpp"
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/page.hpp"
 #include "buffer_cache/page_cache.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "perfmon/perfmon.hpp"
 
 namespace alt {
 
@@ -14,9 +17,17 @@ evicter_t::evicter_t()
       balancer_(nullptr),
       balancer_notify_activity_boolean_(nullptr),
       throttler_(nullptr),
+      eviction_policy_(cache_eviction_policy_t::sampled_lru),
       bytes_loaded_counter_(0),
       access_count_counter_(0),
       access_time_counter_(INITIAL_ACCESS_TIME),
+      hit_count_(0),
+      miss_count_(0),
+      eviction_count_(0),
+      prefetch_count_(0),
+      prefetch_hit_count_(0),
+      unused_prefetch_count_(0),
+      miss_latency_(new perfmon_latency_histogram_t(secs_to_ticks(10))),
       evict_if_necessary_active_(false),
       last_force_flush_time_(ticks_t{0}) { }
 
@@ -37,7 +48,7 @@ void evicter_t::initialize(page_cache_t *page_cache,
     initialized_ = true;  // Can you really say this class is 'initialized_'?
     page_cache_ = page_cache;
     memory_limit_ = balancer->base_mem_per_store();
-    page_cache_ = page_cache;
+    eviction_policy_ = balancer->eviction_policy();
     throttler_ = throttler;
     balancer_ = balancer;
     balancer_notify_activity_boolean_
@@ -127,7 +138,8 @@ void evicter_t::add_to_evictable_unbacked(page_t *page) {
 
 void evicter_t::add_to_evictable_disk_backed(page_t *page) {
     guarantee_initialized();
-    evictable_disk_backed_.add(page, page->hypothetical_memory_usage(page_cache_));
+    evictable_disk_backed_category(page)->add(
+        page, page->hypothetical_memory_usage(page_cache_));
     evict_if_necessary();
     notify_bytes_loading(page->hypothetical_memory_usage(page_cache_));
 }
@@ -138,6 +150,7 @@ void evicter_t::move_unevictable_to_evictable(page_t *page) {
     unevictable_.remove(page, page->hypothetical_memory_usage(page_cache_));
     eviction_bag_t *new_bag = correct_eviction_category(page);
     rassert(new_bag == &evictable_disk_backed_
+            || new_bag == &evictable_disk_backed_repeated_
             || new_bag == &evictable_unbacked_);
     new_bag->add(page, page->hypothetical_memory_usage(page_cache_));
     evict_if_necessary();
@@ -160,12 +173,25 @@ eviction_bag_t *evicter_t::correct_eviction_category(page_t *page) {
     } else if (!page->is_loaded()) {
         return &evicted_;
     } else if (page->is_disk_backed()) {
-        return &evictable_disk_backed_;
+        return evictable_disk_backed_category(page);
     } else {
         return &evictable_unbacked_;
     }
 }
 
+eviction_bag_t *evicter_t::evictable_disk_backed_category(page_t *page) {
+    switch (eviction_policy_) {
+        case cache_eviction_policy_t::sampled_lru:
+            return &evictable_disk_backed_;
+        case cache_eviction_policy_t::two_queue:
+            return page->is_accessed_repeatedly()
+                ? &evictable_disk_backed_repeated_
+                : &evictable_disk_backed_;
+        default:
+            unreachable();
+    }
+}
+
 void evicter_t::remove_page(page_t *page) {
     guarantee_initialized();
     eviction_bag_t *bag = correct_eviction_category(page);
@@ -173,13 +199,46 @@ void evicter_t::remove_page(page_t *page) {
     evict_if_necessary();
 }
 
+// Prefetched pages that haven't been used yet may take up at most this fraction of
+// the cache's memory limit.  Otherwise a scan that stops early could push useful
+// pages out of a small cache.
+const uint64_t PREFETCH_MEMORY_FRACTION = 16;
+
+bool evicter_t::prefetch_budget_available() const {
+    guarantee_initialized();
+    return (unused_prefetch_count_ + 1) * page_cache_->max_block_size().ser_value()
+        <= memory_limit_ / PREFETCH_MEMORY_FRACTION;
+}
+
 uint64_t evicter_t::in_memory_size() const {
     guarantee_initialized();
     return unevictable_.size()
         + evictable_disk_backed_.size()
+        + evictable_disk_backed_repeated_.size()
         + evictable_unbacked_.size();
 }
 
+bool evicter_t::select_page_to_evict(eviction_bag_t **bag_out, page_t **page_out) {
+    // With the two_queue policy, pages that have been used only once get evicted
+    // first, as long as they take up more than a quarter of the memory limit.  (With
+    // sampled_lru, evictable_disk_backed_repeated_ is always empty.)
+    eviction_bag_t *first = &evictable_disk_backed_;
+    eviction_bag_t *second = &evictable_disk_backed_repeated_;
+    if (eviction_policy_ == cache_eviction_policy_t::two_queue
+        && evictable_disk_backed_.size() <= memory_limit_ / 4) {
+        std::swap(first, second);
+    }
+    if (eviction_bag_t::select_oldish(first, access_time_counter_, page_out)) {
+        *bag_out = first;
+        return true;
+    }
+    if (eviction_bag_t::select_oldish(second, access_time_counter_, page_out)) {
+        *bag_out = second;
+        return true;
+    }
+    return false;
+}
+
 void evicter_t::evict_if_necessary() THROWS_NOTHING {
     guarantee_initialized();
     if (evict_if_necessary_active_) {
@@ -195,13 +254,14 @@ void evicter_t::evict_if_necessary() THROWS_NOTHING {
     // currently being written for the purpose of eviction.
 
     evict_if_necessary_active_ = true;
+    eviction_bag_t *bag;
     page_t *page;
     while (in_memory_size() > memory_limit_
-           && eviction_bag_t::select_oldish(
-                &evictable_disk_backed_, access_time_counter_, &page)) {
+           && select_page_to_evict(&bag, &page)) {
         uint32_t mem_usage = page->hypothetical_memory_usage(page_cache_);
-        evictable_disk_backed_.remove(page, mem_usage);
+        bag->remove(page, mem_usage);
         evicted_.add(page, mem_usage);
+        ++eviction_count_;
         page->evict_self(page_cache_);
         page_cache_->consider_evicting_current_page(page->block_id());
     }
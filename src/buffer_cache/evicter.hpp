@@ -6,9 +6,12 @@
 #include <functional>
 
 #include "buffer_cache/eviction_bag.hpp"
+#include "buffer_cache/types.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/cache_line_padded.hpp"
 #include "concurrency/pubsub.hpp"
+#include "containers/scoped.hpp"
+#include "perfmon/types.hpp"
 #include "threading.hpp"
 #include "time.hpp"
 
@@ -66,7 +69,7 @@ public:
     }
     uint64_t evictable_disk_backed_size() const {
         guarantee_initialized();
-        return evictable_disk_backed_.size();
+        return evictable_disk_backed_.size() + evictable_disk_backed_repeated_.size();
     }
     uint64_t evictable_unbacked_size() const {
         guarantee_initialized();
@@ -78,6 +81,64 @@ public:
         return bytes_loaded_counter_;
     }
 
+    // Page acquisitions that found the page in memory, or had to wait for it to get
+    // loaded, and the number of pages evicted so far.
+    void count_hit() {
+        guarantee_initialized();
+        ++hit_count_;
+    }
+    void count_miss() {
+        guarantee_initialized();
+        ++miss_count_;
+    }
+    uint64_t hit_count() const {
+        guarantee_initialized();
+        return hit_count_;
+    }
+    uint64_t miss_count() const {
+        guarantee_initialized();
+        return miss_count_;
+    }
+    uint64_t eviction_count() const {
+        guarantee_initialized();
+        return eviction_count_;
+    }
+
+    // The time it takes to load a page from the serializer, from the cache's home
+    // thread.
+    perfmon_latency_histogram_t *miss_latency() {
+        return miss_latency_.get();
+    }
+
+    // Pages loaded by `page_cache_t::prefetch_block()`, those of them that got
+    // acquired afterwards, and those that got evicted or destroyed first.
+    void count_prefetch() {
+        guarantee_initialized();
+        ++prefetch_count_;
+        ++unused_prefetch_count_;
+    }
+    void count_prefetch_hit() {
+        guarantee_initialized();
+        ++prefetch_hit_count_;
+        --unused_prefetch_count_;
+    }
+    void count_wasted_prefetch() {
+        guarantee_initialized();
+        --unused_prefetch_count_;
+    }
+    uint64_t prefetch_count() const {
+        guarantee_initialized();
+        return prefetch_count_;
+    }
+    uint64_t prefetch_hit_count() const {
+        guarantee_initialized();
+        return prefetch_hit_count_;
+    }
+
+    // Returns true if we can prefetch another page without the prefetched pages
+    // that nobody has used yet taking up more than a fraction of the cache.
+    bool prefetch_budget_available() const;
+
 
     uint64_t in_memory_size() const;
 
@@ -96,6 +157,14 @@ private:
     // Tells the cache balancer about a page being loaded
     void notify_bytes_loading(int64_t ser_buf_change);
 
+    // The evictable disk backed bag the page belongs in, depending on the eviction
+    // policy.
+    eviction_bag_t *evictable_disk_backed_category(page_t *page);
+
+    // Picks the next page to evict, and the bag it's in.  Returns false if there are
+    // no evictable pages.
+    bool select_page_to_evict(eviction_bag_t **bag_out, page_t **page_out);
+
     // Evicts any evictable pages until under the memory limit
     void evict_if_necessary() THROWS_NOTHING;
 
@@ -108,6 +177,8 @@ private:
 
     uint64_t memory_limit_;
 
+    cache_eviction_policy_t eviction_policy_;
+
     // These are updated every time a page is loaded, created, or destroyed, and
     // cleared when cache memory limits are re-evaluated.  This value can go
     // negative, if you keep deleting blocks or suddenly drop a snapshot.
@@ -117,6 +188,15 @@ private:
     // This gets incremented every time a page is accessed.
     uint64_t access_time_counter_;
 
+    uint64_t hit_count_;
+    uint64_t miss_count_;
+    uint64_t eviction_count_;
+    uint64_t prefetch_count_;
+    uint64_t prefetch_hit_count_;
+    uint64_t unused_prefetch_count_;
+
+    scoped_ptr_t<perfmon_latency_histogram_t> miss_latency_;
+
     // This is set to true while `evict_if_necessary()` is active.
     // It avoids reentrant calls to that function.
     bool evict_if_necessary_active_;
@@ -124,6 +204,10 @@ private:
     // These track every page's eviction status.
     eviction_bag_t unevictable_;
     eviction_bag_t evictable_disk_backed_;
+    // Only used by the two_queue eviction policy, for pages that have been accessed
+    // repeatedly.  Everything else stays in `evictable_disk_backed_`, which then
+    // acts as the probationary queue.
+    eviction_bag_t evictable_disk_backed_repeated_;
     eviction_bag_t evictable_unbacked_;
     eviction_bag_t evicted_;
 
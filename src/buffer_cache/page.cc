@@ -2,6 +2,7 @@
 
 #include "arch/runtime/coroutines.hpp"
 #include "buffer_cache/page_cache.hpp"
+#include "perfmon/perfmon.hpp"
 #include "serializer/serializer.hpp"
 
 namespace alt {
@@ -56,6 +57,8 @@ page_t::page_t(block_id_t _block_id, page_cache_t *page_cache)
     : block_id_(_block_id),
       loader_(nullptr),
       access_time_(page_cache->evicter().next_access_time()),
+      accessed_repeatedly_(false),
+      prefetched_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_deferred_loaded(this);
 
@@ -70,6 +73,8 @@ page_t::page_t(block_id_t _block_id, page_cache_t *page_cache,
     : block_id_(_block_id),
       loader_(nullptr),
       access_time_(page_cache->evicter().next_access_time()),
+      accessed_repeatedly_(false),
+      prefetched_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
 
@@ -86,6 +91,8 @@ page_t::page_t(block_id_t _block_id, buf_ptr_t buf,
       loader_(nullptr),
       buf_(std::move(buf)),
       access_time_(page_cache->evicter().next_access_time()),
+      accessed_repeatedly_(false),
+      prefetched_(false),
       snapshot_refcount_(0) {
     rassert(buf_.has());
     page_cache->evicter().add_to_evictable_unbacked(this);
@@ -100,6 +107,8 @@ page_t::page_t(block_id_t _block_id,
       buf_(std::move(buf)),
       block_token_(_block_token),
       access_time_(READ_AHEAD_ACCESS_TIME),
+      accessed_repeatedly_(false),
+      prefetched_(false),
       snapshot_refcount_(0) {
     rassert(buf_.has());
     page_cache->evicter().add_to_evictable_disk_backed(this);
@@ -109,6 +118,8 @@ page_t::page_t(page_t *copyee, page_cache_t *page_cache, cache_account_t *accoun
     : block_id_(copyee->block_id_),
       loader_(nullptr),
       access_time_(page_cache->evicter().next_access_time()),
+      accessed_repeatedly_(false),
+      prefetched_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
     coro_t::spawn_now_dangerously(std::bind(&page_t::load_from_copyee,
@@ -261,6 +272,7 @@ void page_t::catch_up_with_deferred_load(
     // Before blocking, tell the evicter to put us in the right category.
     page_cache->evicter().catch_up_deferred_load(page);
 
+    const ticks_t start_time = get_ticks();
     buf_ptr_t buf;
     {
         serializer_t *const serializer = page_cache->serializer();
@@ -274,6 +286,7 @@ void page_t::catch_up_with_deferred_load(
         buf = serializer->block_read(block_token_ptr->token,
                                      account->get());
     }
+    page_cache->evicter().miss_latency()->record_since(start_time);
 
     ASSERT_FINITE_CORO_WAITING;
     if (our_loader.abandon_page()) {
@@ -346,6 +359,7 @@ void page_t::load_with_block_id(page_t *page, block_id_t block_id,
 
     auto_drainer_t::lock_t lock = page_cache->drainer_lock();
 
+    const ticks_t start_time = get_ticks();
     buf_ptr_t buf;
     counted_t<block_token_t> block_token;
 
@@ -357,6 +371,7 @@ void page_t::load_with_block_id(page_t *page, block_id_t block_id,
         buf = serializer->block_read(block_token,
                                      account->get());
     }
+    page_cache->evicter().miss_latency()->record_since(start_time);
 
     ASSERT_FINITE_CORO_WAITING;
     if (loader.abandon_page()) {
@@ -384,6 +399,7 @@ void page_t::remove_snapshotter(page_cache_t *page_cache) {
         // load_from_copyee.
         rassert(waiters_.empty());
 
+        forget_prefetch(page_cache);
         page_cache->evicter().remove_page(this);
         delete this;
     }
@@ -415,9 +431,25 @@ void page_t::add_waiter(page_acq_t *acq, cache_account_t *account) {
         = acq->page_cache()->evicter().correct_eviction_category(this);
     waiters_.push_front(acq);
     acq->page_cache()->evicter().change_to_correct_eviction_bag(old_bag, this);
+    // The first use of a prefetched page doesn't count as a repeated access either.
+    const bool was_prefetched = prefetched_;
+    if (prefetched_) {
+        prefetched_ = false;
+        acq->page_cache()->evicter().count_prefetch_hit();
+    }
     if (buf_.has()) {
+        // The first use of a read-ahead page doesn't count as a repeated access.
+        // We're in the unevictable bag now, so this doesn't affect which bag we
+        // belong in.
+        if (access_time_ != READ_AHEAD_ACCESS_TIME && !was_prefetched) {
+            accessed_repeatedly_ = true;
+        }
+        acq->page_cache()->evicter().count_hit();
         acq->buf_ready_signal_.pulse();
-    } else if (loader_ != nullptr) {
+        return;
+    }
+    acq->page_cache()->evicter().count_miss();
+    if (loader_ != nullptr) {
         loader_->added_waiter(acq->page_cache(), account);
     } else if (block_token_.has()) {
         coro_t::spawn_now_dangerously(std::bind(&page_t::load_using_block_token,
@@ -429,6 +461,34 @@ void page_t::add_waiter(page_acq_t *acq, cache_account_t *account) {
     }
 }
 
+bool page_t::prefetch(page_cache_t *page_cache, cache_account_t *account) {
+    if (buf_.has() || loader_ != nullptr || !block_token_.has()) {
+        return false;
+    }
+    // `load_using_block_token` moves us out of the evicted bag.
+    eviction_bag_t *old_bag = page_cache->evicter().correct_eviction_category(this);
+    coro_t::spawn_now_dangerously(std::bind(&page_t::load_using_block_token,
+                                            this,
+                                            page_cache,
+                                            account));
+    page_cache->evicter().change_to_correct_eviction_bag(old_bag, this);
+    mark_prefetched(page_cache);
+    return true;
+}
+
+void page_t::mark_prefetched(page_cache_t *page_cache) {
+    rassert(!prefetched_);
+    prefetched_ = true;
+    page_cache->evicter().count_prefetch();
+}
+
+void page_t::forget_prefetch(page_cache_t *page_cache) {
+    if (prefetched_) {
+        prefetched_ = false;
+        page_cache->evicter().count_wasted_prefetch();
+    }
+}
+
 // Unevicts page.
 void page_t::load_using_block_token(page_t *page, page_cache_t *page_cache,
                                     cache_account_t *account) {
@@ -445,6 +505,7 @@ void page_t::load_using_block_token(page_t *page, page_cache_t *page_cache,
     counted_t<block_token_t> block_token = page->block_token_;
     rassert(block_token.has());
 
+    const ticks_t start_time = get_ticks();
     buf_ptr_t buf;
     {
         serializer_t *const serializer = page_cache->serializer();
@@ -453,6 +514,7 @@ void page_t::load_using_block_token(page_t *page, page_cache_t *page_cache,
         buf = serializer->block_read(block_token,
                                      account->get());
     }
+    page_cache->evicter().miss_latency()->record_since(start_time);
 
     ASSERT_FINITE_CORO_WAITING;
     if (loader.abandon_page()) {
@@ -550,9 +612,10 @@ void page_t::remove_waiter(page_acq_t *acq) {
     rassert(snapshot_refcount_ > 0);
 }
 
-void page_t::evict_self(DEBUG_VAR page_cache_t *page_cache) {
+void page_t::evict_self(page_cache_t *page_cache) {
     // A page_t can only self-evict if it has a block token (for now).
     rassert(waiters_.empty());
+    forget_prefetch(page_cache);
     rassert(block_token_.has());
     rassert(buf_.has());
     rassert(block_token_->block_size() == buf_.block_size());
@@ -42,6 +42,12 @@ public:
     void add_waiter(page_acq_t *acq, cache_account_t *account);
     void remove_waiter(page_acq_t *acq);
 
+    // Starts loading an evicted page in the background, without waiting for it.
+    // Returns false if the page is already in memory or being loaded.
+    bool prefetch(page_cache_t *page_cache, cache_account_t *account);
+    // Marks a page that was just created (and started loading) for a prefetch.
+    void mark_prefetched(page_cache_t *page_cache);
+
     // These may not be called until the page_acq_t's buf_ready_signal is pulsed.
     void *get_page_buf(page_cache_t *page_cache);
     void reset_block_token(page_cache_t *page_cache);
@@ -56,6 +62,13 @@ public:
     uint32_t hypothetical_memory_usage(page_cache_t *page_cache) const;
     uint64_t access_time() const { return access_time_; }
 
+    // True if the page has been acquired again while it was loaded, i.e. it's
+    // not just being read once by a scan.
+    bool is_accessed_repeatedly() const { return accessed_repeatedly_; }
+
+    // True if the page was loaded by `prefetch()` and nobody has acquired it since.
+    bool is_prefetched() const { return prefetched_; }
+
     bool is_loading() const {
         return loader_ != nullptr && page_t::loader_is_loading(loader_);
     }
@@ -91,6 +104,9 @@ private:
 
     void pulse_waiters_or_make_evictable(page_cache_t *page_cache);
 
+    // Tells the evicter that a prefetched page goes away without having been used.
+    void forget_prefetch(page_cache_t *page_cache);
+
 
     static void finish_load_with_block_id(page_t *page, page_cache_t *page_cache,
                                           counted_t<block_token_t> block_token,
@@ -132,6 +148,14 @@ private:
 
     uint64_t access_time_;
 
+    // Set by add_waiter when the page was already in memory.  Used by the
+    // two_queue eviction policy.  Only changes while the page is in the unevictable
+    // bag, because that's where pages with waiters are.
+    bool accessed_repeatedly_;
+
+    // See `is_prefetched()`.
+    bool prefetched_;
+
     // How many page_ptr_t's point at this page, expecting nothing to modify it,
     // other than themselves.
     size_t snapshot_refcount_;
@@ -146,7 +170,9 @@ private:
     // if loader_ is non-null:  unevictable_
     // else if waiters_ is non-empty: unevictable_
     // else if buf_ is null: evicted_ (and block_token_ is non-null)
-    // else if block_token_ is non-null: evictable_disk_backed_
+    // else if block_token_ is non-null: evictable_disk_backed_ (or, with the
+    //     two_queue policy, evictable_disk_backed_repeated_ if
+    //     accessed_repeatedly_ is true)
     // else: evictable_unbacked_ (buf_ is non-null, block_token_ is null)
     //
     // So, when loader_, waiters_, buf_, or block_token_ is touched, we might
@@ -389,6 +389,34 @@ current_page_t *page_cache_t::page_for_block_id(block_id_t block_id) {
     return page_it->second;
 }
 
+bool page_cache_t::prefetch_block(block_id_t block_id, cache_account_t *account) {
+    assert_thread();
+    if (!evicter_.prefetch_budget_available()) {
+        return false;
+    }
+
+    auto page_it = current_pages_.find(block_id);
+    current_page_t *page;
+    if (page_it != current_pages_.end()) {
+        page = page_it->second;
+        if (page->is_deleted()) {
+            return false;
+        }
+    } else {
+        if (recency_for_block_id(block_id) == repli_timestamp_t::invalid) {
+            return false;
+        }
+        page = page_for_block_id(block_id);
+    }
+
+    if (page->prefetch(current_page_help_t(block_id, this), account)) {
+        return true;
+    }
+    // We might have created the current_page_t for nothing.
+    consider_evicting_current_page(block_id);
+    return false;
+}
+
 current_page_t *page_cache_t::page_for_new_block_id(
         block_type_t block_type,
         block_id_t *block_id_out) {
@@ -997,6 +1025,16 @@ void current_page_t::convert_from_serializer_if_necessary(current_page_help_t he
     }
 }
 
+bool current_page_t::prefetch(current_page_help_t help, cache_account_t *account) {
+    rassert(!is_deleted_);
+    if (!page_.has()) {
+        page_.init(new page_t(help.block_id, help.page_cache, account));
+        page_.get_page_for_read()->mark_prefetched(help.page_cache);
+        return true;
+    }
+    return page_.get_page_for_read()->prefetch(help.page_cache, account);
+}
+
 page_t *current_page_t::the_page_for_read(current_page_help_t help,
                                           cache_account_t *account) {
     guarantee(!is_deleted_);
@@ -105,6 +105,10 @@ public:
 
     bool should_be_evicted() const;
 
+    // Starts loading the page in the background if it isn't in memory or being
+    // loaded already.  Returns true if it started a load.
+    bool prefetch(current_page_help_t help, cache_account_t *account);
+
 private:
     // current_page_acq_t should not access our fields directly.
     friend class current_page_acq_t;
@@ -454,6 +458,13 @@ public:
     void end_read_txn(scoped_ptr_t<page_txn_t> txn);
 
     current_page_t *page_for_block_id(block_id_t block_id);
+
+    // Starts loading the block in the background, without acquiring it, so that
+    // acquiring it later is less likely to wait for the disk.  Returns true if that
+    // started a load.  Does nothing if the block isn't in use (which can happen if
+    // we got the block id from a snapshot), or if prefetched pages already take up
+    // their share of the cache.
+    bool prefetch_block(block_id_t block_id, cache_account_t *account);
     current_page_t *page_for_new_block_id(
         block_type_t block_type,
         block_id_t *block_id_out);
@@ -8,13 +8,30 @@ alt_cache_stats_t::alt_cache_stats_t(alt::page_cache_t *_page_cache,
     page_cache(_page_cache),
     cache_collection(),
     cache_membership(parent, &cache_collection, "cache"),
-    in_use_bytes(this),
+    in_use_bytes(this, &alt::evicter_t::in_memory_size),
     in_use_bytes_membership(&cache_collection,
                             &in_use_bytes, "in_use_bytes"),
+    hits_total(this, &alt::evicter_t::hit_count),
+    hits_total_membership(&cache_collection, &hits_total, "hits_total"),
+    misses_total(this, &alt::evicter_t::miss_count),
+    misses_total_membership(&cache_collection, &misses_total, "misses_total"),
+    evictions_total(this, &alt::evicter_t::eviction_count),
+    evictions_total_membership(&cache_collection,
+                               &evictions_total, "evictions_total"),
+    miss_latency_membership(&cache_collection,
+                            page_cache->evicter().miss_latency(), "miss_latency_ms"),
+    prefetches_total(this, &alt::evicter_t::prefetch_count),
+    prefetches_total_membership(&cache_collection,
+                                &prefetches_total, "prefetches_total"),
+    prefetch_hits_total(this, &alt::evicter_t::prefetch_hit_count),
+    prefetch_hits_total_membership(&cache_collection,
+                                   &prefetch_hits_total, "prefetch_hits_total"),
     cache_collection_membership(&cache_collection) { }
 
-alt_cache_stats_t::perfmon_value_t::perfmon_value_t(alt_cache_stats_t *_parent) :
-    parent(_parent) { }
+alt_cache_stats_t::perfmon_value_t::perfmon_value_t(
+        alt_cache_stats_t *_parent,
+        uint64_t (alt::evicter_t::*_getter)() const) :
+    parent(_parent), getter(_getter) { }
 
 void *alt_cache_stats_t::perfmon_value_t::begin_stats() {
     return new uint64_t;
@@ -23,7 +40,7 @@ void *alt_cache_stats_t::perfmon_value_t::begin_stats() {
 void alt_cache_stats_t::perfmon_value_t::visit_stats(void *ptr) {
     if (get_thread_id() == parent->home_thread()) {
         uint64_t *value = reinterpret_cast<uint64_t *>(ptr);
-        *value = parent->page_cache->evicter().in_memory_size();
+        *value = (parent->page_cache->evicter().*getter)();
     }
 }
 
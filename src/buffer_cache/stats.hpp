@@ -15,19 +15,38 @@ public:
     perfmon_collection_t cache_collection;
     perfmon_membership_t cache_membership;
 
+    // Reports a value of the cache's evicter, read on the cache's home thread.
     class perfmon_value_t : public perfmon_t {
     public:
-        explicit perfmon_value_t(alt_cache_stats_t *_parent);
+        perfmon_value_t(alt_cache_stats_t *_parent,
+                        uint64_t (alt::evicter_t::*_getter)() const);
         void *begin_stats();
         void visit_stats(void *);
         ql::datum_t end_stats(void *);
     private:
         alt_cache_stats_t *parent;
+        uint64_t (alt::evicter_t::*getter)() const;
         DISABLE_COPYING(perfmon_value_t);
     };
     perfmon_value_t in_use_bytes;
     perfmon_membership_t in_use_bytes_membership;
 
+    // Cumulative counts, for the cache's eviction policy.
+    perfmon_value_t hits_total;
+    perfmon_membership_t hits_total_membership;
+    perfmon_value_t misses_total;
+    perfmon_membership_t misses_total_membership;
+    perfmon_value_t evictions_total;
+    perfmon_membership_t evictions_total_membership;
+
+    perfmon_membership_t miss_latency_membership;
+
+    // Cumulative counts, for B-tree read-ahead.
+    perfmon_value_t prefetches_total;
+    perfmon_membership_t prefetches_total_membership;
+    perfmon_value_t prefetch_hits_total;
+    perfmon_membership_t prefetch_hits_total_membership;
+
 
     perfmon_multi_membership_t cache_collection_membership;
 };
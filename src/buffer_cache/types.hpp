@@ -14,6 +14,16 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(write_durability_t, int8_t,
                                       write_durability_t::SOFT,
                                       write_durability_t::HARD);
 
+// How the page cache picks the pages it evicts.  This is a per-server setting.
+enum class cache_eviction_policy_t {
+    // Evict the least recently used of a few randomly sampled pages.
+    sampled_lru,
+    // Like 2Q: pages that have only been used once (for example by a table scan)
+    // are kept apart from pages that have been used repeatedly, and get evicted
+    // first, so that scans don't flush the working set out of the cache.
+    two_queue
+};
+
 #define DEFAULT_FLUSH_INTERVAL 1000
 // Converting this value from millis to nanos is less than half of 2^63.
 #define NEVER_FLUSH_INTERVAL (0x100000000ll * 1000ll)
@@ -0,0 +1,143 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "client_protocol/cbor.hpp"
+
+#include "arch/runtime/coroutines.hpp"
+#include "client_protocol/json.hpp"
+#include "client_protocol/protocols.hpp"
+#include "concurrency/pmap.hpp"
+#include "rdb_protocol/cbor.hpp"
+#include "rdb_protocol/ql2proto.hpp"
+#include "rdb_protocol/query_params.hpp"
+#include "rdb_protocol/rdb_backtrace.hpp"
+#include "rdb_protocol/response.hpp"
+#include "rdb_protocol/term_storage.hpp"
+#include "utils.hpp"
+
+scoped_ptr_t<ql::query_params_t> cbor_protocol_t::parse_query(
+        tcp_conn_t *conn,
+        signal_t *interruptor,
+        ql::query_cache_t *query_cache) {
+    return json_protocol_t::parse_query(conn, interruptor, query_cache, &send_response);
+}
+
+void write_key(const char *key, chunked_string_buffer_t *out) {
+    ql::cbor::write_text(key, strlen(key), out);
+}
+
+// This mirrors `write_response_internal()` in `client_protocol/json.cc`.
+void write_cbor_response_internal(ql::response_t *response,
+                                  chunked_string_buffer_t *buffer_out,
+                                  bool throw_errors) {
+    size_t start_offset = buffer_out->GetSize();
+
+    try {
+        const bool has_error_type = response->type() == Response::RUNTIME_ERROR &&
+            response->error_type();
+        const bool has_notes = response->type() == Response::SUCCESS_PARTIAL ||
+            response->type() == Response::SUCCESS_SEQUENCE;
+        ql::cbor::write_map_head(
+            2
+            + (has_error_type ? 1 : 0)
+            + (response->backtrace() ? 1 : 0)
+            + (response->profile() ? 1 : 0)
+            + (has_notes ? 1 : 0),
+            buffer_out);
+
+        write_key("t", buffer_out);
+        ql::cbor::write_int(response->type(), buffer_out);
+        if (has_error_type) {
+            write_key("e", buffer_out);
+            ql::cbor::write_int(*response->error_type(), buffer_out);
+        }
+
+        write_key("r", buffer_out);
+        ql::cbor::write_array_head(response->data().size(), buffer_out);
+        const size_t PARALLELIZATION_THRESHOLD = 500;
+        if (response->data().size() > PARALLELIZATION_THRESHOLD) {
+            // We split the data into a few chunks per thread, and let the threads that
+            // aren't busy with other work steal them.
+            const int64_t CHUNKS_PER_THREAD = 4;
+            int64_t num_chunks =
+                CHUNKS_PER_THREAD * std::min<int64_t>(16, get_num_db_threads());
+            std::vector<chunked_string_buffer_t> buffers(num_chunks);
+
+            size_t per_chunk = response->data().size() / num_chunks;
+            stealable_pmap(num_chunks, [&](int64_t m) {
+                    size_t offset = per_chunk * m;
+                    size_t end = (m == num_chunks - 1) ?
+                        response->data().size() : (per_chunk * (m + 1));
+
+                    for (size_t i = offset; i < end; ++i) {
+                        const size_t YIELD_INTERVAL = 2000;
+                        if ((i + 1) % YIELD_INTERVAL == 0) {
+                            coro_t::yield();
+                        }
+                        response->data()[i].write_cbor(&buffers[m]);
+                    }
+                });
+
+            // Since CBOR arrays aren't delimited, the elements can just be appended.
+            for (auto &buffer : buffers) {
+                buffer_out->append(&buffer);
+            }
+        } else {
+            for (const auto &item : response->data()) {
+                item.write_cbor(buffer_out);
+            }
+        }
+        if (response->backtrace()) {
+            write_key("b", buffer_out);
+            response->backtrace()->write_cbor(buffer_out);
+        }
+        if (response->profile()) {
+            write_key("p", buffer_out);
+            response->profile()->write_cbor(buffer_out);
+        }
+        if (has_notes) {
+            write_key("n", buffer_out);
+            ql::cbor::write_array_head(response->notes().size(), buffer_out);
+            for (const auto &note : response->notes()) {
+                ql::cbor::write_int(note, buffer_out);
+            }
+        }
+    } catch (const ql::base_exc_t &ex) {
+        buffer_out->Pop(buffer_out->GetSize() - start_offset);
+        response->fill_error(Response::RUNTIME_ERROR, Response::QUERY_LOGIC,
+                             ex.what(), ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        write_cbor_response_internal(response, buffer_out, true);
+    } catch (const std::exception &ex) {
+        if (throw_errors) {
+            throw;
+        }
+
+        buffer_out->Pop(buffer_out->GetSize() - start_offset);
+        response->fill_error(Response::RUNTIME_ERROR, Response::INTERNAL,
+            strprintf("Internal error in cbor_protocol_t::write: %s", ex.what()),
+            ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        write_cbor_response_internal(response, buffer_out, true);
+    }
+}
+
+// Small wrapper - in debug mode we would rather crash than send the error back
+void cbor_protocol_t::write_response_to_buffer(ql::response_t *response,
+                                               chunked_string_buffer_t *buffer_out) {
+#ifdef NDEBUG
+    write_cbor_response_internal(response, buffer_out, false);
+#else
+    write_cbor_response_internal(response, buffer_out, true);
+#endif
+}
+
+void cbor_protocol_t::send_response(ql::response_t *response,
+                                    int64_t token,
+                                    tcp_conn_t *conn,
+                                    signal_t *interruptor) {
+    chunked_string_buffer_t buffer;
+    char *prefix = buffer.Push(wire_protocol_t::RESPONSE_PREFIX_SIZE);
+
+    write_response_to_buffer(response, &buffer);
+    if (!wire_protocol_t::send_response_buffer(
+            prefix, &buffer, response, token, conn, interruptor)) {
+        send_response(response, token, conn, interruptor);
+    }
+}
@@ -0,0 +1,38 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLIENT_PROTOCOL_CBOR_HPP_
+#define CLIENT_PROTOCOL_CBOR_HPP_
+
+#include <stdint.h>
+
+#include "arch/types.hpp"
+#include "containers/chunked_string_buffer.hpp"
+#include "containers/scoped.hpp"
+
+class signal_t;
+
+namespace ql {
+class response_t;
+class query_cache_t;
+class query_params_t;
+}
+
+// Clients can ask for this protocol during the handshake. Queries are still JSON, but
+// responses are encoded as CBOR (RFC 7049). The response is a map with the same keys
+// as a JSON response, but numbers don't have to be printed and parsed, and binary data
+// is sent as a byte string instead of as a base64-encoded pseudotype.
+class cbor_protocol_t {
+public:
+    static scoped_ptr_t<ql::query_params_t> parse_query(tcp_conn_t *conn,
+                                                        signal_t *interruptor,
+                                                        ql::query_cache_t *query_cache);
+
+    static void write_response_to_buffer(ql::response_t *response,
+                                         chunked_string_buffer_t *buffer_out);
+
+    static void send_response(ql::response_t *response,
+                              int64_t token,
+                              tcp_conn_t *conn,
+                              signal_t *interruptor);
+};
+
+#endif // CLIENT_PROTOCOL_CBOR_HPP_
@@ -7,7 +7,6 @@
 #include "concurrency/pmap.hpp"
 #include "containers/scoped.hpp"
 #include "rapidjson/document.h"
-#include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 #include "rdb_protocol/rdb_backtrace.hpp"
 #include "rdb_protocol/ql2proto.hpp"
@@ -49,6 +48,14 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
         tcp_conn_t *conn,
         signal_t *interruptor,
         ql::query_cache_t *query_cache) {
+    return parse_query(conn, interruptor, query_cache, &send_response);
+}
+
+scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
+        tcp_conn_t *conn,
+        signal_t *interruptor,
+        ql::query_cache_t *query_cache,
+        send_response_fn_t send_error) {
     int64_t token;
     uint32_t size;
     conn->read_buffered(&token, sizeof(token), interruptor);
@@ -75,7 +82,7 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
             conn->pop(size, &pop_interruptor);
         }
 
-        send_response(&error, token, conn, interruptor);
+        send_error(&error, token, conn, interruptor);
         throw tcp_conn_read_closed_exc_t();
     }
 
@@ -91,15 +98,15 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
         parse_query_from_buffer(std::move(data), 0, query_cache, token, &error);
 
     if (!res.has()) {
-        send_response(&error, token, conn, interruptor);
+        send_error(&error, token, conn, interruptor);
     }
     return res;
 }
 
 void write_response_internal(ql::response_t *response,
-                             rapidjson::StringBuffer *buffer_out,
+                             chunked_string_buffer_t *buffer_out,
                              bool throw_errors) {
-    rapidjson::Writer<rapidjson::StringBuffer> writer(*buffer_out);
+    rapidjson::Writer<chunked_string_buffer_t> writer(*buffer_out);
     size_t start_offset = buffer_out->GetSize();
 
     try {
@@ -116,37 +123,38 @@ void write_response_internal(ql::response_t *response,
         writer.StartArray();
         const size_t PARALLELIZATION_THRESHOLD = 500;
         if (response->data().size() > PARALLELIZATION_THRESHOLD) {
-            int64_t num_threads = std::min<int64_t>(16, get_num_db_threads());
-            int32_t thread_offset = get_thread_id().threadnum;
-            std::vector<rapidjson::StringBuffer> buffers(num_threads);
-
-            size_t per_thread = response->data().size() / num_threads;
-            pmap(num_threads, [&](int64_t m) {
-                    int32_t target_thread =
-                        (thread_offset + static_cast<int32_t>(m)) % get_num_db_threads();
-                    on_thread_t rethreader((threadnum_t(target_thread)));
-                    rapidjson::StringBuffer *thread_buffer = &buffers[m];
-                    rapidjson::Writer<rapidjson::StringBuffer>
-                        thread_writer(*thread_buffer);
-
-                    thread_writer.StartArray();
-                    size_t offset = per_thread * m;
-                    size_t end = (m == num_threads - 1) ?
-                        response->data().size() : (per_thread * (m + 1));
+            // We split the data into a few chunks per thread, and let the threads that
+            // aren't busy with other work steal them.
+            const int64_t CHUNKS_PER_THREAD = 4;
+            int64_t num_chunks =
+                CHUNKS_PER_THREAD * std::min<int64_t>(16, get_num_db_threads());
+            std::vector<chunked_string_buffer_t> buffers(num_chunks);
+
+            size_t per_chunk = response->data().size() / num_chunks;
+            stealable_pmap(num_chunks, [&](int64_t m) {
+                    chunked_string_buffer_t *chunk_buffer = &buffers[m];
+                    rapidjson::Writer<chunked_string_buffer_t>
+                        chunk_writer(*chunk_buffer);
+
+                    chunk_writer.StartArray();
+                    size_t offset = per_chunk * m;
+                    size_t end = (m == num_chunks - 1) ?
+                        response->data().size() : (per_chunk * (m + 1));
 
                     for (size_t i = offset; i < end; ++i) {
                         const size_t YIELD_INTERVAL = 2000;
                         if ((i + 1) % YIELD_INTERVAL == 0) {
                             coro_t::yield();
                         }
-                        response->data()[i].write_json(&thread_writer);
+                        response->data()[i].write_json(&chunk_writer);
                     }
 
-                    thread_writer.EndArray();
+                    chunk_writer.EndArray();
                 });
 
-            for (const auto &buffer : buffers) {
-                writer.SpliceArray(buffer);
+            // This moves the per-thread chunks over without copying them.
+            for (auto &buffer : buffers) {
+                writer.SpliceArray(&buffer);
             }
         } else {
             for (const auto &item : response->data()) {
@@ -193,7 +201,7 @@ void write_response_internal(ql::response_t *response,
 
 // Small wrapper - in debug mode we would rather crash than send the error back
 void json_protocol_t::write_response_to_buffer(ql::response_t *response,
-                                               rapidjson::StringBuffer *buffer_out) {
+                                               chunked_string_buffer_t *buffer_out) {
 #ifdef NDEBUG
     write_response_internal(response, buffer_out, false);
 #else
@@ -205,48 +213,15 @@ void json_protocol_t::send_response(ql::response_t *response,
                                     int64_t token,
                                     tcp_conn_t *conn,
                                     signal_t *interruptor) {
-    uint32_t data_size; // filled in below
-    const size_t prefix_size = sizeof(token) + sizeof(data_size);
-
-    // Reserve space for the token and the size
-    rapidjson::StringBuffer buffer;
-    buffer.Push(prefix_size);
+    // Reserve space for the token and the size. The response is written into a list
+    // of chunks that go out over the connection one by one, so a large response
+    // doesn't have to be copied into one contiguous buffer first.
+    chunked_string_buffer_t buffer;
+    char *prefix = buffer.Push(wire_protocol_t::RESPONSE_PREFIX_SIZE);
 
     write_response_to_buffer(response, &buffer);
-    int64_t payload_size = buffer.GetSize() - prefix_size;
-    guarantee(payload_size > 0);
-
-    static_assert(std::is_same<decltype(wire_protocol_t::TOO_LARGE_RESPONSE_SIZE),
-                               const uint32_t>::value,
-                  "The largest response must fit in 32 bits.");
-
-    if (payload_size >= wire_protocol_t::TOO_LARGE_RESPONSE_SIZE) {
-        response->fill_error(Response::RUNTIME_ERROR,
-                             Response::RESOURCE_LIMIT,
-                             wire_protocol_t::too_large_response_message(payload_size),
-                             ql::backtrace_registry_t::EMPTY_BACKTRACE);
+    if (!wire_protocol_t::send_response_buffer(
+            prefix, &buffer, response, token, conn, interruptor)) {
         send_response(response, token, conn, interruptor);
-        return;
     }
-
-    // Fill in the token and size
-    char *mutable_buffer = buffer.GetMutableBuffer();
-#ifdef __s390x__
-    token = __builtin_bswap64(token);
-#endif
-    for (size_t i = 0; i < sizeof(token); ++i) {
-        mutable_buffer[i] = reinterpret_cast<const char *>(&token)[i];
-    }
-
-    data_size = static_cast<uint32_t>(payload_size);
-#ifdef __s390x__
-    data_size = __builtin_bswap32(data_size);
-#endif
-    for (size_t i = 0; i < sizeof(data_size); ++i) {
-        mutable_buffer[i + sizeof(token)] =
-            reinterpret_cast<const char *>(&data_size)[i];
-    }
-
-    conn->write(buffer.GetString(), buffer.GetSize(), interruptor);
 }
-
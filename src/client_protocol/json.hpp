@@ -5,8 +5,8 @@
 #include <stdint.h>
 
 #include "arch/types.hpp"
+#include "containers/chunked_string_buffer.hpp"
 #include "containers/scoped.hpp"
-#include "rapidjson/stringbuffer.h"
 
 class signal_t;
 
@@ -29,9 +29,21 @@ public:
                                                         signal_t *interruptor,
                                                         ql::query_cache_t *query_cache);
 
+    typedef void (*send_response_fn_t)(ql::response_t *response,
+                                       int64_t token,
+                                       tcp_conn_t *conn,
+                                       signal_t *interruptor);
+
+    // Like `parse_query`, but sends errors back with `send_error`. This lets
+    // protocols that only change the format of the responses read JSON queries.
+    static scoped_ptr_t<ql::query_params_t> parse_query(tcp_conn_t *conn,
+                                                        signal_t *interruptor,
+                                                        ql::query_cache_t *query_cache,
+                                                        send_response_fn_t send_error);
+
     // Used by the HTTP ReQL server to write the query response into the HTTP response
     static void write_response_to_buffer(ql::response_t *response,
-                                         rapidjson::StringBuffer *buffer_out);
+                                         chunked_string_buffer_t *buffer_out);
 
     static void send_response(ql::response_t *response,
                               int64_t token,
@@ -3,6 +3,11 @@
 
 #include <limits>
 
+#include "arch/io/network.hpp"
+#include "containers/buffer_group.hpp"
+#include "rdb_protocol/ql2proto.hpp"
+#include "rdb_protocol/rdb_backtrace.hpp"
+#include "rdb_protocol/response.hpp"
 #include "utils.hpp"
 
 const uint32_t wire_protocol_t::HARD_LIMIT_TOO_LARGE_QUERY_SIZE = GIGABYTE;
@@ -23,3 +28,56 @@ std::string wire_protocol_t::too_large_response_message(size_t size) {
     return strprintf("Response size (%zu) greater than maximum (%" PRIu32 ").",
                      size, TOO_LARGE_RESPONSE_SIZE - 1);
 }
+
+bool wire_protocol_t::send_response_buffer(char *prefix,
+                                           chunked_string_buffer_t *buffer,
+                                           ql::response_t *response,
+                                           int64_t token,
+                                           tcp_conn_t *conn,
+                                           signal_t *interruptor) {
+    uint32_t data_size; // filled in below
+    static_assert(sizeof(token) + sizeof(data_size) == RESPONSE_PREFIX_SIZE,
+                  "The prefix consists of the token and the size.");
+
+    int64_t payload_size = buffer->GetSize() - RESPONSE_PREFIX_SIZE;
+    guarantee(payload_size > 0);
+
+    static_assert(std::is_same<decltype(TOO_LARGE_RESPONSE_SIZE),
+                               const uint32_t>::value,
+                  "The largest response must fit in 32 bits.");
+
+    if (payload_size >= TOO_LARGE_RESPONSE_SIZE) {
+        response->fill_error(Response::RUNTIME_ERROR,
+                             Response::RESOURCE_LIMIT,
+                             too_large_response_message(payload_size),
+                             ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        return false;
+    }
+
+    // Fill in the token and size
+#ifdef __s390x__
+    token = __builtin_bswap64(token);
+#endif
+    for (size_t i = 0; i < sizeof(token); ++i) {
+        prefix[i] = reinterpret_cast<const char *>(&token)[i];
+    }
+
+    data_size = static_cast<uint32_t>(payload_size);
+#ifdef __s390x__
+    data_size = __builtin_bswap32(data_size);
+#endif
+    for (size_t i = 0; i < sizeof(data_size); ++i) {
+        prefix[i + sizeof(token)] =
+            reinterpret_cast<const char *>(&data_size)[i];
+    }
+
+    // `write()` sends each chunk straight from our memory, without copying it into
+    // the connection's write buffers.
+    const_buffer_group_t chunks;
+    buffer->get_chunks(&chunks);
+    for (size_t i = 0; i < chunks.num_buffers(); ++i) {
+        const const_buffer_group_t::buffer_t chunk = chunks.get_buffer(i);
+        conn->write(chunk.data, chunk.size, interruptor);
+    }
+    return true;
+}
@@ -6,8 +6,18 @@
 
 #include <string>
 
+#include "arch/types.hpp"
+
 // Include all available wire protocols
+#include "client_protocol/cbor.hpp"
 #include "client_protocol/json.hpp"
+#include "containers/chunked_string_buffer.hpp"
+
+class signal_t;
+
+namespace ql {
+class response_t;
+}
 
 // Contains common declarations used by all wire protocols, this is a class rather than
 // a namespace so we don't have to extern stuff.
@@ -21,6 +31,20 @@ public:
     static const std::string unparseable_query_message;
     static std::string too_large_query_message(uint32_t size);
     static std::string too_large_response_message(size_t size);
+
+    // Every response is preceded by the query's token and the size of the response.
+    static const size_t RESPONSE_PREFIX_SIZE = sizeof(int64_t) + sizeof(uint32_t);
+
+    // `buffer` must start with `RESPONSE_PREFIX_SIZE` bytes at `prefix`, followed by
+    // the serialized `response`. This fills in the prefix and sends the buffer. If the
+    // response is too large, nothing is sent, `response` is replaced by an error and
+    // this returns `false`, so that the caller can send the error instead.
+    static bool send_response_buffer(char *prefix,
+                                     chunked_string_buffer_t *buffer,
+                                     ql::response_t *response,
+                                     int64_t token,
+                                     tcp_conn_t *conn,
+                                     signal_t *interruptor);
 };
 
 #endif // CLIENT_PROTOCOL_PROTOCOLS_HPP_
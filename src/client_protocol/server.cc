@@ -272,6 +272,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
     }
 
     uint8_t version = 0;
+    bool cbor_responses = false;
     std::unique_ptr<auth::base_authenticator_t> authenticator;
     uint32_t error_code = 0;
     std::string error_message;
@@ -410,12 +411,33 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                         5, "Expected a string for `authentication`.");
                 }
 
+                // The optional `response_format` lets the client ask for CBOR instead
+                // of JSON responses. We echo it back, so that the client can tell
+                // whether the server understood it; older servers ignore it.
+                ql::datum_t response_format =
+                    datum.get_field("response_format", ql::NOTHROW);
+                if (response_format.has()) {
+                    if (response_format.get_type() != ql::datum_t::R_STR) {
+                        throw client_protocol::client_server_error_t(
+                            23, "Expected a string for `response_format`.");
+                    }
+                    if (response_format.as_str() == "cbor") {
+                        cbor_responses = true;
+                    } else if (response_format.as_str() != "json") {
+                        throw client_protocol::client_server_error_t(
+                            24, "Unsupported `response_format`.");
+                    }
+                }
+
                 ql::datum_object_builder_t datum_object_builder;
                 datum_object_builder.overwrite("success", ql::datum_t::boolean(true));
                 datum_object_builder.overwrite(
                     "authentication",
                     ql::datum_t(
                         authenticator->next_message(authentication.as_str().to_std())));
+                if (response_format.has()) {
+                    datum_object_builder.overwrite("response_format", response_format);
+                }
 
                 write_datum(
                     conn.get(),
@@ -459,13 +481,18 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                 : ql::return_empty_normal_batches_t::NO,
             auth::user_context_t(authenticator->get_authenticated_username()));
 
-        connection_loop<json_protocol_t>(
-            conn.get(),
-            (version < 4)
-                ? 1
-                : 1024,
-            &query_cache,
-            &ct_keepalive);
+        if (cbor_responses) {
+            connection_loop<cbor_protocol_t>(
+                conn.get(), 1024, &query_cache, &ct_keepalive);
+        } else {
+            connection_loop<json_protocol_t>(
+                conn.get(),
+                (version < 4)
+                    ? 1
+                    : 1024,
+                &query_cache,
+                &ct_keepalive);
+        }
     } catch (client_protocol::client_server_error_t const &error) {
         // We can't write the response here due to coroutine switching inside an
         // exception handler
@@ -749,7 +776,7 @@ void query_server_t::handle(const http_req_t &req,
         }
     }
 
-    rapidjson::StringBuffer buffer;
+    chunked_string_buffer_t buffer;
     json_protocol_t::write_response_to_buffer(&response, &buffer);
 
     uint32_t size = static_cast<uint32_t>(buffer.GetSize());
@@ -764,7 +791,7 @@ void query_server_t::handle(const http_req_t &req,
     std::string body_data;
     body_data.reserve(sizeof(header_buffer) + buffer.GetSize());
     body_data.append(&header_buffer[0], sizeof(header_buffer));
-    body_data.append(buffer.GetString(), buffer.GetSize());
+    buffer.append_to(&body_data);
     result->set_body("application/octet-stream", body_data);
     result->code = http_status_code_t::OK;
 }
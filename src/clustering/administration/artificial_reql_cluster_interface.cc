@@ -107,6 +107,8 @@ bool artificial_reql_cluster_interface_t::table_create(
         const table_generate_config_params_t &config_params,
         const std::string &primary_key,
         write_durability_t durability,
+        uint64_t block_size,
+        block_compression_t block_compression,
         signal_t *interruptor,
         ql::datum_t *result_out,
         admin_err_t *error_out) {
@@ -124,6 +126,8 @@ bool artificial_reql_cluster_interface_t::table_create(
         config_params,
         primary_key,
         durability,
+        block_size,
+        block_compression,
         interruptor,
         result_out,
         error_out);
@@ -852,4 +856,13 @@ artificial_reql_cluster_backends_t::artificial_reql_cluster_backends_t(
         artificial_reql_cluster_interface->get_table_backends_map_mutable(),
         name_string_t::guarantee_valid("_debug_table_status"),
         std::make_pair(debug_table_status_backend.get(), debug_table_status_backend.get()));
+
+    debug_profiler_backend.init(
+        new debug_profiler_artificial_table_backend_t(
+            rdb_context,
+            name_resolver));
+    debug_profiler_sentry = backend_sentry_t(
+        artificial_reql_cluster_interface->get_table_backends_map_mutable(),
+        name_string_t::guarantee_valid("_debug_profiler"),
+        std::make_pair(debug_profiler_backend.get(), debug_profiler_backend.get()));
 }
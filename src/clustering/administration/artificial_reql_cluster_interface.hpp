@@ -7,6 +7,7 @@
 #include <string>
 
 #include "clustering/administration/cluster_config.hpp"
+#include "clustering/administration/debug_profiler.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/servers/server_config.hpp"
 #include "clustering/administration/servers/server_status.hpp"
@@ -85,6 +86,8 @@ public:
             const table_generate_config_params_t &config_params,
             const std::string &primary_key,
             write_durability_t durability,
+            uint64_t block_size,
+            block_compression_t block_compression,
             signal_t *interruptor,
             ql::datum_t *result_out,
             admin_err_t *error_out);
@@ -348,6 +351,9 @@ private:
     scoped_ptr_t<debug_table_status_artificial_table_backend_t>
         debug_table_status_backend;
     backend_sentry_t debug_table_status_sentry;
+
+    scoped_ptr_t<debug_profiler_artificial_table_backend_t> debug_profiler_backend;
+    backend_sentry_t debug_profiler_sentry;
 };
 
 #endif /* CLUSTERING_ADMINISTRATION_ARTIFICIAL_REQL_CLUSTER_INTERFACE_HPP_ */
@@ -0,0 +1,151 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/debug_profiler.hpp"
+
+#include "arch/runtime/sampling_profiler.hpp"
+#include "clustering/administration/admin_op_exc.hpp"
+#include "clustering/administration/datum_adapter.hpp"
+
+// Above this the profiler isn't low-overhead anymore.
+const uint32_t MAX_PROFILER_SAMPLES_PER_SEC = 1000;
+const uint32_t DEFAULT_PROFILER_SAMPLES_PER_SEC = 100;
+
+const char *const PROFILER_ROW_ID = "sampling_profiler";
+
+debug_profiler_artificial_table_backend_t::debug_profiler_artificial_table_backend_t(
+        rdb_context_t *rdb_context,
+        lifetime_t<name_resolver_t const &> name_resolver)
+    : caching_cfeed_artificial_table_backend_t(
+        name_string_t::guarantee_valid("_debug_profiler"), rdb_context, name_resolver),
+      samples_per_sec(DEFAULT_PROFILER_SAMPLES_PER_SEC) { }
+
+debug_profiler_artificial_table_backend_t::~debug_profiler_artificial_table_backend_t() {
+    begin_changefeed_destruction();
+}
+
+std::string debug_profiler_artificial_table_backend_t::get_primary_key_name() {
+    return "id";
+}
+
+bool debug_profiler_artificial_table_backend_t::read_all_rows_as_vector(
+        UNUSED auth::user_context_t const &user_context,
+        UNUSED signal_t *interruptor,
+        std::vector<ql::datum_t> *rows_out,
+        UNUSED admin_err_t *error_out) {
+    rows_out->clear();
+    rows_out->push_back(format_row());
+    return true;
+}
+
+bool debug_profiler_artificial_table_backend_t::read_row(
+        UNUSED auth::user_context_t const &user_context,
+        ql::datum_t primary_key,
+        UNUSED signal_t *interruptor,
+        ql::datum_t *row_out,
+        UNUSED admin_err_t *error_out) {
+    if (primary_key.get_type() != ql::datum_t::R_STR
+            || primary_key.as_str() != PROFILER_ROW_ID) {
+        *row_out = ql::datum_t();
+        return true;
+    }
+    *row_out = format_row();
+    return true;
+}
+
+bool debug_profiler_artificial_table_backend_t::write_row(
+        UNUSED auth::user_context_t const &user_context,
+        ql::datum_t primary_key,
+        UNUSED bool pkey_was_autogenerated,
+        ql::datum_t *new_value_inout,
+        UNUSED signal_t *interruptor,
+        admin_err_t *error_out) {
+    if (!new_value_inout->has()) {
+        *error_out = admin_err_t{
+            "It's illegal to delete rows from the `rethinkdb._debug_profiler` table.",
+            query_state_t::FAILED};
+        return false;
+    }
+    if (primary_key.get_type() != ql::datum_t::R_STR
+            || primary_key.as_str() != PROFILER_ROW_ID) {
+        *error_out = admin_err_t{
+            "It's illegal to insert new rows into the `rethinkdb._debug_profiler` "
+            "table.", query_state_t::FAILED};
+        return false;
+    }
+
+    converter_from_datum_object_t converter;
+    admin_err_t dummy_error;
+    if (!converter.init(*new_value_inout, &dummy_error)) {
+        crash("artificial_table_t should guarantee input is an object");
+    }
+    ql::datum_t dummy_pkey;
+    if (!converter.get("id", &dummy_pkey, &dummy_error)) {
+        crash("artificial_table_t should guarantee primary key is present and correct");
+    }
+
+    ql::datum_t enabled_datum;
+    if (!converter.get("enabled", &enabled_datum, error_out)) {
+        return false;
+    }
+    if (enabled_datum.get_type() != ql::datum_t::R_BOOL) {
+        *error_out = admin_err_t{
+            "Expected a boolean; got " + enabled_datum.print(),
+            query_state_t::FAILED};
+        return false;
+    }
+
+    ql::datum_t samples_per_sec_datum;
+    if (!converter.get("samples_per_sec", &samples_per_sec_datum, error_out)) {
+        return false;
+    }
+    if (samples_per_sec_datum.get_type() != ql::datum_t::R_NUM
+            || samples_per_sec_datum.as_num() < 1
+            || samples_per_sec_datum.as_num() > MAX_PROFILER_SAMPLES_PER_SEC
+            || samples_per_sec_datum.as_num()
+                != static_cast<uint32_t>(samples_per_sec_datum.as_num())) {
+        *error_out = admin_err_t{
+            strprintf("Expected an integer between 1 and %" PRIu32 "; got %s",
+                      MAX_PROFILER_SAMPLES_PER_SEC,
+                      samples_per_sec_datum.print().c_str()),
+            query_state_t::FAILED};
+        return false;
+    }
+
+    // Setting the number of samples to 0 discards the samples. Other values are
+    // ignored instead of making `update()` fail, because the number keeps changing
+    // while the profiler is on.
+    ql::datum_t samples_datum;
+    converter.get_optional("samples", &samples_datum);
+    const bool clear_samples = samples_datum.has()
+        && samples_datum.get_type() == ql::datum_t::R_NUM
+        && samples_datum.as_num() == 0;
+
+    if (!converter.check_no_extra_keys(error_out)) {
+        return false;
+    }
+
+    {
+        on_thread_t thread_switcher(home_thread());
+        samples_per_sec = static_cast<uint32_t>(samples_per_sec_datum.as_num());
+        sampling_profiler_t::get_global_profiler().set_samples_per_sec(
+            enabled_datum.as_bool() ? samples_per_sec : 0);
+        if (clear_samples) {
+            sampling_profiler_t::get_global_profiler().clear();
+        }
+        notify_row(ql::datum_t(PROFILER_ROW_ID));
+    }
+    return true;
+}
+
+ql::datum_t debug_profiler_artificial_table_backend_t::format_row() {
+    on_thread_t thread_switcher(home_thread());
+    sampling_profiler_t *profiler = &sampling_profiler_t::get_global_profiler();
+    ql::datum_object_builder_t obj_builder;
+    obj_builder.overwrite("id", ql::datum_t(PROFILER_ROW_ID));
+    obj_builder.overwrite("enabled",
+        ql::datum_t::boolean(profiler->get_samples_per_sec() != 0));
+    obj_builder.overwrite("samples_per_sec",
+        ql::datum_t(static_cast<double>(samples_per_sec)));
+    obj_builder.overwrite("samples",
+        ql::datum_t(static_cast<double>(profiler->get_num_samples())));
+    return std::move(obj_builder).to_datum();
+}
@@ -0,0 +1,60 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_DEBUG_PROFILER_HPP_
+#define CLUSTERING_ADMINISTRATION_DEBUG_PROFILER_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "rdb_protocol/artificial_table/caching_cfeed_backend.hpp"
+
+/* The `rethinkdb._debug_profiler` table controls the `sampling_profiler_t` of the server
+that the query is run on. It has a single row with the format
+`{"id": "sampling_profiler", "enabled": ..., "samples_per_sec": ..., "samples": ...}`,
+where `samples` is the number of samples that have been taken since the profiler was
+last turned on. Writing 0 to `samples` discards the samples, and other values are
+ignored. The samples themselves are served as folded stacks by the `/ajax/profiler`
+route of the same server's web UI. */
+
+class debug_profiler_artificial_table_backend_t :
+    public caching_cfeed_artificial_table_backend_t
+{
+public:
+    debug_profiler_artificial_table_backend_t(
+            rdb_context_t *rdb_context,
+            lifetime_t<name_resolver_t const &> name_resolver);
+    ~debug_profiler_artificial_table_backend_t();
+
+    std::string get_primary_key_name();
+
+    bool read_all_rows_as_vector(
+            auth::user_context_t const &user_context,
+            signal_t *interruptor,
+            std::vector<ql::datum_t> *rows_out,
+            admin_err_t *error_out);
+
+    bool read_row(
+            auth::user_context_t const &user_context,
+            ql::datum_t primary_key,
+            signal_t *interruptor,
+            ql::datum_t *row_out,
+            admin_err_t *error_out);
+
+    bool write_row(
+            auth::user_context_t const &user_context,
+            ql::datum_t primary_key,
+            bool pkey_was_autogenerated,
+            ql::datum_t *new_value_inout,
+            signal_t *interruptor,
+            admin_err_t *error_out);
+
+private:
+    ql::datum_t format_row();
+
+    // The sampling rate that is used when the profiler gets enabled. Only accessed on
+    // the home thread.
+    uint32_t samples_per_sec;
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_DEBUG_PROFILER_HPP_ */
@@ -0,0 +1,18 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/http/profiler_app.hpp"
+
+#include "arch/runtime/sampling_profiler.hpp"
+
+void profiler_http_app_t::handle(const http_req_t &req,
+                                 http_res_t *result,
+                                 UNUSED signal_t *interruptor) {
+    if (req.method != http_method_t::GET) {
+        *result = http_res_t(http_status_code_t::METHOD_NOT_ALLOWED);
+        return;
+    }
+
+    *result = http_res_t(
+        http_status_code_t::OK, "text/plain; charset=utf-8",
+        sampling_profiler_t::get_global_profiler().get_folded_stacks());
+    maybe_gzip_response(req, result);
+}
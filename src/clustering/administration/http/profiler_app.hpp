@@ -0,0 +1,17 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_PROFILER_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_PROFILER_APP_HPP_
+
+#include "http/http.hpp"
+
+/* `profiler_http_app_t` serves the samples of this server's `sampling_profiler_t` as
+folded stacks, one line per stack, which is the input format of flame graph tools. It
+doesn't change anything: the profiler is turned on and off, and its samples are
+discarded, through the `rethinkdb._debug_profiler` table, which takes write
+permissions on the `rethinkdb` database. */
+class profiler_http_app_t : public http_app_t {
+public:
+    void handle(const http_req_t &req, http_res_t *result, signal_t *interruptor);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_PROFILER_APP_HPP_ */
@@ -2,6 +2,7 @@
 #include "clustering/administration/http/server.hpp"
 
 #include "clustering/administration/http/cyanide.hpp"
+#include "clustering/administration/http/profiler_app.hpp"
 #include "http/file_app.hpp"
 #include "http/http.hpp"
 #include "http/routing_app.hpp"
@@ -20,9 +21,11 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
 #ifndef NDEBUG
     cyanide_app.init(new cyanide_http_app_t);
 #endif
+    profiler_app.init(new profiler_http_app_t);
 
     std::map<std::string, http_app_t *> ajax_routes;
     ajax_routes["reql"] = reql_app;
+    ajax_routes["profiler"] = profiler_app.get();
     DEBUG_ONLY_CODE(ajax_routes["cyanide"] = cyanide_app.get());
     ajax_routing_app.init(new routing_http_app_t(nullptr, ajax_routes));
 
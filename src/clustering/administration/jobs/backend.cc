@@ -76,6 +76,7 @@ void jobs_artificial_table_backend_t::get_all_job_reports(
     std::map<uuid_u, disk_compaction_job_report_t> disk_compaction_jobs_map;
     std::map<uuid_u, index_construction_job_report_t> index_construction_jobs_map;
     std::map<uuid_u, backfill_job_report_t> backfill_jobs_map;
+    std::map<uuid_u, table_load_job_report_t> table_load_jobs_map;
 
     typedef std::map<peer_id_t, cluster_directory_metadata_t> peers_t;
     peers_t peers = directory_view->get().get_inner();
@@ -89,13 +90,15 @@ void jobs_artificial_table_backend_t::get_all_job_reports(
                 std::vector<query_job_report_t> const & query_jobs,
                 std::vector<disk_compaction_job_report_t> const &disk_compaction_jobs,
                 std::vector<index_construction_job_report_t> const &index_construction_jobs,
-                std::vector<backfill_job_report_t> const &backfill_jobs) {
+                std::vector<backfill_job_report_t> const &backfill_jobs,
+                std::vector<table_load_job_report_t> const &table_load_jobs) {
 
                 insert_or_merge_jobs(query_jobs, &query_jobs_map);
                 insert_or_merge_jobs(disk_compaction_jobs, &disk_compaction_jobs_map);
                 insert_or_merge_jobs(
                     index_construction_jobs, &index_construction_jobs_map);
                 insert_or_merge_jobs(backfill_jobs, &backfill_jobs_map);
+                insert_or_merge_jobs(table_load_jobs, &table_load_jobs_map);
 
                 returned_job_reports.pulse();
             });
@@ -126,6 +129,7 @@ void jobs_artificial_table_backend_t::get_all_job_reports(
         disk_compaction_jobs_map.clear();
         index_construction_jobs_map.clear();
         backfill_jobs_map.clear();
+        table_load_jobs_map.clear();
     }
 
     cluster_semilattice_metadata_t metadata = semilattice_view->get();
@@ -137,6 +141,8 @@ void jobs_artificial_table_backend_t::get_all_job_reports(
         table_meta_client, metadata, jobs_out);
     jobs_to_datums(backfill_jobs_map, identifier_format, server_config_client,
         table_meta_client, metadata, jobs_out);
+    jobs_to_datums(table_load_jobs_map, identifier_format, server_config_client,
+        table_meta_client, metadata, jobs_out);
 }
 
 bool jobs_artificial_table_backend_t::read_all_rows_as_vector(
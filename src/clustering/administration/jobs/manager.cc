@@ -20,6 +20,9 @@ const uuid_u jobs_manager_t::base_disk_compaction_id =
 const uuid_u jobs_manager_t::base_backfill_id =
     str_to_uuid("a5e1b38d-c712-42d7-ab4c-f177a3fb0d20");
 
+const uuid_u jobs_manager_t::base_table_load_id =
+    str_to_uuid("3c5d0f57-6a2e-4b8e-9d41-8f0b7e2c6a19");
+
 jobs_manager_t::jobs_manager_t(mailbox_manager_t *_mailbox_manager,
                                server_id_t const &_server_id,
                                rdb_context_t *_rdb_context,
@@ -53,6 +56,7 @@ void jobs_manager_t::on_get_job_reports(
     std::vector<disk_compaction_job_report_t> disk_compaction_job_reports;
     std::vector<index_construction_job_report_t> index_construction_job_reports;
     std::vector<backfill_job_report_t> backfill_job_reports;
+    std::vector<table_load_job_report_t> table_load_job_reports;
 
     if (drainer.is_draining()) {
         // We're shutting down, send an empty reponse since we can't acquire a `drainer`
@@ -63,7 +67,8 @@ void jobs_manager_t::on_get_job_reports(
              query_job_reports,
              disk_compaction_job_reports,
              index_construction_job_reports,
-             backfill_job_reports);
+             backfill_job_reports,
+             table_load_job_reports);
         return;
     }
 
@@ -119,6 +124,21 @@ void jobs_manager_t::on_get_job_reports(
             server_id);
     }
 
+    if (table_persistence_interface != nullptr) {
+        std::map<namespace_id_t, log_serializer_startup_progress_t> startup_progress =
+            table_persistence_interface->get_startup_progress();
+        for (const auto &table : startup_progress) {
+            table_load_job_reports.emplace_back(
+                uuid_u::from_hash(
+                    base_table_load_id,
+                    uuid_to_str(server_id.get_uuid()) + uuid_to_str(table.first)),
+                time - std::min<double>(table.second.start_time, time),
+                server_id,
+                table.first,
+                table.second.progress());
+        }
+    }
+
     try {
         multi_table_manager->visit_tables(interruptor, access_t::read,
         [&](const namespace_id_t &table_id,
@@ -178,7 +198,8 @@ void jobs_manager_t::on_get_job_reports(
              query_job_reports,
              disk_compaction_job_reports,
              index_construction_job_reports,
-             backfill_job_reports);
+             backfill_job_reports,
+             table_load_job_reports);
     } catch (const interrupted_exc_t &) {
         // Do nothing
     }
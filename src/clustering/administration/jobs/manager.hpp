@@ -38,6 +38,7 @@ private:
     static const uuid_u base_sindex_id;
     static const uuid_u base_disk_compaction_id;
     static const uuid_u base_backfill_id;
+    static const uuid_u base_table_load_id;
 
     void on_get_job_reports(
         UNUSED signal_t *interruptor,
@@ -218,6 +218,65 @@ RDB_IMPL_SERIALIZABLE_9_FOR_CLUSTER(
     progress_numerator,
     progress_denominator);
 
+table_load_job_report_t::table_load_job_report_t()
+    : job_report_base_t<table_load_job_report_t>() { }
+
+table_load_job_report_t::table_load_job_report_t(
+        uuid_u const &_id,
+        double _duration,
+        server_id_t const &_server_id,
+        namespace_id_t const &_table,
+        double _progress)
+    : job_report_base_t<table_load_job_report_t>(
+        "table_load", _id, _duration, _server_id),
+      table(_table),
+      progress_numerator(_progress),
+      progress_denominator(1.0) { }
+
+void table_load_job_report_t::merge_derived(
+       table_load_job_report_t const &job_report) {
+    progress_numerator += job_report.progress_numerator;
+    progress_denominator += job_report.progress_denominator;
+}
+
+bool table_load_job_report_t::info_derived(
+        admin_identifier_format_t identifier_format,
+        UNUSED server_config_client_t *server_config_client,
+        table_meta_client_t *table_meta_client,
+        cluster_semilattice_metadata_t const &metadata,
+        ql::datum_object_builder_t *info_builder_out) const {
+    ql::datum_t table_name_or_uuid;
+    ql::datum_t db_name_or_uuid;
+    if (!convert_table_id_to_datums(
+            table,
+            identifier_format,
+            metadata,
+            table_meta_client,
+            &table_name_or_uuid,
+            nullptr,
+            &db_name_or_uuid,
+            nullptr)) {
+        return false;
+    }
+    info_builder_out->overwrite("table", table_name_or_uuid);
+    info_builder_out->overwrite("db", db_name_or_uuid);
+
+    info_builder_out->overwrite("progress",
+        ql::datum_t(progress_numerator / progress_denominator));
+
+    return true;
+}
+
+RDB_IMPL_SERIALIZABLE_7_FOR_CLUSTER(
+    table_load_job_report_t,
+    type,
+    id,
+    duration,
+    servers,
+    table,
+    progress_numerator,
+    progress_denominator);
+
 query_job_report_t::query_job_report_t()
     : job_report_base_t<query_job_report_t>() { }
 
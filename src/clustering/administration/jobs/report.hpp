@@ -131,6 +131,33 @@ public:
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(index_construction_job_report_t);
 
+/* A table whose data file is still being loaded on a server, which mostly means reading
+the serializer's LBA. */
+class table_load_job_report_t : public job_report_base_t<table_load_job_report_t> {
+public:
+    table_load_job_report_t();
+    table_load_job_report_t(
+            uuid_u const &id,
+            double duration,
+            server_id_t const &server_id,
+            namespace_id_t const &table,
+            double progress);
+
+    void merge_derived(table_load_job_report_t const &job_report);
+
+    bool info_derived(
+            admin_identifier_format_t identifier_format,
+            server_config_client_t *server_config_client,
+            table_meta_client_t *table_meta_client,
+            cluster_semilattice_metadata_t const &metadata,
+            ql::datum_object_builder_t *info_builder_out) const;
+
+    namespace_id_t table;
+    double progress_numerator;
+    double progress_denominator;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(table_load_job_report_t);
+
 class query_job_report_t : public job_report_base_t<query_job_report_t> {
 public:
     query_job_report_t();
@@ -162,7 +189,8 @@ public:
     typedef mailbox_t<std::vector<query_job_report_t>,
                       std::vector<disk_compaction_job_report_t>,
                       std::vector<index_construction_job_report_t>,
-                      std::vector<backfill_job_report_t>> return_mailbox_t;
+                      std::vector<backfill_job_report_t>,
+                      std::vector<table_load_job_report_t>> return_mailbox_t;
     typedef mailbox_t<return_mailbox_t::address_t> get_job_reports_mailbox_t;
     typedef mailbox_t<uuid_u, auth::user_context_t> job_interrupt_mailbox_t;
 
@@ -1045,6 +1045,7 @@ void run_rethinkdb_create(const base_path_t &base_path,
                           optional<uint64_t> total_cache_size,
                           const file_direct_io_mode_t direct_io_mode,
                           const int max_concurrent_io_requests,
+                          const io_backend_t io_backend,
                           bool *const result_out) {
     server_id_t our_server_id = server_id_t::generate_server_id();
 
@@ -1058,7 +1059,7 @@ void run_rethinkdb_create(const base_path_t &base_path,
     server_config.config.cache_size_bytes = total_cache_size;
     server_config.version = 1;
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests, io_backend);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -1139,6 +1140,7 @@ void run_rethinkdb_serve(const base_path_t &base_path,
                          const std::string &initial_password,
                          const file_direct_io_mode_t direct_io_mode,
                          const int max_concurrent_io_requests,
+                         const io_backend_t io_backend,
                          const optional<optional<uint64_t> >
                             &total_cache_size,
                          const server_id_t *our_server_id,
@@ -1156,7 +1158,7 @@ void run_rethinkdb_serve(const base_path_t &base_path,
 
     logNTC("Loading data from directory %s\n", base_path.path().c_str());
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests, io_backend);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -1284,6 +1286,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
                              const std::string &initial_password,
                              const file_direct_io_mode_t direct_io_mode,
                              const int max_concurrent_io_requests,
+                             const io_backend_t io_backend,
                              const optional<optional<uint64_t> >
                                 &total_cache_size,
                              const bool new_directory,
@@ -1292,7 +1295,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
                              bool *const result_out) {
     if (!new_directory) {
         run_rethinkdb_serve(base_path, serve_info, initial_password, direct_io_mode,
-                            max_concurrent_io_requests, total_cache_size,
+                            max_concurrent_io_requests, io_backend, total_cache_size,
                             nullptr, nullptr, nullptr, data_directory_lock,
                             result_out);
     } else {
@@ -1328,7 +1331,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
         server_config.version = 1;
 
         run_rethinkdb_serve(base_path, serve_info, initial_password, direct_io_mode,
-                            max_concurrent_io_requests,
+                            max_concurrent_io_requests, io_backend,
                             optional<optional<uint64_t> >(),
                             &our_server_id, &server_config, &cluster_metadata,
                             data_directory_lock, result_out);
@@ -1407,6 +1410,12 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
                                              strprintf("%d", DEFAULT_MAX_CONCURRENT_IO_REQUESTS)));
     help.add("--io-threads n",
              "how many simultaneous I/O operations can happen at the same time");
+    options_out->push_back(options::option_t(options::names_t("--io-backend"),
+                                             options::OPTIONAL,
+                                             "pool"));
+    help.add("--io-backend {pool | io_uring}",
+             "how to run disk I/O: on a pool of threads, or with io_uring (Linux only; "
+             "falls back to the thread pool if unsupported)");
 #ifndef _WIN32
     // TODO WINDOWS: accept this option, but error out if it is passed
     options_out->push_back(options::option_t(options::names_t("--direct-io"),
@@ -1417,6 +1426,12 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
                                              options::OPTIONAL));
     help.add("--cache-size mb", "total cache size (in megabytes) for the process. Can "
         "be 'auto'.");
+    options_out->push_back(options::option_t(options::names_t("--cache-eviction-policy"),
+                                             options::OPTIONAL,
+                                             "lru"));
+    help.add("--cache-eviction-policy {lru | 2q}",
+             "how the cache picks pages to evict.  '2q' evicts pages that were only "
+             "used once (for example by a table scan) first");
     return help;
 }
 
@@ -1624,6 +1639,13 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                                     "before giving up, the default is "
                                                     "24 hours");
 
+    options_out->push_back(options::option_t(options::names_t("--cluster-compression"),
+                                             options::OPTIONAL,
+                                             "none"));
+    help.add("--cluster-compression {none | deflate}", "compress the messages sent to "
+             "other servers that use the same setting, which saves bandwidth between "
+             "data centers at the cost of some CPU time");
+
     return help;
 }
 
@@ -1887,6 +1909,50 @@ MUST_USE bool parse_io_threads_option(const std::map<std::string, options::value
     return true;
 }
 
+MUST_USE bool parse_io_backend_option(const std::map<std::string, options::values_t> &opts,
+                                      io_backend_t *io_backend_out) {
+    const std::string io_backend = get_single_option(opts, "--io-backend");
+    if (io_backend == "pool") {
+        *io_backend_out = io_backend_t::blocker_pool;
+    } else if (io_backend == "io_uring") {
+        *io_backend_out = io_backend_t::io_uring;
+    } else {
+        fprintf(stderr, "ERROR: io-backend must be 'pool' or 'io_uring'\n");
+        return false;
+    }
+    return true;
+}
+
+MUST_USE bool parse_cache_eviction_policy_option(
+        const std::map<std::string, options::values_t> &opts,
+        cache_eviction_policy_t *policy_out) {
+    const std::string policy = get_single_option(opts, "--cache-eviction-policy");
+    if (policy == "lru") {
+        *policy_out = cache_eviction_policy_t::sampled_lru;
+    } else if (policy == "2q") {
+        *policy_out = cache_eviction_policy_t::two_queue;
+    } else {
+        fprintf(stderr, "ERROR: cache-eviction-policy must be 'lru' or '2q'\n");
+        return false;
+    }
+    return true;
+}
+
+MUST_USE bool parse_cluster_compression_option(
+        const std::map<std::string, options::values_t> &opts,
+        cluster_compression_t *compression_out) {
+    const std::string compression = get_single_option(opts, "--cluster-compression");
+    if (compression == "none") {
+        *compression_out = cluster_compression_t::none;
+    } else if (compression == "deflate") {
+        *compression_out = cluster_compression_t::deflate;
+    } else {
+        fprintf(stderr, "ERROR: cluster-compression must be 'none' or 'deflate'\n");
+        return false;
+    }
+    return true;
+}
+
 update_check_t parse_update_checking_option(const std::map<std::string, options::values_t> &opts) {
     return exists_option(opts, "--no-update-check")
         ? update_check_t::do_not_perform
@@ -1929,6 +1995,11 @@ int main_rethinkdb_create(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        io_backend_t io_backend;
+        if (!parse_io_backend_option(opts, &io_backend)) {
+            return EXIT_FAILURE;
+        }
+
         const int num_workers = get_cpu_count();
 
         bool is_new_directory = false;
@@ -1958,6 +2029,7 @@ int main_rethinkdb_create(int argc, char *argv[]) {
                                      total_cache_size,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      &result),
                            num_workers);
 
@@ -2057,6 +2129,16 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        io_backend_t io_backend;
+        if (!parse_io_backend_option(opts, &io_backend)) {
+            return EXIT_FAILURE;
+        }
+
+        cache_eviction_policy_t cache_eviction_policy;
+        if (!parse_cache_eviction_policy_option(opts, &cache_eviction_policy)) {
+            return EXIT_FAILURE;
+        }
+
         update_check_t do_update_checking = parse_update_checking_option(opts);
 
         optional<optional<uint64_t> > total_cache_size =
@@ -2066,6 +2148,11 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
         optional<int> node_reconnect_timeout_secs =
             parse_node_reconnect_timeout_secs_option(opts);
 
+        cluster_compression_t cluster_compression;
+        if (!parse_cluster_compression_option(opts, &cluster_compression)) {
+            return EXIT_FAILURE;
+        }
+
         // Open and lock the directory, but do not create it
         bool is_new_directory = false;
         directory_lock_t data_directory_lock(base_path, false, &is_new_directory);
@@ -2107,7 +2194,9 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                 std::vector<std::string>(argv, argv + argc),
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
-                                tls_configs);
+                                tls_configs,
+                                cache_eviction_policy,
+                                cluster_compression);
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
 
@@ -2118,6 +2207,7 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                      initial_password,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      total_cache_size,
                                      static_cast<server_id_t*>(nullptr),
                                      static_cast<server_config_versioned_t *>(nullptr),
@@ -2168,6 +2258,11 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
         optional<int> node_reconnect_timeout_secs =
             parse_node_reconnect_timeout_secs_option(opts);
 
+        cluster_compression_t cluster_compression;
+        if (!parse_cluster_compression_option(opts, &cluster_compression)) {
+            return EXIT_FAILURE;
+        }
+
 #ifndef _WIN32
         get_and_set_user_group(opts);
 #endif
@@ -2210,7 +2305,9 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
                                 std::vector<std::string>(argv, argv + argc),
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
-                                tls_configs);
+                                tls_configs,
+                                cache_eviction_policy_t::sampled_lru,
+                                cluster_compression);
 
         bool result;
         run_in_thread_pool(
@@ -2328,12 +2425,27 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        io_backend_t io_backend;
+        if (!parse_io_backend_option(opts, &io_backend)) {
+            return EXIT_FAILURE;
+        }
+
+        cache_eviction_policy_t cache_eviction_policy;
+        if (!parse_cache_eviction_policy_option(opts, &cache_eviction_policy)) {
+            return EXIT_FAILURE;
+        }
+
         update_check_t do_update_checking = parse_update_checking_option(opts);
 
         optional<int> join_delay_secs = parse_join_delay_secs_option(opts);
         optional<int> node_reconnect_timeout_secs =
             parse_node_reconnect_timeout_secs_option(opts);
 
+        cluster_compression_t cluster_compression;
+        if (!parse_cluster_compression_option(opts, &cluster_compression)) {
+            return EXIT_FAILURE;
+        }
+
         // Attempt to create the directory early so that the log file can use it.
         // If we create the file, it will be cleaned up unless directory_initialized()
         // is called on it.  This will be done after the metadata files have been created.
@@ -2400,7 +2512,9 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                 std::vector<std::string>(argv, argv + argc),
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
-                                tls_configs);
+                                tls_configs,
+                                cache_eviction_policy,
+                                cluster_compression);
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
 
@@ -2412,6 +2526,7 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                      initial_password,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      total_cache_size,
                                      is_new_directory,
                                      &serve_info,
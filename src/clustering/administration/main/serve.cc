@@ -235,7 +235,9 @@ bool do_serve(io_backender_t *io_backender,
                 serve_info.ports.client_port,
                 semilattice_manager_heartbeat.get_root_view(),
                 semilattice_manager_auth.get_root_view(),
-                serve_info.tls_configs.cluster.get()));
+                serve_info.tls_configs.cluster.get(),
+                CLUSTER_CONNECTIONS_PER_PEER,
+                serve_info.cluster_compression));
         } catch (const address_in_use_exc_t &ex) {
             throw address_in_use_exc_t(strprintf("Could not bind to cluster port: %s", ex.what()));
         }
@@ -279,6 +281,8 @@ bool do_serve(io_backender_t *io_backender,
         needs. */
         rdb_context_t rdb_ctx(&extproc_pool,
                               &mailbox_manager,
+                              io_backender,
+                              base_path,
                               nullptr,   /* we'll fill this in later */
                               semilattice_manager_auth.get_root_view(),
                               &get_global_perfmon_collection(),
@@ -304,7 +308,8 @@ bool do_serve(io_backender_t *io_backender,
             scoped_ptr_t<multi_table_manager_t> multi_table_manager;
             if (i_am_a_server) {
                 cache_balancer.init(new alt_cache_balancer_t(
-                    server_config_server->get_actual_cache_size_bytes()));
+                    server_config_server->get_actual_cache_size_bytes(),
+                    serve_info.cache_eviction_policy));
                 table_persistence_interface.init(
                     new real_table_persistence_interface_t(
                         io_backender,
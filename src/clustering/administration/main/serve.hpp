@@ -13,6 +13,8 @@
 #include "clustering/administration/main/version_check.hpp"
 #include "arch/address.hpp"
 #include "arch/io/openssl.hpp"
+#include "buffer_cache/types.hpp"
+#include "rpc/connectivity/compression.hpp"
 
 class os_signal_cond_t;
 
@@ -119,7 +121,9 @@ public:
                  std::vector<std::string> &&_argv,
                  const int _join_delay_secs,
                  const int _node_reconnect_timeout_secs,
-                 tls_configs_t _tls_configs) :
+                 tls_configs_t _tls_configs,
+                 cache_eviction_policy_t _cache_eviction_policy,
+                 cluster_compression_t _cluster_compression) :
         joins(std::move(_joins)),
         reql_http_proxy(std::move(_reql_http_proxy)),
         web_assets(std::move(_web_assets)),
@@ -128,7 +132,9 @@ public:
         config_file(_config_file),
         argv(std::move(_argv)),
         join_delay_secs(_join_delay_secs),
-        node_reconnect_timeout_secs(_node_reconnect_timeout_secs)
+        node_reconnect_timeout_secs(_node_reconnect_timeout_secs),
+        cache_eviction_policy(_cache_eviction_policy),
+        cluster_compression(_cluster_compression)
     {
         tls_configs = _tls_configs;
     }
@@ -150,6 +156,8 @@ public:
     int join_delay_secs;
     int node_reconnect_timeout_secs;
     tls_configs_t tls_configs;
+    cache_eviction_policy_t cache_eviction_policy;
+    cluster_compression_t cluster_compression;
 };
 
 /* This has been factored out from `command_line.hpp` because it takes a very
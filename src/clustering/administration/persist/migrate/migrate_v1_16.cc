@@ -302,6 +302,8 @@ void migrate_table(const server_id_t &this_server_id,
                 ::write_ack_config_t::SINGLE : ::write_ack_config_t::MAJORITY;
     config.config.durability = old_config.config.durability;
     config.config.user_data = default_user_data();
+    config.config.block_size = DEFAULT_BTREE_BLOCK_SIZE;
+    config.config.block_compression = block_compression_t::none;
     config.shard_scheme.split_points = old_config.shard_scheme.split_points;
 
     // Scan the servers in the old shard config - need to remove deleted and nil servers
@@ -20,6 +20,8 @@ public:
     real_multistore_ptr_t(
             const namespace_id_t &table_id,
             const serializer_filepath_t &path,
+            uint64_t block_size,
+            block_compression_t block_compression,
             scoped_ptr_t<real_branch_history_manager_t> &&bhm,
             const base_path_t &base_path,
             io_backender_t *io_backender,
@@ -56,16 +58,19 @@ public:
         if (create) {
             log_serializer_t::create(
                 &file_opener,
-                log_serializer_t::static_config_t());
+                log_serializer_t::static_config_t(block_size));
         }
 
         // TODO: Could we handle failure when loading the serializer?  Right
         // now, we don't.
 
+        log_serializer_t::dynamic_config_t dynamic_config;
+        dynamic_config.block_compression = block_compression;
         scoped_ptr_t<serializer_t> inner_serializer(new log_serializer_t(
-            log_serializer_t::dynamic_config_t(),
+            dynamic_config,
             &file_opener,
-            perfmon_collection_serializers));
+            perfmon_collection_serializers,
+            &startup_progress));
         serializer.init(new merger_serializer_t(
             std::move(inner_serializer),
             MERGER_SERIALIZER_MAX_ACTIVE_WRITES));
@@ -164,6 +169,16 @@ public:
         }
     }
 
+    threadnum_t get_serializer_thread() const {
+        return serializer_thread_allocation->get_thread();
+    }
+
+    // Must be called on the serializer's thread
+    const log_serializer_startup_progress_t &get_startup_progress() const {
+        rassert(get_thread_id() == get_serializer_thread());
+        return startup_progress;
+    }
+
 private:
     scoped_ptr_t<real_branch_history_manager_t> branch_history_manager;
     scoped_ptr_t<serializer_t> serializer;
@@ -173,6 +188,9 @@ private:
     scoped_ptr_t<thread_allocation_t> serializer_thread_allocation;
     std::vector<scoped_ptr_t<thread_allocation_t> > store_thread_allocations;
 
+    // Updated by the serializer while it's starting up
+    log_serializer_startup_progress_t startup_progress;
+
     auto_drainer_t drainer;
     map_insertion_sentry_t<
         namespace_id_t, std::pair<real_multistore_ptr_t *, auto_drainer_t::lock_t>
@@ -275,6 +293,8 @@ void real_table_persistence_interface_t::delete_metadata(
 
 void real_table_persistence_interface_t::load_multistore(
         const namespace_id_t &table_id,
+        uint64_t block_size,
+        block_compression_t block_compression,
         metadata_file_t::read_txn_t *metadata_read_txn,
         scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
         signal_t *interruptor,
@@ -293,6 +313,8 @@ void real_table_persistence_interface_t::load_multistore(
     multistore_ptr_out->init(new real_multistore_ptr_t(
         table_id,
         file_name_for(table_id),
+        block_size,
+        block_compression,
         std::move(bhm),
         base_path,
         io_backender,
@@ -306,13 +328,15 @@ void real_table_persistence_interface_t::load_multistore(
 
 void real_table_persistence_interface_t::create_multistore(
         const namespace_id_t &table_id,
+        uint64_t block_size,
+        block_compression_t block_compression,
         scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
         signal_t *interruptor,
         perfmon_collection_t *perfmon_collection_serializers) {
     metadata_file_t::read_txn_t read_txn(metadata_file, interruptor);
     load_multistore(
-        table_id, &read_txn, multistore_ptr_out, interruptor,
-        perfmon_collection_serializers);
+        table_id, block_size, block_compression, &read_txn, multistore_ptr_out,
+        interruptor, perfmon_collection_serializers);
 }
 
 void real_table_persistence_interface_t::destroy_multistore(
@@ -362,3 +386,35 @@ bool real_table_persistence_interface_t::is_gc_active() const {
 
     return false;
 }
+
+std::map<namespace_id_t, log_serializer_startup_progress_t>
+real_table_persistence_interface_t::get_startup_progress() const {
+    std::map<namespace_id_t, log_serializer_startup_progress_t> result;
+    for (int thread = 0; thread < get_num_db_threads(); ++thread) {
+        std::map<namespace_id_t, std::pair<real_multistore_ptr_t *, auto_drainer_t::lock_t> >
+            multistores_copy;
+        for (auto const &real_multistore : real_multistores) {
+            if (real_multistore.second.first->get_serializer_thread()
+                    != threadnum_t(thread)) {
+                continue;
+            }
+            multistores_copy.insert(real_multistore);
+        }
+        if (multistores_copy.empty()) {
+            continue;
+        }
+
+        {
+            on_thread_t on_thread((threadnum_t(thread)));
+            for (auto const &multistore : multistores_copy) {
+                const log_serializer_startup_progress_t &progress =
+                    multistore.second.first->get_startup_progress();
+                if (!progress.is_ready) {
+                    result.insert(std::make_pair(multistore.first, progress));
+                }
+            }
+        }
+    }
+
+    return result;
+}
@@ -5,6 +5,7 @@
 #include "clustering/administration/perfmon_collection_repo.hpp"
 #include "clustering/administration/persist/raft_storage_interface.hpp"
 #include "clustering/table_manager/table_metadata.hpp"
+#include "serializer/log/startup_progress.hpp"
 
 class cache_balancer_t;
 class metadata_file_t;
@@ -57,12 +58,16 @@ public:
 
     void load_multistore(
         const namespace_id_t &table_id,
+        uint64_t block_size,
+        block_compression_t block_compression,
         metadata_file_t::read_txn_t *metadata_read_txn,
         scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
         signal_t *interruptor,
         perfmon_collection_t *perfmon_collection_serializers);
     void create_multistore(
         const namespace_id_t &table_id,
+        uint64_t block_size,
+        block_compression_t block_compression,
         scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
         signal_t *interruptor,
         perfmon_collection_t *perfmon_collection_serializers);
@@ -72,6 +77,10 @@ public:
 
     bool is_gc_active() const;
 
+    /* Returns the progress of the tables whose serializers are still starting up. */
+    std::map<namespace_id_t, log_serializer_startup_progress_t>
+        get_startup_progress() const;
+
 private:
     serializer_filepath_t file_name_for(const namespace_id_t &table_id);
     threadnum_t pick_thread();
@@ -292,6 +292,8 @@ bool real_reql_cluster_interface_t::table_create(
         const table_generate_config_params_t &config_params,
         const std::string &primary_key,
         write_durability_t durability,
+        uint64_t block_size,
+        block_compression_t block_compression,
         signal_t *interruptor_on_caller,
         ql::datum_t *result_out,
         admin_err_t *error_out) {
@@ -335,6 +337,8 @@ bool real_reql_cluster_interface_t::table_create(
         config.config.write_ack_config = write_ack_config_t::MAJORITY;
         config.config.durability = durability;
         config.config.user_data = default_user_data();
+        config.config.block_size = block_size;
+        config.config.block_compression = block_compression;
 
         table_id = generate_uuid();
         m_table_meta_client->create(table_id, config, &interruptor_on_home);
@@ -691,6 +695,8 @@ void real_reql_cluster_interface_t::reconfigure_internal(
     new_config.config.write_ack_config = old_config.config.write_ack_config;
     new_config.config.durability = old_config.config.durability;
     new_config.config.user_data = old_config.config.user_data;
+    new_config.config.block_size = old_config.config.block_size;
+    new_config.config.block_compression = old_config.config.block_compression;
 
     calculate_split_points_intelligently(
         table_id,
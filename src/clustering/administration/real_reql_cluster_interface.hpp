@@ -86,6 +86,8 @@ public:
             const table_generate_config_params_t &config_params,
             const std::string &primary_key,
             write_durability_t durability,
+            uint64_t block_size,
+            block_compression_t block_compression,
             signal_t *interruptor,
             ql::datum_t *result_out,
             admin_err_t *error_out);
@@ -39,7 +39,8 @@ parsed_stats_t::server_stats_t::server_stats_t() :
 parsed_stats_t::table_stats_t::table_stats_t() :
     read_docs_per_sec(0), read_docs_total(0),
     written_docs_per_sec(0), written_docs_total(0),
-    in_use_bytes(0), metadata_bytes(0), data_bytes(0),
+    in_use_bytes(0), hits_total(0), misses_total(0), evictions_total(0),
+    metadata_bytes(0), data_bytes(0),
     garbage_bytes(0), preallocated_bytes(0),
     read_bytes_per_sec(0), read_bytes_total(0),
     written_bytes_per_sec(0), written_bytes_total(0) { }
@@ -101,6 +102,19 @@ void parsed_stats_t::add_perfmon_value(const ql::datum_t &perf,
     }
 }
 
+void parsed_stats_t::merge_perfmon_histogram(const ql::datum_t &perf,
+                                             const std::string &key,
+                                             latency_histogram_t *histogram_out) {
+    ql::datum_t v = perf.get_field(key.c_str(), ql::throw_bool_t::NOTHROW);
+    // Servers running an older version don't have the histogram.
+    if (v.has()) {
+        latency_histogram_t histogram;
+        bool res = latency_histogram_t::from_datum(v, &histogram);
+        r_sanity_check(res);
+        histogram_out->merge(histogram);
+    }
+}
+
 void parsed_stats_t::store_shard_values(const ql::datum_t &shard_perf,
                                         table_stats_t *stats_out) {
     r_sanity_check(shard_perf.get_type() == ql::datum_t::R_OBJECT);
@@ -125,6 +139,14 @@ void parsed_stats_t::store_shard_values(const ql::datum_t &shard_perf,
                 } else if (key == "cache") {
                     add_perfmon_value(sub_pair.second, "in_use_bytes",
                                       &stats_out->in_use_bytes);
+                    add_perfmon_value(sub_pair.second, "hits_total",
+                                      &stats_out->hits_total);
+                    add_perfmon_value(sub_pair.second, "misses_total",
+                                      &stats_out->misses_total);
+                    add_perfmon_value(sub_pair.second, "evictions_total",
+                                      &stats_out->evictions_total);
+                    merge_perfmon_histogram(sub_pair.second, "miss_latency_ms",
+                                            &stats_out->miss_latency);
                 }
             }
         }
@@ -142,6 +164,10 @@ void parsed_stats_t::store_serializer_values(const ql::datum_t &ser_perf,
                         &stats_out->written_bytes_per_sec);
     store_perfmon_value(ser_perf, "serializer_written_bytes_total",
                         &stats_out->written_bytes_total);
+    merge_perfmon_histogram(ser_perf, "serializer_read_latency_ms",
+                            &stats_out->read_latency);
+    merge_perfmon_histogram(ser_perf, "serializer_write_latency_ms",
+                            &stats_out->write_latency);
 
     store_perfmon_value(ser_perf, "serializer_data_extents",
                         &stats_out->data_bytes);
@@ -167,6 +193,7 @@ void parsed_stats_t::store_query_engine_stats(const ql::datum_t &qe_perf,
     store_perfmon_value(qe_perf, "queries_total", &stats_out->queries_total);
     store_perfmon_value(qe_perf, "client_connections", &stats_out->client_connections);
     store_perfmon_value(qe_perf, "clients_active", &stats_out->clients_active);
+    merge_perfmon_histogram(qe_perf, "query_latency_ms", &stats_out->query_latency);
 }
 
 void parsed_stats_t::store_table_stats(const namespace_id_t &table_id,
@@ -312,6 +339,11 @@ bool cluster_stats_request_t::to_datum(const parsed_stats_t &stats,
     ADD_CLUSTER_SERVER_STAT(qe_builder, stats, clients_active);
     ADD_CLUSTER_TABLE_STAT(qe_builder, stats, read_docs_per_sec);
     ADD_CLUSTER_TABLE_STAT(qe_builder, stats, written_docs_per_sec);
+    latency_histogram_t query_latency;
+    for (auto const &pair : stats.servers) {
+        query_latency.merge(pair.second.query_latency);
+    }
+    qe_builder.overwrite("query_latency_ms", query_latency.to_datum(false));
     row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
 
     *result_out = std::move(row_builder).to_datum();
@@ -456,6 +488,8 @@ bool server_stats_request_t::to_datum(const parsed_stats_t &stats,
         ADD_SERVER_STAT(qe_builder, stats, server_id, read_docs_total);
         ADD_SERVER_STAT(qe_builder, stats, server_id, written_docs_per_sec);
         ADD_SERVER_STAT(qe_builder, stats, server_id, written_docs_total);
+        qe_builder.overwrite("query_latency_ms",
+                             server_stats.query_latency.to_datum(false));
         row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
     }
     *result_out = std::move(row_builder).to_datum();
@@ -552,6 +586,11 @@ bool table_server_stats_request_t::to_datum(const parsed_stats_t &stats,
 
         ql::datum_object_builder_t se_cache_builder;
         ADD_STAT(se_cache_builder, table_stats, in_use_bytes);
+        ADD_STAT(se_cache_builder, table_stats, hits_total);
+        ADD_STAT(se_cache_builder, table_stats, misses_total);
+        ADD_STAT(se_cache_builder, table_stats, evictions_total);
+        se_cache_builder.overwrite("miss_latency_ms",
+                                   table_stats.miss_latency.to_datum(false));
 
         ql::datum_object_builder_t se_disk_space_builder;
         ADD_STAT(se_disk_space_builder, table_stats, metadata_bytes);
@@ -564,6 +603,10 @@ bool table_server_stats_request_t::to_datum(const parsed_stats_t &stats,
         ADD_STAT(se_disk_builder, table_stats, read_bytes_total);
         ADD_STAT(se_disk_builder, table_stats, written_bytes_per_sec);
         ADD_STAT(se_disk_builder, table_stats, written_bytes_total);
+        se_disk_builder.overwrite("read_latency_ms",
+                                  table_stats.read_latency.to_datum(false));
+        se_disk_builder.overwrite("write_latency_ms",
+                                  table_stats.write_latency.to_datum(false));
         se_disk_builder.overwrite("space_usage", std::move(se_disk_space_builder).to_datum());
 
         ql::datum_object_builder_t se_builder;
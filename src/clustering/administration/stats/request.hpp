@@ -9,6 +9,7 @@
 
 #include "clustering/administration/metadata.hpp"
 #include "containers/uuid.hpp"
+#include "perfmon/histogram.hpp"
 #include "rdb_protocol/datum.hpp"
 
 class server_config_client_t;
@@ -28,6 +29,9 @@ public:
         double written_docs_per_sec;
         double written_docs_total;
         double in_use_bytes;
+        double hits_total;
+        double misses_total;
+        double evictions_total;
         double metadata_bytes;
         double data_bytes;
         double garbage_bytes;
@@ -36,6 +40,9 @@ public:
         double read_bytes_total;
         double written_bytes_per_sec;
         double written_bytes_total;
+        latency_histogram_t miss_latency;
+        latency_histogram_t read_latency;
+        latency_histogram_t write_latency;
     };
 
     struct server_stats_t {
@@ -46,6 +53,7 @@ public:
         double queries_total;
         double client_connections;
         double clients_active;
+        latency_histogram_t query_latency;
 
         std::map<namespace_id_t, table_stats_t> tables;
     };
@@ -81,6 +89,11 @@ private:
                              const std::string &key,
                              double *value_out);
 
+    // Merges the histogram of a `perfmon_latency_histogram_t` into `histogram_out`.
+    void merge_perfmon_histogram(const ql::datum_t &perf,
+                                 const std::string &key,
+                                 latency_histogram_t *histogram_out);
+
     void store_shard_values(const ql::datum_t &shard_perf,
                             table_stats_t *stats_out);
 
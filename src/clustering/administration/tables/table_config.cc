@@ -7,6 +7,7 @@
 #include "clustering/administration/tables/split_points.hpp"
 #include "clustering/table_manager/table_meta_client.hpp"
 #include "concurrency/cross_thread_signal.hpp"
+#include "config/args.hpp"
 #include "containers/archive/string_stream.hpp"
 #include "rdb_protocol/terms/write_hook.hpp"
 
@@ -227,6 +228,61 @@ bool convert_durability_from_datum(
     return true;
 }
 
+ql::datum_t convert_block_size_to_datum(uint64_t block_size) {
+    return ql::datum_t(static_cast<double>(block_size));
+}
+
+bool convert_block_size_from_datum(
+        const ql::datum_t &datum,
+        uint64_t *block_size_out,
+        admin_err_t *error_out) {
+    if (datum.get_type() == ql::datum_t::R_NUM) {
+        double val = datum.as_num();
+        if (val >= MIN_BTREE_BLOCK_SIZE && val <= MAX_BTREE_BLOCK_SIZE
+                && val == static_cast<double>(static_cast<uint64_t>(val))
+                && is_valid_table_block_size(static_cast<uint64_t>(val))) {
+            *block_size_out = static_cast<uint64_t>(val);
+            return true;
+        }
+    }
+    *error_out = admin_err_t{
+        strprintf("Expected a power of two between %" PRIi64 " and %" PRIi64
+                  ", got: %s",
+                  static_cast<int64_t>(MIN_BTREE_BLOCK_SIZE),
+                  static_cast<int64_t>(MAX_BTREE_BLOCK_SIZE),
+                  datum.print().c_str()),
+        query_state_t::FAILED};
+    return false;
+}
+
+ql::datum_t convert_block_compression_to_datum(block_compression_t compression) {
+    switch (compression) {
+        case block_compression_t::none:
+            return ql::datum_t("none");
+        case block_compression_t::lz4:
+            return ql::datum_t("lz4");
+        default:
+            unreachable();
+    }
+}
+
+bool convert_block_compression_from_datum(
+        const ql::datum_t &datum,
+        block_compression_t *compression_out,
+        admin_err_t *error_out) {
+    if (datum == ql::datum_t("none")) {
+        *compression_out = block_compression_t::none;
+    } else if (datum == ql::datum_t("lz4")) {
+        *compression_out = block_compression_t::lz4;
+    } else {
+        *error_out = admin_err_t{
+            "Expected \"none\" or \"lz4\", got: " + datum.print(),
+            query_state_t::FAILED};
+        return false;
+    }
+    return true;
+}
+
 struct convert_flush_interval_visitor_t : public boost::static_visitor<ql::datum_t> {
     ql::datum_t operator()(flush_interval_default_t) const {
         return ql::datum_t("default");
@@ -460,6 +516,9 @@ ql::datum_t convert_table_config_to_datum(
         convert_durability_to_datum(config.durability));
     builder.overwrite("flush_interval",
         convert_flush_interval_to_datum(config.flush_interval));
+    builder.overwrite("block_size", convert_block_size_to_datum(config.block_size));
+    builder.overwrite("block_compression",
+        convert_block_compression_to_datum(config.block_compression));
     builder.overwrite("data", config.user_data.datum);
     return std::move(builder).to_datum();
 }
@@ -531,7 +590,8 @@ bool convert_table_config_and_name_from_datum(
     }
 
     /* As a special case, we allow the user to omit `indexes`, `primary_key`, `shards`,
-    `write_acks`, `durability`, and/or `data` for newly-created tables. */
+    `write_acks`, `durability`, `block_size`, `block_compression`, and/or `data` for
+    newly-created tables. */
 
     if (converter.has("indexes")) {
         ql::datum_t indexes_datum;
@@ -670,6 +730,34 @@ bool convert_table_config_and_name_from_datum(
         config_out->flush_interval = default_flush_interval_config();
     }
 
+    if (existed_before || converter.has("block_size")) {
+        ql::datum_t block_size_datum;
+        if (!converter.get("block_size", &block_size_datum, error_out)) {
+            return false;
+        }
+        if (!convert_block_size_from_datum(
+                block_size_datum, &config_out->block_size, error_out)) {
+            error_out->msg = "In `block_size`: " + error_out->msg;
+            return false;
+        }
+    } else {
+        config_out->block_size = DEFAULT_BTREE_BLOCK_SIZE;
+    }
+
+    if (existed_before || converter.has("block_compression")) {
+        ql::datum_t block_compression_datum;
+        if (!converter.get("block_compression", &block_compression_datum, error_out)) {
+            return false;
+        }
+        if (!convert_block_compression_from_datum(
+                block_compression_datum, &config_out->block_compression, error_out)) {
+            error_out->msg = "In `block_compression`: " + error_out->msg;
+            return false;
+        }
+    } else {
+        config_out->block_compression = block_compression_t::none;
+    }
+
     if (converter.has("write_hook")) {
         ql::datum_t write_hook_datum;
         if (!converter.get("write_hook", &write_hook_datum, error_out)) {
@@ -729,6 +817,16 @@ void table_config_artificial_table_backend_t::do_modify(
                              query_state_t::FAILED);
     }
 
+    if (new_config.config.block_size != old_config.config.block_size) {
+        throw admin_op_exc_t("It's illegal to change a table's block size",
+                             query_state_t::FAILED);
+    }
+
+    if (new_config.config.block_compression != old_config.config.block_compression) {
+        throw admin_op_exc_t("It's illegal to change a table's block compression",
+                             query_state_t::FAILED);
+    }
+
     if (new_config.config.basic.database != old_config.config.basic.database ||
             new_config.config.basic.name != old_config.config.basic.name) {
         if (table_meta_client->exists(
@@ -2,6 +2,7 @@
 #include "clustering/administration/tables/table_metadata.hpp"
 
 #include "clustering/administration/tables/database_metadata.hpp"
+#include "config/args.hpp"
 #include "containers/archive/archive.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
@@ -28,6 +29,13 @@ flush_interval_config_t default_flush_interval_config() {
     return flush_interval_config_t{flush_interval_default_t{}};
 }
 
+bool is_valid_table_block_size(uint64_t block_size) {
+    return block_size >= MIN_BTREE_BLOCK_SIZE
+        && block_size <= MAX_BTREE_BLOCK_SIZE
+        && (block_size & (block_size - 1)) == 0
+        && DEFAULT_EXTENT_SIZE % block_size == 0;
+}
+
 RDB_MAKE_SERIALIZABLE_1(user_data_t, datum);
 
 RDB_IMPL_EQUALITY_COMPARABLE_1(user_data_t, datum);
@@ -68,6 +76,8 @@ archive_result_t deserialize_table_config_pre_v2_4(
     tc->durability = std::move(durability);
     tc->flush_interval = default_flush_interval_config();
     tc->user_data = default_user_data();
+    tc->block_size = DEFAULT_BTREE_BLOCK_SIZE;
+    tc->block_compression = block_compression_t::none;
 
     return res;
 }
@@ -108,7 +118,9 @@ archive_result_t deserialize_table_config_v2_4(
                          std::move(write_ack_config),
                          std::move(durability),
                          default_flush_interval_config(),
-                         default_user_data()};
+                         default_user_data(),
+                         DEFAULT_BTREE_BLOCK_SIZE,
+                         block_compression_t::none};
 
     return res;
 }
@@ -137,13 +149,13 @@ archive_result_t deserialize<cluster_version_t::v2_4>(
     return deserialize_table_config_v2_4(s, tc);
 }
 
-RDB_IMPL_SERIALIZABLE_8_SINCE_v2_5(table_config_t,
+RDB_IMPL_SERIALIZABLE_10_SINCE_v2_5(table_config_t,
     basic, shards, write_hook, sindexes, write_ack_config, durability,
-    flush_interval, user_data);
+    flush_interval, user_data, block_size, block_compression);
 
-RDB_IMPL_EQUALITY_COMPARABLE_8(table_config_t,
+RDB_IMPL_EQUALITY_COMPARABLE_10(table_config_t,
     basic, shards, write_hook, sindexes, write_ack_config, durability,
-    flush_interval, user_data);
+    flush_interval, user_data, block_size, block_compression);
 
 RDB_IMPL_SERIALIZABLE_1_SINCE_v1_16(table_shard_scheme_t, split_points);
 RDB_IMPL_EQUALITY_COMPARABLE_1(table_shard_scheme_t, split_points);
@@ -21,6 +21,7 @@
 #include "rpc/semilattice/joins/map.hpp"
 #include "rpc/semilattice/joins/versioned.hpp"
 #include "rpc/serialize_macros.hpp"
+#include "serializer/log/block_compression.hpp"
 
 /* This is the metadata for a single table. */
 
@@ -77,6 +78,11 @@ public:
 
 user_data_t default_user_data();
 
+/* Returns true if `block_size` (in bytes) can be used as the block size of a table's
+data files: a power of two between `MIN_BTREE_BLOCK_SIZE` and `MAX_BTREE_BLOCK_SIZE`
+that evenly divides the extent size. */
+bool is_valid_table_block_size(uint64_t block_size);
+
 /* `table_config_t` describes the complete contents of the `rethinkdb.table_config`
 artificial table. */
 
@@ -107,6 +113,13 @@ public:
     write_durability_t durability;
     flush_interval_config_t flush_interval;
     user_data_t user_data;  // has user-exposed name "data"
+    /* The size of the blocks in the table's data files. It only takes effect when a
+    server creates the files for the table, so it can't be changed once the table has
+    been created. */
+    uint64_t block_size;
+    /* How the table's data blocks get compressed when they are written. Every server
+    applies it when it opens the table's files. */
+    block_compression_t block_compression;
 };
 
 RDB_DECLARE_EQUALITY_COMPARABLE(table_config_t);
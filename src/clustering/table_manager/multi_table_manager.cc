@@ -46,7 +46,10 @@ multi_table_manager_t::multi_table_manager_t(
                 perfmon_collection_repo->get_perfmon_collections_for_namespace(table_id);
             table->status = table_t::status_t::ACTIVE;
             persistence_interface->load_multistore(
-                table_id, metadata_read_txn, &table->multistore_ptr, &non_interruptor,
+                table_id,
+                raft_storage->get()->snapshot_state.config.config.block_size,
+                raft_storage->get()->snapshot_state.config.config.block_compression,
+                metadata_read_txn, &table->multistore_ptr, &non_interruptor,
                 &perfmon_collections->serializers_collection);
             table->active = make_scoped<active_table_t>(
                 this, table, table_id, state.epoch, state.raft_member_id, raft_storage,
@@ -402,6 +405,8 @@ void multi_table_manager_t::on_action(
             cond_t non_interruptor;
             persistence_interface->create_multistore(
                 table_id,
+                initial_raft_state->snapshot_state.config.config.block_size,
+                initial_raft_state->snapshot_state.config.config.block_compression,
                 &table->multistore_ptr,
                 &non_interruptor,
                 &perfmon_collections->serializers_collection);
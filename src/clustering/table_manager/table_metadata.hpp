@@ -340,14 +340,21 @@ public:
     virtual void delete_metadata(
         const namespace_id_t &table_id) = 0;
 
+    /* `block_size` is the table's configured block size. It's only used if the
+    table's files don't exist yet. `block_compression` is used for the blocks that get
+    written from now on. */
     virtual void load_multistore(
         const namespace_id_t &table_id,
+        uint64_t block_size,
+        block_compression_t block_compression,
         metadata_file_t::read_txn_t *metadata_read_txn,
         scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
         signal_t *interruptor,
         perfmon_collection_t *perfmon_collection_serializers) = 0;
     virtual void create_multistore(
         const namespace_id_t &table_id,
+        uint64_t block_size,
+        block_compression_t block_compression,
         scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
         signal_t *interruptor,
         perfmon_collection_t *perfmon_collection_serializers) = 0;
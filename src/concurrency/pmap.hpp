@@ -2,9 +2,14 @@
 #ifndef CONCURRENCY_PMAP_HPP_
 #define CONCURRENCY_PMAP_HPP_
 
+#include <atomic>
+#include <exception>
+#include <vector>
+
 #include "arch/runtime/coroutines.hpp"
 #include "concurrency/cond_var.hpp"
 #include "concurrency/new_semaphore.hpp"
+#include "threading.hpp"
 
 template <class callable_t, class value_t>
 struct pmap_runner_one_arg_t {
@@ -125,4 +130,61 @@ void throttled_pmap(int64_t count, const callable_t &c, int64_t capacity) {
     throttled_pmap(0, count, c, capacity);
 }
 
+template <class callable_t>
+struct stealable_pmap_runner_t {
+    int64_t i;
+    const callable_t *c;
+    std::exception_ptr *exception_out;
+    std::atomic<int64_t> *outstanding;
+    cond_t *to_signal;
+    threadnum_t signal_thread;
+    stealable_pmap_runner_t(int64_t _i, const callable_t *_c,
+                            std::exception_ptr *_exception_out,
+                            std::atomic<int64_t> *_outstanding, cond_t *_to_signal,
+                            threadnum_t _signal_thread)
+        : i(_i), c(_c), exception_out(_exception_out), outstanding(_outstanding),
+          to_signal(_to_signal), signal_thread(_signal_thread) { }
+
+    void operator()() {
+        try {
+            (*c)(i);
+        } catch (...) {
+            *exception_out = std::current_exception();
+        }
+        // We might be running on another thread, so only the last runner to finish
+        // goes back to the thread that waits for us.
+        if (outstanding->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            on_thread_t rethreader(signal_thread);
+            to_signal->pulse();
+        }
+    }
+};
+
+/* Like `pmap()`, but the calls are spawned with `coro_t::spawn_stealable()`, so that
+threads that run out of work can take some of them over from a busy thread. `c` must
+not care which thread it runs on. If any of the calls throws, the first exception (by
+index) is rethrown once all of them are done. */
+template <class callable_t>
+void stealable_pmap(int64_t count, const callable_t &c) {
+    guarantee(count >= 0);
+    if (count == 0) {
+        return;
+    }
+
+    cond_t cond;
+    std::vector<std::exception_ptr> exceptions(count);
+    std::atomic<int64_t> outstanding(count);
+    for (int64_t i = 0; i < count; ++i) {
+        coro_t::spawn_stealable(
+            stealable_pmap_runner_t<callable_t>(i, &c, &exceptions[i], &outstanding,
+                                                &cond, get_thread_id()));
+    }
+    cond.wait();
+    for (const std::exception_ptr &exception : exceptions) {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+}
+
 #endif /* CONCURRENCY_PMAP_HPP_ */
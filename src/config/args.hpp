@@ -75,6 +75,12 @@
 // Size of each btree node (in bytes) on disk
 #define DEFAULT_BTREE_BLOCK_SIZE                  (4 * KILOBYTE)
 
+// The range of block sizes that can be chosen for a table (see `table_config_t`).
+// `block_size_t` and the B-tree node formats use 16-bit sizes and offsets, so the
+// largest power of two that works is 32KB.
+#define MIN_BTREE_BLOCK_SIZE                      (4 * KILOBYTE)
+#define MAX_BTREE_BLOCK_SIZE                      (32 * KILOBYTE)
+
 // Size of each extent (in bytes)
 // This should not be too small, or garbage collection will become
 // inefficient (especially on rotational drives).
@@ -99,6 +105,24 @@
 // TODO: make this dynamic where possible
 #define MAX_THREADS                               128
 
+// How many TCP connections ("lanes") to use for the intra-cluster traffic to each peer.
+// Mailbox messages are spread over the lanes by their destination thread, so the
+// traffic to a peer isn't serialized through a single connection. Two servers use the
+// smaller of their values.
+#define CLUSTER_CONNECTIONS_PER_PEER              4
+
+// How long to wait for all lanes of a new cluster connection to be established before
+// giving up on the connection.
+#define CLUSTER_LANE_TIMEOUT_MS                   10000
+
+// Cluster messages smaller than this are sent uncompressed even if the connection is
+// compressed, since compressing them wouldn't gain much.
+#define CLUSTER_COMPRESSION_THRESHOLD             256
+
+// Larger compressed cluster messages are split into several frames, none of which
+// inflates to more than this. A peer that sends a larger frame gets disconnected.
+#define CLUSTER_COMPRESSION_MAX_FRAME_SIZE        MEGABYTE
+
 // How many times the page replacement algorithm tries to find an eligible page before giving up.
 // Note that (MAX_UNSAVED_DATA_LIMIT_FRACTION ** PAGE_REPL_NUM_TRIES) is the probability that the
 // page replacement algorithm will succeed on a given try, and if that probability is less than 1/2
@@ -141,6 +165,11 @@
 // block infos.
 #define LBA_RECONSTRUCTION_BATCH_SIZE             1024
 
+// Once starting up would have to replay this many LBA entries (more than it would take
+// to read a snapshot of the in-memory LBA), we write a new snapshot. See
+// `lba_snapshot_t`.
+#define LBA_SNAPSHOT_THRESHOLD                    (1024 * 1024)
+
 #if defined (__powerpc64__)
 // getifaddrs() calls alloca() and it tries to allocate 64KB of memory
 // in stack frame. To avoid stack overflow, increasing the stack size
@@ -180,6 +209,17 @@
 // 2^(MESSAGE_SCHEDULER_MAX_PRIORITY - MESSAGE_SCHEDULER_MIN_PRIORITY + 1)
 #define MESSAGE_SCHEDULER_GRANULARITY           32
 
+// When a thread runs out of messages, it keeps polling its incoming message queue
+// for a while before it goes back to waiting on its event queue, so that other
+// threads don't have to wake it up through its eventfd. The number of polling
+// iterations adapts to how often that has paid off recently, between these bounds.
+#define MESSAGE_HUB_MIN_POLL_ITERATIONS         16
+#define MESSAGE_HUB_MAX_POLL_ITERATIONS         1024
+
+// Threads that run out of messages steal their share of the pending stealable messages
+// (see `coro_t::spawn_stealable()`) of another thread that has at least this many.
+#define MESSAGE_HUB_STEAL_THRESHOLD             2
+
 // Priorities for specific tasks
 #define CORO_PRIORITY_SINDEX_CONSTRUCTION       (-2)
 #define CORO_PRIORITY_BACKFILL_SENDER           (-2)
@@ -0,0 +1,131 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "containers/chunked_string_buffer.hpp"
+
+#include <algorithm>
+
+chunked_string_buffer_t::chunked_string_buffer_t()
+    : closed_size_(0),
+      next_chunk_size_(INITIAL_CHUNK_SIZE),
+      cur_(nullptr),
+      end_(nullptr) { }
+
+char *chunked_string_buffer_t::Push(size_t count) {
+    if (static_cast<size_t>(end_ - cur_) < count) {
+        add_chunk(count);
+    }
+    char *res = cur_;
+    cur_ += count;
+    return res;
+}
+
+void chunked_string_buffer_t::Pop(size_t count) {
+    while (count > 0) {
+        guarantee(!chunks_.empty());
+        chunk_t *last = &chunks_.back();
+        const size_t last_size = cur_ - (last->data.data() + last->begin);
+        if (count <= last_size) {
+            cur_ -= count;
+            return;
+        }
+        count -= last_size;
+        chunks_.pop_back();
+        guarantee(!chunks_.empty());
+        last = &chunks_.back();
+        closed_size_ -= last->end - last->begin;
+        cur_ = last->data.data() + last->end;
+        end_ = last->data.data() + last->data.size();
+    }
+}
+
+size_t chunked_string_buffer_t::GetSize() const {
+    if (chunks_.empty()) {
+        return 0;
+    }
+    return closed_size_ + (cur_ - (chunks_.back().data.data() + chunks_.back().begin));
+}
+
+void chunked_string_buffer_t::SpliceArray(chunked_string_buffer_t *array) {
+    guarantee(array != this);
+    guarantee(array->GetSize() >= 2);
+
+    // Drop the brackets around the elements.
+    guarantee(array->cur_[-1] == ']');
+    array->Pop(1);
+    chunk_t *first = &array->chunks_.front();
+    guarantee(first->data[first->begin] == '[');
+    ++first->begin;
+    if (array->chunks_.size() > 1) {
+        --array->closed_size_;
+    }
+
+    append(array);
+}
+
+void chunked_string_buffer_t::append(chunked_string_buffer_t *other) {
+    guarantee(other != this);
+    if (other->chunks_.empty()) {
+        return;
+    }
+
+    if (!chunks_.empty()) {
+        close_last_chunk();
+        closed_size_ += chunks_.back().end - chunks_.back().begin;
+    }
+    for (size_t i = 0; i < other->chunks_.size(); ++i) {
+        chunks_.push_back(std::move(other->chunks_[i]));
+    }
+    closed_size_ += other->closed_size_;
+    cur_ = other->cur_;
+    end_ = other->end_;
+    next_chunk_size_ = std::max(next_chunk_size_, other->next_chunk_size_);
+
+    other->chunks_.clear();
+    other->closed_size_ = 0;
+    other->next_chunk_size_ = INITIAL_CHUNK_SIZE;
+    other->cur_ = nullptr;
+    other->end_ = nullptr;
+}
+
+void chunked_string_buffer_t::get_chunks(const_buffer_group_t *out) const {
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        const chunk_t &chunk = chunks_[i];
+        const size_t end = i + 1 == chunks_.size()
+            ? cur_ - chunk.data.data()
+            : chunk.end;
+        if (end > chunk.begin) {
+            out->add_buffer(end - chunk.begin, chunk.data.data() + chunk.begin);
+        }
+    }
+}
+
+void chunked_string_buffer_t::append_to(std::string *out) const {
+    const_buffer_group_t chunks;
+    get_chunks(&chunks);
+    out->reserve(out->size() + chunks.get_size());
+    for (size_t i = 0; i < chunks.num_buffers(); ++i) {
+        const_buffer_group_t::buffer_t chunk = chunks.get_buffer(i);
+        out->append(static_cast<const char *>(chunk.data), chunk.size);
+    }
+}
+
+void chunked_string_buffer_t::add_chunk(size_t min_size) {
+    if (!chunks_.empty()) {
+        close_last_chunk();
+        closed_size_ += chunks_.back().end - chunks_.back().begin;
+    }
+    chunk_t chunk;
+    chunk.data.init(std::max(min_size, next_chunk_size_));
+    chunk.begin = 0;
+    chunk.end = 0;
+    next_chunk_size_ = next_chunk_size_ * 2 < MAX_CHUNK_SIZE
+        ? next_chunk_size_ * 2
+        : MAX_CHUNK_SIZE;
+    cur_ = chunk.data.data();
+    end_ = chunk.data.data() + chunk.data.size();
+    chunks_.push_back(std::move(chunk));
+}
+
+void chunked_string_buffer_t::close_last_chunk() {
+    chunk_t *last = &chunks_.back();
+    last->end = cur_ - last->data.data();
+}
@@ -0,0 +1,81 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_CHUNKED_STRING_BUFFER_HPP_
+#define CONTAINERS_CHUNKED_STRING_BUFFER_HPP_
+
+#include <string>
+#include <vector>
+
+#include "containers/buffer_group.hpp"
+#include "containers/scoped.hpp"
+#include "errors.hpp"
+
+/* `chunked_string_buffer_t` is an output stream for `rapidjson::Writer` that keeps what
+gets written to it in a list of separately allocated chunks instead of a single
+contiguous array. Unlike `rapidjson::StringBuffer`, it never has to reallocate and copy
+the data it has already collected, so serializing a large response doesn't need
+several times the size of the response at once. The chunks can be handed to
+`tcp_conn_t::write()` one by one with `get_chunks()`. */
+class chunked_string_buffer_t {
+public:
+    typedef char Ch;
+
+    // The first chunk is small, because most responses are. Every chunk after it is
+    // twice as large as the one before, up to `MAX_CHUNK_SIZE`.
+    static const size_t INITIAL_CHUNK_SIZE = 4 * 1024;
+    static const size_t MAX_CHUNK_SIZE = 256 * 1024;
+
+    chunked_string_buffer_t();
+
+    // The output stream interface that `rapidjson::Writer` uses.
+    void Put(char c) {
+        if (cur_ == end_) {
+            add_chunk(1);
+        }
+        *cur_++ = c;
+    }
+    void Flush() { }
+    // Returns `count` contiguous characters at the end of the buffer.
+    char *Push(size_t count);
+    // Removes the last `count` characters.
+    void Pop(size_t count);
+    size_t GetSize() const;
+
+    // Called by `rapidjson::Writer::SpliceArray()`. Appends the elements of the JSON
+    // array in `array` to this buffer and leaves `array` empty. The chunks of `array`
+    // are moved over rather than copied.
+    void SpliceArray(chunked_string_buffer_t *array);
+
+    // Appends the contents of `other` to this buffer and leaves `other` empty, again
+    // by moving the chunks over.
+    void append(chunked_string_buffer_t *other);
+
+    // Adds the non-empty chunks to `out`, in order. They stay valid until the buffer
+    // is modified or destroyed.
+    void get_chunks(const_buffer_group_t *out) const;
+    void append_to(std::string *out) const;
+
+private:
+    struct chunk_t {
+        scoped_array_t<char> data;
+        // The part of `data` that is in use. For the last chunk, `cur_` takes the
+        // place of `end`.
+        size_t begin;
+        size_t end;
+    };
+
+    void add_chunk(size_t min_size);
+    // Updates `end` of the last chunk from `cur_`.
+    void close_last_chunk();
+
+    std::vector<chunk_t> chunks_;
+    // The size of all chunks but the last one.
+    size_t closed_size_;
+    size_t next_chunk_size_;
+    // The free space in the last chunk.
+    char *cur_;
+    char *end_;
+
+    DISABLE_COPYING(chunked_string_buffer_t);
+};
+
+#endif  // CONTAINERS_CHUNKED_STRING_BUFFER_HPP_
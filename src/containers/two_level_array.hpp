@@ -48,9 +48,15 @@ private:
 public:
     two_level_array_t() { }
     ~two_level_array_t() {
+        clear();
+    }
+
+    // Resets every value to value_t().
+    void clear() {
         for (auto it = chunks.begin(); it != chunks.end(); ++it) {
             delete *it;
         }
+        chunks.clear();
     }
 
     value_t get(size_t key) const {
@@ -0,0 +1,139 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "perfmon/histogram.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+latency_histogram_t::latency_histogram_t() {
+    clear();
+}
+
+void latency_histogram_t::record(ticks_t duration) {
+    const uint64_t micros = duration.nanos > 0 ? duration.nanos / 1000 : 0;
+    ++buckets_[bucket_index(micros)];
+    ++count_;
+    max_micros_ = std::max(max_micros_, micros);
+}
+
+void latency_histogram_t::merge(const latency_histogram_t &other) {
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    max_micros_ = std::max(max_micros_, other.max_micros_);
+}
+
+void latency_histogram_t::clear() {
+    memset(buckets_, 0, sizeof(buckets_));
+    count_ = 0;
+    max_micros_ = 0;
+}
+
+uint64_t latency_histogram_t::percentile_micros(double fraction) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    const uint64_t target = std::max<uint64_t>(
+        1, static_cast<uint64_t>(ceil(fraction * static_cast<double>(count_))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        seen += buckets_[i];
+        if (seen >= target) {
+            // The maximum is exact, so there's no point in reporting more than that.
+            return std::min(bucket_upper_bound(i), max_micros_);
+        }
+    }
+    return max_micros_;
+}
+
+ql::datum_t latency_histogram_t::to_datum(bool include_buckets) const {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("count", ql::datum_t(static_cast<double>(count_)));
+
+    const std::pair<const char *, double> percentiles[] = {
+        std::make_pair("p50", 0.5),
+        std::make_pair("p90", 0.9),
+        std::make_pair("p99", 0.99),
+        std::make_pair("p99_9", 0.999) };
+    for (const auto &p : percentiles) {
+        builder.overwrite(p.first, count_ == 0
+            ? ql::datum_t::null()
+            : ql::datum_t(percentile_micros(p.second) / 1000.0));
+    }
+    builder.overwrite("max", count_ == 0
+        ? ql::datum_t::null()
+        : ql::datum_t(max_micros_ / 1000.0));
+
+    if (include_buckets) {
+        ql::datum_array_builder_t buckets(ql::configured_limits_t::unlimited);
+        for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+            if (buckets_[i] != 0) {
+                ql::datum_array_builder_t bucket(ql::configured_limits_t::unlimited);
+                bucket.add(ql::datum_t(static_cast<double>(i)));
+                bucket.add(ql::datum_t(static_cast<double>(buckets_[i])));
+                buckets.add(std::move(bucket).to_datum());
+            }
+        }
+        builder.overwrite("buckets", std::move(buckets).to_datum());
+    }
+    return std::move(builder).to_datum();
+}
+
+bool latency_histogram_t::from_datum(const ql::datum_t &datum,
+                                     latency_histogram_t *out) {
+    out->clear();
+    if (datum.get_type() != ql::datum_t::R_OBJECT) {
+        return false;
+    }
+    ql::datum_t buckets = datum.get_field("buckets", ql::NOTHROW);
+    ql::datum_t max = datum.get_field("max", ql::NOTHROW);
+    if (!buckets.has() || buckets.get_type() != ql::datum_t::R_ARRAY || !max.has()) {
+        return false;
+    }
+    for (size_t i = 0; i < buckets.arr_size(); ++i) {
+        ql::datum_t bucket = buckets.get(i);
+        if (bucket.get_type() != ql::datum_t::R_ARRAY || bucket.arr_size() != 2
+            || bucket.get(0).get_type() != ql::datum_t::R_NUM
+            || bucket.get(1).get_type() != ql::datum_t::R_NUM) {
+            return false;
+        }
+        const double index = bucket.get(0).as_num();
+        const double count = bucket.get(1).as_num();
+        if (index < 0 || index >= NUM_BUCKETS || count < 0) {
+            return false;
+        }
+        out->buckets_[static_cast<size_t>(index)] += static_cast<uint64_t>(count);
+        out->count_ += static_cast<uint64_t>(count);
+    }
+    if (max.get_type() == ql::datum_t::R_NUM) {
+        out->max_micros_ = static_cast<uint64_t>(llround(max.as_num() * 1000.0));
+    }
+    return true;
+}
+
+size_t latency_histogram_t::bucket_index(uint64_t micros) {
+    micros = std::min(micros, (static_cast<uint64_t>(1) << MAX_BITS) - 1);
+    if (micros < (static_cast<uint64_t>(1) << SUB_BUCKET_BITS)) {
+        return micros;
+    }
+    // The position of the highest bit picks the power of two, and the bits below it
+    // pick the bucket within it.
+    const int exponent = 63 - __builtin_clzll(micros);
+    const int shift = exponent - SUB_BUCKET_BITS;
+    return ((shift + 1) << SUB_BUCKET_BITS)
+        + ((micros >> shift) & ((1 << SUB_BUCKET_BITS) - 1));
+}
+
+uint64_t latency_histogram_t::bucket_upper_bound(size_t index) {
+    const size_t group = index >> SUB_BUCKET_BITS;
+    if (group == 0) {
+        return index;
+    }
+    const uint64_t sub_bucket = index & ((1 << SUB_BUCKET_BITS) - 1);
+    const int shift = group - 1;
+    const uint64_t lower = ((static_cast<uint64_t>(1) << SUB_BUCKET_BITS) + sub_bucket)
+        << shift;
+    return lower + (static_cast<uint64_t>(1) << shift) - 1;
+}
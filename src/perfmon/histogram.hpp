@@ -0,0 +1,55 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef PERFMON_HISTOGRAM_HPP_
+#define PERFMON_HISTOGRAM_HPP_
+
+#include <stdint.h>
+
+#include "rdb_protocol/datum.hpp"
+#include "time.hpp"
+
+/* `latency_histogram_t` counts durations in log-linear buckets, similar to an HDR
+histogram: every power of two is split into `1 << SUB_BUCKET_BITS` buckets of equal
+width, so a value is known up to 12.5% no matter how large it is, while the histogram
+has a fixed size. Histograms can be merged, which is how the per-thread histograms of
+`perfmon_latency_histogram_t` get combined, and how the stats of several servers or
+shards get combined into one.
+
+Durations are counted in microseconds. Longer durations than about 19 hours end up in
+the last bucket. */
+class latency_histogram_t {
+public:
+    static const int SUB_BUCKET_BITS = 3;
+    static const int MAX_BITS = 36;
+    static const size_t NUM_BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1)
+        << SUB_BUCKET_BITS;
+
+    latency_histogram_t();
+
+    void record(ticks_t duration);
+    void merge(const latency_histogram_t &other);
+    void clear();
+
+    uint64_t count() const { return count_; }
+
+    // Returns the smallest duration in microseconds that at least `fraction` of the
+    // recorded durations are less than or equal to (up to the bucket size), or 0 if
+    // nothing has been recorded.
+    uint64_t percentile_micros(double fraction) const;
+
+    /* Returns an object with the count, some percentiles and the maximum in
+    milliseconds. Unless `include_buckets` is false, it also contains the non-empty
+    buckets so that `from_datum()` can reconstruct the histogram for merging. */
+    ql::datum_t to_datum(bool include_buckets) const;
+    // Returns false if `datum` didn't come from `to_datum(true)`.
+    static bool from_datum(const ql::datum_t &datum, latency_histogram_t *out);
+
+private:
+    static size_t bucket_index(uint64_t micros);
+    static uint64_t bucket_upper_bound(size_t index);
+
+    uint64_t buckets_[NUM_BUCKETS];
+    uint64_t count_;
+    uint64_t max_micros_;
+};
+
+#endif  // PERFMON_HISTOGRAM_HPP_
@@ -302,6 +302,67 @@ ql::datum_t perfmon_rate_monitor_t::output_stat(const double &stat) {
     return ql::datum_t(stat / ticks_to_secs(length));
 }
 
+/* perfmon_latency_histogram_t */
+
+perfmon_latency_histogram_t::perfmon_latency_histogram_t(ticks_t _length)
+    : perfmon_perthread_t<latency_histogram_t>(), length(_length) { }
+
+perfmon_latency_histogram_t::thread_info_t *
+perfmon_latency_histogram_t::get_thread_info(ticks_t now) {
+    int64_t interval = now.nanos / length.nanos;
+    rassert(get_thread_id().threadnum >= 0);
+    std::unique_ptr<thread_info_t> &thread = thread_data[get_thread_id().threadnum];
+    if (!thread) {
+        thread.reset(new thread_info_t);
+        thread->current_interval = interval;
+    }
+
+    if (thread->current_interval == interval) {
+        /* We're up to date; nothing to do */
+    } else if (thread->current_interval + 1 == interval) {
+        /* We're one step behind */
+        thread->last = thread->current;
+        thread->current.clear();
+        thread->current_interval++;
+    } else {
+        /* We're more than one step behind */
+        thread->last.clear();
+        thread->current.clear();
+        thread->current_interval = interval;
+    }
+    return thread.get();
+}
+
+void perfmon_latency_histogram_t::record(ticks_t duration) {
+    get_thread_info(get_ticks())->current.record(duration);
+}
+
+void perfmon_latency_histogram_t::record_since(ticks_t start) {
+    ticks_t now = get_ticks();
+    get_thread_info(now)->current.record(ticks_t{now.nanos - start.nanos});
+}
+
+void perfmon_latency_histogram_t::get_thread_stat(latency_histogram_t *stat) {
+    rassert(get_thread_id().threadnum >= 0);
+    if (thread_data[get_thread_id().threadnum]) {
+        /* Like `perfmon_sampler_t`, we return the last complete interval. */
+        *stat = get_thread_info(get_ticks())->last;
+    }
+}
+
+latency_histogram_t perfmon_latency_histogram_t::combine_stats(
+        const latency_histogram_t *stats) {
+    latency_histogram_t combined;
+    for (int i = 0; i < get_num_threads(); i++) {
+        combined.merge(stats[i]);
+    }
+    return combined;
+}
+
+ql::datum_t perfmon_latency_histogram_t::output_stat(const latency_histogram_t &stat) {
+    return stat.to_datum(true);
+}
+
 perfmon_duration_sampler_t::perfmon_duration_sampler_t(ticks_t length, bool _ignore_global_full_perfmon)
     : stat(), active(), total(), recent(length, true),
       active_membership(&stat, &active, "active_count"),
@@ -16,6 +16,7 @@
 
 #include "concurrency/cache_line_padded.hpp"
 #include "config/args.hpp"
+#include "perfmon/histogram.hpp"
 #include "perfmon/types.hpp"
 #include "perfmon/core.hpp"
 #include "time.hpp"
@@ -215,6 +216,37 @@ public:
     void record(double value = 1.0);
 };
 
+/* perfmon_latency_histogram_t keeps a histogram of durations, such as the time it takes
+ * to run a query or to read a block from disk, and reports percentiles of them. Unlike
+ * perfmon_sampler_t, it can tell how long the slowest 1% or 0.1% of events took. Like
+ * perfmon_sampler_t, it reports on the last complete interval of `length` ticks. The
+ * output also contains the histogram's buckets, so that the histograms of several
+ * perfmons can be merged with `latency_histogram_t::from_datum()`.
+ *
+ * Each thread gets its own histogram, which is only allocated once the thread records
+ * something.
+ */
+class perfmon_latency_histogram_t : public perfmon_perthread_t<latency_histogram_t> {
+private:
+    struct thread_info_t {
+        latency_histogram_t current, last;
+        int64_t current_interval;
+    };
+
+    std::unique_ptr<thread_info_t> thread_data[MAX_THREADS];
+    thread_info_t *get_thread_info(ticks_t now);
+    ticks_t length;
+
+    void get_thread_stat(latency_histogram_t *);
+    latency_histogram_t combine_stats(const latency_histogram_t *);
+    ql::datum_t output_stat(const latency_histogram_t &);
+public:
+    explicit perfmon_latency_histogram_t(ticks_t length);
+    void record(ticks_t duration);
+    // Records the time that has passed since `start`, which came from `get_ticks()`.
+    void record_since(ticks_t start);
+};
+
 /* perfmon_duration_sampler_t is a perfmon_t that monitors events that have a
  * starting and ending time. When something starts, call begin(); when
  * something ends, call end() with the same value as begin. It will produce
@@ -145,20 +145,13 @@ public:
     }
 
 #endif
-    // RethinkDB addition: Splice a buffer (containing an array) into the current array
-    bool SpliceArray(const rapidjson::StringBuffer &buffer) {
+    // RethinkDB addition: Splice a buffer (containing an array) into the current array.
+    // The output stream takes over the contents of `buffer`, so it has to implement
+    // `SpliceArray()` itself.
+    bool SpliceArray(OutputStream *buffer) {
         RAPIDJSON_ASSERT(level_stack_.template Top<Level>()->inArray);
         Prefix(kStringType); // The type doesn't matter here
-
-        const Ch *data = buffer.GetString();
-        const size_t size = buffer.GetSize();
-
-        // Ignore the start and end square brackets in the array
-        RAPIDJSON_ASSERT(data[0] == '[');
-        RAPIDJSON_ASSERT(data[size - 1] == ']');
-        for (size_t i = 1; i < size - 1; ++i) {
-            os_->Put(data[i]);
-        }
+        os_->SpliceArray(buffer);
         return true;
     }
 
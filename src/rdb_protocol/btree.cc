@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 
+#include "btree/bulk_load.hpp"
 #include "btree/concurrent_traversal.hpp"
 #include "btree/get_distribution.hpp"
 #include "btree/operations.hpp"
@@ -27,6 +28,7 @@
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/geo_traversal.hpp"
 #include "rdb_protocol/lazy_btree_val.hpp"
+#include "rdb_protocol/parallel_terminal.hpp"
 #include "rdb_protocol/pseudo_geometry.hpp"
 #include "rdb_protocol/serialize_datum_onto_blob.hpp"
 #include "rdb_protocol/shards.hpp"
@@ -508,6 +510,159 @@ batched_replace_response_t rdb_batched_replace(
     return std::move(out).to_datum();
 }
 
+ql::datum_t rdb_append_one(
+    const btree_info_t &info,
+    const store_key_t &key,
+    const one_replace_t &one_replace,
+    max_block_size_t block_size,
+    btree_bulk_loader_t *loader,
+    const deletion_context_t *deletion_context,
+    rdb_modification_info_t *mod_info_out) {
+    const return_changes_t return_changes = one_replace.should_return_changes();
+    const datum_string_t &primary_key = info.primary_key;
+
+    // The key is greater than every key in the table, so there's no old row.
+    const ql::datum_t old_val = ql::datum_t::null();
+    ql::datum_t new_val;
+    try {
+        new_val = one_replace.replace(old_val);
+        rcheck_row_replacement(primary_key, key, old_val, new_val);
+        bool was_changed;
+        ql::datum_t resp = make_row_replacement_stats(
+            primary_key, key, old_val, new_val, return_changes, &was_changed);
+        if (!was_changed) {
+            return resp;
+        }
+        r_sanity_check(new_val.get_field(primary_key, ql::NOTHROW).has());
+
+        scoped_malloc_t<rdb_value_t> value(blob::btree_maxreflen);
+        memset(value.get(), 0, blob::btree_maxreflen);
+        {
+            blob_t blob(block_size, value->value_ref(), blob::btree_maxreflen);
+            ql::serialization_result_t res
+                = datum_serialize_onto_blob(loader->leaf(), &blob, new_val);
+            if (res & ql::serialization_result_t::ARRAY_TOO_BIG) {
+                rfail_typed_target(&new_val, "Array too large for disk writes "
+                                   "(limit 100,000 elements).");
+            } else if (res & ql::serialization_result_t::EXTREMA_PRESENT) {
+                rfail_typed_target(&new_val, "`r.minval` and `r.maxval` cannot be "
+                                   "written to disk.");
+            }
+            r_sanity_check(!ql::bad(res));
+        }
+
+        mod_info_out->added.first = new_val;
+        mod_info_out->added.second.assign(
+            value->value_ref(), value->value_ref() + value->inline_size(block_size));
+        loader->append(key.btree_key(), value.get(),
+                       deletion_context->balancing_detacher());
+        return resp;
+    } catch (const ql::base_exc_t &e) {
+        return make_row_replacement_error_stats(old_val,
+                                                new_val,
+                                                return_changes,
+                                                e.what());
+    } catch (const interrupted_exc_t &e) {
+        ql::datum_object_builder_t object_builder;
+        std::string msg = strprintf("interrupted (%s:%d)", __FILE__, __LINE__);
+        object_builder.add_error(msg.c_str());
+        return std::move(object_builder).to_datum();
+    }
+}
+
+bool rdb_batched_append(
+    const btree_info_t &info,
+    scoped_ptr_t<real_superblock_t> *superblock,
+    const std::vector<store_key_t> &keys,
+    const btree_batched_replacer_t *replacer,
+    rdb_modification_report_cb_t *sindex_cb,
+    ql::configured_limits_t limits,
+    profile::sampler_t *sampler,
+    profile::trace_t *trace,
+    batched_replace_response_t *response_out) {
+    if (keys.empty()) {
+        return false;
+    }
+
+    // The rows get appended in key order. If a key shows up more than once, the
+    // inserts would conflict with each other, so we leave that to
+    // `rdb_batched_replace()`. The same goes for limit changefeeds, which need to see
+    // the table after each change.
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return keys[a] < keys[b];
+    });
+    for (size_t i = 1; i < order.size(); ++i) {
+        if (keys[order[i - 1]] == keys[order[i]]) {
+            return false;
+        }
+    }
+    if (sindex_cb->has_pkey_cfeeds(keys)) {
+        return false;
+    }
+
+    // The results in the order of `keys`, so that the response (including the order
+    // of the changes and which error is the first one) is the same as if the rows had
+    // been written one by one.
+    std::vector<ql::datum_t> results(keys.size());
+    std::vector<rdb_modification_report_t> mod_reports;
+    std::vector<rwlock_in_line_t> stamp_spots;
+    mod_reports.reserve(keys.size());
+    stamp_spots.reserve(keys.size());
+    {
+        (*superblock)->get()->write_acq_signal()->wait_lazily_unordered();
+        rdb_value_sizer_t sizer((*superblock)->cache()->max_block_size());
+        if (!btree_bulk_loader_t::may_append(
+                &sizer, superblock->get(), keys[order[0]].btree_key())) {
+            return false;
+        }
+        btree_bulk_loader_t loader(&sizer, superblock->get(), info.timestamp);
+        if (!loader.can_append(keys[order[0]].btree_key())) {
+            return false;
+        }
+
+        sampler->new_sample();
+        PROFILE_STARTER_IF_ENABLED(
+            trace != nullptr, "Perform bulk append.", trace);
+        rdb_live_deletion_context_t deletion_context;
+        for (size_t index : order) {
+            info.slice->stats.pm_keys_set.record();
+            info.slice->stats.pm_total_keys_set += 1;
+            rdb_modification_report_t mod_report(keys[index]);
+            results[index] = rdb_append_one(
+                info, keys[index], one_replace_t(replacer, index),
+                sizer.block_size(), &loader, &deletion_context, &mod_report.info);
+            if (mod_report.info.added.first.has()) {
+                // We get in line for the changefeed stamp while we still hold the
+                // superblock, just like `do_a_replace_from_batched_replace()`.
+                stamp_spots.push_back(sindex_cb->get_in_line_for_cfeed_stamp());
+                mod_reports.push_back(std::move(mod_report));
+            }
+        }
+        loader.finish();
+    }
+    superblock->reset();
+
+    for (size_t i = 0; i < mod_reports.size(); ++i) {
+        new_mutex_in_line_t sindex_spot = sindex_cb->get_in_line_for_sindex();
+        sindex_cb->on_mod_report(mod_reports[i], false, &sindex_spot, &stamp_spots[i]);
+        stamp_spots[i].reset();
+    }
+
+    ql::datum_t stats = ql::datum_t::empty_object();
+    std::set<std::string> conditions;
+    for (const ql::datum_t &res : results) {
+        stats = stats.merge(res, ql::stats_merge, limits, &conditions);
+    }
+    ql::datum_object_builder_t out(stats);
+    out.add_warnings(conditions, limits);
+    *response_out = std::move(out).to_datum();
+    return true;
+}
+
 void rdb_set(const store_key_t &key,
              ql::datum_t data,
              bool overwrite,
@@ -642,7 +797,8 @@ public:
                region_t region,
                store_key_t last_key,
                sorting_t _sorting,
-               require_sindexes_t require_sindex_val)
+               require_sindexes_t require_sindex_val,
+               is_primary_t is_primary)
         : env(_env),
           batcher(make_scoped<ql::batcher_t>(batchspec.to_batcher())),
           sorting(_sorting),
@@ -657,6 +813,12 @@ public:
             transformers.push_back(ql::make_op(_transforms[i]));
         }
         guarantee(transformers.size() == _transforms.size());
+        // Transforms may need the secondary index value, which only the traversal
+        // can compute, so we only spread out the work of primary index reads.
+        if (is_primary == is_primary_t::YES && _terminal.has_value()) {
+            parallel_terminal = ql::parallel_terminal_t::make(
+                env, _transforms, *_terminal);
+        }
     }
     job_data_t(job_data_t &&) = default;
 
@@ -670,6 +832,10 @@ private:
     std::vector<scoped_ptr_t<ql::op_t> > transformers;
     sorting_t sorting;
     scoped_ptr_t<ql::accumulator_t> accumulator;
+    // If this is set, the transforms and `accumulator` aren't applied during the
+    // traversal. Instead the rows are evaluated on several threads, and the partial
+    // results are merged into `accumulator` at the end.
+    scoped_ptr_t<ql::parallel_terminal_t> parallel_terminal;
 };
 
 class rget_io_data_t {
@@ -761,7 +927,12 @@ rget_cb_t::rget_cb_t(rget_io_data_t &&_io,
 }
 
 void rget_cb_t::finish(continue_bool_t last_cb) THROWS_ONLY(interrupted_exc_t) {
-    job.accumulator->finish(last_cb, &io.response->result);
+    if (job.parallel_terminal.has()) {
+        job.parallel_terminal->finish(
+            job.accumulator.get(), last_cb, &io.response->result);
+    } else {
+        job.accumulator->finish(last_cb, &io.response->result);
+    }
 }
 
 // Handle a keyvalue pair.  Returns whether or not we're done early.
@@ -976,6 +1147,12 @@ continue_bool_t rget_cb_t::handle_pair(
             }
         }
 
+        if (job.parallel_terminal.has()) {
+            return job.parallel_terminal->add(std::move(val), copies)
+                ? continue_bool_t::CONTINUE
+                : continue_bool_t::ABORT;
+        }
+
         ql::groups_t data = {{ql::datum_t(), ql::datums_t(copies, val)}};
 
         for (auto it = job.transformers.begin(); it != job.transformers.end(); ++it) {
@@ -1037,7 +1214,8 @@ void rdb_rget_slice(
                        ? range.left
                        : range.right.key_or_max(),
                    sorting,
-                   require_sindexes_t::NO),
+                   require_sindexes_t::NO,
+                   is_primary_t::YES),
         r_nullopt);
 
     direction_t direction = reversed(sorting) ? BACKWARD : FORWARD;
@@ -1117,7 +1295,8 @@ void rdb_rget_secondary_slice(
                        ? sindex_region_range.left
                        : sindex_region_range.right.key_or_max(),
                    sorting,
-                   require_sindex_val),
+                   require_sindex_val,
+                   is_primary_t::NO),
         make_optional(rget_sindex_data_t(
             pk_range,
             datumspec,
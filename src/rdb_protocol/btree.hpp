@@ -121,6 +121,24 @@ batched_replace_response_t rdb_batched_replace(
     profile::sampler_t *sampler,
     profile::trace_t *trace);
 
+/* `rdb_batched_append()` is a fast path for batches of inserts into an empty table, or
+into a table whose keys are all smaller than those in the batch (for example when
+importing data that's sorted by primary key). Instead of looking up every key, it sorts
+the batch and appends the rows to the right edge of the primary B-tree with a
+`btree_bulk_loader_t`. Returns false without writing anything if the batch can't be
+appended; the caller should use `rdb_batched_replace()` in that case. On success, the
+superblock gets released. */
+bool rdb_batched_append(
+    const btree_info_t &info,
+    scoped_ptr_t<real_superblock_t> *superblock,
+    const std::vector<store_key_t> &keys,
+    const btree_batched_replacer_t *replacer,
+    rdb_modification_report_cb_t *sindex_cb,
+    ql::configured_limits_t limits,
+    profile::sampler_t *sampler,
+    profile::trace_t *trace,
+    batched_replace_response_t *response_out);
+
 void rdb_set(const store_key_t &key, ql::datum_t data,
              bool overwrite,
              btree_slice_t *slice, repli_timestamp_t timestamp,
@@ -0,0 +1,111 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/cbor.hpp"
+
+#include <string.h>
+
+namespace ql {
+namespace cbor {
+
+// The values of the "additional information" bits for some simple values and for
+// arguments that follow the initial byte.
+const uint8_t FALSE_VALUE = 20;
+const uint8_t TRUE_VALUE = 21;
+const uint8_t NULL_VALUE = 22;
+const uint8_t ONE_BYTE_ARGUMENT = 24;
+const uint8_t TWO_BYTE_ARGUMENT = 25;
+const uint8_t FOUR_BYTE_ARGUMENT = 26;
+const uint8_t EIGHT_BYTE_ARGUMENT = 27;
+
+uint8_t initial_byte(major_type_t major_type, uint8_t additional_info) {
+    return (static_cast<uint8_t>(major_type) << 5) | additional_info;
+}
+
+// CBOR is big-endian.
+void write_big_endian(uint64_t value, size_t size, char *out) {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = static_cast<char>(value >> (8 * (size - 1 - i)));
+    }
+}
+
+void write_head(major_type_t major_type,
+                uint64_t argument,
+                chunked_string_buffer_t *out) {
+    if (argument < ONE_BYTE_ARGUMENT) {
+        out->Put(initial_byte(major_type, static_cast<uint8_t>(argument)));
+        return;
+    }
+    uint8_t additional_info;
+    size_t size;
+    if (argument <= UINT8_MAX) {
+        additional_info = ONE_BYTE_ARGUMENT;
+        size = 1;
+    } else if (argument <= UINT16_MAX) {
+        additional_info = TWO_BYTE_ARGUMENT;
+        size = 2;
+    } else if (argument <= UINT32_MAX) {
+        additional_info = FOUR_BYTE_ARGUMENT;
+        size = 4;
+    } else {
+        additional_info = EIGHT_BYTE_ARGUMENT;
+        size = 8;
+    }
+    char *buf = out->Push(1 + size);
+    buf[0] = initial_byte(major_type, additional_info);
+    write_big_endian(argument, size, buf + 1);
+}
+
+void write_null(chunked_string_buffer_t *out) {
+    out->Put(initial_byte(major_type_t::SIMPLE_OR_FLOAT, NULL_VALUE));
+}
+
+void write_bool(bool value, chunked_string_buffer_t *out) {
+    out->Put(initial_byte(major_type_t::SIMPLE_OR_FLOAT,
+                          value ? TRUE_VALUE : FALSE_VALUE));
+}
+
+void write_int(int64_t value, chunked_string_buffer_t *out) {
+    if (value >= 0) {
+        write_head(major_type_t::UNSIGNED_INT, static_cast<uint64_t>(value), out);
+    } else {
+        // Negative integers are encoded as -1 minus the argument.
+        write_head(major_type_t::NEGATIVE_INT, -(value + 1), out);
+    }
+}
+
+void write_double(double value, chunked_string_buffer_t *out) {
+    static_assert(sizeof(double) == sizeof(uint64_t), "Unexpected size of double.");
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    char *buf = out->Push(1 + sizeof(bits));
+    buf[0] = initial_byte(major_type_t::SIMPLE_OR_FLOAT, EIGHT_BYTE_ARGUMENT);
+    write_big_endian(bits, sizeof(bits), buf + 1);
+}
+
+void write_string(major_type_t major_type,
+                  const char *data,
+                  size_t size,
+                  chunked_string_buffer_t *out) {
+    write_head(major_type, size, out);
+    if (size > 0) {
+        memcpy(out->Push(size), data, size);
+    }
+}
+
+void write_text(const char *data, size_t size, chunked_string_buffer_t *out) {
+    write_string(major_type_t::TEXT_STRING, data, size, out);
+}
+
+void write_bytes(const char *data, size_t size, chunked_string_buffer_t *out) {
+    write_string(major_type_t::BYTE_STRING, data, size, out);
+}
+
+void write_array_head(size_t size, chunked_string_buffer_t *out) {
+    write_head(major_type_t::ARRAY, size, out);
+}
+
+void write_map_head(size_t size, chunked_string_buffer_t *out) {
+    write_head(major_type_t::MAP, size, out);
+}
+
+}  // namespace cbor
+}  // namespace ql
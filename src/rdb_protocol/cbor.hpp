@@ -0,0 +1,44 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_CBOR_HPP_
+#define RDB_PROTOCOL_CBOR_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "containers/chunked_string_buffer.hpp"
+
+namespace ql {
+namespace cbor {
+
+/* Functions for writing CBOR (RFC 7049) data items. Only definite-length items are
+written, since we always know the sizes of arrays, maps and strings up front. */
+
+enum class major_type_t {
+    UNSIGNED_INT = 0,
+    NEGATIVE_INT = 1,
+    BYTE_STRING = 2,
+    TEXT_STRING = 3,
+    ARRAY = 4,
+    MAP = 5,
+    TAG = 6,
+    SIMPLE_OR_FLOAT = 7
+};
+
+// Writes the initial byte of a data item and, if needed, the argument that follows it.
+void write_head(major_type_t major_type, uint64_t argument, chunked_string_buffer_t *out);
+
+void write_null(chunked_string_buffer_t *out);
+void write_bool(bool value, chunked_string_buffer_t *out);
+void write_int(int64_t value, chunked_string_buffer_t *out);
+void write_double(double value, chunked_string_buffer_t *out);
+void write_text(const char *data, size_t size, chunked_string_buffer_t *out);
+void write_bytes(const char *data, size_t size, chunked_string_buffer_t *out);
+
+// The elements or key/value pairs must follow.
+void write_array_head(size_t size, chunked_string_buffer_t *out);
+void write_map_head(size_t size, chunked_string_buffer_t *out);
+
+}  // namespace cbor
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_CBOR_HPP_
@@ -9,6 +9,7 @@
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/interruptor.hpp"
 #include "containers/archive/boost_types.hpp"
+#include "containers/archive/vector_stream.hpp"
 #include "rdb_protocol/artificial_table/backend.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/env.hpp"
@@ -499,6 +500,34 @@ struct stamped_msg_t {
 
 RDB_MAKE_SERIALIZABLE_3(stamped_msg_t, server_uuid, stamp, submsg);
 
+// Writes a `stamped_msg_t` whose `submsg` has already been serialized, so that
+// `send_all` doesn't have to serialize the same `msg_t` for every feed it sends it to.
+class stamped_msg_writer_t : public mailbox_write_callback_t {
+public:
+    stamped_msg_writer_t(const uuid_u &_server_uuid,
+                         uint64_t _stamp,
+                         const std::vector<char> *_serialized_submsg)
+        : server_uuid(_server_uuid),
+          stamp(_stamp),
+          serialized_submsg(_serialized_submsg) { }
+    void write(DEBUG_VAR cluster_version_t cluster_version, write_message_t *wm) {
+        rassert(cluster_version == cluster_version_t::CLUSTER);
+        // This has to match the serialization of `stamped_msg_t` above.
+        serialize<cluster_version_t::CLUSTER>(wm, server_uuid);
+        serialize<cluster_version_t::CLUSTER>(wm, stamp);
+        wm->append(serialized_submsg->data(), serialized_submsg->size());
+    }
+#ifdef ENABLE_MESSAGE_PROFILER
+    const char *message_profiler_tag() const {
+        return "changefeed::stamped_msg_t";
+    }
+#endif
+private:
+    const uuid_u server_uuid;
+    const uint64_t stamp;
+    const std::vector<char> *const serialized_submsg;
+};
+
 // This function takes a `lock_t` to make sure you have one.  (We can't just
 // always acquire a drainer lock before sending because we sometimes send a
 // `stop_t` during destruction, and you can't acquire a drain lock on a draining
@@ -541,8 +570,23 @@ void server_t::send_all(
     }
     acq.reset();
     stamp_spot->reset(); // Done stamping, no need to hold onto it while we send.
+    if (stamps.empty()) {
+        return;
+    }
+
+    // Every feed gets the same `msg_t`, so we only serialize it once. There is one
+    // feed per table and subscribed server (see `client_t`), but a table with feeds
+    // on many servers would otherwise serialize the same values for each of them.
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, msg);
+    vector_stream_t serialized_msg;
+    serialized_msg.reserve(wm.size());
+    int res = send_write_message(&serialized_msg, &wm);
+    guarantee(res == 0);
+
     for (const auto &pair : stamps) {
-        send(manager, pair.first, stamped_msg_t(uuid, pair.second, msg));
+        stamped_msg_writer_t writer(uuid, pair.second, &serialized_msg.vector());
+        send_write(manager, pair.first, &writer);
     }
 }
 
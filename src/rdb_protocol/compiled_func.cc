@@ -0,0 +1,299 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/compiled_func.hpp"
+
+#include "math.hpp"
+#include "rdb_protocol/error.hpp"
+#include "rdb_protocol/var_types.hpp"
+
+namespace ql {
+
+// Deeper function bodies are evaluated through the term tree, which guards against
+// running out of stack space.
+const size_t MAX_COMPILED_FUNC_DEPTH = 64;
+
+scoped_ptr_t<compiled_func_t> compiled_func_t::compile(
+        const var_scope_t &captured_scope,
+        const std::vector<sym_t> &arg_names,
+        const raw_term_t &body) {
+    scoped_ptr_t<compiled_func_t> res(new compiled_func_t());
+    if (!res->compile_term(captured_scope, arg_names, body, 0, &res->root)) {
+        return scoped_ptr_t<compiled_func_t>();
+    }
+    return res;
+}
+
+bool compiled_func_t::compile_term(const var_scope_t &captured_scope,
+                                   const std::vector<sym_t> &arg_names,
+                                   const raw_term_t &term,
+                                   size_t depth,
+                                   size_t *index_out) {
+    if (depth >= MAX_COMPILED_FUNC_DEPTH || term.num_optargs() != 0) {
+        return false;
+    }
+
+    instruction_t instruction;
+    instruction.arg_index = 0;
+    size_t min_args;
+    size_t max_args = SIZE_MAX;
+    switch (static_cast<int>(term.type())) {
+    case Term::DATUM: {
+        datum_t d = term.datum();
+        switch (d.get_type()) {
+        case datum_t::R_NULL: // fallthru
+        case datum_t::R_BOOL: // fallthru
+        case datum_t::R_NUM: // fallthru
+        case datum_t::R_STR:
+            break;
+        case datum_t::R_ARRAY: // fallthru
+        case datum_t::R_BINARY: // fallthru
+        case datum_t::R_OBJECT: // fallthru
+        case datum_t::MINVAL: // fallthru
+        case datum_t::MAXVAL: // fallthru
+        case datum_t::UNINITIALIZED: // fallthru
+        default:
+            return false;
+        }
+        instruction.opcode = opcode_t::CONSTANT;
+        instruction.constant = std::move(d);
+        min_args = max_args = 0;
+    } break;
+    case Term::VAR: {
+        if (term.num_args() != 1 || term.arg(0).type() != Term::DATUM) {
+            return false;
+        }
+        datum_t name = term.arg(0).datum();
+        if (name.get_type() != datum_t::R_NUM) {
+            return false;
+        }
+        const sym_t var(name.as_int());
+        bool is_arg = false;
+        for (size_t i = 0; i < arg_names.size(); ++i) {
+            if (arg_names[i].value == var.value) {
+                // Later arguments shadow earlier ones with the same name, like in
+                // `var_scope_t::with_func_arg_list()`.
+                instruction.arg_index = i;
+                is_arg = true;
+            }
+        }
+        if (is_arg) {
+            instruction.opcode = opcode_t::ARG;
+        } else if (captured_scope.compute_visibility().contains_var(var)) {
+            // Captured variables can't change between calls.
+            instruction.opcode = opcode_t::CONSTANT;
+            instruction.constant = captured_scope.lookup_var(var);
+        } else {
+            return false;
+        }
+        min_args = max_args = 0;
+    } break;
+    case Term::IMPLICIT_VAR: {
+        // We only handle `r.row` if it refers to this function's own argument.
+        if (!function_emits_implicit_variable(arg_names)
+            || !captured_scope.compute_visibility().with_func_arg_name_list(
+                arg_names).implicit_is_accessible()) {
+            return false;
+        }
+        instruction.opcode = opcode_t::ARG;
+        instruction.arg_index = 0;
+        min_args = max_args = 0;
+    } break;
+    case Term::BRACKET: // fallthru
+    case Term::GET_FIELD: {
+        if (term.num_args() != 2 || term.arg(1).type() != Term::DATUM) {
+            return false;
+        }
+        datum_t field = term.arg(1).datum();
+        if (field.get_type() != datum_t::R_STR) {
+            return false;
+        }
+        instruction.opcode = opcode_t::GET_FIELD;
+        instruction.constant = std::move(field);
+        // The field name is stored in the instruction, so we only compile the object.
+        min_args = max_args = 1;
+    } break;
+    case Term::EQ: instruction.opcode = opcode_t::EQ; min_args = 2; break;
+    case Term::NE: instruction.opcode = opcode_t::NE; min_args = 2; break;
+    case Term::LT: instruction.opcode = opcode_t::LT; min_args = 2; break;
+    case Term::LE: instruction.opcode = opcode_t::LE; min_args = 2; break;
+    case Term::GT: instruction.opcode = opcode_t::GT; min_args = 2; break;
+    case Term::GE: instruction.opcode = opcode_t::GE; min_args = 2; break;
+    case Term::NOT: instruction.opcode = opcode_t::NOT; min_args = max_args = 1; break;
+    case Term::AND: instruction.opcode = opcode_t::AND; min_args = 0; break;
+    case Term::OR: instruction.opcode = opcode_t::OR; min_args = 0; break;
+    case Term::ADD: instruction.opcode = opcode_t::ADD; min_args = 1; break;
+    case Term::SUB: instruction.opcode = opcode_t::SUB; min_args = 1; break;
+    case Term::MUL: instruction.opcode = opcode_t::MUL; min_args = 1; break;
+    case Term::DIV: instruction.opcode = opcode_t::DIV; min_args = 1; break;
+    default:
+        return false;
+    }
+
+    if (min_args == 0 && max_args == 0) {
+        if (term.type() != Term::DATUM && term.type() != Term::VAR
+            && term.num_args() != 0) {
+            return false;
+        }
+    } else {
+        const size_t num_args = term.type() == Term::BRACKET
+            || term.type() == Term::GET_FIELD ? 1 : term.num_args();
+        if (num_args < min_args || num_args > max_args) {
+            return false;
+        }
+        for (size_t i = 0; i < num_args; ++i) {
+            size_t operand;
+            if (!compile_term(captured_scope, arg_names, term.arg(i), depth + 1,
+                              &operand)) {
+                return false;
+            }
+            instruction.operands.push_back(operand);
+        }
+    }
+
+    instructions.push_back(std::move(instruction));
+    *index_out = instructions.size() - 1;
+    return true;
+}
+
+datum_t compiled_func_t::eval(const std::vector<datum_t> &args) const {
+    datum_t res;
+    try {
+        if (!eval_instruction(root, args, &res)) {
+            return datum_t();
+        }
+    } catch (const base_exc_t &) {
+        // The term tree will produce the error, with a proper backtrace.
+        return datum_t();
+    }
+    return res;
+}
+
+bool compiled_func_t::eval_instruction(size_t index,
+                                       const std::vector<datum_t> &args,
+                                       datum_t *out) const {
+    const instruction_t &instruction = instructions[index];
+    switch (instruction.opcode) {
+    case opcode_t::CONSTANT:
+        *out = instruction.constant;
+        return true;
+    case opcode_t::ARG:
+        if (instruction.arg_index >= args.size()) {
+            return false;
+        }
+        *out = args[instruction.arg_index];
+        return out->has();
+    case opcode_t::GET_FIELD: {
+        datum_t obj;
+        if (!eval_instruction(instruction.operands[0], args, &obj)
+            || obj.get_type() != datum_t::R_OBJECT) {
+            return false;
+        }
+        *out = obj.get_field(instruction.constant.as_str(), NOTHROW);
+        return out->has();
+    }
+    case opcode_t::EQ: // fallthru
+    case opcode_t::NE: // fallthru
+    case opcode_t::LT: // fallthru
+    case opcode_t::LE: // fallthru
+    case opcode_t::GT: // fallthru
+    case opcode_t::GE: {
+        // Like `predicate_term_t`, this stops evaluating the arguments as soon as one
+        // of the comparisons is false, and `NE` inverts the whole chain.
+        datum_t lhs;
+        if (!eval_instruction(instruction.operands[0], args, &lhs)) {
+            return false;
+        }
+        bool result = true;
+        for (size_t i = 1; i < instruction.operands.size(); ++i) {
+            datum_t rhs;
+            if (!eval_instruction(instruction.operands[i], args, &rhs)) {
+                return false;
+            }
+            bool holds;
+            if (instruction.opcode == opcode_t::EQ
+                || instruction.opcode == opcode_t::NE) {
+                holds = lhs == rhs;
+            } else {
+                const int c = lhs.cmp(rhs);
+                holds = instruction.opcode == opcode_t::LT ? c < 0
+                    : instruction.opcode == opcode_t::LE ? c <= 0
+                    : instruction.opcode == opcode_t::GT ? c > 0
+                    : c >= 0;
+            }
+            if (!holds) {
+                result = false;
+                break;
+            }
+            lhs = std::move(rhs);
+        }
+        *out = datum_t::boolean(instruction.opcode == opcode_t::NE ? !result : result);
+        return true;
+    }
+    case opcode_t::NOT: {
+        datum_t v;
+        if (!eval_instruction(instruction.operands[0], args, &v)) {
+            return false;
+        }
+        *out = datum_t::boolean(!v.as_bool());
+        return true;
+    }
+    case opcode_t::AND: // fallthru
+    case opcode_t::OR: {
+        // Like `and_term_t` and `or_term_t`, this returns the last value that was
+        // evaluated.
+        const bool is_and = instruction.opcode == opcode_t::AND;
+        datum_t v = datum_t::boolean(is_and);
+        for (size_t i = 0; i < instruction.operands.size(); ++i) {
+            if (!eval_instruction(instruction.operands[i], args, &v)) {
+                return false;
+            }
+            if (v.as_bool() != is_and) {
+                break;
+            }
+        }
+        *out = std::move(v);
+        return true;
+    }
+    case opcode_t::ADD: // fallthru
+    case opcode_t::SUB: // fallthru
+    case opcode_t::MUL: // fallthru
+    case opcode_t::DIV: {
+        datum_t acc;
+        if (!eval_instruction(instruction.operands[0], args, &acc)) {
+            return false;
+        }
+        for (size_t i = 1; i < instruction.operands.size(); ++i) {
+            datum_t rhs;
+            if (!eval_instruction(instruction.operands[i], args, &rhs)) {
+                return false;
+            }
+            // Strings, arrays and times are left to `arith_term_t`.
+            if (acc.get_type() != datum_t::R_NUM || rhs.get_type() != datum_t::R_NUM) {
+                return false;
+            }
+            double num;
+            if (instruction.opcode == opcode_t::ADD) {
+                num = acc.as_num() + rhs.as_num();
+            } else if (instruction.opcode == opcode_t::SUB) {
+                num = acc.as_num() - rhs.as_num();
+            } else if (instruction.opcode == opcode_t::MUL) {
+                num = acc.as_num() * rhs.as_num();
+            } else {
+                if (rhs.as_num() == 0) {
+                    return false;
+                }
+                num = acc.as_num() / rhs.as_num();
+            }
+            if (!risfinite(num)) {
+                return false;
+            }
+            acc = datum_t(num);
+        }
+        *out = std::move(acc);
+        return true;
+    }
+    default:
+        unreachable();
+    }
+}
+
+}  // namespace ql
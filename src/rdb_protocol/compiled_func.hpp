@@ -0,0 +1,92 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_COMPILED_FUNC_HPP_
+#define RDB_PROTOCOL_COMPILED_FUNC_HPP_
+
+#include <vector>
+
+#include "containers/scoped.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/ql2proto.hpp"
+#include "rdb_protocol/sym.hpp"
+#include "rdb_protocol/term_storage.hpp"
+
+namespace ql {
+
+class var_scope_t;
+
+/* `compiled_func_t` evaluates the body of a simple ReQL function directly on
+`datum_t`s, rather than walking the term tree and allocating a `val_t` for every term
+along the way. The body gets flattened into a vector of instructions that refer to
+their operands by index. Only literals, variables, field access, comparisons,
+arithmetic and boolean logic are supported; `compile()` returns an empty pointer for
+functions that use anything else.
+
+Whenever evaluation runs into something that the term tree would handle differently
+(errors such as a missing field, but also e.g. adding two strings), `eval()` gives up
+and returns an empty `datum_t`. The caller then evaluates the function through the
+term tree instead, which produces the right result or error. This is safe because
+all the supported terms are deterministic and have no side effects. */
+class compiled_func_t {
+public:
+    static scoped_ptr_t<compiled_func_t> compile(const var_scope_t &captured_scope,
+                                                 const std::vector<sym_t> &arg_names,
+                                                 const raw_term_t &body);
+
+    // Returns an empty `datum_t` if the function needs to be evaluated through the
+    // term tree.
+    datum_t eval(const std::vector<datum_t> &args) const;
+
+private:
+    enum class opcode_t {
+        CONSTANT,
+        ARG,
+        GET_FIELD,
+        EQ,
+        NE,
+        LT,
+        LE,
+        GT,
+        GE,
+        NOT,
+        AND,
+        OR,
+        ADD,
+        SUB,
+        MUL,
+        DIV
+    };
+
+    struct instruction_t {
+        opcode_t opcode;
+        // The constant for `CONSTANT`, or the field name for `GET_FIELD`.
+        datum_t constant;
+        // The argument index for `ARG`.
+        size_t arg_index;
+        // The instructions that compute the operands.
+        std::vector<size_t> operands;
+    };
+
+    compiled_func_t() { }
+
+    // Appends the instructions for `term` and returns the index of the one that
+    // computes its value, or returns false if `term` can't be compiled.
+    bool compile_term(const var_scope_t &captured_scope,
+                      const std::vector<sym_t> &arg_names,
+                      const raw_term_t &term,
+                      size_t depth,
+                      size_t *index_out);
+
+    bool eval_instruction(size_t index,
+                          const std::vector<datum_t> &args,
+                          datum_t *out) const;
+
+    std::vector<instruction_t> instructions;
+    // The instruction that computes the function's value.
+    size_t root;
+
+    DISABLE_COPYING(compiled_func_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_COMPILED_FUNC_HPP_
@@ -72,12 +72,16 @@ rdb_context_t::stats_t::stats_t(perfmon_collection_t *global_stats)
       queries_per_sec_membership(&qe_stats_collection,
                                  &queries_per_sec, "queries_per_sec"),
       queries_total_membership(&qe_stats_collection,
-                               &queries_total, "queries_total") { }
+                               &queries_total, "queries_total"),
+      query_latency(secs_to_ticks(10)),
+      query_latency_membership(&qe_stats_collection,
+                               &query_latency, "query_latency_ms") { }
 
 rdb_context_t::rdb_context_t()
     : extproc_pool(nullptr),
       cluster_interface(nullptr),
       manager(nullptr),
+      io_backender(nullptr),
       reql_http_proxy(),
       stats(&get_global_perfmon_collection()) { }
 
@@ -89,6 +93,7 @@ rdb_context_t::rdb_context_t(
     : extproc_pool(_extproc_pool),
       cluster_interface(_cluster_interface),
       manager(nullptr),
+      io_backender(nullptr),
       reql_http_proxy(),
       stats(&get_global_perfmon_collection()) {
     init_auth_watchables(auth_semilattice_view);
@@ -97,6 +102,8 @@ rdb_context_t::rdb_context_t(
 rdb_context_t::rdb_context_t(
         extproc_pool_t *_extproc_pool,
         mailbox_manager_t *_mailbox_manager,
+        io_backender_t *_io_backender,
+        const base_path_t &_base_path,
         reql_cluster_interface_t *_cluster_interface,
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view,
@@ -105,6 +112,8 @@ rdb_context_t::rdb_context_t(
     : extproc_pool(_extproc_pool),
       cluster_interface(_cluster_interface),
       manager(_mailbox_manager),
+      io_backender(_io_backender),
+      base_path(_base_path),
       reql_http_proxy(_reql_http_proxy),
       stats(global_stats) {
     init_auth_watchables(auth_semilattice_view);
@@ -15,6 +15,7 @@
 #include "containers/optional.hpp"
 #include "containers/scoped.hpp"
 #include "containers/uuid.hpp"
+#include "paths.hpp"
 #include "perfmon/perfmon.hpp"
 #include "protocol_api.hpp"
 #include "rdb_protocol/changefeed.hpp"
@@ -23,6 +24,7 @@
 #include "rdb_protocol/geo/lon_lat_types.hpp"
 #include "rdb_protocol/shards.hpp"
 #include "rdb_protocol/wire_func.hpp"
+#include "serializer/log/block_compression.hpp"
 
 namespace auth {
 
@@ -45,6 +47,7 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
 class auth_semilattice_metadata_t;
 class ellipsoid_spec_t;
 class extproc_pool_t;
+class io_backender_t;
 class name_string_t;
 class namespace_interface_t;
 template <class> class cross_thread_watchable_variable_t;
@@ -275,6 +278,8 @@ public:
             const table_generate_config_params_t &config_params,
             const std::string &primary_key,
             write_durability_t durability,
+            uint64_t block_size,
+            block_compression_t block_compression,
             signal_t *interruptor,
             ql::datum_t *result_out,
             admin_err_t *error_out) = 0;
@@ -464,6 +469,8 @@ public:
     rdb_context_t(
         extproc_pool_t *_extproc_pool,
         mailbox_manager_t *_mailbox_manager,
+        io_backender_t *_io_backender,
+        const base_path_t &_base_path,
         reql_cluster_interface_t *_cluster_interface,
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view,
@@ -477,6 +484,11 @@ public:
 
     mailbox_manager_t *manager;
 
+    // Used to spill large sorts to disk. `io_backender` is `nullptr` if there is no
+    // data directory to put the temporary files in (on proxies and in unit tests).
+    io_backender_t *io_backender;
+    const base_path_t base_path;
+
     const std::string reql_http_proxy;
 
     class stats_t {
@@ -493,6 +505,9 @@ public:
         perfmon_membership_t queries_per_sec_membership;
         perfmon_counter_t queries_total;
         perfmon_membership_t queries_total_membership;
+        // The time it takes to answer the START request of a query.
+        perfmon_latency_histogram_t query_latency;
+        perfmon_membership_t query_latency_membership;
     private:
         DISABLE_COPYING(stats_t);
     } stats;
@@ -22,6 +22,7 @@
 #include "rapidjson/rapidjson.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
+#include "rdb_protocol/cbor.hpp"
 #include "rdb_protocol/datum_stream/array.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/error.hpp"
@@ -1574,6 +1575,57 @@ template void datum_t::write_json(
     rapidjson::Writer<rapidjson::StringBuffer> *writer) const;
 template void datum_t::write_json(
     rapidjson::PrettyWriter<rapidjson::StringBuffer> *writer) const;
+template void datum_t::write_json(
+    rapidjson::Writer<chunked_string_buffer_t> *writer) const;
+
+void datum_t::write_cbor_unchecked_stack(chunked_string_buffer_t *out) const {
+    switch (get_type()) {
+    case MINVAL: rfail_datum(base_exc_t::LOGIC, "Cannot convert `r.minval` to CBOR.");
+    case MAXVAL: rfail_datum(base_exc_t::LOGIC, "Cannot convert `r.maxval` to CBOR.");
+    case R_NULL: cbor::write_null(out); break;
+    case R_BINARY: {
+        const datum_string_t &data = as_binary();
+        cbor::write_bytes(data.data(), data.size(), out);
+    } break;
+    case R_BOOL: cbor::write_bool(as_bool(), out); break;
+    case R_NUM: {
+        const double d = as_num();
+        // Same as in `write_json_unchecked_stack()`.
+        int64_t i;
+        if (!(d == 0.0 && std::signbit(d))
+            && number_as_integer(d, &i)) {
+            cbor::write_int(i, out);
+        } else {
+            cbor::write_double(d, out);
+        }
+    } break;
+    case R_STR: cbor::write_text(as_str().data(), as_str().size(), out); break;
+    case R_ARRAY: {
+        const size_t sz = arr_size();
+        cbor::write_array_head(sz, out);
+        for (size_t i = 0; i < sz; ++i) {
+            unchecked_get(i).write_cbor(out);
+        }
+    } break;
+    case R_OBJECT: {
+        const size_t sz = obj_size();
+        cbor::write_map_head(sz, out);
+        for (size_t i = 0; i < sz; ++i) {
+            auto pair = get_pair(i);
+            cbor::write_text(pair.first.data(), pair.first.size(), out);
+            pair.second.write_cbor(out);
+        }
+    } break;
+    case UNINITIALIZED: // fallthru
+    default: unreachable();
+    }
+}
+
+void datum_t::write_cbor(chunked_string_buffer_t *out) const {
+    call_with_enough_stack_datum([&] {
+            return this->write_cbor_unchecked_stack(out);
+        });
+}
 
 rapidjson::Value datum_t::as_json(rapidjson::Value::AllocatorType *allocator) const {
     switch (get_type()) {
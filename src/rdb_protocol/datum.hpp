@@ -13,6 +13,7 @@
 
 #include "cjson/json.hpp"
 #include "containers/archive/archive.hpp"
+#include "containers/chunked_string_buffer.hpp"
 #include "containers/counted.hpp"
 #include "containers/optional.hpp"
 #include "rdb_protocol/datum_string.hpp"
@@ -301,9 +302,13 @@ public:
                   const configured_limits_t &limits,
                   std::set<std::string> *conditions) const;
 
-    // json_writer_t can be rapidjson::Writer<rapidjson::StringBuffer>
-    // or rapidjson::PrettyWriter<rapidjson::StringBuffer>
+    // json_writer_t can be rapidjson::Writer<rapidjson::StringBuffer>,
+    // rapidjson::PrettyWriter<rapidjson::StringBuffer> or
+    // rapidjson::Writer<chunked_string_buffer_t>
     template <class json_writer_t> void write_json(json_writer_t *writer) const;
+    // Like `write_json()`, but writes CBOR. Binary data is written as a byte string
+    // rather than as a base64-encoded pseudotype.
+    void write_cbor(chunked_string_buffer_t *out) const;
     rapidjson::Value as_json(rapidjson::Value::AllocatorType *allocator) const;
 
     // DEPRECATED: Used for backwards compatibility with reql_versions before 2.1
@@ -371,6 +376,7 @@ private:
 
     template <class json_writer_t>
     void write_json_unchecked_stack(json_writer_t *writer) const;
+    void write_cbor_unchecked_stack(chunked_string_buffer_t *out) const;
 
     // Same as get_pair() / get(), but don't perform boundary or type checks.
     // For internal use to improve performance.
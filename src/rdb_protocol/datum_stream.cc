@@ -6,6 +6,7 @@
 #include "rdb_protocol/batching.hpp"
 #include "rdb_protocol/datum_stream/array.hpp"
 #include "rdb_protocol/datum_stream/eq_join.hpp"
+#include "rdb_protocol/datum_stream/external_sort.hpp"
 #include "rdb_protocol/datum_stream/fold.hpp"
 #include "rdb_protocol/datum_stream/indexed_sort.hpp"
 #include "rdb_protocol/datum_stream/lazy.hpp"
@@ -1622,6 +1623,242 @@ indexed_sort_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batch
     return ret;
 }
 
+// EXTERNAL_SORT_DATUM_STREAM_T
+
+// How many runs of the same level get merged into one. This bounds the number of
+// temporary files, each of which has its own serializer and cache.
+const size_t EXTERNAL_SORT_MERGE_FAN_IN = 16;
+
+// Every push is one transaction, so we write a limited number of elements at a time
+// to keep the transactions small.
+const size_t EXTERNAL_SORT_ELEMENTS_PER_PUSH = 256;
+
+external_sort_datum_stream_t::run_t::run_t(io_backender_t *io_backender,
+                                           const serializer_filepath_t &filename,
+                                           perfmon_collection_t *stats_parent,
+                                           int _level)
+    : queue(io_backender, filename, stats_parent), level(_level) { }
+
+bool external_sort_datum_stream_t::is_available(env_t *env) {
+    return env->get_rdb_ctx() != nullptr
+        && env->get_rdb_ctx()->io_backender != nullptr;
+}
+
+external_sort_datum_stream_t::external_sort_datum_stream_t(
+    env_t *env,
+    std::function<bool(env_t *,  // NOLINT(readability/casting)
+                       profile::sampler_t *,
+                       const datum_t &,
+                       const datum_t &)> _lt_cmp,
+    backtrace_id_t _bt)
+    : eager_datum_stream_t(_bt),
+      lt_cmp_(_lt_cmp),
+      io_backender_(env->get_rdb_ctx()->io_backender),
+      base_path_(env->get_rdb_ctx()->base_path),
+      merge_started_(false) {
+    r_sanity_check(is_available(env));
+}
+
+external_sort_datum_stream_t::~external_sort_datum_stream_t() {
+    // Wait for the coroutine that writes the last run before we delete the runs.
+    drainer_.drain();
+}
+
+void external_sort_datum_stream_t::add_run(env_t *env, std::vector<datum_t> &&run) {
+    r_sanity_check(!merge_started_);
+    {
+        profile::sampler_t sampler("Sorting in-memory.", env->trace);
+        std::stable_sort(run.begin(), run.end(),
+                         std::bind(lt_cmp_, env, &sampler, ph::_1, ph::_2));
+    }
+
+    // Only one run gets written at a time, so that we don't hold more than two of
+    // them in memory.
+    wait_for_write(env);
+    merge_full_levels(env);
+
+    profile::sampler_t sampler("Writing sorted run to disk.", env->trace);
+    runs_.push_back(create_run(0));
+    coro_t::spawn_sometime(std::bind(&external_sort_datum_stream_t::write_run,
+                                     this,
+                                     runs_.back().get(),
+                                     std::move(run),
+                                     auto_drainer_t::lock_t(&drainer_)));
+}
+
+scoped_ptr_t<external_sort_datum_stream_t::run_t>
+external_sort_datum_stream_t::create_run(int level) {
+    return make_scoped<run_t>(
+        io_backender_,
+        serializer_filepath_t(base_path_, "orderby_" + uuid_to_str(generate_uuid())),
+        &perfmon_collection_,
+        level);
+}
+
+void external_sort_datum_stream_t::push_to_run(run_t *run,
+                                               const std::vector<datum_t> &data) {
+    for (size_t i = 0; i < data.size(); i += EXTERNAL_SORT_ELEMENTS_PER_PUSH) {
+        const size_t end = std::min(i + EXTERNAL_SORT_ELEMENTS_PER_PUSH, data.size());
+        scoped_array_t<write_message_t> wms(end - i);
+        for (size_t j = i; j < end; ++j) {
+            // The file gets deleted again when the query is done, so using
+            // `cluster_version_t::LATEST_OVERALL` is safe.
+            serialize<cluster_version_t::LATEST_OVERALL>(&wms[j - i], data[j]);
+        }
+        run->queue.push(wms);
+    }
+}
+
+void external_sort_datum_stream_t::write_run(run_t *run,
+                                             const std::vector<datum_t> &data,
+                                             auto_drainer_t::lock_t) {
+    push_to_run(run, data);
+    run->written.pulse();
+}
+
+void external_sort_datum_stream_t::wait_for_write(env_t *env) {
+    if (!runs_.empty()) {
+        wait_interruptible(&runs_.back()->written, env->interruptor);
+    }
+}
+
+void external_sort_datum_stream_t::merge_runs(env_t *env, size_t first_run) {
+    r_sanity_check(first_run < runs_.size());
+    profile::sampler_t sampler("Merging sorted runs on disk.", env->trace);
+    auto cmp = [&](const std::pair<datum_t, size_t> &a,
+                   const std::pair<datum_t, size_t> &b) {
+        return heap_cmp(env, &sampler, a, b);
+    };
+
+    int level = 0;
+    heap_t heap;
+    for (size_t i = first_run; i < runs_.size(); ++i) {
+        level = std::max(level, runs_[i]->level + 1);
+        pop_from_run(i, &heap);
+    }
+    std::make_heap(heap.begin(), heap.end(), cmp);
+
+    scoped_ptr_t<run_t> merged = create_run(level);
+    std::vector<datum_t> chunk;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), cmp);
+        std::pair<datum_t, size_t> next = std::move(heap.back());
+        heap.pop_back();
+        if (pop_from_run(next.second, &heap)) {
+            std::push_heap(heap.begin(), heap.end(), cmp);
+        }
+        chunk.push_back(std::move(next.first));
+        if (chunk.size() == EXTERNAL_SORT_ELEMENTS_PER_PUSH || heap.empty()) {
+            push_to_run(merged.get(), chunk);
+            chunk.clear();
+            if (env->interruptor->is_pulsed()) {
+                throw interrupted_exc_t();
+            }
+        }
+        sampler.new_sample();
+    }
+    merged->written.pulse();
+
+    // `pop_from_run()` has deleted the merged runs.
+    runs_.resize(first_run);
+    runs_.push_back(std::move(merged));
+}
+
+void external_sort_datum_stream_t::merge_full_levels(env_t *env) {
+    // The levels of `runs_` never increase from the front to the back, so the most
+    // recent runs are the ones with the lowest level.
+    while (runs_.size() >= EXTERNAL_SORT_MERGE_FAN_IN) {
+        const size_t first_run = runs_.size() - EXTERNAL_SORT_MERGE_FAN_IN;
+        if (runs_[first_run]->level != runs_.back()->level) {
+            break;
+        }
+        merge_runs(env, first_run);
+    }
+}
+
+bool external_sort_datum_stream_t::heap_cmp(env_t *env,
+                                            profile::sampler_t *sampler,
+                                            const std::pair<datum_t, size_t> &a,
+                                            const std::pair<datum_t, size_t> &b) const {
+    // `std::make_heap()` and friends put the greatest element first, so we reverse the
+    // comparison.
+    if (lt_cmp_(env, sampler, b.first, a.first)) {
+        return true;
+    } else if (lt_cmp_(env, sampler, a.first, b.first)) {
+        return false;
+    }
+    return a.second > b.second;
+}
+
+bool external_sort_datum_stream_t::pop_from_run(size_t run_index, heap_t *heap) {
+    run_t *run = runs_[run_index].get();
+    if (run->queue.empty()) {
+        // Delete the temporary file as soon as we don't need it anymore.
+        runs_[run_index].reset();
+        return false;
+    }
+    datum_t d;
+    deserializing_viewer_t<datum_t> viewer(&d);
+    run->queue.pop(&viewer);
+    heap->push_back(std::make_pair(std::move(d), run_index));
+    return true;
+}
+
+std::vector<datum_t>
+external_sort_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
+    std::vector<datum_t> ret;
+    batcher_t batcher = batchspec.to_batcher();
+
+    if (!merge_started_) {
+        wait_for_write(env);
+        // Merge on disk until the final merge doesn't need too many runs at once.
+        merge_full_levels(env);
+        while (runs_.size() > EXTERNAL_SORT_MERGE_FAN_IN) {
+            merge_runs(env, runs_.size() - EXTERNAL_SORT_MERGE_FAN_IN);
+        }
+    }
+
+    profile::sampler_t sampler("Merging sorted runs.", env->trace);
+    auto cmp = [&](const std::pair<datum_t, size_t> &a,
+                   const std::pair<datum_t, size_t> &b) {
+        return heap_cmp(env, &sampler, a, b);
+    };
+
+    if (!merge_started_) {
+        merge_started_ = true;
+        for (size_t i = 0; i < runs_.size(); ++i) {
+            pop_from_run(i, &heap_);
+        }
+        std::make_heap(heap_.begin(), heap_.end(), cmp);
+    }
+
+    while (!heap_.empty() && !batcher.should_send_batch()) {
+        std::pop_heap(heap_.begin(), heap_.end(), cmp);
+        std::pair<datum_t, size_t> next = std::move(heap_.back());
+        heap_.pop_back();
+        if (pop_from_run(next.second, &heap_)) {
+            std::push_heap(heap_.begin(), heap_.end(), cmp);
+        }
+        batcher.note_el(next.first);
+        ret.push_back(std::move(next.first));
+        sampler.new_sample();
+    }
+    return ret;
+}
+
+bool external_sort_datum_stream_t::is_exhausted() const {
+    return merge_started_ ? heap_.empty() : runs_.empty();
+}
+feed_type_t external_sort_datum_stream_t::cfeed_type() const {
+    return feed_type_t::not_feed;
+}
+bool external_sort_datum_stream_t::is_infinite() const {
+    return false;
+}
+bool external_sort_datum_stream_t::is_array() const {
+    return false;
+}
+
 // ORDERED_DISTINCT_DATUM_STREAM_T
 ordered_distinct_datum_stream_t::ordered_distinct_datum_stream_t(
     counted_t<datum_stream_t> _source) : wrapper_datum_stream_t(_source) { }
@@ -2299,22 +2536,142 @@ bool map_datum_stream_t::is_exhausted() const {
 eq_join_datum_stream_t::eq_join_datum_stream_t(counted_t<datum_stream_t> _stream,
                                                counted_t<table_t> _table,
                                                datum_string_t _join_index,
+                                               bool _join_index_exists,
                                                counted_t<const func_t> _predicate,
                                                bool _ordered,
+                                               eq_join_strategy_t _strategy,
                                                backtrace_id_t _bt) :
     eager_datum_stream_t(_bt),
     stream(std::move(_stream)),
     table(std::move(_table)),
     join_index(std::move(_join_index)),
+    join_index_exists(_join_index_exists),
     predicate(std::move(_predicate)),
     ordered(_ordered),
+    strategy(_strategy),
+    table_rows_loaded(false),
     is_array_eq_join(stream->is_array()),
     is_infinite_eq_join(stream->is_infinite()),
-    eq_join_type(stream->cfeed_type()) { }
+    eq_join_type(stream->cfeed_type()) {
+    r_sanity_check(join_index_exists || strategy == eq_join_strategy_t::HASH);
+}
+
+datum_t eq_join_datum_stream_t::get_join_key(env_t *env, const datum_t &left) {
+    datum_t key_val;
+    try {
+        key_val = predicate->call(env, std::vector<datum_t>{left})->as_datum();
+    } catch (const exc_t &e) {
+        if (e.get_type() == base_exc_t::NON_EXISTENCE) {
+            return datum_t();
+        } else {
+            throw;
+        }
+    }
+    if (key_val.get_type() == datum_t::type_t::R_NULL) {
+        return datum_t();
+    }
+    return key_val;
+}
+
+datum_t eq_join_datum_stream_t::make_joined_row(const datum_t &left,
+                                                const datum_t &right) {
+    ql::datum_object_builder_t res_item;
+    bool conflict = true;
+    conflict &= res_item.add(datum_string_t("right"), right);
+    conflict &= res_item.add(datum_string_t("left"), left);
+    guarantee(!conflict);
+    return std::move(res_item).to_datum();
+}
+
+void eq_join_datum_stream_t::add_table_row(env_t *env, datum_t key, datum_t row) {
+    const size_t limit = env->limits().array_size_limit();
+    table_rows.insert(std::make_pair(std::move(key), std::move(row)));
+    rcheck(table_rows.size() <= limit, base_exc_t::RESOURCE,
+           strprintf("Table `%s` has more than %zu rows, which is too many for "
+                     "`strategy: \"hash\"`.  Raise the `array_limit` option to "
+                     "`.run` or use the default strategy.",
+                     table->display_name().c_str(), limit));
+}
+
+void eq_join_datum_stream_t::load_table_rows(env_t *env) {
+    profile::sampler_t sampler("Reading table for hash join.", env->trace);
+    // Without an index we scan the primary index and key the rows by the field.
+    scoped_ptr_t<reader_t> reader = table->get_all_with_sindexes(
+        env,
+        datumspec_t(datum_range_t::universe()),
+        join_index_exists ? join_index.to_std() : table->get_pkey(),
+        backtrace());
+    while (!reader->is_finished()) {
+        std::vector<rget_item_t> items = reader->raw_next_batch(
+            env, batchspec_t::all().with_new_batch_type(batch_type_t::TERMINAL));
+        for (auto &&item : items) {
+            if (join_index_exists) {
+                datum_t key = item.sindex_key.has()
+                    ? item.sindex_key
+                    : item.data.get_field(join_index, NOTHROW);
+                if (key.has()) {
+                    add_table_row(env, std::move(key), std::move(item.data));
+                }
+            } else {
+                datum_t field = item.data.get_field(join_index, NOTHROW);
+                if (!field.has() || field.get_type() == datum_t::R_NULL) {
+                    // Like with an index, rows without the field don't match anything.
+                } else if (field.get_type() == datum_t::R_ARRAY) {
+                    // Like with a multi index, an array matches each of its elements.
+                    std::set<datum_t> elements;
+                    for (size_t i = 0; i < field.arr_size(); ++i) {
+                        elements.insert(field.get(i));
+                    }
+                    for (const datum_t &element : elements) {
+                        add_table_row(env, element, item.data);
+                    }
+                } else {
+                    add_table_row(env, std::move(field), std::move(item.data));
+                }
+            }
+            sampler.new_sample();
+        }
+    }
+    table_rows_loaded = true;
+}
+
+std::vector<datum_t> eq_join_datum_stream_t::next_hash_join_batch(
+    env_t *env,
+    const batchspec_t &batchspec) {
+    if (!table_rows_loaded) {
+        load_table_rows(env);
+    }
+    batcher_t batcher = batchspec.to_batcher();
+
+    std::vector<datum_t> res;
+    while (!stream->is_exhausted() && !batcher.should_send_batch()) {
+        std::vector<datum_t> stream_batch = stream->next_batch(env, batchspec);
+        if (stream_batch.empty()) {
+            // The input stream is either exhausted or a changefeed.
+            break;
+        }
+        for (const datum_t &left : stream_batch) {
+            datum_t key = get_join_key(env, left);
+            if (!key.has()) {
+                continue;
+            }
+            auto range = table_rows.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it) {
+                datum_t res_datum = make_joined_row(left, it->second);
+                batcher.note_el(res_datum);
+                res.push_back(std::move(res_datum));
+            }
+        }
+    }
+    return res;
+}
 
 std::vector<datum_t> eq_join_datum_stream_t::next_raw_batch(
     env_t *env,
     const batchspec_t &batchspec) {
+    if (strategy == eq_join_strategy_t::HASH) {
+        return next_hash_join_batch(env, batchspec);
+    }
     batcher_t batcher = batchspec.to_batcher();
 
     batchspec_t inner_batchspec = ordered ?
@@ -2339,20 +2696,9 @@ std::vector<datum_t> eq_join_datum_stream_t::next_raw_batch(
             sindex_to_datum.clear();
             std::map<datum_t, uint64_t> keys;
             for (size_t i = 0; i < stream_batch.size(); ++i) {
-                datum_t key_val;
-                try {
-                    key_val = predicate->call(
-                        env,
-                        std::vector<datum_t>{stream_batch[i]})->as_datum();
-                } catch (const exc_t &e) {
-                    if (e.get_type() == base_exc_t::NON_EXISTENCE) {
-                        continue;
-                    } else {
-                        throw;
-                    }
-                }
+                datum_t key_val = get_join_key(env, stream_batch[i]);
                 // Build a multimap from sindex value to datums from left side stream.
-                if (key_val.get_type() != datum_t::type_t::R_NULL) {
+                if (key_val.has()) {
                     sindex_to_datum.insert(std::pair<datum_t, datum_t>{
                             key_val, stream_batch[i]});
                     keys[key_val] = 1;
@@ -2383,15 +2729,8 @@ std::vector<datum_t> eq_join_datum_stream_t::next_raw_batch(
         } else {
             range = sindex_to_datum.equal_range(item.data.get_field(join_index));
         }
-        datum_string_t right("right");
-        datum_string_t left("left");
         for (auto pair = range.first; pair != range.second; ++pair) {
-            ql::datum_object_builder_t res_item;
-            bool conflict = true;
-            conflict &= res_item.add(right, item.data);
-            conflict &= res_item.add(left, pair->second);
-            guarantee(!conflict);
-            datum_t res_datum = std::move(res_item).to_datum();
+            datum_t res_datum = make_joined_row(pair->second, item.data);
             batcher.note_el(res_datum);
             res.push_back(std::move(res_datum));
         }
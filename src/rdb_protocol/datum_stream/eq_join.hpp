@@ -5,13 +5,25 @@
 
 namespace ql {
 
+enum class eq_join_strategy_t {
+    // Looks up the join keys of every batch of the input stream in the table's index.
+    INDEX,
+    // Reads the whole table once, keeps it in memory by join key, and then looks up
+    // the join keys of the input stream there. This is faster when the table is small
+    // compared to the input stream. It also works if the table has no index on the
+    // field that is joined on.
+    HASH
+};
+
 class eq_join_datum_stream_t : public eager_datum_stream_t {
 public:
     eq_join_datum_stream_t(counted_t<datum_stream_t> _stream,
                            counted_t<table_t> _table,
                            datum_string_t _join_index,
+                           bool _join_index_exists,
                            counted_t<const func_t> _predicate,
                            bool _ordered,
+                           eq_join_strategy_t _strategy,
                            backtrace_id_t bt);
 
     bool is_array() const final {
@@ -30,12 +42,27 @@ public:
     }
 
 private:
+    std::vector<datum_t> next_hash_join_batch(env_t *env, const batchspec_t &batchspec);
+
+    // Reads the whole table into `table_rows`.
+    void load_table_rows(env_t *env);
+    // Adds `row` to `table_rows` under `key`, with the `array_limit` check.
+    void add_table_row(env_t *env, datum_t key, datum_t row);
+
+    // Returns the join key of `left`, or an empty `datum_t` if it doesn't have one.
+    datum_t get_join_key(env_t *env, const datum_t &left);
+
+    static datum_t make_joined_row(const datum_t &left, const datum_t &right);
+
     counted_t<datum_stream_t> stream;
     scoped_ptr_t<reader_t> get_all_reader;
     std::vector<rget_item_t> get_all_items;
 
     counted_t<table_t> table;
     datum_string_t join_index;
+    // If this is false, `join_index` is a field of the table's rows that has no index
+    // of the same name. Only `eq_join_strategy_t::HASH` supports that.
+    bool join_index_exists;
 
     std::multimap<ql::datum_t,
                   ql::datum_t> sindex_to_datum;
@@ -44,6 +71,11 @@ private:
 
     bool ordered;
 
+    eq_join_strategy_t strategy;
+    // The table's rows by join key, for `eq_join_strategy_t::HASH`.
+    std::multimap<datum_t, datum_t> table_rows;
+    bool table_rows_loaded;
+
     bool is_array_eq_join;
     bool is_infinite_eq_join;
     feed_type_t eq_join_type;
@@ -0,0 +1,114 @@
+#ifndef RDB_PROTOCOL_DATUM_STREAM_EXTERNAL_SORT_HPP_
+#define RDB_PROTOCOL_DATUM_STREAM_EXTERNAL_SORT_HPP_
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/disk_backed_queue.hpp"
+#include "perfmon/perfmon.hpp"
+#include "rdb_protocol/datum_stream.hpp"
+
+namespace ql {
+
+/* `external_sort_datum_stream_t` sorts sequences that are too big to be sorted in
+memory. The sequence gets handed to it in runs with `add_run()`, each of which is
+sorted in memory and then written to a temporary file. Once all runs have been added,
+the stream returns their elements by merging the sorted runs. Elements that compare as
+equal stay in the order in which they were added, like with `std::stable_sort()`.
+
+Writing a run to disk happens in the background, so the caller can read and sort the
+next run in the meantime.
+
+Every run has its own temporary file, with its own serializer and cache. To bound how
+many of them exist at a time, runs get merged on disk into bigger ones, a number of
+runs of the same size at a time. */
+class external_sort_datum_stream_t : public eager_datum_stream_t {
+public:
+    // Returns false if there's nowhere to put the temporary files.
+    static bool is_available(env_t *env);
+
+    external_sort_datum_stream_t(
+        env_t *env,
+        std::function<bool(env_t *,  // NOLINT(readability/casting)
+                           profile::sampler_t *,
+                           const datum_t &,
+                           const datum_t &)> lt_cmp,
+        backtrace_id_t bt);
+    ~external_sort_datum_stream_t();
+
+    void add_run(env_t *env, std::vector<datum_t> &&run);
+
+    virtual bool is_exhausted() const;
+    virtual feed_type_t cfeed_type() const;
+    virtual bool is_infinite() const;
+
+private:
+    struct run_t {
+        run_t(io_backender_t *io_backender,
+              const serializer_filepath_t &filename,
+              perfmon_collection_t *stats_parent,
+              int _level);
+
+        internal_disk_backed_queue_t queue;
+        // 0 for the runs from `add_run()`. A run that was merged from other runs has
+        // a level one higher than theirs.
+        const int level;
+        // Pulsed once all of the run's elements have been written.
+        cond_t written;
+    };
+
+    typedef std::vector<std::pair<datum_t, size_t> > heap_t;
+
+    virtual bool is_array() const;
+    virtual std::vector<datum_t>
+    next_raw_batch(env_t *env, const batchspec_t &batchspec);
+
+    scoped_ptr_t<run_t> create_run(int level);
+    static void push_to_run(run_t *run, const std::vector<datum_t> &data);
+    void write_run(run_t *run,
+                   const std::vector<datum_t> &data,
+                   auto_drainer_t::lock_t keepalive);
+    void wait_for_write(env_t *env);
+
+    // Merges `runs_[first_run]` and all runs after it into a single run.
+    void merge_runs(env_t *env, size_t first_run);
+    // Merges the most recent runs while there are enough of them of the same level.
+    void merge_full_levels(env_t *env);
+
+    // Orders the heap so that the smallest element comes first, and among equal
+    // elements the one from the earliest run.
+    bool heap_cmp(env_t *env,
+                  profile::sampler_t *sampler,
+                  const std::pair<datum_t, size_t> &a,
+                  const std::pair<datum_t, size_t> &b) const;
+
+    // Appends the next element of `runs_[run_index]` to `heap`, or deletes the run
+    // and returns false if it has been used up.
+    bool pop_from_run(size_t run_index, heap_t *heap);
+
+    const std::function<bool(env_t *,  // NOLINT(readability/casting)
+                             profile::sampler_t *,
+                             const datum_t &,
+                             const datum_t &)> lt_cmp_;
+
+    io_backender_t *const io_backender_;
+    const base_path_t base_path_;
+    perfmon_collection_t perfmon_collection_;
+
+    // Ordered by when their elements were added, so that we can keep the sort stable.
+    std::vector<scoped_ptr_t<run_t> > runs_;
+
+    // Heap of the smallest element of every run that hasn't been used up yet,
+    // together with the run's index. Empty until the merge starts.
+    heap_t heap_;
+    bool merge_started_;
+
+    auto_drainer_t drainer_;
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_DATUM_STREAM_EXTERNAL_SORT_HPP_
@@ -45,7 +45,9 @@ reql_func_t::reql_func_t(const var_scope_t &_captured_scope,
     : func_t(_body->backtrace()),
       captured_scope(_captured_scope),
       arg_names(std::move(_arg_names)),
-      body(std::move(_body)) { }
+      body(std::move(_body)),
+      compiled_body(compiled_func_t::compile(captured_scope, arg_names,
+                                             body->get_src())) { }
 
 reql_func_t::reql_func_t(scoped_ptr_t<term_storage_t> &&_storage,
                          const var_scope_t &_captured_scope,
@@ -55,7 +57,9 @@ reql_func_t::reql_func_t(scoped_ptr_t<term_storage_t> &&_storage,
       captured_scope(_captured_scope),
       arg_names(std::move(_arg_names)),
       term_storage(std::move(_storage)),
-      body(std::move(_body)) { }
+      body(std::move(_body)),
+      compiled_body(compiled_func_t::compile(captured_scope, arg_names,
+                                             body->get_src())) { }
 
 reql_func_t::~reql_func_t() { }
 
@@ -75,6 +79,22 @@ scoped_ptr_t<val_t> reql_func_t::call(env_t *env,
                          arg_names.size(),
                          (arg_names.size() == 1 ? "" : "s")));
 
+        // The compiled body doesn't record any profiling information, so we only use
+        // it when the query isn't being profiled.
+        if (compiled_body.has() && env->profile() == profile_bool_t::DONT_PROFILE) {
+            env->do_eval_callback();
+            if (env->interruptor->is_pulsed()) {
+                throw interrupted_exc_t();
+            }
+            env->maybe_yield();
+            datum_t res = compiled_body->eval(args);
+            if (res.has()) {
+                return scoped_ptr_t<val_t>(new val_t(res, backtrace()));
+            }
+            // Otherwise we evaluate the body again through the term tree, which
+            // produces the correct result or error.
+        }
+
         var_scope_t new_scope = arg_names.size() == 0
             ? captured_scope
             : captured_scope.with_func_arg_list(arg_names, args);
@@ -12,6 +12,7 @@
 
 #include "containers/counted.hpp"
 #include "containers/uuid.hpp"
+#include "rdb_protocol/compiled_func.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/op.hpp"
@@ -126,6 +127,10 @@ private:
     // The body of the function, which gets ->eval(...) called when call(...) is called.
     counted_t<const term_t> body;
 
+    // If the body is simple enough, this evaluates it without going through `body`.
+    // Empty otherwise.
+    scoped_ptr_t<compiled_func_t> compiled_body;
+
     DISABLE_COPYING(reql_func_t);
 };
 
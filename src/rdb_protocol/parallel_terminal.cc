@@ -0,0 +1,204 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/parallel_terminal.hpp"
+
+#include <algorithm>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "assignment_sentry.hpp"
+#include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/wait_any.hpp"
+#include "rdb_protocol/env.hpp"
+
+namespace ql {
+
+scoped_ptr_t<parallel_terminal_t> parallel_terminal_t::make(
+        env_t *env,
+        const std::vector<transform_variant_t> &transforms,
+        const terminal_variant_t &terminal) {
+    // Profiling traces can't be shared between threads.
+    if (env->profile() == profile_bool_t::PROFILE) {
+        return scoped_ptr_t<parallel_terminal_t>();
+    }
+    // `limit_read_t` is order-dependent, and a plain `count()` doesn't even load the
+    // rows, so there's nothing to spread out.
+    if (boost::get<limit_read_t>(&terminal) != nullptr
+        || (boost::get<count_wire_func_t>(&terminal) != nullptr && transforms.empty())) {
+        return scoped_ptr_t<parallel_terminal_t>();
+    }
+    for (const auto &transform : transforms) {
+        // These need the secondary index value.
+        const group_wire_func_t *group = boost::get<group_wire_func_t>(&transform);
+        if (group != nullptr && group->should_append_index()) {
+            return scoped_ptr_t<parallel_terminal_t>();
+        }
+        const distinct_wire_func_t *distinct =
+            boost::get<distinct_wire_func_t>(&transform);
+        if (distinct != nullptr && distinct->use_index) {
+            return scoped_ptr_t<parallel_terminal_t>();
+        }
+    }
+    // `MAX_HELPERS` is copied so that `std::min()` doesn't need its address.
+    const size_t max_helpers = MAX_HELPERS;
+    const size_t num_helpers =
+        std::min<size_t>(max_helpers, std::max(get_num_db_threads(), 1));
+    if (num_helpers < 2) {
+        return scoped_ptr_t<parallel_terminal_t>();
+    }
+    return scoped_ptr_t<parallel_terminal_t>(
+        new parallel_terminal_t(env, transforms, terminal, num_helpers));
+}
+
+parallel_terminal_t::parallel_terminal_t(
+        env_t *_env,
+        const std::vector<transform_variant_t> &transforms,
+        const terminal_variant_t &terminal,
+        size_t num_helpers)
+    : env(_env), helper_idle_cond(nullptr), failed(false) {
+    // The first helper is the thread that does the traversal, which can evaluate rows
+    // while it's waiting for the disk. The others are the threads after it.
+    const int home = get_thread_id().threadnum;
+    for (size_t i = 0; i < num_helpers; ++i) {
+        scoped_ptr_t<helper_t> helper(
+            new helper_t(threadnum_t((home + i) % get_num_db_threads())));
+        for (const auto &transform : transforms) {
+            helper->transformers.push_back(make_op(transform));
+        }
+        helper->accumulator = make_terminal(terminal);
+        helpers.push_back(std::move(helper));
+        idle_helpers.push_back(i);
+    }
+    batch.reserve(BATCH_SIZE);
+}
+
+parallel_terminal_t::~parallel_terminal_t() {
+    // `drainer` waits for the batches that are still running.
+}
+
+bool parallel_terminal_t::add(datum_t &&val, size_t copies)
+        THROWS_ONLY(interrupted_exc_t) {
+    if (failed) {
+        return false;
+    }
+    for (size_t i = 1; i < copies; ++i) {
+        batch.push_back(val);
+    }
+    if (copies != 0) {
+        batch.push_back(std::move(val));
+    }
+    if (batch.size() >= BATCH_SIZE) {
+        dispatch_batch();
+    }
+    return !failed;
+}
+
+void parallel_terminal_t::finish(accumulator_t *acc,
+                                 continue_bool_t last_cb,
+                                 result_t *out)
+        THROWS_ONLY(interrupted_exc_t) {
+    if (!failed && !batch.empty()) {
+        dispatch_batch();
+    }
+    wait_for_idle_helpers(helpers.size());
+
+    std::vector<result_t> results;
+    for (const auto &helper : helpers) {
+        if (helper->interrupted) {
+            throw interrupted_exc_t();
+        }
+        if (helper->error.has_value()) {
+            *out = *helper->error;
+        }
+    }
+    if (boost::get<exc_t>(out) == nullptr) {
+        // Each partial result is like the result of a shard, so merging them works the
+        // same way as unsharding.
+        results.reserve(helpers.size());
+        for (const auto &helper : helpers) {
+            if (helper->used) {
+                results.push_back(result_t());
+                helper->accumulator->finish(continue_bool_t::CONTINUE, &results.back());
+            }
+        }
+        if (!results.empty()) {
+            std::vector<result_t *> result_ptrs;
+            for (auto &result : results) {
+                result_ptrs.push_back(&result);
+            }
+            try {
+                acc->unshard(env, result_ptrs);
+            } catch (const exc_t &e) {
+                *out = e;
+            } catch (const datum_exc_t &e) {
+                *out = exc_t(e, backtrace_id_t::empty());
+            }
+        }
+    }
+    acc->finish(last_cb, out);
+}
+
+void parallel_terminal_t::dispatch_batch() THROWS_ONLY(interrupted_exc_t) {
+    wait_for_idle_helpers(1);
+    const size_t helper_index = idle_helpers.back();
+    idle_helpers.pop_back();
+    helper_t *helper = helpers[helper_index].get();
+    helper->used = true;
+    helper->batch.swap(batch);
+    batch.clear();
+    batch.reserve(BATCH_SIZE);
+    coro_t::spawn_sometime(std::bind(&parallel_terminal_t::run_batch,
+                                     this, helper_index, drainer.lock()));
+}
+
+void parallel_terminal_t::run_batch(size_t helper_index,
+                                    auto_drainer_t::lock_t keepalive) {
+    helper_t *helper = helpers[helper_index].get();
+    {
+        serializable_env_t s_env = env->get_serializable_env();
+        cross_thread_signal_t interruptor(env->interruptor, helper->thread);
+        cross_thread_signal_t drain_signal(keepalive.get_drain_signal(),
+                                           helper->thread);
+        on_thread_t thread_switcher(helper->thread);
+        wait_any_t combined_interruptor(&interruptor, &drain_signal);
+        env_t helper_env(env->get_rdb_ctx(),
+                         return_empty_normal_batches_t::NO,
+                         &combined_interruptor,
+                         std::move(s_env),
+                         nullptr);
+        try {
+            groups_t data;
+            data[datum_t()].swap(helper->batch);
+            for (auto &transformer : helper->transformers) {
+                (*transformer)(&helper_env, &data, []() { return datum_t(); });
+            }
+            (*helper->accumulator)(&helper_env, &data, store_key_t(),
+                                   []() { return datum_t(); });
+        } catch (const exc_t &e) {
+            helper->error.set(e);
+        } catch (const datum_exc_t &e) {
+            helper->error.set(exc_t(e, backtrace_id_t::empty()));
+        } catch (const interrupted_exc_t &) {
+            helper->interrupted = true;
+        }
+        helper->batch.clear();
+    }
+
+    if (helper->error.has_value() || helper->interrupted) {
+        failed = true;
+    }
+    idle_helpers.push_back(helper_index);
+    if (helper_idle_cond != nullptr) {
+        helper_idle_cond->pulse_if_not_already_pulsed();
+    }
+}
+
+void parallel_terminal_t::wait_for_idle_helpers(size_t count)
+        THROWS_ONLY(interrupted_exc_t) {
+    while (idle_helpers.size() < count) {
+        cond_t cond;
+        assignment_sentry_t<cond_t *> assignment_sentry(&helper_idle_cond, &cond);
+        wait_interruptible(&cond, env->interruptor);
+    }
+}
+
+}  // namespace ql
@@ -0,0 +1,90 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_PARALLEL_TERMINAL_HPP_
+#define RDB_PROTOCOL_PARALLEL_TERMINAL_HPP_
+
+#include <vector>
+
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/scoped.hpp"
+#include "rdb_protocol/shards.hpp"
+#include "threading.hpp"
+
+namespace ql {
+
+class env_t;
+
+/* `parallel_terminal_t` lets a range read on a single shard use more than one CPU
+core when it ends in a terminal like `count()` or `reduce()`, possibly after a `group()`.
+The btree traversal has to stay on the store's thread, but the rows it loads are handed
+to helper threads in batches. Each helper runs the transforms and its own copy of the
+terminal on the rows it gets, and when the traversal is done, the partial results get
+merged the same way as the results of different shards.
+
+This only works for transforms and terminals that don't depend on the order of the
+rows, and that don't need the secondary index value. `make()` returns an empty pointer
+if that's not the case. */
+class parallel_terminal_t {
+public:
+    // The maximum number of threads that evaluate the rows of a single read, including
+    // the thread that does the traversal.
+    static const size_t MAX_HELPERS = 4;
+    // The number of rows that are handed to a helper at once.
+    static const size_t BATCH_SIZE = 256;
+
+    static scoped_ptr_t<parallel_terminal_t> make(
+        env_t *env,
+        const std::vector<transform_variant_t> &transforms,
+        const terminal_variant_t &terminal);
+    ~parallel_terminal_t();
+
+    // Hands `copies` copies of `val` to a helper. This blocks if all helpers are busy.
+    // Returns `false` if evaluation has failed, so that the traversal can stop.
+    bool add(datum_t &&val, size_t copies) THROWS_ONLY(interrupted_exc_t);
+
+    // Waits for all rows to be evaluated, merges the partial results into `acc` (which
+    // must be a fresh accumulator for the same terminal) and finishes it into `out`.
+    void finish(accumulator_t *acc, continue_bool_t last_cb, result_t *out)
+        THROWS_ONLY(interrupted_exc_t);
+
+private:
+    struct helper_t {
+        explicit helper_t(threadnum_t _thread)
+            : thread(_thread), used(false), interrupted(false) { }
+        const threadnum_t thread;
+        std::vector<scoped_ptr_t<op_t> > transformers;
+        scoped_ptr_t<accumulator_t> accumulator;
+        bool used;
+        // The rows that the helper is working on.
+        datums_t batch;
+        // Set on `thread`, and only read once the helper is idle again.
+        optional<exc_t> error;
+        bool interrupted;
+    };
+
+    parallel_terminal_t(env_t *env,
+                        const std::vector<transform_variant_t> &transforms,
+                        const terminal_variant_t &terminal,
+                        size_t num_helpers);
+
+    void dispatch_batch() THROWS_ONLY(interrupted_exc_t);
+    void run_batch(size_t helper_index, auto_drainer_t::lock_t keepalive);
+    // Waits until at least `count` helpers are idle.
+    void wait_for_idle_helpers(size_t count) THROWS_ONLY(interrupted_exc_t);
+
+    env_t *const env;
+    std::vector<scoped_ptr_t<helper_t> > helpers;
+    std::vector<size_t> idle_helpers;
+    // Pulsed when a helper becomes idle while we're waiting for one.
+    cond_t *helper_idle_cond;
+    datums_t batch;
+    bool failed;
+
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(parallel_terminal_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_PARALLEL_TERMINAL_HPP_
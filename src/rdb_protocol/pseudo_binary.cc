@@ -17,10 +17,8 @@ namespace pseudo {
 const char *const binary_string = "BINARY";
 const char *const data_key = "data";
 
-// Given a raw data string, encodes it into a `r.binary` pseudotype with base64 encoding
-void encode_base64_ptype(
-        const datum_string_t &data,
-        rapidjson::Writer<rapidjson::StringBuffer> *writer) {
+template <class json_writer_t>
+void write_base64_ptype(const datum_string_t &data, json_writer_t *writer) {
     writer->StartObject();
     writer->Key(datum_t::reql_type_string.data(), datum_t::reql_type_string.size());
     writer->String(binary_string);
@@ -30,6 +28,19 @@ void encode_base64_ptype(
     writer->EndObject();
 }
 
+// Given a raw data string, encodes it into a `r.binary` pseudotype with base64 encoding
+void encode_base64_ptype(
+        const datum_string_t &data,
+        rapidjson::Writer<rapidjson::StringBuffer> *writer) {
+    write_base64_ptype(data, writer);
+}
+
+void encode_base64_ptype(
+        const datum_string_t &data,
+        rapidjson::Writer<chunked_string_buffer_t> *writer) {
+    write_base64_ptype(data, writer);
+}
+
 rapidjson::Value encode_base64_ptype(const datum_string_t &data,
                                      rapidjson::Value::AllocatorType *allocator) {
     rapidjson::Value res(rapidjson::kObjectType);
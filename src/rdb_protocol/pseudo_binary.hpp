@@ -6,6 +6,7 @@
 #include <utility>
 #include <vector>
 
+#include "containers/chunked_string_buffer.hpp"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 #include "rdb_protocol/datum_string.hpp"
@@ -21,6 +22,9 @@ extern const char *const data_key;
 void encode_base64_ptype(
         const datum_string_t &data,
         rapidjson::Writer<rapidjson::StringBuffer> *writer);
+void encode_base64_ptype(
+        const datum_string_t &data,
+        rapidjson::Writer<chunked_string_buffer_t> *writer);
 
 rapidjson::Value encode_base64_ptype(const datum_string_t &data,
                                      rapidjson::Value::AllocatorType *allocator);
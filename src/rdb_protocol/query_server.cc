@@ -35,6 +35,7 @@ void rdb_query_server_t::run_query(ql::query_params_t *query_params,
                                    signal_t *interruptor) {
     guarantee(interruptor != nullptr);
     guarantee(rdb_ctx->cluster_interface != nullptr);
+    const ticks_t start_time = get_ticks();
     try {
         // TODO: make this perfmon correct now that we have parallelized queries
         scoped_perfmon_counter_t client_active(&rdb_ctx->stats.clients_active);
@@ -81,6 +82,11 @@ void rdb_query_server_t::run_query(ql::query_params_t *query_params,
 
     rdb_ctx->stats.queries_per_sec.record();
     ++rdb_ctx->stats.queries_total;
+    // Only the first request of a query says how long queries take. A CONTINUE on a
+    // changefeed or a NOREPLY_WAIT can wait for as long as it likes.
+    if (query_params->type == Query::START) {
+        rdb_ctx->stats.query_latency.record_since(start_time);
+    }
 }
 
 void rdb_query_server_t::fill_server_info(ql::response_t *out) {
@@ -854,9 +854,16 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         for (auto it = bi.inserts.begin(); it != bi.inserts.end(); ++it) {
             keys.emplace_back(it->get_field(datum_string_t(bi.pkey)).print_primary());
         }
+        const btree_info_t info(btree, timestamp, datum_string_t(bi.pkey));
+        batched_replace_response_t append_response;
+        if (rdb_batched_append(info, superblock, keys, &replacer, &sindex_cb,
+                               bi.limits, sampler, trace, &append_response)) {
+            response->response = append_response;
+            return;
+        }
         response->response =
             rdb_batched_replace(
-                btree_info_t(btree, timestamp, datum_string_t(bi.pkey)),
+                info,
                 superblock,
                 keys,
                 &replacer,
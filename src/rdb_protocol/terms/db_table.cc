@@ -7,6 +7,8 @@
 #include "clustering/administration/admin_op_exc.hpp"
 #include "clustering/administration/auth/permissions.hpp"
 #include "clustering/administration/auth/username.hpp"
+#include "clustering/administration/tables/table_metadata.hpp"
+#include "config/args.hpp"
 #include "containers/name_string.hpp"
 #include "rdb_protocol/datum_string.hpp"
 #include "rdb_protocol/op.hpp"
@@ -162,7 +164,7 @@ public:
         : meta_op_term_t(env, term, argspec_t(1, 2),
             optargspec_t({"primary_key", "shards", "replicas",
                           "nonvoting_replica_tags", "primary_replica_tag",
-                          "durability"})) { }
+                          "durability", "block_size", "block_compression"})) { }
 private:
     virtual scoped_ptr_t<val_t> eval_impl(
             scope_env_t *env, args_t *args, eval_flags_t) const {
@@ -194,6 +196,32 @@ private:
                 DURABILITY_REQUIREMENT_SOFT ?
                     write_durability_t::SOFT : write_durability_t::HARD;
 
+        uint64_t block_size = DEFAULT_BTREE_BLOCK_SIZE;
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "block_size")) {
+            int64_t n = v->as_int();
+            rcheck_target(v, n > 0 && is_valid_table_block_size(n), base_exc_t::LOGIC,
+                          strprintf("Invalid block size %" PRIi64 " (must be a power "
+                                    "of two between %" PRIi64 " and %" PRIi64 ").",
+                                    n, static_cast<int64_t>(MIN_BTREE_BLOCK_SIZE),
+                                    static_cast<int64_t>(MAX_BTREE_BLOCK_SIZE)));
+            block_size = n;
+        }
+
+        block_compression_t block_compression = block_compression_t::none;
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "block_compression")) {
+            const datum_string_t &str = v->as_str();
+            if (str == "none") {
+                block_compression = block_compression_t::none;
+            } else if (str == "lz4") {
+                block_compression = block_compression_t::lz4;
+            } else {
+                rfail_target(v, base_exc_t::LOGIC,
+                             "Block compression option `%s` unrecognized "
+                             "(options are \"none\" and \"lz4\").",
+                             str.to_std().c_str());
+            }
+        }
+
         counted_t<const db_t> db;
         name_string_t tbl_name;
         if (args->num_args() == 1) {
@@ -217,6 +245,8 @@ private:
                     config_params,
                     primary_key,
                     durability,
+                    block_size,
+                    block_compression,
                     env->env->interruptor,
                     &result,
                     &error)) {
@@ -5,6 +5,7 @@
 #include <utility>
 #include <vector>
 
+#include "clustering/administration/admin_op_exc.hpp"
 #include "parsing/utf8.hpp"
 #include "rdb_protocol/datum_stream/eq_join.hpp"
 #include "rdb_protocol/datum_stream/fold.hpp"
@@ -223,7 +224,7 @@ public:
         : grouped_seq_op_term_t(env,
                                 term,
                                 argspec_t(3),
-                                optargspec_t({"index", "ordered"})) { }
+                                optargspec_t({"index", "ordered", "strategy"})) { }
 
     virtual const char *name() const { return "eqjoin"; }
 private:
@@ -243,6 +244,20 @@ private:
         if (maybe_ordered.has()) {
             ordered = maybe_ordered->as_bool();
         }
+        eq_join_strategy_t strategy = eq_join_strategy_t::INDEX;
+        scoped_ptr_t<val_t> maybe_strategy = args->optarg(env, "strategy");
+        if (maybe_strategy.has()) {
+            const std::string strategy_str = maybe_strategy->as_str().to_std();
+            if (strategy_str == "hash") {
+                strategy = eq_join_strategy_t::HASH;
+            } else {
+                rcheck_target(maybe_strategy.get(),
+                              strategy_str == "index",
+                              base_exc_t::LOGIC,
+                              strprintf("Unrecognized strategy `%s` (must be `index` "
+                                        "or `hash`).", strategy_str.c_str()));
+            }
+        }
         datum_t key;
         scoped_ptr_t<val_t> maybe_key = args->optarg(env, "index");
         if (maybe_key.has()) {
@@ -250,12 +265,30 @@ private:
         } else {
             key = datum_t(datum_string_t(table->get_pkey()));
         }
+        // The hash strategy reads the whole table anyway, so it doesn't need an index
+        // to join on a field.
+        bool join_index_exists = true;
+        if (strategy == eq_join_strategy_t::HASH
+                && key.as_str().to_std() != table->get_pkey()) {
+            std::map<std::string, std::pair<sindex_config_t, sindex_status_t> >
+                configs_and_statuses;
+            admin_err_t error;
+            if (!env->env->reql_cluster_interface()->sindex_list(
+                    table->db, name_string_t::guarantee_valid(table->name.c_str()),
+                    env->env->interruptor, &error, &configs_and_statuses)) {
+                REQL_RETHROW(error);
+            }
+            join_index_exists =
+                configs_and_statuses.count(key.as_str().to_std()) != 0;
+        }
         counted_t<eq_join_datum_stream_t> eq_join_stream =
             make_counted<eq_join_datum_stream_t>(stream,
                                                  table,
                                                  key.as_str(),
+                                                 join_index_exists,
                                                  predicate_function,
                                                  ordered,
+                                                 strategy,
                                                  backtrace());
 
         return new_val(env->env, eq_join_stream);
@@ -6,6 +6,7 @@
 
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/datum_stream/array.hpp"
+#include "rdb_protocol/datum_stream/external_sort.hpp"
 #include "rdb_protocol/datum_stream/indexed_sort.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/func.hpp"
@@ -106,6 +107,9 @@ private:
             rcheck(!comparisons.empty(), base_exc_t::LOGIC,
                    "Must specify something to order by.");
             std::vector<datum_t> to_sort;
+            // If the sequence doesn't fit into an array, we sort it in runs of at
+            // most the array size limit and merge them from disk.
+            counted_t<external_sort_datum_stream_t> external_sort;
             batchspec_t batchspec = batchspec_t::user(batch_type_t::TERMINAL, env->env);
             for (;;) {
                 std::vector<datum_t> data
@@ -114,14 +118,30 @@ private:
                     break;
                 }
                 std::move(data.begin(), data.end(), std::back_inserter(to_sort));
+                if (to_sort.size() > env->env->limits().array_size_limit()
+                    && external_sort_datum_stream_t::is_available(env->env)) {
+                    if (!external_sort.has()) {
+                        external_sort = make_counted<external_sort_datum_stream_t>(
+                            env->env, lt_cmp, backtrace());
+                    }
+                    external_sort->add_run(env->env, std::move(to_sort));
+                    to_sort.clear();
+                }
                 rcheck_array_size(to_sort, env->env->limits());
             }
-            profile::sampler_t sampler("Sorting in-memory.", env->env->trace);
-            auto fn = std::bind(lt_cmp, env->env, &sampler, ph::_1, ph::_2);
-            std::stable_sort(to_sort.begin(), to_sort.end(), fn);
-            seq = make_counted<array_datum_stream_t>(
-                datum_t(std::move(to_sort), env->env->limits()),
-                backtrace());
+            if (external_sort.has()) {
+                if (!to_sort.empty()) {
+                    external_sort->add_run(env->env, std::move(to_sort));
+                }
+                seq = external_sort;
+            } else {
+                profile::sampler_t sampler("Sorting in-memory.", env->env->trace);
+                auto fn = std::bind(lt_cmp, env->env, &sampler, ph::_1, ph::_2);
+                std::stable_sort(to_sort.begin(), to_sort.end(), fn);
+                seq = make_counted<array_datum_stream_t>(
+                    datum_t(std::move(to_sort), env->env->limits()),
+                    backtrace());
+            }
         }
         return tbl_slice.has()
             ? new_val(make_counted<selection_t>(tbl_slice->get_tbl(), seq))
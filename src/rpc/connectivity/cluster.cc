@@ -6,7 +6,10 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <utility>
+#include <vector>
 
 #include "arch/io/network.hpp"
 #include "arch/timing.hpp"
@@ -15,6 +18,7 @@
 #include "concurrency/cross_thread_watchable.hpp"
 #include "concurrency/pmap.hpp"
 #include "concurrency/semaphore.hpp"
+#include "concurrency/wait_any.hpp"
 #include "config/args.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "containers/archive/versioned.hpp"
@@ -128,35 +132,63 @@ void connectivity_cluster_t::connection_t::kill_connection() {
     }
 }
 
-connectivity_cluster_t::connection_t::connection_t(
-        run_t *_parent,
-        const peer_id_t &_peer_id,
-        const server_id_t &_server_id,
+connectivity_cluster_t::connection_t::lane_t::lane_t(
         keepalive_tcp_conn_stream_t *_conn,
-        const peer_address_t &_peer_address) THROWS_NOTHING :
+        cluster_compression_t compression) :
     conn(_conn),
-    peer_address(_peer_address),
     flusher([&](signal_t *) {
-        guarantee(this->conn != nullptr);
         // We need to acquire the send_mutex because flushing the buffer
         // must not interleave with other writes (restriction of linux_tcp_conn_t).
         mutex_t::acq_t acq(&this->send_mutex);
         // We ignore the return value of flush_buffer(). Closed connections
         // must be handled elsewhere.
         this->conn->flush_buffer();
-    }, 1),
+    }, 1) {
+    guarantee(conn != nullptr);
+    switch (compression) {
+    case cluster_compression_t::none:
+        break;
+    case cluster_compression_t::deflate:
+        compressor.init(new cluster_compressor_t());
+        break;
+    default:
+        unreachable();
+    }
+}
+
+connectivity_cluster_t::connection_t::connection_t(
+        run_t *_parent,
+        const peer_id_t &_peer_id,
+        const server_id_t &_server_id,
+        const std::vector<keepalive_tcp_conn_stream_t *> &lane_conns,
+        cluster_compression_t compression,
+        const peer_address_t &_peer_address) THROWS_NOTHING :
+    conn(lane_conns.empty() ? nullptr : lane_conns[0]),
+    peer_address(_peer_address),
+    lanes(lane_conns.size()),
     pm_collection(),
     pm_bytes_sent(secs_to_ticks(1), true),
+    pm_send_latency(secs_to_ticks(10)),
     pm_collection_membership(
         &_parent->parent->connectivity_collection,
         &pm_collection,
         uuid_to_str(_peer_id.get_uuid())),
     pm_bytes_sent_membership(&pm_collection, &pm_bytes_sent, "bytes_sent"),
+    pm_send_latency_membership(&pm_collection, &pm_send_latency, "send_latency_ms"),
+    pm_compression_input_bytes_membership(
+        &pm_collection, &pm_compression_input_bytes, "compression_input_bytes"),
+    pm_compression_output_bytes_membership(
+        &pm_collection, &pm_compression_output_bytes, "compression_output_bytes"),
     parent(_parent),
     peer_id(_peer_id),
     server_id(_server_id),
     drainers()
 {
+    pmap(lanes.size(), [&](size_t i) {
+        on_thread_t thread_switcher(lane_conns[i]->home_thread());
+        lanes[i].init(new lane_t(lane_conns[i], compression));
+    });
+
     pmap(get_num_threads(), [this](int thread_id) {
         on_thread_t thread_switcher((threadnum_t(thread_id)));
         parent->parent->connections.get()->set_key_no_equals(
@@ -173,8 +205,13 @@ connectivity_cluster_t::connection_t::~connection_t() THROWS_NOTHING {
         drainers.get()->drain();
     });
 
-    /* The drainers have been destroyed, so nothing can be holding the `send_mutex`. */
-    guarantee(!send_mutex.is_locked());
+    pmap(lanes.size(), [this](size_t i) {
+        on_thread_t thread_switcher(lanes[i]->conn->home_thread());
+        /* The drainers have been destroyed, so nothing can be holding the
+        `send_mutex`. */
+        guarantee(!lanes[i]->send_mutex.is_locked());
+        lanes[i].reset();
+    });
 }
 
 // Helper function for the `run_t` constructor's initialization list
@@ -221,11 +258,15 @@ connectivity_cluster_t::run_t::run_t(
             _heartbeat_sl_view,
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t> >
             _auth_sl_view,
-        tls_ctx_t *_tls_ctx)
+        tls_ctx_t *_tls_ctx,
+        size_t _connections_per_peer,
+        cluster_compression_t _compression)
         THROWS_ONLY(address_in_use_exc_t, tcp_socket_exc_t) :
     parent(_parent),
     server_id(_server_id),
     tls_ctx(_tls_ctx),
+    connections_per_peer(_connections_per_peer),
+    compression(_compression),
 
     /* Create the socket to use when listening for connections from peers */
     cluster_listener_socket(new tcp_bound_socket_t(local_addresses, port)),
@@ -257,7 +298,9 @@ connectivity_cluster_t::run_t::run_t(
     `connection_map` on each thread and notifying any listeners that we're now
     connected to ourself. The destructor will remove us from the
     `connection_map` and again notify any listeners. */
-    connection_to_ourself(this, parent->me, _server_id, nullptr, routing_table[parent->me]),
+    connection_to_ourself(this, parent->me, _server_id,
+        std::vector<keepalive_tcp_conn_stream_t *>(), cluster_compression_t::none,
+        routing_table[parent->me]),
 
     heartbeat_sl_view(_heartbeat_sl_view),
     auth_sl_view(_auth_sl_view),
@@ -268,6 +311,7 @@ connectivity_cluster_t::run_t::run_t(
                  this, ph::_1, join_delay_secs, auto_drainer_t::lock_t(&drainer))))
 {
     parent->assert_thread();
+    guarantee(connections_per_peer >= 1);
 }
 
 connectivity_cluster_t::run_t::~run_t() {
@@ -321,7 +365,8 @@ void connectivity_cluster_t::run_t::on_new_connection(
 
     keepalive_tcp_conn_stream_t conn_stream(conn);
 
-    handle(&conn_stream, r_nullopt, r_nullopt, r_nullopt, lock, nullptr, join_delay_secs);
+    handle(&conn_stream, r_nullopt, r_nullopt, r_nullopt, r_nullopt, 0, lock, nullptr,
+        join_delay_secs);
 }
 
 join_result_t connectivity_cluster_t::run_t::connect_to_peer(
@@ -359,7 +404,8 @@ join_result_t connectivity_cluster_t::run_t::connect_to_peer(
 
             join_result = handle(
                 &conn, expected_id, optional<peer_address_t>(*address),
-                expected_server_id, drainer_lock, successful_join_inout, join_delay_secs);
+                expected_server_id, optional<ip_and_port_t>(selected_addr), 0,
+                drainer_lock, successful_join_inout, join_delay_secs);
         } catch (const tcp_conn_t::connect_failed_exc_t &) {
             /* Ignore */
         } catch (const crypto::openssl_error_t &) {
@@ -434,6 +480,105 @@ join_results_t connectivity_cluster_t::run_t::join_blocking(
     return join_results;
 }
 
+/* While `handle()` sets up a connection that has more than one lane, it puts a
+`lane_collector_t` into `run_t::lane_collectors`. The `handle()` calls for the
+additional lanes hand their TCP connections over to it, and then wait for the
+`lane_collector_t` to be destroyed before they close them. */
+class connectivity_cluster_t::run_t::lane_collector_t {
+public:
+    explicit lane_collector_t(size_t num_lanes) :
+        lane_conns(num_lanes, nullptr),
+        released_conds(num_lanes, nullptr),
+        num_missing(num_lanes - 1) {
+        guarantee(num_lanes >= 2);
+    }
+
+    ~lane_collector_t() {
+        for (cond_t *released : released_conds) {
+            if (released != nullptr) {
+                released->pulse();
+            }
+        }
+    }
+
+    /* Returns `false` if the lane can't be used, in which case the caller should close
+    the connection. Otherwise, `released` will be pulsed once the connection is over. */
+    bool hand_over(size_t lane_index,
+                   keepalive_tcp_conn_stream_t *conn,
+                   cond_t *released) {
+        if (lane_index == 0 || lane_index >= lane_conns.size()
+                || lane_conns[lane_index] != nullptr) {
+            return false;
+        }
+        lane_conns[lane_index] = conn;
+        released_conds[lane_index] = released;
+        --num_missing;
+        if (num_missing == 0) {
+            all_arrived.pulse();
+        }
+        return true;
+    }
+
+    /* Called if one of the lanes that we tried to open failed, so that `handle()`
+    doesn't have to wait for the timeout. */
+    void lane_failed() {
+        if (!failed.is_pulsed()) {
+            failed.pulse();
+        }
+    }
+
+    const signal_t *get_all_arrived() const { return &all_arrived; }
+    const signal_t *get_failed() const { return &failed; }
+
+    keepalive_tcp_conn_stream_t *get_lane_conn(size_t lane_index) const {
+        return lane_conns[lane_index];
+    }
+
+private:
+    std::vector<keepalive_tcp_conn_stream_t *> lane_conns;
+    std::vector<cond_t *> released_conds;
+    size_t num_missing;
+    cond_t all_arrived, failed;
+
+    DISABLE_COPYING(lane_collector_t);
+};
+
+void connectivity_cluster_t::run_t::connect_lane(
+        ip_and_port_t address,
+        size_t lane_index,
+        peer_id_t expected_id,
+        peer_address_t expected_address,
+        server_id_t expected_server_id,
+        auto_drainer_t::lock_t drainer_lock) THROWS_NOTHING {
+    parent->assert_thread();
+    join_result_t join_result = join_result_t::TEMPORARY_ERROR;
+    try {
+        keepalive_tcp_conn_stream_t conn(
+            tls_ctx, address.ip(), address.port().value(),
+            drainer_lock.get_drain_signal(), cluster_client_port);
+
+        /* If this succeeds, it only returns after the connection is over. */
+        join_result = handle(
+            &conn, optional<peer_id_t>(expected_id),
+            optional<peer_address_t>(expected_address),
+            optional<server_id_t>(expected_server_id), r_nullopt, lane_index,
+            drainer_lock, nullptr, 0);
+    } catch (const tcp_conn_t::connect_failed_exc_t &) {
+        /* Ignore */
+    } catch (const crypto::openssl_error_t &) {
+        /* Ignore */
+    } catch (const interrupted_exc_t &) {
+        /* Ignore */
+    }
+
+    if (join_result != join_result_t::SUCCESS) {
+        auto it = lane_collectors.find(expected_id);
+        if (it != lane_collectors.end()) {
+            it->second->lane_failed();
+        }
+    }
+}
+
 class cluster_conn_closing_subscription_t : public signal_t::subscription_t {
 public:
     explicit cluster_conn_closing_subscription_t(keepalive_tcp_conn_stream_t *conn) :
@@ -453,11 +598,12 @@ private:
 };
 
 /* `heartbeat_manager_t` is responsible for sending heartbeats over a single connection
-and making sure that heartbeats have arrived on time.
+and making sure that heartbeats have arrived on time. Every lane of the connection gets
+its own heartbeats and its own timeout, so that a lane that stalls takes the whole
+connection down instead of silently holding back the messages that are sent over it.
 `connectivity_cluster_t::run_t::handle()` constructs one after constructing the
 `connection_t`. */
 class connectivity_cluster_t::heartbeat_manager_t :
-    public keepalive_tcp_conn_stream_t::keepalive_callback_t,
     private repeating_timer_callback_t,
     private cluster_send_message_write_callback_t
 {
@@ -472,15 +618,22 @@ public:
                 heartbeat_sl_view_) :
         connection(connection_),
         connection_keepalive(connection_keepalive_),
-        read_done(false),
-        write_done(false),
-        intervals_since_last_read_done(0),
+        lanes(connection->lanes.size()),
         peer_str(peer_str_),
         timeout(0),
         heartbeat_sl_view(std::move(heartbeat_sl_view_)),
         heartbeat_sl_view_sub(std::bind(&heartbeat_manager_t::on_heartbeat_change, this))
     {
-        connection->conn->set_keepalive_callback(this);
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            lanes[i].init(new lane_watcher_t());
+        }
+        /* The additional lanes live on threads of their own, and the callbacks are
+        invoked from there. */
+        pmap(lanes.size(), [this](size_t i) {
+            keepalive_tcp_conn_stream_t *lane_conn = connection->lanes[i]->conn;
+            on_thread_t thread_switcher(lane_conn->home_thread());
+            lane_conn->set_keepalive_callback(lanes[i].get());
+        });
 
         // This will trigger the initialization of the timeout, and timer
         watchable_t<heartbeat_semilattice_metadata_t>::freeze_t
@@ -489,55 +642,55 @@ public:
     }
 
     ~heartbeat_manager_t() {
-        connection->conn->set_keepalive_callback(nullptr);
-    }
-
-    /* These are called by the `keepalive_tcp_conn_stream_t`. */
-    void keepalive_read() {
-        read_done = true;
-    }
-
-    void keepalive_write() {
-        write_done = true;
+        pmap(lanes.size(), [this](size_t i) {
+            keepalive_tcp_conn_stream_t *lane_conn = connection->lanes[i]->conn;
+            on_thread_t thread_switcher(lane_conn->home_thread());
+            lane_conn->set_keepalive_callback(nullptr);
+        });
     }
 
     void on_ring() {
         ASSERT_FINITE_CORO_WAITING;
 
-        if (intervals_since_last_read_done > HEARTBEAT_TIMEOUT_INTERVALS) {
-            logERR("Heartbeat timeout, killing connection to peer %s", peer_str.c_str());
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            if (lanes[i]->intervals_since_last_read_done > HEARTBEAT_TIMEOUT_INTERVALS) {
+                logERR("Heartbeat timeout on lane %zu, killing connection to peer %s",
+                       i, peer_str.c_str());
 
-            /* This won't block if we call it from the same thread. This is an
-            implementation detail that outside code shouldn't rely on, but since
-            `heartbeat_manager_t` is part of `connectivity_cluster_t` it's OK. */
-            connection->kill_connection();
-            return;
-        }
-        if (write_done) {
-            write_done = false;
-        } else {
-            /* The purpose of `heartbeat_manager_keepalive` is to ensure that we don't
-            shut down while the heartbeat sending coroutine is still active */
-            auto_drainer_t::lock_t this_keepalive(&drainer);
-            coro_t::spawn_later_ordered(
-                [this, this_keepalive /* important to capture */] {
-                    /* This might block, so we have to run it in a sub-coroutine. */
-                    connection->parent->parent->send_message(
-                        connection, connection_keepalive,
-                        connectivity_cluster_t::heartbeat_tag, this);
-                });
+                /* This won't block if we call it from the same thread. This is an
+                implementation detail that outside code shouldn't rely on, but since
+                `heartbeat_manager_t` is part of `connectivity_cluster_t` it's OK. */
+                connection->kill_connection();
+                return;
+            }
         }
-        if (read_done) {
-            /* `intervals_since_last_read_done` may be negative when transitioning
-               between timeouts, we should't reset it to zero when it's doing so. */
-            if (intervals_since_last_read_done >= 0) {
-                intervals_since_last_read_done = 0;
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            lane_watcher_t *lane = lanes[i].get();
+            if (!lane->write_done.exchange(false)) {
+                /* The purpose of `heartbeat_manager_keepalive` is to ensure that we
+                don't shut down while the heartbeat sending coroutine is still active */
+                auto_drainer_t::lock_t this_keepalive(&drainer);
+                coro_t::spawn_later_ordered(
+                    [this, this_keepalive /* important to capture */, i] {
+                        /* This might block, so we have to run it in a sub-coroutine.
+                        The lane's index is used as the ordering key so that the
+                        heartbeat goes over that lane. */
+                        connection->parent->parent->send_message(
+                            connection, connection_keepalive,
+                            connectivity_cluster_t::heartbeat_tag, this, i);
+                    });
+            }
+            if (lane->read_done.exchange(false)) {
+                /* `intervals_since_last_read_done` may be negative when transitioning
+                   between timeouts, we should't reset it to zero when it's doing so. */
+                if (lane->intervals_since_last_read_done >= 0) {
+                    lane->intervals_since_last_read_done = 0;
+                } else {
+                    lane->intervals_since_last_read_done++;
+                }
             } else {
-                intervals_since_last_read_done++;
+                lane->intervals_since_last_read_done++;
             }
-            read_done = false;
-        } else {
-            intervals_since_last_read_done++;
         }
     }
 
@@ -560,13 +713,15 @@ public:
             return;
         }
 
-        if (timeout > timeout_new) {
-            /* It may take the peer some time to transition to the new timeout, by
-               setting `intervals_since_last_read_done` to a negative value we allow it
-               to transition. */
-            intervals_since_last_read_done = -timeout / timeout_new;
-        } else {
-            intervals_since_last_read_done = 0;
+        for (const scoped_ptr_t<lane_watcher_t> &lane : lanes) {
+            if (timeout > timeout_new) {
+                /* It may take the peer some time to transition to the new timeout, by
+                   setting `intervals_since_last_read_done` to a negative value we allow
+                   it to transition. */
+                lane->intervals_since_last_read_done = -timeout / timeout_new;
+            } else {
+                lane->intervals_since_last_read_done = 0;
+            }
         }
         timeout = timeout_new;
         timer = scoped_ptr_t<repeating_timer_t>(new repeating_timer_t(
@@ -574,10 +729,33 @@ public:
     }
 
 private:
+    /* Called by the `keepalive_tcp_conn_stream_t` of a lane, on the lane's thread. The
+    flags are picked up by `on_ring()` on our own thread. */
+    class lane_watcher_t : public keepalive_tcp_conn_stream_t::keepalive_callback_t {
+    public:
+        lane_watcher_t() :
+            read_done(false), write_done(false), intervals_since_last_read_done(0) { }
+
+        void keepalive_read() {
+            read_done = true;
+        }
+
+        void keepalive_write() {
+            write_done = true;
+        }
+
+        std::atomic<bool> read_done, write_done;
+
+        /* Only accessed on the `heartbeat_manager_t`'s thread. */
+        int64_t intervals_since_last_read_done;
+
+    private:
+        DISABLE_COPYING(lane_watcher_t);
+    };
+
     connectivity_cluster_t::connection_t *connection;
     auto_drainer_t::lock_t connection_keepalive;
-    bool read_done, write_done;
-    int64_t intervals_since_last_read_done;
+    std::vector<scoped_ptr_t<lane_watcher_t> > lanes;
     std::string peer_str;
     int64_t timeout;
 
@@ -594,6 +772,45 @@ private:
     DISABLE_COPYING(heartbeat_manager_t);
 };
 
+/* `lane_rethreader_t` moves the additional lanes of a connection to their own threads
+for as long as it exists, the way a pair of `rethread_tcp_conn_stream_t`s does for the
+first lane. It must be constructed and destroyed on the thread that the lanes are on
+to begin with. */
+class lane_rethreader_t {
+public:
+    /* `threads[i]` is for `lane_conns[i + 1]`. */
+    lane_rethreader_t(const std::vector<keepalive_tcp_conn_stream_t *> &lane_conns,
+                      const std::vector<scoped_ptr_t<thread_allocation_t> > &threads) {
+        guarantee(lane_conns.size() == threads.size() + 1);
+        for (size_t i = 0; i < threads.size(); ++i) {
+            lanes.push_back(std::make_pair(lane_conns[i + 1], threads[i]->get_thread()));
+        }
+        pmap(lanes.size(), [&](size_t i) {
+            lanes[i].first->rethread(INVALID_THREAD);
+            on_thread_t thread_switcher(lanes[i].second);
+            lanes[i].first->rethread(lanes[i].second);
+        });
+    }
+
+    ~lane_rethreader_t() {
+        pmap(lanes.size(), [&](size_t i) {
+            {
+                on_thread_t thread_switcher(lanes[i].second);
+                /* Pending writes must have been transmitted or aborted before we can
+                move the lane back. */
+                lanes[i].first->flush_buffer();
+                lanes[i].first->rethread(INVALID_THREAD);
+            }
+            lanes[i].first->rethread(get_thread_id());
+        });
+    }
+
+private:
+    std::vector<std::pair<keepalive_tcp_conn_stream_t *, threadnum_t> > lanes;
+
+    DISABLE_COPYING(lane_rethreader_t);
+};
+
 // Error-handling helper for connectivity_cluster_t::run_t::handle(). Returns true if
 // handle() should return.
 template <class T>
@@ -864,12 +1081,18 @@ join_result_t connectivity_cluster_t::run_t::handle(
         optional<peer_id_t> expected_id,
         optional<peer_address_t> expected_address,
         optional<server_id_t> expected_server_id,
+        optional<ip_and_port_t> dialed_address,
+        size_t lane_index,
         auto_drainer_t::lock_t drainer_lock,
         bool *successful_join_inout,
         const int join_delay_secs) THROWS_NOTHING
 {
     parent->assert_thread();
 
+    /* When all of our connections come from the same client port, we can't open more
+    than one connection to the same address. */
+    const uint64_t max_lanes = cluster_client_port == 0 ? connections_per_peer : 1;
+
     bool has_admin_password = false;
     {
         auth_semilattice_metadata_t auth = auth_sl_view->get();
@@ -920,6 +1143,9 @@ join_result_t connectivity_cluster_t::run_t::handle(
         serialize_universal(&wm, has_admin_password);
         serialize_universal(&wm, parent->me);
         serialize_universal(&wm, routing_table[parent->me].hosts());
+        serialize_universal(&wm, max_lanes);
+        serialize_universal(&wm, static_cast<uint64_t>(lane_index));
+        serialize_universal(&wm, static_cast<uint8_t>(compression));
         if (send_write_message(conn, &wm)) {
             return join_result_t::TEMPORARY_ERROR; // network error.
         }
@@ -996,18 +1222,8 @@ join_result_t connectivity_cluster_t::run_t::handle(
             fail_handshake(conn, peername, reason);
             return join_result_t::PERMANENT_ERROR;
         }
-
-        if (servers.count(remote_server_id) != 0) {
-            // There currently is another connection open to the server
-            logINF("Rejected a connection from server %s since one is open already.",
-                   remote_server_id.print().c_str());
-            return join_result_t::TEMPORARY_ERROR;
-        }
     }
 
-    set_insertion_sentry_t<server_id_t> remote_server_id_sentry(
-        &servers, remote_server_id);
-
     // Check bitsize (e.g. 32bit or 64bit)
     {
         std::string remote_arch_bitsize;
@@ -1064,14 +1280,48 @@ join_result_t connectivity_cluster_t::run_t::handle(
         }
     }
 
-    // Receive id, host/ports.
+    // Receive id, host/ports, the lanes, and the compression.
     peer_id_t other_id;
     std::set<host_and_port_t> other_peer_addr_hosts;
+    uint64_t remote_max_lanes;
+    uint64_t remote_lane_index;
+    uint8_t remote_compression;
     if (deserialize_universal_and_check(conn, &other_id, peername) ||
-        deserialize_universal_and_check(conn, &other_peer_addr_hosts, peername)) {
+        deserialize_universal_and_check(conn, &other_peer_addr_hosts, peername) ||
+        deserialize_universal_and_check(conn, &remote_max_lanes, peername) ||
+        deserialize_universal_and_check(conn, &remote_lane_index, peername) ||
+        deserialize_universal_and_check(conn, &remote_compression, peername)) {
         return join_result_t::TEMPORARY_ERROR;
     }
 
+    /* Both servers come to the same result here, and every lane of a connection does,
+    too. */
+    const cluster_compression_t negotiated_compression =
+        negotiate_cluster_compression(compression, remote_compression);
+
+    /* Only the side that opened the TCP connection says which lane it's for; the
+    other side sends zero. */
+    const size_t num_lanes = std::max<uint64_t>(std::min(max_lanes, remote_max_lanes), 1);
+    const size_t lane = lane_index != 0 ? lane_index : remote_lane_index;
+    if ((lane_index != 0 && remote_lane_index != 0) || lane >= num_lanes) {
+        logERR("Received inconsistent lane information from %s, closing connection.",
+               peername);
+        return join_result_t::TEMPORARY_ERROR;
+    }
+
+    /* The additional lanes of a connection belong to the server that the first lane
+    is open to, so they don't count as connections of their own here. */
+    set_insertion_sentry_t<server_id_t> remote_server_id_sentry;
+    if (lane == 0) {
+        if (servers.count(remote_server_id) != 0) {
+            // There currently is another connection open to the server
+            logINF("Rejected a connection from server %s since one is open already.",
+                   remote_server_id.print().c_str());
+            return join_result_t::TEMPORARY_ERROR;
+        }
+        remote_server_id_sentry.reset(&servers, remote_server_id);
+    }
+
     {
         // Tell the other node that we are happy to connect with it
         write_message_t wm;
@@ -1147,6 +1397,21 @@ join_result_t connectivity_cluster_t::run_t::handle(
         return join_result_t::TEMPORARY_ERROR;
     }
 
+    if (lane != 0) {
+        /* This is one of the additional lanes of a connection whose `handle()` call is
+        still waiting for it. We hand the TCP connection over to that call, which is
+        responsible for it from now on, and keep it open until that call is done. */
+        auto collector = lane_collectors.find(other_id);
+        cond_t released;
+        if (collector == lane_collectors.end()
+                || !collector->second->hand_over(lane, conn, &released)) {
+            return join_result_t::TEMPORARY_ERROR;
+        }
+        conn_closer_1.reset();
+        released.wait_lazily_unordered();
+        return join_result_t::SUCCESS;
+    }
+
     // Just saying that we're still on the rpc listener thread.
     parent->assert_thread();
 
@@ -1160,6 +1425,19 @@ join_result_t connectivity_cluster_t::run_t::handle(
     object_buffer_t<map_insertion_sentry_t<peer_id_t, peer_address_t> >
         routing_table_entry_sentry;
 
+    /* If the connection has more than one lane, we register a `lane_collector_t` as
+    soon as we have registered the peer in `routing_table`. That's before we send our
+    last message of the handshake, so it's always there when the other lanes arrive. */
+    object_buffer_t<lane_collector_t> lane_collector;
+    map_insertion_sentry_t<peer_id_t, lane_collector_t *> lane_collector_entry;
+    auto register_lane_collector = [&]() {
+        if (num_lanes > 1) {
+            lane_collector.create(num_lanes);
+            lane_collector_entry.reset(
+                &lane_collectors, other_id, lane_collector.get());
+        }
+    };
+
     /* We pick one side of the connection to be the "leader" and the other side
     to be the "follower". These roles are only relevant in the initial startup
     process. The leader registers the connection locally. If there's a conflict,
@@ -1182,6 +1460,7 @@ join_result_t connectivity_cluster_t::run_t::handle(
                                                     &routing_table_to_send)) {
             return join_result_t::TEMPORARY_ERROR;
         }
+        register_lane_collector();
 
         /* We're good to go! Transmit the routing table to the follower, so it
         knows we're in. */
@@ -1215,6 +1494,7 @@ join_result_t connectivity_cluster_t::run_t::handle(
                                                     &routing_table_to_send)) {
             return join_result_t::TEMPORARY_ERROR;
         }
+        register_lane_collector();
 
         /* Send our routing table to the leader */
         {
@@ -1273,12 +1553,46 @@ join_result_t connectivity_cluster_t::run_t::handle(
         }
     }
 
+    /* Collect the additional lanes. If we opened the first lane, it's up to us to
+    open them as well. */
+    std::vector<keepalive_tcp_conn_stream_t *> lane_conns(1, conn);
+    if (num_lanes > 1) {
+        if (dialed_address.has_value()) {
+            for (size_t i = 1; i < num_lanes; ++i) {
+                coro_t::spawn_sometime(std::bind(
+                    &connectivity_cluster_t::run_t::connect_lane, this,
+                    *dialed_address, i, other_id, *other_peer_addr.get(),
+                    remote_server_id, drainer_lock));
+            }
+        }
+        signal_timer_t timeout;
+        timeout.start(CLUSTER_LANE_TIMEOUT_MS);
+        wait_any_t waiter(lane_collector->get_all_arrived(), lane_collector->get_failed(),
+                          &timeout, drainer_lock.get_drain_signal());
+        waiter.wait_lazily_unordered();
+        if (!lane_collector->get_all_arrived()->is_pulsed()) {
+            if (!drainer_lock.get_drain_signal()->is_pulsed()) {
+                logWRN("Could not establish all %zu connections to %s, closing "
+                       "connection.", num_lanes, peername);
+            }
+            return join_result_t::TEMPORARY_ERROR;
+        }
+        for (size_t i = 1; i < num_lanes; ++i) {
+            lane_conns.push_back(lane_collector->get_lane_conn(i));
+        }
+    }
+
     /* Now that we're about to switch threads, it's not safe to try to close
     the connection from this thread anymore. This is safe because we won't do
     anything that permanently blocks before setting up `conn_closer_2`. */
     conn_closer_1.reset();
 
     thread_allocation_t chosen_thread(&parent->thread_allocator);
+    std::vector<scoped_ptr_t<thread_allocation_t> > lane_threads;
+    for (size_t i = 1; i < lane_conns.size(); ++i) {
+        lane_threads.push_back(make_scoped<thread_allocation_t>(
+            &parent->thread_allocator));
+    }
 
     cross_thread_signal_t connection_thread_drain_signal(
         drainer_lock.get_drain_signal(),
@@ -1290,6 +1604,7 @@ join_result_t connectivity_cluster_t::run_t::handle(
                     heartbeat_sl_view)), chosen_thread.get_thread());
 
     rethread_tcp_conn_stream_t unregister_conn(conn, INVALID_THREAD);
+    lane_rethreader_t lane_rethreader(lane_conns, lane_threads);
     on_thread_t conn_threader(chosen_thread.get_thread());
     rethread_tcp_conn_stream_t reregister_conn(conn, get_thread_id());
 
@@ -1317,7 +1632,8 @@ join_result_t connectivity_cluster_t::run_t::handle(
         constructor registers it in the `connectivity_cluster_t`'s connection
         map. */
         connection_t conn_structure(
-            this, other_id, remote_server_id, conn, *other_peer_addr.get());
+            this, other_id, remote_server_id, lane_conns, negotiated_compression,
+            *other_peer_addr.get());
 
         /* `heartbeat_manager` will periodically send a heartbeat message to
         other servers, and it will also close the connection if we don't
@@ -1328,57 +1644,29 @@ join_result_t connectivity_cluster_t::run_t::handle(
             peerstr,
             cross_thread_heartbeat_sl_view.get_watchable());
 
-        /* Main message-handling loop: read messages off the connection until
-        it's closed, which may be due to network events, or the other end
-        shutting down, or us shutting down. */
-        try {
-            int messages_handled_since_yield = 0;
-            while (true) {
-                message_tag_t tag;
-                archive_result_t res = deserialize_universal(conn, &tag);
-                if (bad(res)) { throw fake_archive_exc_t(); }
-
-                /* Ignore messages tagged with the heartbeat tag. The
-                `keepalive_tcp_conn_stream_t` will have already notified the
-                `heartbeat_manager_t` as soon as the heartbeat arrived. */
-                if (tag != heartbeat_tag) {
-                    cluster_message_handler_t *handler = parent->message_handlers[tag];
-                    guarantee(handler != nullptr, "Got a message for an unfamiliar tag. "
-                        "Apparently we aren't compatible with the cluster on the other "
-                        "end.");
-
-                    /* If you really want to support old cluster versions, the
-                    resolved_version should be passed into the on_message() handler. */
-                    guarantee(resolved_version == cluster_version_t::CLUSTER);
-                    handler->on_message(
-                        &conn_structure,
-                        auto_drainer_t::lock_t(conn_structure.drainers.get()),
-                        conn); // might raise fake_archive_exc_t
+        /* Read messages off every lane until it's closed, which may be due to network
+        events, or the other end shutting down, or us shutting down. If we shut down,
+        `conn_closer_2` closes the first lane. Once any of the lanes is closed, we close
+        all of them. */
+        pmap(lane_conns.size(), [&](size_t i) {
+            {
+                on_thread_t thread_switcher(lane_conns[i]->home_thread());
+                handle_messages(&conn_structure, lane_conns[i], negotiated_compression,
+                                resolved_version);
+            }
+            pmap(lane_conns.size(), [&](size_t j) {
+                on_thread_t thread_switcher(lane_conns[j]->home_thread());
+                if (lane_conns[j]->is_read_open()) {
+                    lane_conns[j]->shutdown_read();
                 }
-
-                ++messages_handled_since_yield;
-                if (messages_handled_since_yield >= MESSAGE_HANDLER_MAX_BATCH_SIZE) {
-                    coro_t::yield();
-                    messages_handled_since_yield = 0;
+                if (lane_conns[j]->is_write_open()) {
+                    /* Shutdown the write direction as well, to make sure that any
+                    active `send_message` calls get interrupted and don't stop us from
+                    destructing the `conn_structure`. */
+                    lane_conns[j]->shutdown_write();
                 }
-            }
-        } catch (const fake_archive_exc_t &) {
-            /* The exception broke us out of the loop, and that's what we
-            wanted. This could either be because we lost contact with the peer
-            or because the cluster is shutting down and `close_conn()` got
-            called. */
-        }
-
-        if (conn->is_read_open()) {
-            logWRN("Received invalid data on a cluster connection. Disconnecting.");
-            conn->shutdown_read();
-        }
-        if (conn->is_write_open()) {
-            /* Shutdown the write direction as well, to make sure that any active
-            `send_message` calls get interrupted and don't stop us from destructing
-            the `conn_structure`. */
-            conn->shutdown_write();
-        }
+            });
+        });
 
         /* The `conn_structure` destructor removes us from the connection map. It also
         blocks until all references to `conn_structure` have been released (using its
@@ -1393,6 +1681,66 @@ join_result_t connectivity_cluster_t::run_t::handle(
     return join_result_t::SUCCESS;
 }
 
+void connectivity_cluster_t::run_t::handle_messages(
+        connection_t *connection,
+        keepalive_tcp_conn_stream_t *lane_conn,
+        cluster_compression_t lane_compression,
+        cluster_version_t cluster_version) THROWS_NOTHING {
+    read_stream_t *stream = lane_conn;
+    object_buffer_t<cluster_decompressing_stream_t> decompressing_stream;
+    switch (lane_compression) {
+    case cluster_compression_t::none:
+        break;
+    case cluster_compression_t::deflate:
+        stream = decompressing_stream.create(lane_conn);
+        break;
+    default:
+        unreachable();
+    }
+
+    try {
+        int messages_handled_since_yield = 0;
+        while (true) {
+            message_tag_t tag;
+            archive_result_t res = deserialize_universal(stream, &tag);
+            if (bad(res)) { throw fake_archive_exc_t(); }
+
+            /* Ignore messages tagged with the heartbeat tag. The
+            `keepalive_tcp_conn_stream_t` will have already notified the
+            `heartbeat_manager_t` as soon as the heartbeat arrived. */
+            if (tag != heartbeat_tag) {
+                cluster_message_handler_t *handler = parent->message_handlers[tag];
+                guarantee(handler != nullptr, "Got a message for an unfamiliar tag. "
+                    "Apparently we aren't compatible with the cluster on the other "
+                    "end.");
+
+                /* If you really want to support old cluster versions, the
+                cluster_version should be passed into the on_message() handler. */
+                guarantee(cluster_version == cluster_version_t::CLUSTER);
+                handler->on_message(
+                    connection,
+                    auto_drainer_t::lock_t(connection->drainers.get()),
+                    stream); // might raise fake_archive_exc_t
+            }
+
+            ++messages_handled_since_yield;
+            if (messages_handled_since_yield >= MESSAGE_HANDLER_MAX_BATCH_SIZE) {
+                coro_t::yield();
+                messages_handled_since_yield = 0;
+            }
+        }
+    } catch (const fake_archive_exc_t &) {
+        /* The exception broke us out of the loop, and that's what we
+        wanted. This could either be because we lost contact with the peer
+        or because the connection is being closed. */
+    }
+
+    if (lane_conn->is_read_open()) {
+        logWRN("Received invalid data on a cluster connection. Disconnecting.");
+        lane_conn->shutdown_read();
+    }
+}
+
 connectivity_cluster_t::connectivity_cluster_t() THROWS_NOTHING :
     me(peer_id_t(generate_uuid())),
     /* We assign threads from the highest thread number downwards. This is to reduce the
@@ -1466,7 +1814,8 @@ connectivity_cluster_t::connection_t *connectivity_cluster_t::get_connection(
 void connectivity_cluster_t::send_message(connection_t *connection,
                                      auto_drainer_t::lock_t connection_keepalive,
                                      message_tag_t tag,
-                                     cluster_send_message_write_callback_t *callback) {
+                                     cluster_send_message_write_callback_t *callback,
+                                     uint64_t ordering_key) {
     // We could be on _any_ thread.
 
     /* If the connection is being closed, just drop the message now. It's not going
@@ -1526,59 +1875,86 @@ void connectivity_cluster_t::send_message(connection_t *connection,
         message_handlers[tag]->on_local_message(connection, connection_keepalive,
             std::move(buffer_data));
     } else {
-        on_thread_t threader(connection->conn->home_thread());
+        // This includes switching to the lane's thread and waiting for the
+        // `send_mutex`, not just the write itself.
+        const ticks_t start_time = get_ticks();
+        /* Messages with the same ordering key always go over the same lane, so they
+        can't overtake each other. */
+        connection_t::lane_t *lane =
+            connection->lanes[ordering_key % connection->lanes.size()].get();
+        on_thread_t threader(lane->conn->home_thread());
 
         /* Acquire the send-mutex so we don't collide with other things trying
-        to send on the same connection. */
+        to send on the same lane. */
         {
             /* The `true` is for eager waiting, which is a significant performance
             optimization in this case. */
-            mutex_t::acq_t acq(&connection->send_mutex, true);
-
-            /* Write the tag to the network */
-            {
-                // All cluster versions use a uint8_t tag here.
-                write_message_t wm;
-                static_assert(std::is_same<message_tag_t, uint8_t>::value,
-                              "We expect to be serializing a uint8_t -- if this has "
-                              "changed, the cluster communication format has changed and "
-                              "you need to ask yourself whether live cluster upgrades work."
-                              );
-                serialize_universal(&wm, tag);
-                make_buffered_tcp_conn_stream_wrapper_t buffered_conn(connection->conn);
-                int res = send_write_message(&buffered_conn, &wm);
+            mutex_t::acq_t acq(&lane->send_mutex, true);
+
+            if (lane->compressor.has()) {
+                /* The tag and the message go into one frame. This has to happen while
+                we hold the `send_mutex`, because the frames have to be written in the
+                order that the compressor produced them in. */
+                std::vector<char> frame;
+                lane->compressor->frame_message(tag, buffer.vector(), &frame);
+                connection->pm_compression_input_bytes += buffer.vector().size() + 1;
+                connection->pm_compression_output_bytes += frame.size();
+                int64_t res = lane->conn->write_buffered(frame.data(), frame.size());
                 if (res == -1) {
-                    /* Close the other half of the connection to make sure that
-                       `connectivity_cluster_t::run_t::handle()` notices that something is
-                       up */
-                    if (connection->conn->is_read_open()) {
-                        connection->conn->shutdown_read();
+                    if (lane->conn->is_read_open()) {
+                        lane->conn->shutdown_read();
                     }
                     return;
+                } else {
+                    guarantee(res == static_cast<int64_t>(frame.size()));
+                }
+            } else {
+                /* Write the tag to the network */
+                {
+                    // All cluster versions use a uint8_t tag here.
+                    write_message_t wm;
+                    static_assert(std::is_same<message_tag_t, uint8_t>::value,
+                                  "We expect to be serializing a uint8_t -- if this "
+                                  "has changed, the cluster communication format has "
+                                  "changed and you need to ask yourself whether live "
+                                  "cluster upgrades work.");
+                    serialize_universal(&wm, tag);
+                    make_buffered_tcp_conn_stream_wrapper_t buffered_conn(lane->conn);
+                    int res = send_write_message(&buffered_conn, &wm);
+                    if (res == -1) {
+                        /* Close the other half of the connection to make sure
+                           that `connectivity_cluster_t::run_t::handle()` notices
+                           that something is up */
+                        if (lane->conn->is_read_open()) {
+                            lane->conn->shutdown_read();
+                        }
+                        return;
+                    }
                 }
-            }
 
-            /* Write the message itself to the network */
-            {
-                int64_t res = connection->conn->write_buffered(buffer.vector().data(),
-                                                               buffer.vector().size());
-                if (res == -1) {
-                    if (connection->conn->is_read_open()) {
-                        connection->conn->shutdown_read();
+                /* Write the message itself to the network */
+                {
+                    int64_t res = lane->conn->write_buffered(buffer.vector().data(),
+                                                             buffer.vector().size());
+                    if (res == -1) {
+                        if (lane->conn->is_read_open()) {
+                            lane->conn->shutdown_read();
+                        }
+                        return;
+                    } else {
+                        guarantee(res == static_cast<int64_t>(buffer.vector().size()));
                     }
-                    return;
-                } else {
-                    guarantee(res == static_cast<int64_t>(buffer.vector().size()));
                 }
             }
         } /* Releases the send_mutex */
 
-        connection->flusher.notify();
+        lane->flusher.notify();
         cond_t dummy_interruptor;
-        connection->flusher.flush(&dummy_interruptor);
-        if (!connection->conn->is_write_open()) {
-            if (connection->conn->is_read_open()) {
-                connection->conn->shutdown_read();
+        lane->flusher.flush(&dummy_interruptor);
+        connection->pm_send_latency.record_since(start_time);
+        if (!lane->conn->is_write_open()) {
+            if (lane->conn->is_read_open()) {
+                lane->conn->shutdown_read();
             }
             return;
         }
@@ -17,11 +17,14 @@
 #include "containers/archive/tcp_conn_stream.hpp"
 #include "containers/map_sentries.hpp"
 #include "concurrency/pump_coro.hpp"
+#include "config/args.hpp"
 #include "perfmon/perfmon.hpp"
 #include "random.hpp"
+#include "rpc/connectivity/compression.hpp"
 #include "rpc/connectivity/peer_id.hpp"
 #include "rpc/connectivity/server_id.hpp"
 #include "utils.hpp"
+#include "version.hpp"
 
 namespace boost {
 template <class> class optional;
@@ -81,9 +84,24 @@ connection. Once a connection is established, messages can be sent across it in
 directions. Every message is guaranteed to eventually arrive unless the connection goes
 down. Messages cannot be duplicated.
 
-Can messages be reordered? I think the current implementation doesn't ever reorder
-messages, but don't rely on this guarantee. However, some old code may rely on this
-guarantee (I'm not sure) so don't break this property without checking first. */
+A connection to another server can consist of several TCP connections, which we call
+"lanes" (see `CLUSTER_CONNECTIONS_PER_PEER`). `send_message()` picks the lane by the
+message's ordering key. Messages that are sent with the same ordering key arrive in the
+order they were sent in, but messages with different ordering keys can overtake each
+other. Every lane carries its own heartbeats, so a lane that stalls brings down the
+whole connection.
+
+Everything except for mailbox messages uses the default ordering key, so the directory,
+the semilattice metadata and any other tag stay on the first lane and in FIFO order
+among themselves. Mailbox messages use the destination thread as their ordering key, so
+they keep their order per thread but not relative to the first lane. Nothing relied on
+that order before lanes existed either: `mailbox_manager_t`,
+`directory_read_manager_t` and `semilattice_manager_t` all hand each message to a
+coroutine on another thread, so their deliveries could already interleave. Within the
+directory, `fifo_enforcer_t` tokens put updates back in order, and the semilattice
+`sync_from()`/`sync_to()` replies wait for the metadata version that they refer to
+rather than assuming it arrived first. A protocol that needs a mailbox message to be
+handled after a message of another tag has to wait for it explicitly, the same way. */
 
 class connectivity_cluster_t :
     public home_thread_mixin_debug_only_t
@@ -141,23 +159,53 @@ public:
             return conn == nullptr;
         }
 
-        /* Drops the connection. */
+        /* Drops the connection. Only the first lane is closed right away; `handle()`
+        closes the other ones once it notices. */
         void kill_connection();
 
     private:
         friend class connectivity_cluster_t;
 
+        /* One of the TCP connections that make up the connection. Each lane is on a
+        thread of its own and has its own `send_mutex`, so senders that use different
+        lanes don't wait for each other. It must be constructed and destroyed on the
+        thread of its `conn`. */
+        class lane_t {
+        public:
+            lane_t(keepalive_tcp_conn_stream_t *conn,
+                   cluster_compression_t compression);
+
+            keepalive_tcp_conn_stream_t *const conn;
+
+            mutex_t send_mutex;
+
+            /* Empty unless the connection is compressed. It's protected by the
+            `send_mutex`, since messages must be framed in the order they're sent in. */
+            scoped_ptr_t<cluster_compressor_t> compressor;
+
+            /* Calls `conn->flush_buffer()`. Can be used for making sure that a
+            buffered write makes it to the TCP stack. */
+            pump_coro_t flusher;
+
+        private:
+            DISABLE_COPYING(lane_t);
+        };
+
         /* The constructor registers us in every thread's `connections` map, thereby
-        notifying event subscribers. */
+        notifying event subscribers. `lane_conns` is empty for the loopback connection;
+        otherwise its first entry is the TCP connection that the handshake took place
+        on. */
         connection_t(
             run_t *,
             const peer_id_t &peer_id,
             const server_id_t &server_id,
-            keepalive_tcp_conn_stream_t *,
+            const std::vector<keepalive_tcp_conn_stream_t *> &lane_conns,
+            cluster_compression_t compression,
             const peer_address_t &peer_address) THROWS_NOTHING;
         ~connection_t() THROWS_NOTHING;
 
-        /* NULL for the loopback connection (i.e. our "connection" to ourself) */
+        /* NULL for the loopback connection (i.e. our "connection" to ourself).
+        Otherwise it's the first lane. */
         keepalive_tcp_conn_stream_t *conn;
 
         /* `connection_t` contains the addresses so that we can call
@@ -165,16 +213,19 @@ public:
         cross-thread to access the routing table. */
         peer_address_t peer_address;
 
-        /* Unused for our connection to ourself */
-        mutex_t send_mutex;
-
-        /* Calls `conn->flush_buffer()`. Can be used for making sure that a
-        buffered write makes it to the TCP stack. */
-        pump_coro_t flusher;
+        /* Empty for our connection to ourself. The lanes don't change for as long as
+        the `connection_t` exists, so they can be read from any thread. */
+        std::vector<scoped_ptr_t<lane_t> > lanes;
 
         perfmon_collection_t pm_collection;
         perfmon_sampler_t pm_bytes_sent;
-        perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership;
+        perfmon_latency_histogram_t pm_send_latency;
+        /* The size of the messages sent on a compressed connection, before and after
+        compression. */
+        perfmon_counter_t pm_compression_input_bytes, pm_compression_output_bytes;
+        perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership,
+            pm_send_latency_membership, pm_compression_input_bytes_membership,
+            pm_compression_output_bytes_membership;
 
         /* We only hold this information so we can deregister ourself */
         run_t *parent;
@@ -203,7 +254,9 @@ public:
                   heartbeat_semilattice_metadata_t> > heartbeat_sl_view,
               std::shared_ptr<semilattice_read_view_t<
                   auth_semilattice_metadata_t> > auth_sl_view,
-              tls_ctx_t *tls_ctx)
+              tls_ctx_t *tls_ctx,
+              size_t connections_per_peer = CLUSTER_CONNECTIONS_PER_PEER,
+              cluster_compression_t compression = cluster_compression_t::none)
             THROWS_ONLY(address_in_use_exc_t, tcp_socket_exc_t);
 
         ~run_t();
@@ -220,6 +273,8 @@ public:
         friend class connectivity_cluster_t;
         friend class auto_reconnector_t;
 
+        class lane_collector_t;
+
         /* Sets a variable to a value in its constructor; sets it to NULL in its
         destructor. This is kind of silly. The reason we need it is that we need
         the variable to be set before the constructors for some other fields of
@@ -257,6 +312,16 @@ public:
                              const int join_delay_secs,
                              co_semaphore_t *rate_control) THROWS_NOTHING;
 
+        /* `connect_lane()` is spawned by `handle()` for each additional lane of a
+        connection that we opened. It connects to the same address as the first lane did
+        and hands the new TCP connection over to the `lane_collector_t` of the peer. */
+        void connect_lane(ip_and_port_t address,
+                          size_t lane_index,
+                          peer_id_t expected_id,
+                          peer_address_t expected_address,
+                          server_id_t expected_server_id,
+                          auto_drainer_t::lock_t drainer_lock) THROWS_NOTHING;
+
         /* `join_blocking()` is spawned in a new coroutine by `join()`. It's also run by
         `handle()` when we hear about a new peer from a peer we are connected to, and
         directly by the auto_reconnector_t. For cases where it is used directly, it
@@ -280,15 +345,26 @@ public:
         connect-notification, receiving messages from the peer until it
         disconnects or we are shut down, and sending out the
         disconnect-notification. It returns a join_result_t indicating the outcome
-        of the attempted join. */
+        of the attempted join. `dialed_address` is the address that we connected to if
+        we opened the TCP connection ourselves; in that case we also open the additional
+        lanes. `lane_index` is non-zero if `c` is one of those additional lanes. */
         join_result_t handle(keepalive_tcp_conn_stream_t *c,
             optional<peer_id_t> expected_id,
             optional<peer_address_t> expected_address,
             optional<server_id_t> expected_server_id,
+            optional<ip_and_port_t> dialed_address,
+            size_t lane_index,
             auto_drainer_t::lock_t,
             bool *successful_join_inout,
             const int join_delay_secs) THROWS_NOTHING;
 
+        /* Reads messages off of one lane of `connection` and dispatches them to the
+        message handlers until the lane is closed. */
+        void handle_messages(connection_t *connection,
+                             keepalive_tcp_conn_stream_t *lane_conn,
+                             cluster_compression_t compression,
+                             cluster_version_t cluster_version) THROWS_NOTHING;
+
         connectivity_cluster_t *parent;
 
         /* The server's own id and the set of servers we are connected to, we only allow
@@ -298,6 +374,18 @@ public:
 
         tls_ctx_t *tls_ctx;
 
+        /* How many lanes we use for a connection to a peer, unless the peer wants
+        fewer. */
+        size_t connections_per_peer;
+
+        /* The compression we want for connections. A connection is only compressed if
+        the peer wants the same. */
+        cluster_compression_t compression;
+
+        /* The `lane_collector_t`s of the connections whose `handle()` is waiting for
+        their additional lanes to arrive. */
+        std::map<peer_id_t, lane_collector_t *> lane_collectors;
+
         /* `attempt_table` is a table of all the host:port pairs we're currently
         trying to connect to or have connected to. If we are told to connect to
         an address already in this table, we'll just ignore it. That's important
@@ -357,13 +445,20 @@ public:
     connection_t *get_connection(peer_id_t peer,
             auto_drainer_t::lock_t *keepalive_out) THROWS_NOTHING;
 
+    /* The stats of every connection, keyed by the peer ID. */
+    perfmon_collection_t *get_connectivity_collection() THROWS_NOTHING {
+        return &connectivity_collection;
+    }
+
     /* Sends a message to the other server. The message is associated with a "tag",
     which determines which message handler on the other server will receive the message.
-    */
+    The `ordering_key` determines the lane that the message goes over; see the comment
+    at the top of the class. */
     void send_message(connection_t *connection,
                       auto_drainer_t::lock_t connection_keepalive,
                       message_tag_t tag,
-                      cluster_send_message_write_callback_t *callback);
+                      cluster_send_message_write_callback_t *callback,
+                      uint64_t ordering_key = 0);
 
 private:
     friend class cluster_message_handler_t;
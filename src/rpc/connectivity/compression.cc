@@ -0,0 +1,195 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rpc/connectivity/compression.hpp"
+
+#include <string.h>
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "config/args.hpp"
+#include "containers/archive/varint.hpp"
+
+// The frame types. These are part of the cluster protocol.
+static const uint8_t FRAME_RAW = 0;
+static const uint8_t FRAME_DEFLATE = 1;
+
+// A frame header is the type and a varint of at most 10 bytes.
+static const size_t MAX_FRAME_HEADER_SIZE = 11;
+
+// How large a compressed frame may be. A frame inflates to at most
+// `CLUSTER_COMPRESSION_MAX_FRAME_SIZE` bytes, and deflate never grows incompressible
+// data by more than a fraction of a percent plus the flush marker.
+static const uint64_t MAX_DEFLATE_FRAME_SIZE =
+    CLUSTER_COMPRESSION_MAX_FRAME_SIZE + CLUSTER_COMPRESSION_MAX_FRAME_SIZE / 16 + 1024;
+
+// Raw deflate data, without the zlib header and checksum. The framing takes care of
+// that.
+static const int DEFLATE_WINDOW_BITS = -15;
+
+cluster_compression_t negotiate_cluster_compression(cluster_compression_t ours,
+                                                    uint8_t theirs) {
+    return static_cast<uint8_t>(ours) == theirs ? ours : cluster_compression_t::none;
+}
+
+static void append_frame_header(uint8_t type, uint64_t size, std::vector<char> *out) {
+    uint8_t header[MAX_FRAME_HEADER_SIZE];
+    header[0] = type;
+    const size_t header_size = 1 + serialize_varint_uint64_into_buf(size, header + 1);
+    out->insert(out->end(), header, header + header_size);
+}
+
+cluster_compressor_t::cluster_compressor_t() : stream(new z_stream_s()) {
+    // Compression happens on the connection's thread while it holds the send mutex,
+    // so we go for speed rather than for the best ratio.
+    int res = deflateInit2(stream.get(), Z_BEST_SPEED, Z_DEFLATED, DEFLATE_WINDOW_BITS,
+                           8, Z_DEFAULT_STRATEGY);
+    guarantee(res == Z_OK, "deflateInit2 failed: %d", res);
+}
+
+cluster_compressor_t::~cluster_compressor_t() {
+    deflateEnd(stream.get());
+}
+
+void cluster_compressor_t::frame_message(uint8_t tag,
+                                         const std::vector<char> &body,
+                                         std::vector<char> *frame_out) {
+    const uint64_t message_size = body.size() + 1;
+    if (message_size < CLUSTER_COMPRESSION_THRESHOLD) {
+        append_frame_header(FRAME_RAW, message_size, frame_out);
+        frame_out->push_back(static_cast<char>(tag));
+        frame_out->insert(frame_out->end(), body.begin(), body.end());
+        return;
+    }
+
+    /* Every frame ends with a sync flush, so each one inflates to exactly the part of
+    the message that went into it. They continue the same deflate stream. */
+    size_t offset = 0;
+    do {
+        compressed.clear();
+        size_t chunk_size = CLUSTER_COMPRESSION_MAX_FRAME_SIZE;
+        if (offset == 0) {
+            deflate_into(&tag, 1, Z_NO_FLUSH, &compressed);
+            --chunk_size;
+        }
+        chunk_size = std::min(chunk_size, body.size() - offset);
+        deflate_into(body.data() + offset, chunk_size, Z_SYNC_FLUSH, &compressed);
+        offset += chunk_size;
+        append_frame_header(FRAME_DEFLATE, compressed.size(), frame_out);
+        frame_out->insert(frame_out->end(), compressed.begin(), compressed.end());
+    } while (offset < body.size());
+}
+
+void cluster_compressor_t::deflate_into(const void *data, size_t size, int flush,
+                                        std::vector<char> *out) {
+    stream->next_in = static_cast<Bytef *>(const_cast<void *>(data));
+    stream->avail_in = size;
+    size_t pos = out->size();
+    /* For `Z_SYNC_FLUSH`, `deflate()` is done once it leaves some of the output buffer
+    unused. */
+    do {
+        out->resize(pos + std::max<size_t>(deflateBound(stream.get(), size), 1024));
+        stream->next_out = reinterpret_cast<Bytef *>(out->data() + pos);
+        stream->avail_out = out->size() - pos;
+        int res = deflate(stream.get(), flush);
+        guarantee(res == Z_OK || res == Z_BUF_ERROR, "deflate failed: %d", res);
+        pos = out->size() - stream->avail_out;
+    } while (stream->avail_out == 0);
+    guarantee(stream->avail_in == 0);
+    out->resize(pos);
+}
+
+cluster_decompressing_stream_t::cluster_decompressing_stream_t(read_stream_t *_inner) :
+    inner(_inner),
+    stream(new z_stream_s()),
+    raw_remaining(0),
+    inflated_pos(0) {
+    int res = inflateInit2(stream.get(), DEFLATE_WINDOW_BITS);
+    guarantee(res == Z_OK, "inflateInit2 failed: %d", res);
+}
+
+cluster_decompressing_stream_t::~cluster_decompressing_stream_t() {
+    inflateEnd(stream.get());
+}
+
+int64_t cluster_decompressing_stream_t::read(void *p, int64_t n) {
+    while (raw_remaining == 0 && inflated_pos == inflated.size()) {
+        int64_t res = next_frame();
+        if (res != 1) {
+            return res;
+        }
+    }
+
+    if (raw_remaining > 0) {
+        int64_t res = inner->read(p, std::min<uint64_t>(n, raw_remaining));
+        if (res == 0) {
+            // The connection got closed in the middle of a frame.
+            return -1;
+        }
+        if (res > 0) {
+            raw_remaining -= res;
+        }
+        return res;
+    }
+
+    const size_t count = std::min<size_t>(n, inflated.size() - inflated_pos);
+    memcpy(p, inflated.data() + inflated_pos, count);
+    inflated_pos += count;
+    return count;
+}
+
+int64_t cluster_decompressing_stream_t::next_frame() {
+    uint8_t type;
+    int64_t res = force_read(inner, &type, 1);
+    if (res != 1) {
+        return res;
+    }
+    uint64_t size;
+    if (bad(deserialize_varint_uint64(inner, &size))) {
+        return -1;
+    }
+
+    switch (type) {
+    case FRAME_RAW:
+        raw_remaining = size;
+        return 1;
+    case FRAME_DEFLATE: {
+        /* The size comes from the network, so we check it before we allocate
+        anything. */
+        if (size > MAX_DEFLATE_FRAME_SIZE) {
+            return -1;
+        }
+        compressed.resize(size);
+        if (force_read(inner, compressed.data(), size) != static_cast<int64_t>(size)) {
+            return -1;
+        }
+        stream->next_in = reinterpret_cast<Bytef *>(compressed.data());
+        stream->avail_in = size;
+        inflated.clear();
+        inflated_pos = 0;
+        size_t pos = 0;
+        do {
+            /* We leave room for one byte more than a frame may inflate to, so that we
+            can tell a frame that's too large from one that just fits. */
+            if (pos > CLUSTER_COMPRESSION_MAX_FRAME_SIZE) {
+                return -1;
+            }
+            inflated.resize(std::min<size_t>(pos + std::max<size_t>(4 * size, 1024),
+                                             CLUSTER_COMPRESSION_MAX_FRAME_SIZE + 1));
+            stream->next_out = reinterpret_cast<Bytef *>(inflated.data() + pos);
+            stream->avail_out = inflated.size() - pos;
+            int zres = inflate(stream.get(), Z_SYNC_FLUSH);
+            if (zres != Z_OK && zres != Z_BUF_ERROR) {
+                return -1;
+            }
+            pos = inflated.size() - stream->avail_out;
+        } while (stream->avail_out == 0);
+        inflated.resize(pos);
+        if (pos > CLUSTER_COMPRESSION_MAX_FRAME_SIZE || stream->avail_in != 0) {
+            return -1;
+        }
+        return 1;
+    }
+    default:
+        return -1;
+    }
+}
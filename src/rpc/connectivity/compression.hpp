@@ -0,0 +1,88 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RPC_CONNECTIVITY_COMPRESSION_HPP_
+#define RPC_CONNECTIVITY_COMPRESSION_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "containers/archive/archive.hpp"
+#include "containers/scoped.hpp"
+
+struct z_stream_s;
+
+/* Compression of the messages on a cluster connection. Both servers say in the
+handshake which mode they want, and a connection is only compressed if both want the
+same mode.
+
+On a compressed lane, every message (its tag and its body) is sent as frames: a
+`uint8_t` frame type, the size of the payload as a varint, and the payload. Messages
+smaller than `CLUSTER_COMPRESSION_THRESHOLD` go into a single uncompressed frame, whose
+payload is just the message. Larger messages are compressed and split into frames that
+inflate to at most `CLUSTER_COMPRESSION_MAX_FRAME_SIZE` bytes each. The payloads of the compressed frames of a lane are the output of a
+single deflate stream, which is flushed at the end of every frame. So the receiver can
+inflate each frame as soon as it arrives, but the compressor still gets to use what it
+has seen in earlier messages. */
+
+enum class cluster_compression_t : uint8_t {
+    none = 0,
+    deflate = 1
+};
+
+// Returns `none` if the two servers don't want the same mode.
+cluster_compression_t negotiate_cluster_compression(cluster_compression_t ours,
+                                                    uint8_t theirs);
+
+/* Turns messages into frames. There's one for each direction of each compressed lane,
+and messages must be framed in the order they are sent in. */
+class cluster_compressor_t {
+public:
+    cluster_compressor_t();
+    ~cluster_compressor_t();
+
+    // Appends the frame for the message with the given tag and body to `frame_out`.
+    void frame_message(uint8_t tag,
+                       const std::vector<char> &body,
+                       std::vector<char> *frame_out);
+
+private:
+    void deflate_into(const void *data, size_t size, int flush,
+                      std::vector<char> *out);
+
+    scoped_ptr_t<z_stream_s> stream;
+    std::vector<char> compressed;
+
+    DISABLE_COPYING(cluster_compressor_t);
+};
+
+/* Reads the frames that a `cluster_compressor_t` produced off of `inner` and returns the
+messages in them. `read()` returns -1 if a frame is malformed or larger than a
+`cluster_compressor_t` would have made it. */
+class cluster_decompressing_stream_t : public read_stream_t {
+public:
+    explicit cluster_decompressing_stream_t(read_stream_t *inner);
+    ~cluster_decompressing_stream_t();
+
+    MUST_USE int64_t read(void *p, int64_t n);
+
+private:
+    // Returns 1 once it has read the next frame, or what `inner` returned otherwise.
+    int64_t next_frame();
+
+    read_stream_t *const inner;
+    scoped_ptr_t<z_stream_s> stream;
+
+    // What's left of the current uncompressed frame, which we read from `inner`
+    // directly.
+    uint64_t raw_remaining;
+
+    // The inflated payload of the current compressed frame.
+    std::vector<char> compressed;
+    std::vector<char> inflated;
+    size_t inflated_pos;
+
+    DISABLE_COPYING(cluster_decompressing_stream_t);
+};
+
+#endif  // RPC_CONNECTIVITY_COMPRESSION_HPP_
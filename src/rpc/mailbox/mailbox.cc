@@ -125,8 +125,10 @@ void send_write(mailbox_manager_t *src, raw_mailbox_t::address_t dest,
         return;
     }
     raw_mailbox_writer_t writer(dest.thread, dest.mailbox_id, callback);
+    /* Messages to mailboxes on the same thread go over the same lane, so messages to
+    the same mailbox arrive in order. */
     src->get_connectivity_cluster()->send_message(connection, connection_keepalive,
-        src->get_message_tag(), &writer);
+        src->get_message_tag(), &writer, static_cast<uint64_t>(dest.thread));
 }
 
 static const int MAX_OUTSTANDING_MAILBOX_WRITES_PER_THREAD = 4;
@@ -30,6 +30,9 @@ public:
 private:
     template <class... Args2>
     friend void send(mailbox_manager_t *, mailbox_addr_t<Args2...>, const Args2 &... args);
+    template <class... Args2>
+    friend void send_write(mailbox_manager_t *, mailbox_addr_t<Args2...>,
+                           mailbox_write_callback_t *);
 
     raw_mailbox_t::address_t addr;
 };
@@ -105,4 +108,13 @@ void send(mailbox_manager_t *src, mailbox_addr_t<Args...> dest, const Args &...
     send_write(src, dest.addr, &writer);
 }
 
+/* This is for senders that serialize the arguments themselves, for example to serialize
+a large argument only once when sending it to many mailboxes. `callback` must write
+exactly what `send()` would have written for the same arguments. */
+template <class... Args>
+void send_write(mailbox_manager_t *src, mailbox_addr_t<Args...> dest,
+                mailbox_write_callback_t *callback) {
+    send_write(src, dest.addr, callback);
+}
+
 #endif // RPC_MAILBOX_TYPED_HPP_
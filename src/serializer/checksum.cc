@@ -1,58 +1,72 @@
 #include "serializer/checksum.hpp"
 
-// The return value of this function or its behavior can't be changed -- the on-disk
-// format obviously requires a specific checksum algorithm.
-serializer_checksum compute_checksum(const void *word32s, size_t wordcount) {
-    const uint32_t *p = static_cast<const uint32_t *>(word32s);
+#include <algorithm>
 
-    // This is the Fletcher-64 algorithm, applied to the input whose words are xored with
-    // 1.
-
-    // Given a sequence of 32-bit words x0, x1, ..., xN-1, define sK by
-    // sK = x0 + x1 + ... + xK.  Our checksum computes two values:
-    // A = (sN-1 MOD (2**32 - 1)).
-    // B = ((s0 + s1 + ... + sN-1) MOD (2**32 - 1)).
-    //
-    // We output the pair ((A == 0 ? (2**32-1) : A), (B == 0 ? (2**32-1) : B)).
-
-    // Why Fletcher-64 on xored inputs?
-    //
-    // One advantage is that checksum(s + t) can be computed from checksum(s) => (A1, B1)
-    // and checksum(t) => (A2, B2).  Output (A3, B3) where A3 = A1 + A2, B3 = B1 + A1 *
-    // length(t) + B2.
-    //
-    // We first xor the words by 1, so that the word 0x00000000 is distinguishable from
-    // 0xFFFFFFFF.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHECKSUM_HAS_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define CHECKSUM_HAS_X86_SIMD 0
+#endif
 
-    uint64_t a = 0xFFFFFFFF;
-    uint64_t b = 0xFFFFFFFF;
+#include "errors.hpp"
 
-    // We go through a minor shenanigan here to handle very large buffers.
-    for (;;) {
-        // 0xFFFFul is low enough that a and b can't overflow.
-        const size_t n = wordcount & 0xFFFFul;
+// This is the Fletcher-64 algorithm, applied to the input whose words are xored with 1.
+
+// Given a sequence of 32-bit words x0, x1, ..., xN-1, define sK by
+// sK = x0 + x1 + ... + xK.  Our checksum computes two values:
+// A = (sN-1 MOD (2**32 - 1)).
+// B = ((s0 + s1 + ... + sN-1) MOD (2**32 - 1)).
+//
+// We output the pair ((A == 0 ? (2**32-1) : A), (B == 0 ? (2**32-1) : B)).
 
-        // At this point, a and b are <= 0x1_FFFF_FFFE and non-zero.
+// Why Fletcher-64 on xored inputs?
+//
+// One advantage is that checksum(s + t) can be computed from checksum(s) => (A1, B1)
+// and checksum(t) => (A2, B2).  Output (A3, B3) where A3 = A1 + A2, B3 = B1 + A1 *
+// length(t) + B2.
+//
+// We first xor the words by 1, so that the word 0x00000000 is distinguishable from
+// 0xFFFFFFFF.
 
-        const uint32_t xorer = 1;
+// Since the output only depends on A and B modulo 2**32 - 1, the vectorized
+// implementations below are free to sum the words in a different order, as long as
+// they produce the same residues.
+
+namespace {
+
+const uint64_t FLETCHER_MODULUS = 0xFFFFFFFFull;
+const uint32_t FLETCHER_XORER = 1;
+
+// Runs the Fletcher recurrence over `wordcount` words, starting from *a and *b.  On
+// entry and on exit, *a and *b are <= 0x1_FFFF_FFFE and non-zero.
+void fletcher_scalar(const uint32_t *p, size_t wordcount, uint64_t *a_inout,
+                     uint64_t *b_inout) {
+    uint64_t a = *a_inout;
+    uint64_t b = *b_inout;
+
+    // We go through a minor shenanigan here to handle very large buffers.
+    while (wordcount != 0) {
+        // 0xFFFFul is low enough that a and b can't overflow.
+        const size_t n = std::min<size_t>(wordcount, 0xFFFFul);
 
         for (size_t i = 0; i < n; i++) {
-            a += (uint64_t)(p[i] ^ xorer);
+            a += (uint64_t)(p[i] ^ FLETCHER_XORER);
             b += a;
         }
 
         a = (a & 0xFFFFFFFFul) + (a >> 32);
         b = (b & 0xFFFFFFFFul) + (b >> 32);
 
-        // At this point, a and b are <= 0x1_FFFF_FFFE and non-zero.
-
         wordcount -= n;
-        if (wordcount == 0) {
-            break;
-        }
         p += n;
     }
 
+    *a_inout = a;
+    *b_inout = b;
+}
+
+serializer_checksum fletcher_finish(uint64_t a, uint64_t b) {
     // At this point, a and b are <= 0x1_FFFF_FFFE and non-zero.
     a = (a & 0xFFFFFFFFul) + (a >> 32);
     b = (b & 0xFFFFFFFFul) + (b >> 32);
@@ -60,6 +74,205 @@ serializer_checksum compute_checksum(const void *word32s, size_t wordcount) {
     return serializer_checksum{(b << 32) | a};
 }
 
+serializer_checksum compute_checksum_scalar(const void *word32s, size_t wordcount) {
+    uint64_t a = 0xFFFFFFFF;
+    uint64_t b = 0xFFFFFFFF;
+    fletcher_scalar(static_cast<const uint32_t *>(word32s), wordcount, &a, &b);
+    return fletcher_finish(a, b);
+}
+
+#if CHECKSUM_HAS_X86_SIMD
+
+// The vectorized implementations keep, for every lane j of a vector of `width`
+// words, the lane sums
+//   A_j = x_j + x_(width + j) + x_(2 * width + j) + ...
+//   B_j = sum over iterations k of the A_j before iteration k.
+// After K iterations (covering N = K * width words), word i = k * width + j
+// contributes (N - i) = width * (K - 1 - k) + (width - j) times to B, so
+//   A = sum_j A_j,   B = sum_j (width * B_j + (width - j) * A_j).
+// Lanes are 64 bits wide and get folded modulo 2**32 - 1 every
+// SIMD_FOLD_ITERATIONS iterations, which keeps B_j well below 2**64.
+const size_t SIMD_FOLD_ITERATIONS = 4096;
+
+inline uint64_t fold(uint64_t x) {
+    return (x & 0xFFFFFFFFull) + (x >> 32);
+}
+
+// Combines the lane sums into the state the scalar recurrence would have after the
+// N words, starting from the initial state (2**32 - 1, 2**32 - 1).
+void combine_lanes(const uint64_t *lane_a, const uint64_t *lane_b, size_t width,
+                   uint64_t *a_out, uint64_t *b_out) {
+    uint64_t a = 0;
+    uint64_t b = 0;
+    for (size_t j = 0; j < width; ++j) {
+        const uint64_t aj = fold(fold(lane_a[j]));
+        const uint64_t bj = fold(fold(lane_b[j]));
+        a += aj;
+        b += width * bj + (width - j) * aj;
+    }
+    // The initial state is congruent to zero, so adding the modulus keeps a and b
+    // non-zero without changing their residues.
+    *a_out = FLETCHER_MODULUS + a % FLETCHER_MODULUS;
+    *b_out = FLETCHER_MODULUS + b % FLETCHER_MODULUS;
+}
+
+__attribute__((target("sse4.1")))
+serializer_checksum compute_checksum_sse41(const void *word32s, size_t wordcount) {
+    const uint32_t *p = static_cast<const uint32_t *>(word32s);
+    const size_t width = 4;
+    const size_t iterations = wordcount / width;
+
+    const __m128i xorer = _mm_set1_epi32(FLETCHER_XORER);
+    const __m128i low_mask = _mm_set1_epi64x(0xFFFFFFFFll);
+    __m128i a_lo = _mm_setzero_si128();
+    __m128i a_hi = _mm_setzero_si128();
+    __m128i b_lo = _mm_setzero_si128();
+    __m128i b_hi = _mm_setzero_si128();
+
+    for (size_t done = 0; done < iterations;) {
+        const size_t end = done + std::min(SIMD_FOLD_ITERATIONS, iterations - done);
+        for (; done < end; ++done) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + done * width));
+            x = _mm_xor_si128(x, xorer);
+            b_lo = _mm_add_epi64(b_lo, a_lo);
+            b_hi = _mm_add_epi64(b_hi, a_hi);
+            a_lo = _mm_add_epi64(a_lo, _mm_cvtepu32_epi64(x));
+            a_hi = _mm_add_epi64(a_hi, _mm_cvtepu32_epi64(_mm_srli_si128(x, 8)));
+        }
+        a_lo = _mm_add_epi64(_mm_and_si128(a_lo, low_mask), _mm_srli_epi64(a_lo, 32));
+        a_hi = _mm_add_epi64(_mm_and_si128(a_hi, low_mask), _mm_srli_epi64(a_hi, 32));
+        b_lo = _mm_add_epi64(_mm_and_si128(b_lo, low_mask), _mm_srli_epi64(b_lo, 32));
+        b_hi = _mm_add_epi64(_mm_and_si128(b_hi, low_mask), _mm_srli_epi64(b_hi, 32));
+    }
+
+    uint64_t lane_a[4];
+    uint64_t lane_b[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_a), a_lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_a + 2), a_hi);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_b), b_lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_b + 2), b_hi);
+
+    uint64_t a;
+    uint64_t b;
+    combine_lanes(lane_a, lane_b, width, &a, &b);
+    fletcher_scalar(p + iterations * width, wordcount - iterations * width, &a, &b);
+    return fletcher_finish(a, b);
+}
+
+__attribute__((target("avx2")))
+serializer_checksum compute_checksum_avx2(const void *word32s, size_t wordcount) {
+    const uint32_t *p = static_cast<const uint32_t *>(word32s);
+    const size_t width = 8;
+    const size_t iterations = wordcount / width;
+
+    const __m256i xorer = _mm256_set1_epi32(FLETCHER_XORER);
+    const __m256i low_mask = _mm256_set1_epi64x(0xFFFFFFFFll);
+    __m256i a_lo = _mm256_setzero_si256();
+    __m256i a_hi = _mm256_setzero_si256();
+    __m256i b_lo = _mm256_setzero_si256();
+    __m256i b_hi = _mm256_setzero_si256();
+
+    for (size_t done = 0; done < iterations;) {
+        const size_t end = done + std::min(SIMD_FOLD_ITERATIONS, iterations - done);
+        for (; done < end; ++done) {
+            __m256i x = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(p + done * width));
+            x = _mm256_xor_si256(x, xorer);
+            b_lo = _mm256_add_epi64(b_lo, a_lo);
+            b_hi = _mm256_add_epi64(b_hi, a_hi);
+            a_lo = _mm256_add_epi64(a_lo,
+                                    _mm256_cvtepu32_epi64(_mm256_castsi256_si128(x)));
+            a_hi = _mm256_add_epi64(a_hi,
+                                    _mm256_cvtepu32_epi64(_mm256_extracti128_si256(x, 1)));
+        }
+        a_lo = _mm256_add_epi64(_mm256_and_si256(a_lo, low_mask), _mm256_srli_epi64(a_lo, 32));
+        a_hi = _mm256_add_epi64(_mm256_and_si256(a_hi, low_mask), _mm256_srli_epi64(a_hi, 32));
+        b_lo = _mm256_add_epi64(_mm256_and_si256(b_lo, low_mask), _mm256_srli_epi64(b_lo, 32));
+        b_hi = _mm256_add_epi64(_mm256_and_si256(b_hi, low_mask), _mm256_srli_epi64(b_hi, 32));
+    }
+
+    uint64_t lane_a[8];
+    uint64_t lane_b[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_a), a_lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_a + 4), a_hi);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_b), b_lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_b + 4), b_hi);
+
+    uint64_t a;
+    uint64_t b;
+    combine_lanes(lane_a, lane_b, width, &a, &b);
+    fletcher_scalar(p + iterations * width, wordcount - iterations * width, &a, &b);
+    return fletcher_finish(a, b);
+}
+
+#endif  // CHECKSUM_HAS_X86_SIMD
+
+typedef serializer_checksum (*checksum_fn_t)(const void *, size_t);
+
+checksum_fn_t checksum_fn(checksum_impl_t impl) {
+    switch (impl) {
+        case checksum_impl_t::scalar:
+            return &compute_checksum_scalar;
+#if CHECKSUM_HAS_X86_SIMD
+        case checksum_impl_t::sse41:
+            return &compute_checksum_sse41;
+        case checksum_impl_t::avx2:
+            return &compute_checksum_avx2;
+#else
+        case checksum_impl_t::sse41:
+        case checksum_impl_t::avx2:
+            return nullptr;
+#endif
+        default:
+            unreachable();
+    }
+}
+
+checksum_fn_t choose_checksum_fn() {
+    if (checksum_impl_supported(checksum_impl_t::avx2)) {
+        return checksum_fn(checksum_impl_t::avx2);
+    } else if (checksum_impl_supported(checksum_impl_t::sse41)) {
+        return checksum_fn(checksum_impl_t::sse41);
+    } else {
+        return checksum_fn(checksum_impl_t::scalar);
+    }
+}
+
+}  // namespace
+
+bool checksum_impl_supported(checksum_impl_t impl) {
+    switch (impl) {
+        case checksum_impl_t::scalar:
+            return true;
+#if CHECKSUM_HAS_X86_SIMD
+        case checksum_impl_t::sse41:
+            return __builtin_cpu_supports("sse4.1");
+        case checksum_impl_t::avx2:
+            return __builtin_cpu_supports("avx2");
+#else
+        case checksum_impl_t::sse41:
+        case checksum_impl_t::avx2:
+            return false;
+#endif
+        default:
+            unreachable();
+    }
+}
+
+serializer_checksum compute_checksum_with_impl(checksum_impl_t impl,
+                                               const void *word32s,
+                                               size_t wordcount) {
+    guarantee(checksum_impl_supported(impl));
+    return checksum_fn(impl)(word32s, wordcount);
+}
+
+// The return value of this function or its behavior can't be changed -- the on-disk
+// format obviously requires a specific checksum algorithm.
+serializer_checksum compute_checksum(const void *word32s, size_t wordcount) {
+    static const checksum_fn_t fn = choose_checksum_fn();
+    return fn(word32s, wordcount);
+}
+
 serializer_checksum compute_checksum_concat(serializer_checksum left,
                                             serializer_checksum right,
                                             uint64_t right_wordcount) {
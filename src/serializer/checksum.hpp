@@ -22,6 +22,18 @@ ATTR_PACKED(struct serializer_checksum {
 // The checksum is never zero.
 serializer_checksum compute_checksum(const void *word32s, size_t wordcount);
 
+// The implementations compute_checksum picks from at startup, depending on what the
+// CPU supports.  They all compute the same checksum.
+enum class checksum_impl_t { scalar, sse41, avx2 };
+
+bool checksum_impl_supported(checksum_impl_t impl);
+
+// Like compute_checksum, but with a specific implementation (which must be
+// supported).  Used by the unit tests.
+serializer_checksum compute_checksum_with_impl(checksum_impl_t impl,
+                                               const void *word32s,
+                                               size_t wordcount);
+
 // Combines checksums into the checksum of the concatenated buffer.  Given two buffers,
 // s, and t, serializer_checksum_concat(serializer_checksum(s), serializer_checksum(t),
 // t.wordcount) computes serializer_checksum(concat(s, t)).
@@ -0,0 +1,277 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "serializer/log/block_compression.hpp"
+
+#include <string.h>
+
+#include "config/args.hpp"
+#include "errors.hpp"
+#include "math.hpp"
+
+namespace {
+
+// Parameters of the LZ4 block format.
+const size_t LZ4_MIN_MATCH = 4;
+// The last match must start at least this many bytes before the end of the block...
+const size_t LZ4_MATCH_FIND_LIMIT = 12;
+// ... and the last this many bytes must be literals.
+const size_t LZ4_LAST_LITERALS = 5;
+const size_t LZ4_MAX_OFFSET = 65535;
+
+const int LZ4_HASH_LOG = 12;
+
+inline uint32_t read_u32(const char *p) {
+    uint32_t ret;
+    memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+
+inline uint32_t lz4_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+// Writes an LZ4 length extension (the part of a length that didn't fit into the
+// token's nibble).  Returns false if we ran out of space.
+inline bool write_length_extension(size_t length, char **op, const char *op_end) {
+    for (;;) {
+        if (*op == op_end) {
+            return false;
+        }
+        if (length < 255) {
+            *(*op)++ = static_cast<char>(length);
+            return true;
+        }
+        *(*op)++ = static_cast<char>(255);
+        length -= 255;
+    }
+}
+
+inline bool read_length_extension(const uint8_t **ip, const uint8_t *ip_end,
+                                  size_t *length) {
+    for (;;) {
+        if (*ip == ip_end) {
+            return false;
+        }
+        const uint8_t b = *(*ip)++;
+        *length += b;
+        if (b != 255) {
+            return true;
+        }
+    }
+}
+
+// Emits one sequence: `literal_count` literals from `literals`, followed by a match
+// of `match_length` bytes at distance `offset` (unless `match_length` is 0, which
+// marks the final, literals-only sequence).
+bool emit_sequence(const char *literals, size_t literal_count,
+                   size_t offset, size_t match_length,
+                   char **op, const char *op_end) {
+    if (*op == op_end) {
+        return false;
+    }
+    char *token = (*op)++;
+    const size_t match_code = match_length == 0 ? 0 : match_length - LZ4_MIN_MATCH;
+    *token = static_cast<char>(((literal_count < 15 ? literal_count : 15) << 4)
+                               | (match_code < 15 ? match_code : 15));
+    if (literal_count >= 15
+        && !write_length_extension(literal_count - 15, op, op_end)) {
+        return false;
+    }
+    if (static_cast<size_t>(op_end - *op) < literal_count) {
+        return false;
+    }
+    memcpy(*op, literals, literal_count);
+    *op += literal_count;
+
+    if (match_length == 0) {
+        return true;
+    }
+    if (op_end - *op < 2) {
+        return false;
+    }
+    *(*op)++ = static_cast<char>(offset & 0xFF);
+    *(*op)++ = static_cast<char>(offset >> 8);
+    if (match_code >= 15
+        && !write_length_extension(match_code - 15, op, op_end)) {
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+size_t lz4_compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) {
+    guarantee(src_size <= UINT16_MAX);
+
+    // Positions fit into 16 bits since blocks are smaller than 64KB.  Stale or
+    // zero-initialized entries are harmless, since every candidate gets verified.
+    uint16_t hash_table[1 << LZ4_HASH_LOG];
+    memset(hash_table, 0, sizeof(hash_table));
+
+    char *op = dst;
+    const char *const op_end = dst + dst_capacity;
+
+    size_t anchor = 0;
+    if (src_size > LZ4_MATCH_FIND_LIMIT) {
+        const size_t match_find_end = src_size - LZ4_MATCH_FIND_LIMIT;
+        const size_t match_extend_end = src_size - LZ4_LAST_LITERALS;
+        size_t ip = 0;
+        while (ip < match_find_end) {
+            const uint32_t sequence = read_u32(src + ip);
+            const uint32_t h = lz4_hash(sequence);
+            const size_t candidate = hash_table[h];
+            hash_table[h] = static_cast<uint16_t>(ip);
+
+            if (candidate >= ip
+                || ip - candidate > LZ4_MAX_OFFSET
+                || read_u32(src + candidate) != sequence) {
+                ++ip;
+                continue;
+            }
+
+            size_t match_length = LZ4_MIN_MATCH;
+            while (ip + match_length < match_extend_end
+                   && src[candidate + match_length] == src[ip + match_length]) {
+                ++match_length;
+            }
+
+            if (!emit_sequence(src + anchor, ip - anchor, ip - candidate, match_length,
+                               &op, op_end)) {
+                return 0;
+            }
+            ip += match_length;
+            anchor = ip;
+        }
+    }
+
+    if (!emit_sequence(src + anchor, src_size - anchor, 0, 0, &op, op_end)) {
+        return 0;
+    }
+    return op - dst;
+}
+
+bool lz4_decompress(const char *src, size_t src_size, char *dst, size_t dst_size) {
+    const uint8_t *ip = reinterpret_cast<const uint8_t *>(src);
+    const uint8_t *const ip_end = ip + src_size;
+    char *op = dst;
+    char *const op_end = dst + dst_size;
+
+    for (;;) {
+        if (ip == ip_end) {
+            return false;
+        }
+        const uint8_t token = *ip++;
+
+        size_t literal_count = token >> 4;
+        if (literal_count == 15 && !read_length_extension(&ip, ip_end, &literal_count)) {
+            return false;
+        }
+        if (static_cast<size_t>(ip_end - ip) < literal_count
+            || static_cast<size_t>(op_end - op) < literal_count) {
+            return false;
+        }
+        memcpy(op, ip, literal_count);
+        ip += literal_count;
+        op += literal_count;
+
+        if (ip == ip_end) {
+            // The final sequence has no match part.
+            return op == op_end;
+        }
+
+        if (ip_end - ip < 2) {
+            return false;
+        }
+        const size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+            return false;
+        }
+
+        size_t match_length = token & 15;
+        if (match_length == 15 && !read_length_extension(&ip, ip_end, &match_length)) {
+            return false;
+        }
+        match_length += LZ4_MIN_MATCH;
+        if (static_cast<size_t>(op_end - op) < match_length) {
+            return false;
+        }
+
+        // The source and destination may overlap (that's how runs are encoded), so
+        // we can't use memcpy or memmove here.
+        const char *match = op - offset;
+        for (size_t i = 0; i < match_length; ++i) {
+            op[i] = match[i];
+        }
+        op += match_length;
+    }
+}
+
+bool compress_block(block_compression_t compression,
+                    const ser_buffer_t *buf,
+                    block_size_t block_size,
+                    scoped_device_block_aligned_ptr_t<ser_buffer_t> *disk_buf_out,
+                    block_size_t *disk_block_size_out) {
+    switch (compression) {
+        case block_compression_t::none:
+            return false;
+        case block_compression_t::lz4:
+            break;
+        default:
+            unreachable();
+    }
+
+    const size_t header_size = sizeof(ls_buf_data_t) + sizeof(compressed_block_header_t);
+    const size_t aligned_size = ceil_aligned(block_size.ser_value(), DEVICE_BLOCK_SIZE);
+
+    // We only bother if the block shrinks by at least one device block.
+    const size_t max_disk_size = aligned_size - DEVICE_BLOCK_SIZE;
+    if (max_disk_size <= header_size) {
+        return false;
+    }
+
+    scoped_device_block_aligned_ptr_t<ser_buffer_t> disk_buf(max_disk_size);
+    char *const disk_bytes = reinterpret_cast<char *>(disk_buf.get());
+    const size_t compressed_size = lz4_compress(buf->cache_data,
+                                                block_size.value(),
+                                                disk_bytes + header_size,
+                                                max_disk_size - header_size);
+    if (compressed_size == 0) {
+        return false;
+    }
+
+    disk_buf->ser_header = buf->ser_header;
+    compressed_block_header_t header;
+    header.codec = static_cast<uint32_t>(block_compression_t::lz4);
+    memcpy(disk_buf->cache_data, &header, sizeof(header));
+
+    const size_t disk_size = header_size + compressed_size;
+    memset(disk_bytes + disk_size, 0, ceil_aligned(disk_size, DEVICE_BLOCK_SIZE) - disk_size);
+
+    *disk_buf_out = std::move(disk_buf);
+    *disk_block_size_out = block_size_t::unsafe_make(disk_size);
+    return true;
+}
+
+void decompress_block(const ser_buffer_t *disk_buf,
+                      block_size_t disk_block_size,
+                      ser_buffer_t *out,
+                      block_size_t block_size) {
+    const size_t header_size = sizeof(ls_buf_data_t) + sizeof(compressed_block_header_t);
+    guarantee(disk_block_size.ser_value() > header_size);
+    guarantee(disk_block_size.ser_value() < block_size.ser_value());
+
+    compressed_block_header_t header;
+    memcpy(&header, disk_buf->cache_data, sizeof(header));
+    guarantee(header.codec == static_cast<uint32_t>(block_compression_t::lz4),
+              "Unknown block compression codec %" PRIu32 " (block id %" PR_BLOCK_ID ")",
+              header.codec, disk_buf->ser_header.block_id);
+
+    out->ser_header = disk_buf->ser_header;
+    const bool ok = lz4_decompress(
+        reinterpret_cast<const char *>(disk_buf) + header_size,
+        disk_block_size.ser_value() - header_size,
+        out->cache_data,
+        block_size.value());
+    guarantee(ok, "Corrupted compressed block (block id %" PR_BLOCK_ID ")",
+              disk_buf->ser_header.block_id);
+}
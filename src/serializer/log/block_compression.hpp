@@ -0,0 +1,61 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_LOG_BLOCK_COMPRESSION_HPP_
+#define SERIALIZER_LOG_BLOCK_COMPRESSION_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arch/compiler.hpp"
+#include "containers/archive/archive.hpp"
+#include "containers/scoped.hpp"
+#include "serializer/types.hpp"
+
+/* Transparent compression of data blocks.  A compressed block still starts with its
+`ls_buf_data_t` header (read-ahead and the GC look at the block id of raw on-disk
+blocks), followed by a `compressed_block_header_t` and the compressed cache data.
+Whether a block is compressed is recorded in the LBA: a block whose on-disk size is
+smaller than its block size is compressed. */
+
+enum class block_compression_t {
+    // Write all blocks uncompressed.
+    none = 0,
+    // Use the LZ4 block format, falling back to an uncompressed block when that
+    // doesn't save at least one device block.
+    lz4 = 1
+};
+ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(block_compression_t, int8_t,
+                                      block_compression_t::none,
+                                      block_compression_t::lz4);
+
+// This defines the disk format!  Do not change.
+ATTR_PACKED(struct compressed_block_header_t {
+    uint32_t codec;
+});
+
+// Compresses `src_size` bytes at `src` into `dst` using the LZ4 block format.
+// Returns the compressed size, or 0 if the output would exceed `dst_capacity`.
+// `src_size` must be less than 64KB.
+size_t lz4_compress(const char *src, size_t src_size, char *dst, size_t dst_capacity);
+
+// Decompresses an LZ4 block.  Returns false if the input is malformed or doesn't
+// decompress to exactly `dst_size` bytes.
+bool lz4_decompress(const char *src, size_t src_size, char *dst, size_t dst_size);
+
+// Tries to compress the block in `buf`.  Returns false (and leaves the outputs
+// untouched) if compression is disabled or wouldn't reduce the number of device
+// blocks the block occupies on disk.  Otherwise `disk_buf_out` is set to a zero-padded
+// buffer holding the on-disk representation, of size `*disk_block_size_out`.
+bool compress_block(block_compression_t compression,
+                    const ser_buffer_t *buf,
+                    block_size_t block_size,
+                    scoped_device_block_aligned_ptr_t<ser_buffer_t> *disk_buf_out,
+                    block_size_t *disk_block_size_out);
+
+// Inverse of `compress_block`.  `out` must have room for `block_size.ser_value()`
+// bytes.  Crashes if the on-disk block is corrupted.
+void decompress_block(const ser_buffer_t *disk_buf,
+                      block_size_t disk_block_size,
+                      ser_buffer_t *out,
+                      block_size_t block_size);
+
+#endif  // SERIALIZER_LOG_BLOCK_COMPRESSION_HPP_
@@ -6,6 +6,7 @@
 
 #include "config/args.hpp"
 #include "containers/archive/archive.hpp"
+#include "serializer/log/block_compression.hpp"
 #include "serializer/types.hpp"
 #include "rpc/serialize_macros.hpp"
 
@@ -17,6 +18,8 @@ struct log_serializer_dynamic_config_t {
         // This is probably too low, thanks to status quo bias (the status quo having
         // been to never compute checksums).
         checksum_threshold = 65536;
+        block_compression = block_compression_t::none;
+        lba_snapshot_threshold = LBA_SNAPSHOT_THRESHOLD;
     }
 
     /* Enable reading more data than requested to let the cache warmup more quickly
@@ -26,6 +29,13 @@ struct log_serializer_dynamic_config_t {
        writing the serializer superblock.  Designed to make single-document writes
        fast. */
     uint32_t checksum_threshold;
+    /* How newly written data blocks get compressed.  Blocks are decompressed
+       according to their own on-disk format, so this can change between runs.
+       Tables take it from their `table_config_t`. */
+    block_compression_t block_compression;
+    /* How many LBA entries we let pile up for replaying at startup before we write a
+       new snapshot of the LBA.  0 disables LBA snapshots. */
+    uint64_t lba_snapshot_threshold;
 };
 
 /* This is equivalent to log_serializer_static_config_t below, but is an on-disk
@@ -51,6 +61,10 @@ struct log_serializer_static_config_t : public log_serializer_on_disk_static_con
         extent_size_ = DEFAULT_EXTENT_SIZE;
         block_size_ = DEFAULT_BTREE_BLOCK_SIZE;
     }
+    explicit log_serializer_static_config_t(uint64_t block_size) {
+        extent_size_ = DEFAULT_EXTENT_SIZE;
+        block_size_ = block_size;
+    }
 };
 
 RDB_MAKE_SERIALIZABLE_2(log_serializer_static_config_t,
@@ -13,6 +13,7 @@
 #include "errors.hpp"
 #include "perfmon/perfmon.hpp"
 #include "serializer/buf_ptr.hpp"
+#include "serializer/log/block_compression.hpp"
 #include "serializer/log/log_serializer.hpp"
 #include "stl_utils.hpp"
 
@@ -63,6 +64,10 @@ private:
         uint16_t relative_offset_in_dblocks : 14;
         uint16_t token_referenced : 1;
         uint16_t index_referenced : 1;
+        // The space the block takes up on disk.
+        block_size_t disk_block_size;
+        // The size of the block once read (and possibly decompressed).  This is the
+        // same as disk_block_size unless the block is compressed.
         block_size_t block_size;
     };
 
@@ -77,7 +82,7 @@ public:
           garbage_bytes_stat(_parent->static_config->extent_size()),
           num_live_blocks_stat(0),
           extent_offset(extent_ref.offset()) {
-        static_assert(sizeof(block_info_t) == 4, "block_info_t not 4 bytes");
+        static_assert(sizeof(block_info_t) == 6, "block_info_t not 6 bytes");
         add_self_to_parent_entries();
     }
 
@@ -128,11 +133,19 @@ public:
         return block_infos.empty()
             ? 0
             : (block_infos.back().relative_offset_in_dblocks * DEVICE_BLOCK_SIZE)
-            + aligned_value(block_infos.back().block_size);
+            + aligned_value(block_infos.back().disk_block_size);
     }
 
-    // Returns the ostensible size of the block_index'th block.  Note that
-    // block_boundaries[i] + block_size(i) <= block_boundaries[i + 1].
+    // Returns the on-disk size of the block_index'th block.  Note that
+    // block_boundaries[i] + disk_block_size(i) <= block_boundaries[i + 1].
+    block_size_t disk_block_size(unsigned int _block_index) const {
+        guarantee(state != state_reconstructing);
+        guarantee(_block_index < block_infos.size());
+        return block_infos[_block_index].disk_block_size;
+    }
+
+    // Returns the ostensible size of the block_index'th block, which is bigger than
+    // disk_block_size(_block_index) if the block is compressed.
     block_size_t block_size(unsigned int _block_index) const {
         guarantee(state != state_reconstructing);
         guarantee(_block_index < block_infos.size());
@@ -157,23 +170,24 @@ public:
         return it - block_infos.begin();
     }
 
-    bool new_offset(block_size_t _block_size,
+    bool new_offset(block_size_t _disk_block_size,
+                    block_size_t _block_size,
                     uint32_t *relative_offset_out,
                     unsigned int *block_index_out) {
         // Returns true if there's enough room at the end of the extent for the new
         // block.
         guarantee(state == state_active);
-        guarantee(_block_size.ser_value() <= parent->static_config->extent_size());
+        guarantee(_disk_block_size.ser_value() <= parent->static_config->extent_size());
 
         uint32_t offset = back_relative_offset();
         guarantee(offset <= parent->static_config->extent_size());
 
-        if (offset > parent->static_config->extent_size() - _block_size.ser_value()) {
+        if (offset > parent->static_config->extent_size() - _disk_block_size.ser_value()) {
             return false;
         } else {
             *relative_offset_out = offset;
             *block_index_out = block_infos.size();
-            block_infos.push_back(block_info_t{static_cast<uint16_t>(offset / DEVICE_BLOCK_SIZE), false, false, _block_size});
+            block_infos.push_back(block_info_t{static_cast<uint16_t>(offset / DEVICE_BLOCK_SIZE), false, false, _disk_block_size, _block_size});
             update_stats(nullptr, &block_infos.back());
             return true;
         }
@@ -225,7 +239,7 @@ public:
         uint32_t b = 0;
         for (auto it = block_infos.begin(); it < block_infos.end(); ++it) {
             if (it->token_referenced) {
-                b += aligned_value(it->block_size);
+                b += aligned_value(it->disk_block_size);
             }
         }
         return b;
@@ -244,21 +258,24 @@ public:
                                 &gc_entry_t::info_less);
     }
 
-    void mark_live_indexwise_with_offset(int64_t offset, block_size_t _block_size) {
+    void mark_live_indexwise_with_offset(int64_t offset,
+                                         block_size_t _disk_block_size,
+                                         block_size_t _block_size) {
         guarantee(offset >= extent_ref.offset() && offset < extent_ref.offset() + UINT32_MAX);
 
         uint32_t _relative_offset = offset - extent_ref.offset();
 
         auto it = find_lower_bound_iter(_relative_offset);
         if (it == block_infos.end()) {
-            block_infos.push_back(block_info_t{static_cast<uint16_t>(_relative_offset / DEVICE_BLOCK_SIZE), false, true, _block_size});
+            block_infos.push_back(block_info_t{static_cast<uint16_t>(_relative_offset / DEVICE_BLOCK_SIZE), false, true, _disk_block_size, _block_size});
             update_stats(nullptr, &block_infos.back());
         } else if (uint32_t(it->relative_offset_in_dblocks * DEVICE_BLOCK_SIZE) > _relative_offset) {
-            guarantee(uint32_t(it->relative_offset_in_dblocks * DEVICE_BLOCK_SIZE) >= _relative_offset + aligned_value(_block_size));
-            auto new_block = block_infos.insert(it, block_info_t{static_cast<uint16_t>(_relative_offset / DEVICE_BLOCK_SIZE), false, true, _block_size});
+            guarantee(uint32_t(it->relative_offset_in_dblocks * DEVICE_BLOCK_SIZE) >= _relative_offset + aligned_value(_disk_block_size));
+            auto new_block = block_infos.insert(it, block_info_t{static_cast<uint16_t>(_relative_offset / DEVICE_BLOCK_SIZE), false, true, _disk_block_size, _block_size});
             update_stats(nullptr, &*new_block);
         } else {
             guarantee(uint32_t(it->relative_offset_in_dblocks * DEVICE_BLOCK_SIZE) == _relative_offset);
+            guarantee(it->disk_block_size == _disk_block_size);
             guarantee(it->block_size == _block_size);
             const block_info_t old_info = *it;
             it->index_referenced = true;
@@ -283,7 +300,7 @@ public:
         uint32_t b = 0;
         for (auto it = block_infos.begin(); it < block_infos.end(); ++it) {
             if (it->index_referenced) {
-                b += aligned_value(it->block_size);
+                b += aligned_value(it->disk_block_size);
             }
         }
         return b;
@@ -301,7 +318,7 @@ public:
             ret += strprintf("%s[%" PRIi64 "..+%" PRIu16 ") %c%c",
                              it == block_infos.begin() ? "" : separator,
                              offset + it->relative_offset_in_dblocks * DEVICE_BLOCK_SIZE,
-                             it->block_size.ser_value(),
+                             it->disk_block_size.ser_value(),
                              it->token_referenced ? 'T' : ' ',
                              it->index_referenced ? 'I' : ' ');
         }
@@ -331,14 +348,14 @@ private:
             if (old_block->token_referenced || old_block->index_referenced) {
                 // Block is live
                 num_live_blocks_stat -= 1;
-                garbage_bytes_stat += aligned_value(old_block->block_size);
+                garbage_bytes_stat += aligned_value(old_block->disk_block_size);
             }
         }
         // Apply new_block
         if (new_block->token_referenced || new_block->index_referenced) {
             // Block is live
             num_live_blocks_stat += 1;
-            garbage_bytes_stat -= aligned_value(new_block->block_size);
+            garbage_bytes_stat -= aligned_value(new_block->disk_block_size);
         }
     }
 
@@ -430,7 +447,9 @@ void data_block_manager_t::start_reconstruct() {
 // gc_entry_t in the entries table.  (This is used when we start up, when
 // everything is presumed to be garbage, until we mark it as
 // non-garbage.)
-void data_block_manager_t::mark_live(int64_t offset, block_size_t ser_block_size) {
+void data_block_manager_t::mark_live(int64_t offset,
+                                     block_size_t disk_block_size,
+                                     block_size_t block_size) {
     uint64_t extent_id = static_config->extent_index(offset);
 
     if (entries.get(extent_id) == nullptr) {
@@ -441,7 +460,7 @@ void data_block_manager_t::mark_live(int64_t offset, block_size_t ser_block_size
     }
 
     gc_entry_t *entry = entries.get(extent_id);
-    entry->mark_live_indexwise_with_offset(offset, ser_block_size);
+    entry->mark_live_indexwise_with_offset(offset, disk_block_size, block_size);
 }
 
 void data_block_manager_t::end_reconstruct() {
@@ -665,14 +684,17 @@ public:
 
                 const block_size_t block_size
                     = block_size_t::unsafe_make(info.ser_block_size);
-                buf_ptr_t buf = buf_ptr_t::alloc_uninitialized(block_size);
-                memcpy(buf.ser_buffer(), current_buf, info.ser_block_size);
-                buf.fill_padding_zero();
-                guarantee(info.ser_block_size <= *(lower_it + 1) - *lower_it);
+                const block_size_t disk_block_size
+                    = block_size_t::unsafe_make(info.ser_disk_size);
+                guarantee(info.ser_disk_size <= *(lower_it + 1) - *lower_it);
+                buf_ptr_t buf = parent->buf_from_disk_block(
+                    reinterpret_cast<const ser_buffer_t *>(current_buf),
+                    disk_block_size, block_size);
 
                 counted_t<block_token_t> token
                     = parent->serializer->generate_block_token(current_offset,
-                                                               block_size);
+                                                               block_size,
+                                                               disk_block_size);
 
                 parent->serializer->offer_buf_to_read_ahead_callbacks(
                         block_id,
@@ -696,8 +718,33 @@ bool data_block_manager_t::should_perform_read_ahead(int64_t offset) {
     return !entry->was_written && serializer->should_perform_read_ahead();
 }
 
+buf_ptr_t data_block_manager_t::buf_from_disk_block(const ser_buffer_t *disk_buf,
+                                                  block_size_t disk_block_size,
+                                                  block_size_t block_size) {
+    buf_ptr_t ret = buf_ptr_t::alloc_uninitialized(block_size);
+    if (disk_block_size == block_size) {
+        memcpy(ret.ser_buffer(), disk_buf, block_size.ser_value());
+    } else {
+        decompress_block(disk_buf, disk_block_size, ret.ser_buffer(), block_size);
+        ++stats->pm_serializer_block_decompressions;
+    }
+    ret.fill_padding_zero();
+    return ret;
+}
+
 buf_ptr_t data_block_manager_t::read(int64_t off_in, block_size_t block_size,
-                                   file_account_t *io_account) {
+                                     block_size_t disk_block_size,
+                                     file_account_t *io_account) {
+    buf_ptr_t disk_buf = read_disk_block(off_in, disk_block_size, io_account);
+    if (disk_block_size == block_size) {
+        return disk_buf;
+    }
+    return buf_from_disk_block(disk_buf.ser_buffer(), disk_block_size, block_size);
+}
+
+buf_ptr_t data_block_manager_t::read_disk_block(int64_t off_in,
+                                                block_size_t block_size,
+                                                file_account_t *io_account) {
     guarantee(state == state_ready);
     if (should_perform_read_ahead(off_in)) {
         buf_ptr_t ret = buf_ptr_t::alloc_uninitialized(block_size);
@@ -742,18 +789,48 @@ data_block_manager_t::many_writes(const buf_write_info_t *writes,
                                   size_t writes_count,
                                   file_account_t *io_account,
                                   iocallback_t *cb) {
+    const block_compression_t compression
+        = serializer->dynamic_config.block_compression;
+
+    std::vector<disk_write_t> disk_writes;
+    disk_writes.reserve(writes_count);
+    std::vector<scoped_device_block_aligned_ptr_t<ser_buffer_t>> compressed_bufs;
+    for (size_t i = 0; i < writes_count; ++i) {
+        writes[i].buf->ser_header.block_id = writes[i].block_id;
+
+        disk_write_t disk_write{writes[i].buf, writes[i].block_size,
+                                writes[i].block_size};
+        if (compression != block_compression_t::none) {
+            scoped_device_block_aligned_ptr_t<ser_buffer_t> compressed;
+            if (compress_block(compression, writes[i].buf, writes[i].block_size,
+                               &compressed, &disk_write.disk_block_size)) {
+                disk_write.buf = compressed.get();
+                compressed_bufs.push_back(std::move(compressed));
+            }
+            stats->block_compressed(
+                gc_entry_t::aligned_value(disk_write.block_size),
+                gc_entry_t::aligned_value(disk_write.disk_block_size));
+        }
+        disk_writes.push_back(disk_write);
+    }
+
+    return write_disk_blocks(disk_writes, std::move(compressed_bufs), io_account, cb);
+}
+
+std::vector<counted_t<block_token_t>>
+data_block_manager_t::write_disk_blocks(
+        const std::vector<disk_write_t> &writes,
+        std::vector<scoped_device_block_aligned_ptr_t<ser_buffer_t>> &&owned_bufs,
+        file_account_t *io_account,
+        iocallback_t *cb) {
     // These tokens are grouped by extent.  You can do a contiguous write in each
     // extent.
     uint64_t cumulative_aligned_size;
     std::vector<std::vector<counted_t<block_token_t>>> token_groups
-        = gimme_some_new_offsets(writes, writes_count, &cumulative_aligned_size);
+        = gimme_some_new_offsets(writes, &cumulative_aligned_size);
     const bool wants_checksum
         = cumulative_aligned_size <= serializer->dynamic_config.checksum_threshold;
 
-    for (size_t i = 0; i < writes_count; ++i) {
-        writes[i].buf->ser_header.block_id = writes[i].block_id;
-    }
-
     struct intermediate_cb_t : public iocallback_t {
         virtual void on_io_complete() {
             --ops_remaining;
@@ -766,9 +843,12 @@ data_block_manager_t::many_writes(const buf_write_info_t *writes,
 
         size_t ops_remaining;
         iocallback_t *cb;
+        // Buffers (of compressed blocks) that must live until the writes complete.
+        std::vector<scoped_device_block_aligned_ptr_t<ser_buffer_t>> owned_bufs;
     };
 
     intermediate_cb_t *const intermediate_cb = new intermediate_cb_t;
+    intermediate_cb->owned_bufs = std::move(owned_bufs);
     // We add 1 for degenerate case where token_groups is empty -- we call
     // intermediate_cb->on_io_complete later.
     intermediate_cb->ops_remaining = token_groups.size() + 1;
@@ -778,7 +858,7 @@ data_block_manager_t::many_writes(const buf_write_info_t *writes,
     for (const std::vector<counted_t<block_token_t>> &group : token_groups) {
         const int64_t front_offset = group.front()->offset();
         const int64_t back_offset = group.back()->offset()
-            + gc_entry_t::aligned_value(group.back()->block_size());
+            + gc_entry_t::aligned_value(group.back()->disk_block_size());
 
         guarantee(divides(DEVICE_BLOCK_SIZE, front_offset));
 
@@ -792,14 +872,14 @@ data_block_manager_t::many_writes(const buf_write_info_t *writes,
         for (size_t j = 0, je = group.size(); j < je; ++j) {
             block_token_t *token = group[j].get();
             const int64_t j_offset = token->offset();
-            const block_size_t j_block_size = token->block_size();
+            const block_size_t j_disk_block_size = token->disk_block_size();
             guarantee(j_offset == last_written_offset);
-            const size_t j_aligned_size = gc_entry_t::aligned_value(j_block_size);
+            const size_t j_aligned_size = gc_entry_t::aligned_value(j_disk_block_size);
             total_aligned_size += j_aligned_size;
 
             // The behavior of gimme_some_new_offsets is supposed to retain order, so
             // we expect writes[write_number] to have the currently-relevant write.
-            guarantee(writes[write_number].block_size == j_block_size);
+            guarantee(writes[write_number].disk_block_size == j_disk_block_size);
 
             void *buf = writes[write_number].buf;
             if (wants_checksum) {
@@ -828,7 +908,7 @@ data_block_manager_t::many_writes(const buf_write_info_t *writes,
     intermediate_cb->on_io_complete();
 
     std::vector<counted_t<block_token_t>> ret;
-    ret.reserve(writes_count);
+    ret.reserve(writes.size());
     for (std::vector<counted_t<block_token_t>> &group : token_groups) {
         for (counted_t<block_token_t> &token : group) {
             ret.push_back(std::move(token));
@@ -967,7 +1047,7 @@ void data_block_manager_t::mark_garbage(int64_t offset, extent_transaction_t *tx
     // Add to old garbage count if necessary (works because of the
     // !entry->block_is_garbage(block_index) assertion above).
     if (entry->state == gc_entry_t::state_old && entry->block_is_garbage(block_index)) {
-        gc_stats.old_garbage_block_bytes += gc_entry_t::aligned_value(entry->block_size(block_index));
+        gc_stats.old_garbage_block_bytes += gc_entry_t::aligned_value(entry->disk_block_size(block_index));
     }
 
     check_and_handle_empty_extent(extent_id);
@@ -998,7 +1078,7 @@ void data_block_manager_t::mark_garbage_tokenwise_with_offset(int64_t offset) {
     // !entry->block_is_garbage(block_index) assertion above).
     if (entry->state == gc_entry_t::state_old && entry->block_is_garbage(block_index)) {
         gc_stats.old_garbage_block_bytes
-            += gc_entry_t::aligned_value(entry->block_size(block_index));
+            += gc_entry_t::aligned_value(entry->disk_block_size(block_index));
     }
 
     check_and_handle_empty_extent(extent_id);
@@ -1126,7 +1206,7 @@ void data_block_manager_t::gc_one_extent(gc_state_t *gc_state) {
 
                 const uint32_t end
                     = gc_state->current_entry->relative_offset(i)
-                    + gc_entry_t::aligned_value(gc_state->current_entry->block_size(i));
+                    + gc_entry_t::aligned_value(gc_state->current_entry->disk_block_size(i));
 
                 if (beg <= current_interval_end) {
                     current_interval_end = end;
@@ -1202,7 +1282,8 @@ void data_block_manager_t::gc_one_extent(gc_state_t *gc_state) {
                     + gc_state->current_entry->relative_offset(i);
 
                 gc_writes.push_back(gc_write_t(block, block_offset,
-                    gc_state->current_entry->block_size(i)));
+                    gc_state->current_entry->block_size(i),
+                    gc_state->current_entry->disk_block_size(i)));
             }
             guarantee(gc_writes.size() == num_writes);
         }
@@ -1259,21 +1340,25 @@ void data_block_manager_t::write_gcs(
         // Step 1: Write buffers to disk and assemble index operations
         ASSERT_NO_CORO_WAITING;
 
-        std::vector<buf_write_info_t> the_writes;
+        // The blocks are copied verbatim, so compressed blocks stay compressed.
+        std::vector<disk_write_t> the_writes;
         the_writes.reserve(writes.size());
         for (size_t i = 0; i < writes.size(); ++i) {
             old_block_tokens.push_back(
                     serializer->generate_block_token(writes[i].old_offset,
-                                                     writes[i].block_size));
+                                                     writes[i].block_size,
+                                                     writes[i].disk_block_size));
 
-            the_writes.push_back(buf_write_info_t(writes[i].buf,
-                                                  writes[i].block_size,
-                                                  writes[i].buf->ser_header.block_id));
+            the_writes.push_back(disk_write_t{writes[i].buf,
+                                              writes[i].block_size,
+                                              writes[i].disk_block_size});
         }
 
-        new_block_tokens = many_writes(the_writes.data(), the_writes.size(),
-                                       choose_gc_io_account(),
-                                       &block_write_cond);
+        new_block_tokens = write_disk_blocks(
+            the_writes,
+            std::vector<scoped_device_block_aligned_ptr_t<ser_buffer_t>>(),
+            choose_gc_io_account(),
+            &block_write_cond);
 
         guarantee(new_block_tokens.size() == writes.size());
     }
@@ -1445,8 +1530,7 @@ void data_block_manager_t::actually_shutdown() {
 // Outputs how many bytes would get written, so we can use that info to decide later
 // whether to checksum the blocks (which'll let us save an fdatasync)
 std::vector<std::vector<counted_t<block_token_t>>>
-data_block_manager_t::gimme_some_new_offsets(const buf_write_info_t *writes,
-                                             size_t writes_count,
+data_block_manager_t::gimme_some_new_offsets(const std::vector<disk_write_t> &writes,
                                              uint64_t *cumulative_aligned_size_out) {
     ASSERT_NO_CORO_WAITING;
 
@@ -1463,12 +1547,13 @@ data_block_manager_t::gimme_some_new_offsets(const buf_write_info_t *writes,
     uint64_t cumulative_aligned_size = 0;
 
     std::vector<counted_t<block_token_t> > tokens;
-    for (size_t i = 0; i < writes_count; ++i) {
-        block_size_t block_size = writes[i].block_size;
+    for (const disk_write_t &write : writes) {
+        const block_size_t disk_block_size = write.disk_block_size;
+        const block_size_t block_size = write.block_size;
         uint32_t relative_offset = valgrind_undefined<uint32_t>(UINT32_MAX);
         unsigned int block_index = valgrind_undefined<unsigned int>(UINT_MAX);
-        cumulative_aligned_size += gc_entry_t::aligned_value(block_size);
-        if (!active_extent->new_offset(block_size,
+        cumulative_aligned_size += gc_entry_t::aligned_value(disk_block_size);
+        if (!active_extent->new_offset(disk_block_size, block_size,
                                        &relative_offset, &block_index)) {
             // Move the active_extent gc_entry_t to the young extent queue (if it's
             // not already empty), and make a new gc_entry_t.
@@ -1485,7 +1570,8 @@ data_block_manager_t::gimme_some_new_offsets(const buf_write_info_t *writes,
             }
 
             ++stats->pm_serializer_data_extents_allocated;
-            const bool succeeded = active_extent->new_offset(block_size,
+            const bool succeeded = active_extent->new_offset(disk_block_size,
+                                                             block_size,
                                                              &relative_offset,
                                                              &block_index);
             guarantee(succeeded);
@@ -1502,7 +1588,8 @@ data_block_manager_t::gimme_some_new_offsets(const buf_write_info_t *writes,
         active_extent->was_written = true;
         active_extent->mark_live_tokenwise(block_index);
 
-        tokens.push_back(serializer->generate_block_token(offset, block_size));
+        tokens.push_back(serializer->generate_block_token(offset, block_size,
+                                                          disk_block_size));
     }
 
     if (!tokens.empty()) {
@@ -50,7 +50,10 @@ public:
     static void prepare_initial_metablock(dbm_metablock_mixin_t *mb);
     void start_existing(file_t *dbfile, const dbm_metablock_mixin_t *last_metablock);
 
+    // Reads the block at off_in, decompressing it if disk_block_size is smaller than
+    // block_size.
     buf_ptr_t read(int64_t off_in, block_size_t block_size,
+                   block_size_t disk_block_size,
                    file_account_t *io_account);
 
     /* exposed gc api */
@@ -59,7 +62,8 @@ public:
 
     /* r{start,end}_reconstruct functions for safety */
     void start_reconstruct();
-    void mark_live(int64_t offset, block_size_t block_size);
+    void mark_live(int64_t offset, block_size_t disk_block_size,
+                   block_size_t block_size);
     void end_reconstruct();
 
     /* We must make sure that blocks which have tokens pointing to them don't
@@ -85,20 +89,46 @@ public:
     double garbage_ratio() const;
 
     // Potentially computes a checksum of the blocks to be written, depending on config.
-    // Caller may ignore that information, or use it to save an fdatasync.
+    // Caller may ignore that information, or use it to save an fdatasync.  Blocks get
+    // compressed according to the serializer's block_compression setting.
     std::vector<counted_t<block_token_t> >
     many_writes(const buf_write_info_t *writes,
                 size_t writes_count,
                 file_account_t *io_account,
                 iocallback_t *cb);
 
+    bool is_gc_active() const;
+
+private:
+    // A block in the form it gets written to disk.
+    struct disk_write_t {
+        ser_buffer_t *buf;
+        block_size_t block_size;
+        block_size_t disk_block_size;
+    };
+
+    // Writes blocks that are already in their on-disk form.  `owned_bufs` get freed
+    // once the writes have completed.
+    std::vector<counted_t<block_token_t> >
+    write_disk_blocks(
+        const std::vector<disk_write_t> &writes,
+        std::vector<scoped_device_block_aligned_ptr_t<ser_buffer_t> > &&owned_bufs,
+        file_account_t *io_account,
+        iocallback_t *cb);
+
     std::vector<std::vector<counted_t<block_token_t> > >
-    gimme_some_new_offsets(const buf_write_info_t *writes, size_t writes_count,
+    gimme_some_new_offsets(const std::vector<disk_write_t> &writes,
                            uint64_t *cumulative_aligned_size_out);
 
-    bool is_gc_active() const;
+    // Reads the raw on-disk bytes of a block.
+    buf_ptr_t read_disk_block(int64_t off_in, block_size_t disk_block_size,
+                              file_account_t *io_account);
+
+    // Copies or decompresses an on-disk block into a new buf.
+    buf_ptr_t buf_from_disk_block(const ser_buffer_t *disk_buf,
+                                  block_size_t disk_block_size,
+                                  block_size_t block_size);
 
-private:
     void actually_shutdown();
 
     struct gc_state_t : public intrusive_list_node_t<gc_state_t>{
@@ -117,10 +147,11 @@ private:
         ser_buffer_t *buf;
         int64_t old_offset;
         block_size_t block_size;
+        block_size_t disk_block_size;
         gc_write_t(ser_buffer_t *b, int64_t _old_offset,
-                   block_size_t _block_size)
+                   block_size_t _block_size, block_size_t _disk_block_size)
             : buf(b), old_offset(_old_offset),
-              block_size(_block_size) { }
+              block_size(_block_size), disk_block_size(_disk_block_size) { }
     };
 
     /* Runs in a coroutine and keeps calling `gc_one_extent()` for as long as
@@ -57,13 +57,18 @@ void lba_disk_extent_t::write_outstanding(
     data->wait_for_write_completion(cb);
 }
 
-void lba_disk_extent_t::read_step_1(read_info_t *info_out,
+void lba_disk_extent_t::read_step_1(read_info_t *info_out, int first_entry,
                                     extent_t::read_callback_t *cb) {
     em->assert_thread();
-    info_out->buffer = scoped_device_block_aligned_ptr_t<lba_extent_t>(em->extent_size);
+    rassert(first_entry <= count);
+    // Most extents are full, but the last one usually isn't. There's no point in
+    // allocating more than we read.
+    const size_t length = sizeof(lba_extent_t) + sizeof(lba_entry_t) * count;
+    info_out->buffer = scoped_device_block_aligned_ptr_t<lba_extent_t>(
+        ceil_aligned(length, DEVICE_BLOCK_SIZE));
+    info_out->first_entry = first_entry;
     info_out->count = count;
-    data->read(0, sizeof(lba_extent_t) + sizeof(lba_entry_t) * count,
-               info_out->buffer.get(), cb);
+    data->read(0, length, info_out->buffer.get(), cb);
 }
 
 void lba_disk_extent_t::read_step_2(read_info_t *info, in_memory_index_t *index) {
@@ -71,7 +76,7 @@ void lba_disk_extent_t::read_step_2(read_info_t *info, in_memory_index_t *index)
     lba_extent_t *extent = info->buffer.get();
     guarantee(memcmp(extent->header.magic, lba_magic, LBA_MAGIC_SIZE) == 0);
 
-    for (int i = 0; i < info->count; i++) {
+    for (int i = info->first_entry; i < info->count; i++) {
         lba_entry_t *e = &extent->entries[i];
         if (!lba_entry_t::is_padding(e)) {
             // The on-disk format still stores 32 bit block sizes.
@@ -79,7 +84,8 @@ void lba_disk_extent_t::read_step_2(read_info_t *info, in_memory_index_t *index)
             // for the in-memory index to save a few bytes.
             guarantee(e->ser_block_size <= std::numeric_limits<uint16_t>::max());
             index->set_block_info(e->block_id, e->recency, e->offset,
-                                  static_cast<uint16_t>(e->ser_block_size));
+                                  static_cast<uint16_t>(e->ser_block_size),
+                                  e->disk_size());
         }
     }
 
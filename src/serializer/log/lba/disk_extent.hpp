@@ -39,14 +39,17 @@ public:
     /* To read from an LBA on disk, first call read_step_1(), passing it the address of
     a new read_info_t structure. When it calls the callback you provide, then call
     read_step_2() with the same read_info_t as before and with a pointer to the
-    in_memory_index_t to be filled with data. */
+    in_memory_index_t to be filled with data. Only the entries from `first_entry` on
+    are applied to the index. */
 
     struct read_info_t {
         scoped_device_block_aligned_ptr_t<lba_extent_t> buffer;
+        int first_entry;
         int count;
     };
 
-    void read_step_1(read_info_t *info_out, extent_t::read_callback_t *cb);
+    void read_step_1(read_info_t *info_out, int first_entry,
+                     extent_t::read_callback_t *cb);
     void read_step_2(read_info_t *info, in_memory_index_t *index);
 
     /* destroy() deletes the structure in memory and also tells the extent manager that
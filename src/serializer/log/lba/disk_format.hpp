@@ -4,6 +4,8 @@
 
 #include <limits.h>
 
+#include "config/args.hpp"
+#include "serializer/checksum.hpp"
 #include "serializer/serializer.hpp"
 
 
@@ -60,9 +62,11 @@ ATTR_PACKED(struct lba_entry_t {
     // (It probably assumes that sizeof(lba_entry_t) evenly divides
     // DEVICE_BLOCK_SIZE).
 
-    // Put the zero-padding at the beginning of the LBA entry.  We could use this, or
-    // the first 16 bits, perhaps, as a version flag.
-    uint32_t zero_reserved;
+    // The number of bytes the block occupies on disk, if it is stored compressed
+    // (see serializer/log/block_compression.hpp).  Zero means the block is stored
+    // uncompressed and occupies ser_block_size bytes.  (This used to be zero-padding,
+    // so older data files read back as entirely uncompressed.)
+    uint32_t ser_disk_size;
 
     // This could be a uint16_t if you wanted it to be, as long as block sizes are
     // all less than or equal to 4K (which is less than 64K).
@@ -76,10 +80,12 @@ ATTR_PACKED(struct lba_entry_t {
     flagged_off64_t offset;
 
     static lba_entry_t make(block_id_t block_id, repli_timestamp_t recency,
-                            flagged_off64_t offset, uint16_t ser_block_size) {
+                            flagged_off64_t offset, uint16_t ser_block_size,
+                            uint16_t ser_disk_size) {
         guarantee(ser_block_size != 0 || !offset.has_value());
+        guarantee(ser_disk_size <= ser_block_size);
         lba_entry_t entry;
-        entry.zero_reserved = 0;
+        entry.ser_disk_size = ser_disk_size == ser_block_size ? 0 : ser_disk_size;
         entry.ser_block_size = ser_block_size;
         entry.block_id = block_id;
         entry.recency = recency;
@@ -87,13 +93,18 @@ ATTR_PACKED(struct lba_entry_t {
         return entry;
     }
 
+    // The number of bytes the block occupies on disk.
+    uint16_t disk_size() const {
+        return ser_disk_size == 0 ? ser_block_size : ser_disk_size;
+    }
+
     static bool is_padding(const lba_entry_t *entry) {
         return entry->block_id == PADDING_BLOCK_ID  && entry->offset.is_padding();
     }
 
     static lba_entry_t make_padding_entry() {
         return make(PADDING_BLOCK_ID, repli_timestamp_t::invalid,
-                    flagged_off64_t::padding(), 0);
+                    flagged_off64_t::padding(), 0, 0);
     }
 });
 
@@ -171,5 +182,67 @@ struct lba_superblock_t {
 
 
 
+/* A snapshot of the in-memory LBA index lets us skip most of the LBA at startup. It
+has one entry for every block id below the end block ids of the time it was taken,
+first the regular block ids, then the aux block ids. The entries are spread out over
+one or more extents. Each extent starts with an `lba_snapshot_extent_t` header; the
+first extent then lists the offsets of the other extents, and then come the entries. */
+
+ATTR_PACKED(struct lba_snapshot_entry_t {
+    flagged_off64_t offset;
+    repli_timestamp_t recency;
+    uint16_t ser_block_size;
+    uint16_t ser_disk_size;
+});
+
+#define LBA_SNAPSHOT_MAGIC_SIZE 8
+static const char lba_snapshot_magic[LBA_SNAPSHOT_MAGIC_SIZE] = {'l', 'b', 'a', 's', 'n', 'a', 'p', 's'};
+
+ATTR_PACKED(struct lba_snapshot_extent_t {
+    char magic[LBA_SNAPSHOT_MAGIC_SIZE];
+    // The id of the snapshot that this extent belongs to, see
+    // `lba_snapshot_metablock_t::snapshot_id`.
+    int64_t snapshot_id;
+    // The position in the snapshot of the first entry in this extent, and how many
+    // entries there are in it.
+    int64_t first_entry;
+    int64_t entries_count;
+    // How many extent offsets follow the header. Zero except in the first extent.
+    int64_t extent_offsets_count;
+    // The checksum of the header (with `checksum` set to zero), the extent offsets and
+    // the entries.
+    serializer_checksum checksum;
+});
+
+// The position that the log of an LBA shard had when a snapshot was taken: the first
+// `entries_count` entries of the LBA extent at `extent_offset`, and all the extents
+// before it. Only the entries after it have to be replayed on top of the snapshot.
+ATTR_PACKED(struct lba_snapshot_shard_mark_t {
+    // NULL_OFFSET if the shard had no LBA extents yet.
+    int64_t extent_offset;
+    int32_t entries_count;
+    // Zero if the snapshot can't be used for this shard, because the garbage collector
+    // has since discarded the extent that `extent_offset` refers to.
+    int32_t valid;
+});
+
+// The reference to the current snapshot that is stored in the metablock.
+ATTR_PACKED(struct lba_snapshot_metablock_t {
+    // Zero if there is no snapshot. (The first extent holds the static header, so it
+    // can never belong to a snapshot.)
+    int64_t first_extent_offset;
+    int64_t extents_count;
+    // Every snapshot gets a higher id than the one before it, and stamps it into the
+    // header of each of its extents. This way an extent that was left over from an
+    // older snapshot can't be mistaken for one of the current snapshot.
+    int64_t snapshot_id;
+    // The number of regular block ids and aux block ids in the snapshot.
+    int64_t num_blocks;
+    int64_t num_aux_blocks;
+    lba_snapshot_shard_mark_t shard_marks[LBA_SHARD_FACTOR];
+    // The checksum of all of the above.
+    serializer_checksum checksum;
+});
+
 #endif  // SERIALIZER_LOG_LBA_DISK_FORMAT_HPP_
 
@@ -7,13 +7,14 @@
 #include "math.hpp"
 
 lba_disk_structure_t::lba_disk_structure_t(extent_manager_t *_em, file_t *_file)
-    : em(_em), file(_file), superblock_extent(nullptr), last_extent(nullptr)
+    : em(_em), file(_file), superblock_extent(nullptr), last_extent(nullptr),
+      held_back_reader(nullptr)
 {
 }
 
 lba_disk_structure_t::lba_disk_structure_t(extent_manager_t *_em, file_t *_file,
                                            lba_shard_metablock_t *metablock)
-    : em(_em), file(_file)
+    : em(_em), file(_file), held_back_reader(nullptr)
 {
     if (metablock->last_lba_extent_offset != NULL_OFFSET) {
         last_extent = new lba_disk_extent_t(em, file, metablock->last_lba_extent_offset,
@@ -70,6 +71,7 @@ void lba_disk_structure_t::on_extent_read() {
 
 void lba_disk_structure_t::add_entry(block_id_t block_id, repli_timestamp_t recency,
                                      flagged_off64_t offset, uint16_t ser_block_size,
+                                     uint16_t ser_disk_size,
                                      file_account_t *io_account,
                                      extent_transaction_t *txn,
                                      optional<std::vector<checksum_filerange>> *checksums) {
@@ -91,7 +93,8 @@ void lba_disk_structure_t::add_entry(block_id_t block_id, repli_timestamp_t rece
 
     rassert(!last_extent->full());
 
-    last_extent->add_entry(lba_entry_t::make(block_id, recency, offset, ser_block_size),
+    last_extent->add_entry(lba_entry_t::make(block_id, recency, offset, ser_block_size,
+                                             ser_disk_size),
                            io_account, checksums);
 }
 
@@ -223,6 +226,7 @@ struct reader_t
 {
     lba_disk_structure_t *ds;   // The disk structure we are reading from
     in_memory_index_t *index;   // The in-memory-index we are reading into
+    int64_t *entries_applied;   // Where we count the entries that we have applied
     lba_disk_structure_t::read_callback_t *rcb;   // Who to call back when we finish
 
     /* extent_reader_t takes care of reading a single extent. */
@@ -232,6 +236,7 @@ struct reader_t
         reader_t *parent;   // Our reader_t that we were created by
         int index;   // parent->readers[index] = this
         lba_disk_extent_t *extent;   // The extent we are supposed to read
+        int first_entry;   // The first entry in the extent that we apply
         lba_disk_extent_t::read_info_t read_info;   // Opaque data used by extent_t::read()
         bool have_read;   // true if our extent has been loaded from disk
 
@@ -241,8 +246,8 @@ struct reader_t
         and the LBA would be corrupted. */
         bool prev_done;
 
-        extent_reader_t(reader_t *p, lba_disk_extent_t *e)
-            : parent(p), extent(e), have_read(false)
+        extent_reader_t(reader_t *p, lba_disk_extent_t *e, int _first_entry)
+            : parent(p), extent(e), first_entry(_first_entry), have_read(false)
         {
             index = parent->readers.size();
             parent->readers.push_back(this);
@@ -256,7 +261,7 @@ struct reader_t
         }
         void start_reading() {
             parent->active_readers++;
-            extent->read_step_1(&read_info, this);
+            extent->read_step_1(&read_info, first_entry, this);
         }
         void on_extent_read() {   // Called when our extent has been read from disk
             rassert(!have_read);
@@ -270,6 +275,7 @@ struct reader_t
         }
         void done() {
             extent->read_step_2(&read_info, parent->index);
+            *parent->entries_applied += read_info.count - read_info.first_entry;
             parent->active_readers--;
             parent->start_more_readers();
             if (index == static_cast<int>(parent->readers.size()) - 1) {
@@ -289,14 +295,24 @@ struct reader_t
     // throttle the reading process so that we stay under LBA_READ_BUFFER_SIZE.
     int active_readers;
 
-    reader_t(lba_disk_structure_t *_ds, in_memory_index_t *_index, lba_disk_structure_t::read_callback_t *cb)
-        : ds(_ds), index(_index), rcb(cb)
+    // True until release_read() is called if the read is held back.
+    bool held_back;
+
+    reader_t(lba_disk_structure_t *_ds, in_memory_index_t *_index,
+             const lba_snapshot_shard_mark_t *start, bool _held_back,
+             int64_t *_entries_applied, lba_disk_structure_t::read_callback_t *cb)
+        : ds(_ds), index(_index), entries_applied(_entries_applied), rcb(cb),
+          held_back(_held_back)
     {
+        // If we start at a snapshot's mark, the extents before it are skipped and so
+        // are the entries in it that come before the mark.
+        bool started = start == nullptr || start->extent_offset == NULL_OFFSET;
         for (lba_disk_extent_t *e = ds->extents_in_superblock.head();
              e != nullptr; e = ds->extents_in_superblock.next(e)) {
-            new extent_reader_t(this, e);
+            add_extent_reader(e, start, &started);
         }
-        if (ds->last_extent) new extent_reader_t(this, ds->last_extent);
+        if (ds->last_extent) add_extent_reader(ds->last_extent, start, &started);
+        guarantee(started, "The LBA snapshot's mark is not part of the LBA.");
 
         /* The constructor for extent_reader_t pushed them onto our 'readers' vector. So
         now we have a vector with an extent_reader_t object for each extent we need to
@@ -305,14 +321,46 @@ struct reader_t
         if (readers.empty()) {
             done();
         } else {
+            if (held_back) {
+                // The first reader waits for `release()` as if it was waiting for the
+                // extent before it.
+                readers[0]->prev_done = false;
+                rassert(ds->held_back_reader == nullptr);
+                ds->held_back_reader = this;
+            }
             next_reader = 0;
             active_readers = 0;
             start_more_readers();
         }
     }
 
+    void release() {
+        rassert(held_back);
+        held_back = false;
+        // There is more buffer space for us now.
+        start_more_readers();
+        readers[0]->on_prev_done();
+    }
+
+    void add_extent_reader(lba_disk_extent_t *e, const lba_snapshot_shard_mark_t *start,
+                           bool *started) {
+        if (*started) {
+            new extent_reader_t(this, e, 0);
+        } else if (e->data->extent_ref.offset() == start->extent_offset) {
+            *started = true;
+            if (start->entries_count < e->count) {
+                new extent_reader_t(this, e, start->entries_count);
+            }
+        }
+    }
+
     void start_more_readers() {
-        int limit = std::max<int>(LBA_READ_BUFFER_SIZE / ds->em->extent_size / LBA_SHARD_FACTOR, 1);
+        // While we are held back, an LBA snapshot is being read at the same time. It
+        // gets one half of the buffer space, and the shards share the other half.
+        const int64_t buffer_size = held_back
+            ? LBA_READ_BUFFER_SIZE / 2
+            : LBA_READ_BUFFER_SIZE;
+        int limit = std::max<int>(buffer_size / ds->em->extent_size / LBA_SHARD_FACTOR, 1);
         while (next_reader != static_cast<int>(readers.size())
                && active_readers < limit) {
             readers[next_reader++]->start_reading();
@@ -320,13 +368,84 @@ struct reader_t
     }
 
     void done() {
+        if (ds->held_back_reader == this) {
+            ds->held_back_reader = nullptr;
+        }
         rcb->on_lba_extents_read();
         delete this;
     }
 };
 
-void lba_disk_structure_t::read(in_memory_index_t *index, read_callback_t *cb) {
-    new reader_t(this, index, cb);
+void lba_disk_structure_t::read(in_memory_index_t *index,
+                                const lba_snapshot_shard_mark_t *start,
+                                bool held_back, int64_t *entries_applied,
+                                read_callback_t *cb) {
+    new reader_t(this, index, start, held_back, entries_applied, cb);
+}
+
+void lba_disk_structure_t::release_read() {
+    // If the read didn't have any extents to read, it is already done.
+    if (held_back_reader != nullptr) {
+        reader_t *reader = held_back_reader;
+        held_back_reader = nullptr;
+        reader->release();
+    }
+}
+
+lba_snapshot_shard_mark_t lba_disk_structure_t::get_log_position() const {
+    lba_snapshot_shard_mark_t position;
+    const lba_disk_extent_t *last = last_extent != nullptr
+        ? last_extent
+        : extents_in_superblock.tail();
+    if (last != nullptr) {
+        position.extent_offset = last->data->extent_ref.offset();
+        position.entries_count = last->count;
+    } else {
+        position.extent_offset = NULL_OFFSET;
+        position.entries_count = 0;
+    }
+    position.valid = 1;
+    return position;
+}
+
+bool lba_disk_structure_t::has_log_position(
+        const lba_snapshot_shard_mark_t &position) const {
+    if (position.extent_offset == NULL_OFFSET) {
+        return true;
+    }
+    for (lba_disk_extent_t *e = extents_in_superblock.head();
+         e != nullptr; e = extents_in_superblock.next(e)) {
+        if (e->data->extent_ref.offset() == position.extent_offset) {
+            return position.entries_count <= e->count;
+        }
+    }
+    return last_extent != nullptr
+        && last_extent->data->extent_ref.offset() == position.extent_offset
+        && position.entries_count <= last_extent->count;
+}
+
+int64_t lba_disk_structure_t::count_log_entries(
+        const lba_snapshot_shard_mark_t *start) const {
+    const int64_t last_extent_count = last_extent != nullptr ? last_extent->count : 0;
+    if (start == nullptr || start->extent_offset == NULL_OFFSET) {
+        return extents_in_superblock.size() * num_entries_that_can_fit_in_an_extent()
+            + last_extent_count;
+    }
+    int64_t count = 0;
+    bool started = false;
+    for (lba_disk_extent_t *e = extents_in_superblock.head();
+         e != nullptr; e = extents_in_superblock.next(e)) {
+        if (started) {
+            count += e->count;
+        } else if (e->data->extent_ref.offset() == start->extent_offset) {
+            started = true;
+            count += e->count - start->entries_count;
+        }
+    }
+    if (last_extent != nullptr && !started) {
+        return last_extent_count - start->entries_count;
+    }
+    return count + last_extent_count;
 }
 
 void lba_disk_structure_t::prepare_metablock(lba_shard_metablock_t *mb_out) {
@@ -12,12 +12,14 @@
 
 class lba_load_fsm_t;
 class lba_writer_t;
+struct reader_t;
 
 class lba_disk_structure_t :
     public extent_t::read_callback_t
 {
     friend class lba_load_fsm_t;
     friend class lba_writer_t;
+    friend struct reader_t;
 
 public:
     // Create a new LBA
@@ -35,6 +37,7 @@ public:
     // Put entries in an LBA and then call wait_for_write_completion() to write to disk
     void add_entry(block_id_t block_id, repli_timestamp_t recency,
                    flagged_off64_t offset, uint16_t ser_block_size,
+                   uint16_t ser_disk_size,
                    file_account_t *io_account,
                    extent_transaction_t *txn,
                    optional<std::vector<checksum_filerange>> *checksums);
@@ -59,12 +62,28 @@ public:
                          optional<std::vector<checksum_filerange>> *checksums);
 
     // If you call read(), then the in_memory_index_t will be populated and then the
-    // read_callback_t will be called when it is done.
+    // read_callback_t will be called when it is done. If `start` isn't null, only the
+    // entries after that position are read. The number of entries applied to the index
+    // is added to `*entries_applied` as the read goes along.
+    // If `held_back` is true, the extents are already read from disk, but they are not
+    // applied to the index before release_read() gets called. That way the LBA can be
+    // read while an LBA snapshot is still being applied.
     struct read_callback_t {
         virtual void on_lba_extents_read() = 0;
         virtual ~read_callback_t() {}
     };
-    void read(in_memory_index_t *index, read_callback_t *cb);
+    void read(in_memory_index_t *index, const lba_snapshot_shard_mark_t *start,
+              bool held_back, int64_t *entries_applied, read_callback_t *cb);
+    void release_read();
+
+    // Returns the current end of the log, for use in an LBA snapshot.
+    lba_snapshot_shard_mark_t get_log_position() const;
+    // Returns true if `position` is still part of the log, i.e. if read() can start at
+    // it.
+    bool has_log_position(const lba_snapshot_shard_mark_t &position) const;
+
+    // Returns roughly how many entries read() would go through, with the same `start`.
+    int64_t count_log_entries(const lba_snapshot_shard_mark_t *start) const;
 
     void prepare_metablock(lba_shard_metablock_t *mb_out);
 
@@ -91,6 +110,8 @@ private:
     load_callback_t *start_callback;
     int startup_superblock_count;
     scoped_device_block_aligned_ptr_t<lba_superblock_t> startup_superblock_buffer;
+    // The read that release_read() applies to
+    reader_t *held_back_reader;
 
     /* Use destroy() or shutdown() instead */
     ~lba_disk_structure_t() {}
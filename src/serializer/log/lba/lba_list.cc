@@ -11,9 +11,11 @@
 // TODO: Some of the code in this file is bullshit disgusting shit.
 
 lba_list_t::lba_list_t(extent_manager_t *em,
+        uint64_t _snapshot_threshold,
         const lba_list_t::write_metablock_fun_t &_write_metablock_fun)
     : gc_drainer(new auto_drainer_t), write_metablock_fun(_write_metablock_fun),
-      extent_manager(em), state(state_unstarted), inline_lba_entries_count(0)
+      extent_manager(em), state(state_unstarted), inline_lba_entries_count(0),
+      snapshot_threshold(_snapshot_threshold), entries_since_snapshot(0)
 {
     for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
         gc_active[i] = false;
@@ -50,21 +52,30 @@ void lba_list_t::prepare_metablock(lba_metablock_mixin_t *mb_out) {
            (LBA_NUM_INLINE_ENTRIES - inline_lba_entries_count) * sizeof(lba_entry_t));
 }
 
+void lba_list_t::prepare_snapshot_metablock(lba_snapshot_metablock_t *mb_out) {
+    snapshot->prepare_metablock(mb_out);
+}
+
 class lba_start_fsm_t :
-    private lba_disk_structure_t::load_callback_t,
-    private lba_disk_structure_t::read_callback_t
+    private lba_disk_structure_t::load_callback_t
 {
 public:
     int cbs_out;
     lba_list_t *owner;
     lba_list_t::ready_callback_t *callback;
+    log_serializer_startup_progress_t *progress;
 
-    lba_start_fsm_t(lba_list_t *l, lba_metablock_mixin_t *last_metablock)
-        : owner(l), callback(nullptr)
+    lba_start_fsm_t(lba_list_t *l, lba_metablock_mixin_t *last_metablock,
+                    const lba_snapshot_metablock_t *last_snapshot_metablock,
+                    log_serializer_startup_progress_t *_progress)
+        : owner(l), callback(nullptr), progress(_progress), snapshot_applied(false)
     {
         rassert(owner->state == lba_list_t::state_unstarted);
         owner->state = lba_list_t::state_starting_up;
 
+        owner->snapshot.init(new lba_snapshot_t(owner->extent_manager, owner->dbfile));
+        owner->snapshot->start_existing(last_snapshot_metablock);
+
         // Copy the current set of inline LBA entries from the metablock
         guarantee(last_metablock->inline_lba_entries_count <= LBA_NUM_INLINE_ENTRIES);
         owner->inline_lba_entries_count = last_metablock->inline_lba_entries_count;
@@ -74,6 +85,9 @@ public:
 
         cbs_out = LBA_SHARD_FACTOR;
         for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
+            shards[i].parent = this;
+            shards[i].shard = i;
+            shards[i].state = shard_t::state_reading;
             owner->disk_structures[i] = new lba_disk_structure_t(
                 owner->extent_manager, owner->dbfile,
                 &last_metablock->shards[i]);
@@ -85,70 +99,181 @@ public:
         rassert(cbs_out > 0);
         cbs_out--;
         if (cbs_out == 0) {
-            cbs_out = LBA_SHARD_FACTOR;
-            for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
-                owner->disk_structures[i]->read(&owner->in_memory_index, this);
+            // Reading the snapshot blocks, so we do it in a coroutine.
+            coro_t::spawn_sometime(std::bind(&lba_start_fsm_t::read_lba, this));
+        }
+    }
+
+    void read_lba() {
+        // Now that we know the extents of each shard, we can check that the snapshot's
+        // marks are still part of the LBA. The GC makes sure of that, but if they
+        // weren't, we'd have no choice but to replay the whole shard.
+        for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
+            const lba_snapshot_shard_mark_t &mark = owner->snapshot->get_mark(i);
+            if (mark.valid && !owner->disk_structures[i]->has_log_position(mark)) {
+                owner->snapshot->invalidate(i);
+            }
+        }
+
+        progress->lba_entries_total = owner->snapshot->count_entries();
+        for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
+            const lba_snapshot_shard_mark_t &mark = owner->snapshot->get_mark(i);
+            progress->lba_entries_total +=
+                owner->disk_structures[i]->count_log_entries(mark.valid ? &mark : nullptr);
+        }
+
+        // The shards are read while the snapshot is being applied, but their entries
+        // are held back until it has been applied. Otherwise the older entries from
+        // the snapshot would overwrite them.
+        const bool have_snapshot = owner->snapshot->is_valid_for_any_shard();
+        cbs_out = LBA_SHARD_FACTOR;
+        for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
+            const lba_snapshot_shard_mark_t &mark = owner->snapshot->get_mark(i);
+            owner->disk_structures[i]->read(&owner->in_memory_index,
+                                            mark.valid ? &mark : nullptr,
+                                            have_snapshot,
+                                            &progress->lba_entries_applied,
+                                            &shards[i]);
+        }
+
+        bool was_valid[LBA_SHARD_FACTOR];
+        for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
+            was_valid[i] = owner->snapshot->get_mark(i).valid;
+        }
+        owner->snapshot->read(&owner->in_memory_index, &progress->lba_entries_applied);
+
+        // The entries before the marks are part of the snapshot. That leaves the ones
+        // after them to be replayed.
+        owner->entries_since_snapshot = 0;
+        for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
+            const lba_snapshot_shard_mark_t &mark = owner->snapshot->get_mark(i);
+            if (mark.valid) {
+                ++progress->lba_snapshot_shards;
+                owner->entries_since_snapshot +=
+                    owner->disk_structures[i]->count_log_entries(&mark);
+            } else if (was_valid[i]) {
+                // The snapshot turned out to be damaged. What we have read of the shard
+                // so far is not enough, so we read the whole shard again once the
+                // current read is done.
+                shards[i].needs_full_read = true;
+                progress->lba_entries_total +=
+                    owner->disk_structures[i]->count_log_entries(nullptr);
+            }
+        }
+
+        snapshot_applied = true;
+        for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
+            if (shards[i].state == shard_t::state_read) {
+                on_shard_read(i);
+            } else {
+                owner->disk_structures[i]->release_read();
             }
         }
     }
 
-    void on_lba_extents_read() {
+    void on_shard_read(int i) {
+        shard_t *shard = &shards[i];
+        if (!snapshot_applied) {
+            // Only possible if there was nothing to read for the shard. `read_lba()`
+            // comes back to it.
+            shard->state = shard_t::state_read;
+            return;
+        }
+        if (shard->needs_full_read) {
+            shard->needs_full_read = false;
+            owner->disk_structures[i]->read(&owner->in_memory_index, nullptr, false,
+                                            &progress->lba_entries_applied, shard);
+            return;
+        }
+        shard->state = shard_t::state_ready;
+
+        // All LBA entries from the shard's LBA extents have been read. Now we can load
+        // the (more recent) inlined entries of the shard from the metablock into the
+        // index.
+        for (int32_t j = 0; j < owner->inline_lba_entries_count; ++j) {
+            lba_entry_t *e = &owner->inline_lba_entries[j];
+            if (lba_list_t::shard_of(e->block_id) != i) {
+                continue;
+            }
+            // The on-disk format still stores 32 bit block sizes.
+            // We've never actually used them, and we now use 16 bit block sizes
+            // for the in-memory index to save a few bytes.
+            guarantee(e->ser_block_size <= std::numeric_limits<uint16_t>::max());
+            owner->in_memory_index.set_block_info(
+                    e->block_id,
+                    e->recency,
+                    e->offset,
+                    static_cast<uint16_t>(e->ser_block_size),
+                    e->disk_size());
+        }
+
+        rassert(callback != nullptr);
+        callback->on_lba_shard_ready(i);
+
         rassert(cbs_out > 0);
         cbs_out--;
         if (cbs_out == 0) {
-            // All LBA entries from the LBA extents have been read.
-            // Now we can load the (more recent) inlined entries from
-            // the metablock into the index:
-            for (int32_t i = 0; i < owner->inline_lba_entries_count; ++i) {
-                lba_entry_t *e = &owner->inline_lba_entries[i];
-                // The on-disk format still stores 32 bit block sizes.
-                // We've never actually used them, and we now use 16 bit block sizes
-                // for the in-memory index to save a few bytes.
-                guarantee(e->ser_block_size <= std::numeric_limits<uint16_t>::max());
-                owner->in_memory_index.set_block_info(
-                        e->block_id,
-                        e->recency,
-                        e->offset,
-                        static_cast<uint16_t>(e->ser_block_size));
-            }
-
             owner->state = lba_list_t::state_ready;
-            if (callback) callback->on_lba_ready();
+            callback->on_lba_ready();
             delete this;
         }
     }
+
+private:
+    struct shard_t : public lba_disk_structure_t::read_callback_t {
+        shard_t() : needs_full_read(false) { }
+        void on_lba_extents_read() {
+            parent->on_shard_read(shard);
+        }
+        lba_start_fsm_t *parent;
+        int shard;
+        enum state_t {
+            state_reading,
+            // Done reading, but waiting for the snapshot to be applied
+            state_read,
+            state_ready
+        } state;
+        bool needs_full_read;
+    };
+    shard_t shards[LBA_SHARD_FACTOR];
+    bool snapshot_applied;
 };
 
 bool lba_list_t::start_existing(file_t *file, lba_metablock_mixin_t *last_metablock,
+        const lba_snapshot_metablock_t *last_snapshot_metablock,
+        log_serializer_startup_progress_t *progress,
         ready_callback_t *cb) {
     rassert(state == state_unstarted);
 
     dbfile = file;
     gc_io_account.init(new file_account_t(dbfile, LBA_GC_IO_PRIORITY));
 
-    lba_start_fsm_t *starter = new lba_start_fsm_t(this, last_metablock);
-    if (state == state_ready) {
-        return true;
-    } else {
-        starter->callback = cb;
-        return false;
-    }
+    // The LBA is always read in a coroutine, so we never finish right away.
+    lba_start_fsm_t *starter = new lba_start_fsm_t(this, last_metablock,
+                                                   last_snapshot_metablock, progress);
+    starter->callback = cb;
+    return false;
 }
 
+// These can also be used while starting up, for the shards that are ready (see
+// `ready_callback_t`).
 block_id_t lba_list_t::end_block_id() {
-    rassert(state == state_ready || state == state_gc_shutting_down);
+    rassert(state == state_ready || state == state_gc_shutting_down
+            || state == state_starting_up);
 
     return in_memory_index.end_block_id();
 }
 
 block_id_t lba_list_t::end_aux_block_id() {
-    rassert(state == state_ready || state == state_gc_shutting_down);
+    rassert(state == state_ready || state == state_gc_shutting_down
+            || state == state_starting_up);
 
     return in_memory_index.end_aux_block_id();
 }
 
 index_block_info_t lba_list_t::get_block_info(block_id_t block) {
-    rassert(state == state_ready || state == state_gc_shutting_down);
+    rassert(state == state_ready || state == state_gc_shutting_down
+            || state == state_starting_up);
     return in_memory_index.get_block_info(block);
 }
 
@@ -164,6 +289,10 @@ block_size_t lba_list_t::get_block_size(block_id_t block) {
     return block_size_t::unsafe_make(get_block_info(block).ser_block_size);
 }
 
+block_size_t lba_list_t::get_disk_block_size(block_id_t block) {
+    return block_size_t::unsafe_make(get_block_info(block).ser_disk_size);
+}
+
 repli_timestamp_t lba_list_t::get_block_recency(block_id_t block) {
     return get_block_info(block).recency;
 }
@@ -192,11 +321,14 @@ segmented_vector_t<repli_timestamp_t> lba_list_t::get_block_recencies(block_id_t
 
 void lba_list_t::set_block_info(block_id_t block, repli_timestamp_t recency,
                                 flagged_off64_t offset, uint16_t ser_block_size,
+                                uint16_t ser_disk_size,
                                 file_account_t *io_account, extent_transaction_t *txn,
                                 optional<std::vector<checksum_filerange>> *checksums) {
     rassert(state == state_ready || state == state_gc_shutting_down);
 
-    in_memory_index.set_block_info(block, recency, offset, ser_block_size);
+    in_memory_index.set_block_info(block, recency, offset, ser_block_size,
+                                   ser_disk_size);
+    ++entries_since_snapshot;
 
     // If the inline LBA is full, free it up first by moving its entries to
     // the LBA extents
@@ -205,7 +337,7 @@ void lba_list_t::set_block_info(block_id_t block, repli_timestamp_t recency,
         rassert(!check_inline_lba_full());
     }
     // Then store the entry inline
-    add_inline_entry(block, recency, offset, ser_block_size);
+    add_inline_entry(block, recency, offset, ser_block_size, ser_disk_size);
 }
 
 bool lba_list_t::check_inline_lba_full() const {
@@ -245,6 +377,7 @@ void lba_list_t::move_inline_entries_to_extents(
                 e.recency,
                 e.offset,
                 e.ser_block_size,
+                e.disk_size(),
                 io_account,
                 txn,
                 checksums);
@@ -254,11 +387,12 @@ void lba_list_t::move_inline_entries_to_extents(
 }
 
 void lba_list_t::add_inline_entry(block_id_t block, repli_timestamp_t recency,
-                                flagged_off64_t offset, uint16_t ser_block_size) {
+                                flagged_off64_t offset, uint16_t ser_block_size,
+                                uint16_t ser_disk_size) {
 
     rassert(!check_inline_lba_full());
     inline_lba_entries[inline_lba_entries_count++] =
-            lba_entry_t::make(block, recency, offset, ser_block_size);
+            lba_entry_t::make(block, recency, offset, ser_block_size, ser_disk_size);
 }
 
 class lba_writer_t :
@@ -361,11 +495,12 @@ void lba_list_t::gc(int lba_shard, auto_drainer_t::lock_t) {
 
         flagged_off64_t off = get_block_offset(id);
         if (off.has_value()) {
-            uint16_t ser_block_size = get_ser_block_size(id);
+            const index_block_info_t info = get_block_info(id);
             disk_structures[lba_shard]->add_entry(id,
-                                                  get_block_recency(id),
+                                                  info.recency,
                                                   off,
-                                                  ser_block_size,
+                                                  info.ser_block_size,
+                                                  info.ser_disk_size,
                                                   gc_io_account.get(),
                                                   txns.back().get(),
                                                   &checksums);
@@ -408,6 +543,7 @@ void lba_list_t::gc(int lba_shard, auto_drainer_t::lock_t) {
 
     // Discard the old LBA extents
     if (!aborted) {
+        invalidate_snapshot_marks(lba_shard, gced_extents);
         disk_structures[lba_shard]->destroy_extents(gced_extents, gc_io_account.get(),
                                                     txns.back().get(), &checksums);
     }
@@ -436,6 +572,96 @@ void lba_list_t::gc(int lba_shard, auto_drainer_t::lock_t) {
     gc_active[lba_shard] = false;
 }
 
+void lba_list_t::invalidate_snapshot_marks(
+        int lba_shard, const std::set<lba_disk_extent_t *> &extents) {
+    lba_snapshot_t *snapshots[2] = { snapshot.get(), new_snapshot.get() };
+    for (lba_snapshot_t *s : snapshots) {
+        if (s == nullptr || !s->get_mark(lba_shard).valid) {
+            continue;
+        }
+        const int64_t mark_offset = s->get_mark(lba_shard).extent_offset;
+        for (lba_disk_extent_t *e : extents) {
+            // If the shard had no extents when the mark was taken, all of them come
+            // after it.
+            if (mark_offset == NULL_OFFSET || e->data->extent_ref.offset() == mark_offset) {
+                s->invalidate(lba_shard);
+                break;
+            }
+        }
+    }
+}
+
+void lba_list_t::consider_snapshot() {
+    if (we_want_to_snapshot()) {
+        new_snapshot.init(new lba_snapshot_t(extent_manager, dbfile));
+        coro_t *snapshot_coro = coro_t::spawn_sometime(std::bind(
+                &lba_list_t::write_snapshot,
+                this, auto_drainer_t::lock_t(gc_drainer.get())));
+        snapshot_coro->set_priority(CORO_PRIORITY_LBA_GC);
+    }
+}
+
+void lba_list_t::write_snapshot(auto_drainer_t::lock_t gc_drainer_lock) {
+    // The marks and the contents of the snapshot have to be taken without blocking in
+    // between, see `lba_snapshot_t::write()`.
+    lba_snapshot_shard_mark_t marks[LBA_SHARD_FACTOR];
+    for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
+        marks[i] = disk_structures[i]->get_log_position();
+    }
+    const int64_t old_entries_since_snapshot = entries_since_snapshot;
+    entries_since_snapshot = 0;
+    if (!new_snapshot->write(snapshot->get_id() + 1, &in_memory_index, marks,
+                             gc_io_account.get(), gc_drainer_lock.get_drain_signal())) {
+        // We are shutting down.
+        entries_since_snapshot += old_entries_since_snapshot;
+        new_snapshot.reset();
+        return;
+    }
+
+    // Once the metablock refers to the new snapshot, the old one can go. Just like the
+    // GC, we must not commit the transaction before the metablock has been written.
+    scoped_ptr_t<lba_snapshot_t> old_snapshot = std::move(snapshot);
+    snapshot = std::move(new_snapshot);
+    extent_transaction_t txn;
+    extent_manager->begin_transaction(&txn);
+    old_snapshot->destroy(&txn);
+    extent_manager->end_transaction(&txn);
+
+    // `write()` has already datasynced the snapshot.
+    cond_t snapshot_written;
+    snapshot_written.pulse();
+    write_metablock_fun(&snapshot_written, gc_io_account.get());
+
+    extent_manager->commit_transaction(&txn);
+
+    // Only snapshots that made it into a metablock count.
+    ++extent_manager->stats->pm_serializer_lba_snapshots;
+}
+
+// Decides based on how many LBA entries we would have to replay at startup.
+bool lba_list_t::we_want_to_snapshot() {
+    if (snapshot_threshold == 0 || new_snapshot.has() || state != state_ready) {
+        return false;
+    }
+
+    int64_t replay_entries = entries_since_snapshot;
+    for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
+        if (!snapshot->get_mark(i).valid) {
+            replay_entries += disk_structures[i]->count_log_entries(nullptr);
+        }
+    }
+    if (replay_entries < static_cast<int64_t>(snapshot_threshold)) {
+        return false;
+    }
+
+    // Reading the snapshot has to be cheaper than replaying those entries, or there's no
+    // point in writing it.
+    const uint64_t snapshot_entries = end_block_id()
+        + make_aux_block_id_relative(end_aux_block_id());
+    return replay_entries * sizeof(lba_entry_t)
+        >= snapshot_entries * sizeof(lba_snapshot_entry_t);
+}
+
 bool lba_list_t::is_any_gc_active() const {
     for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
         if (gc_active[i]) {
@@ -505,6 +731,10 @@ void lba_list_t::shutdown() {
         disk_structures[i] = nullptr;
     }
 
+    rassert(!new_snapshot.has());
+    snapshot->shutdown();
+    snapshot.reset();
+
     gc_io_account.reset();
 
     state = state_shut_down;
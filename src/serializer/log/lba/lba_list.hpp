@@ -13,6 +13,8 @@
 #include "serializer/log/lba/disk_format.hpp"
 #include "serializer/log/lba/in_memory_index.hpp"
 #include "serializer/log/lba/disk_structure.hpp"
+#include "serializer/log/lba/snapshot.hpp"
+#include "serializer/log/startup_progress.hpp"
 
 class lba_start_fsm_t;
 class lba_syncer_t;
@@ -25,26 +27,45 @@ class lba_list_t
     typedef std::function<void(const signal_t *, file_account_t *)> write_metablock_fun_t;
 
 public:
-    explicit lba_list_t(extent_manager_t *em,
-                        const write_metablock_fun_t &_write_metablock_fun);
+    // `snapshot_threshold` is how many LBA entries we allow to pile up for replaying
+    // at startup before we write a new snapshot of the in-memory index. Zero turns
+    // snapshots off.
+    lba_list_t(extent_manager_t *em,
+               uint64_t _snapshot_threshold,
+               const write_metablock_fun_t &_write_metablock_fun);
     ~lba_list_t();
 
     static void prepare_initial_metablock(lba_metablock_mixin_t *mb_out);
     void prepare_metablock(lba_metablock_mixin_t *mb_out);
+    void prepare_snapshot_metablock(lba_snapshot_metablock_t *mb_out);
 
+    // The shards of the LBA are read in parallel. Once `on_lba_shard_ready()` has been
+    // called for a shard, the block infos of the block ids that belong to it (see
+    // `shard_of()`) are final and can be looked up before the whole LBA is ready.
+    // The block ids of a shard that are above `end_block_id()` and
+    // `end_aux_block_id()` at that time don't exist.
     struct ready_callback_t {
+        virtual void on_lba_shard_ready(int shard) = 0;
         virtual void on_lba_ready() = 0;
         virtual ~ready_callback_t() {}
     };
     bool start_existing(file_t *dbfile, lba_metablock_mixin_t *last_metablock,
+                        const lba_snapshot_metablock_t *last_snapshot_metablock,
+                        log_serializer_startup_progress_t *progress,
                         ready_callback_t *cb);
 
+    static int shard_of(block_id_t block) {
+        CT_ASSERT(FIRST_AUX_BLOCK_ID % LBA_SHARD_FACTOR == 0);
+        return block % LBA_SHARD_FACTOR;
+    }
+
     index_block_info_t get_block_info(block_id_t block);
 
     // These return individual fields of get_block_info.
     flagged_off64_t get_block_offset(block_id_t block);
     uint16_t get_ser_block_size(block_id_t block);
     block_size_t get_block_size(block_id_t block);
+    block_size_t get_disk_block_size(block_id_t block);
     repli_timestamp_t get_block_recency(block_id_t block);
     segmented_vector_t<repli_timestamp_t> get_block_recencies(block_id_t first,
                                                               block_id_t step);
@@ -64,6 +85,7 @@ public:
                         repli_timestamp_t recency,
                         flagged_off64_t offset,
                         uint16_t ser_block_size,
+                        uint16_t ser_disk_size,
                         file_account_t *io_account,
                         extent_transaction_t *txn,
                         optional<std::vector<checksum_filerange>> *checksums);
@@ -77,6 +99,7 @@ public:
                            completion_callback_t *cb);
 
     void consider_gc();
+    void consider_snapshot();
 
     // The garbage collector must be shut down first through `shutdown_gc()`
     // (must be run in a coroutine). Once that is done, call `shutdown()` to
@@ -123,7 +146,8 @@ private:
             file_account_t *io_account, extent_transaction_t *txn,
             optional<std::vector<checksum_filerange>> *checksums);
     void add_inline_entry(block_id_t block, repli_timestamp_t recency,
-                          flagged_off64_t offset, uint16_t ser_block_size);
+                          flagged_off64_t offset, uint16_t ser_block_size,
+                          uint16_t ser_disk_size);
 
     lba_disk_structure_t *disk_structures[LBA_SHARD_FACTOR];
 
@@ -134,6 +158,26 @@ private:
     // gc. The integer is which shard to GC.
     bool we_want_to_gc(int i);
 
+    // The snapshot of the in-memory index that the metablock refers to, and the one
+    // that we are writing to replace it, if any.
+    scoped_ptr_t<lba_snapshot_t> snapshot;
+    scoped_ptr_t<lba_snapshot_t> new_snapshot;
+    const uint64_t snapshot_threshold;
+    // Roughly how many LBA entries have been written after the marks of `snapshot`.
+    int64_t entries_since_snapshot;
+
+    // Writes `new_snapshot` and then a metablock that refers to it.
+    void write_snapshot(auto_drainer_t::lock_t gc_drainer_lock);
+
+    // Returns true if replaying the LBA at startup has become expensive enough that we
+    // want a new snapshot.
+    bool we_want_to_snapshot();
+
+    // Called by the GC before it discards `extents` of the given shard. The snapshots
+    // that start replaying the shard in one of them can't be used for it anymore.
+    void invalidate_snapshot_marks(int lba_shard,
+                                   const std::set<lba_disk_extent_t *> &extents);
+
     DISABLE_COPYING(lba_list_t);
 };
 
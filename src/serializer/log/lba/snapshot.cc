@@ -0,0 +1,416 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "serializer/log/lba/snapshot.hpp"
+
+#include <algorithm>
+
+#include "arch/arch.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "math.hpp"
+#include "serializer/log/stats.hpp"
+
+namespace {
+
+serializer_checksum compute_snapshot_metablock_checksum(
+        const lba_snapshot_metablock_t *mb) {
+    CT_ASSERT(offsetof(lba_snapshot_metablock_t, checksum)
+              % serializer_checksum::word_size == 0);
+    return compute_checksum(mb, offsetof(lba_snapshot_metablock_t, checksum)
+                                / serializer_checksum::word_size);
+}
+
+}  // namespace
+
+lba_snapshot_t::lba_snapshot_t(extent_manager_t *_em, file_t *_file)
+    : em(_em), file(_file), snapshot_id(0), num_blocks(0), num_aux_blocks(0),
+      existing_first_extent_offset(0), existing_extents_count(0) {
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        marks[i].extent_offset = NULL_OFFSET;
+        marks[i].entries_count = 0;
+        marks[i].valid = 0;
+    }
+}
+
+lba_snapshot_t::~lba_snapshot_t() {
+    rassert(extents.empty(), "Use destroy() or shutdown() first.");
+}
+
+const lba_snapshot_shard_mark_t &lba_snapshot_t::get_mark(int shard) const {
+    rassert(shard >= 0 && shard < LBA_SHARD_FACTOR);
+    return marks[shard];
+}
+
+void lba_snapshot_t::invalidate(int shard) {
+    rassert(shard >= 0 && shard < LBA_SHARD_FACTOR);
+    marks[shard].valid = 0;
+}
+
+bool lba_snapshot_t::is_valid_for_any_shard() const {
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        if (marks[i].valid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void lba_snapshot_t::prepare_metablock(lba_snapshot_metablock_t *mb_out) const {
+    memset(mb_out, 0, sizeof(*mb_out));
+    if (!extents.empty()) {
+        mb_out->first_extent_offset = extents[0].offset();
+        mb_out->extents_count = extents.size();
+        mb_out->snapshot_id = snapshot_id;
+        mb_out->num_blocks = num_blocks;
+        mb_out->num_aux_blocks = num_aux_blocks;
+        for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+            mb_out->shard_marks[i] = marks[i];
+        }
+    }
+    mb_out->checksum = compute_snapshot_metablock_checksum(mb_out);
+}
+
+void lba_snapshot_t::start_existing(const lba_snapshot_metablock_t *mb) {
+    rassert(extents.empty());
+    // Metablocks from before LBA snapshots have zeros here, which fail the checksum.
+    if (mb->first_extent_offset == 0
+        || mb->checksum.value != compute_snapshot_metablock_checksum(mb).value) {
+        return;
+    }
+    existing_first_extent_offset = mb->first_extent_offset;
+    existing_extents_count = mb->extents_count;
+    snapshot_id = mb->snapshot_id;
+    num_blocks = mb->num_blocks;
+    num_aux_blocks = mb->num_aux_blocks;
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        marks[i] = mb->shard_marks[i];
+    }
+}
+
+int64_t lba_snapshot_t::entries_per_extent() const {
+    return (em->extent_size - sizeof(lba_snapshot_extent_t))
+        / sizeof(lba_snapshot_entry_t);
+}
+
+int64_t lba_snapshot_t::entries_in_first_extent(int64_t extents_count) const {
+    const int64_t space = static_cast<int64_t>(em->extent_size)
+        - static_cast<int64_t>(sizeof(lba_snapshot_extent_t))
+        - static_cast<int64_t>(sizeof(int64_t)) * (extents_count - 1);
+    return space < 0 ? -1 : space / static_cast<int64_t>(sizeof(lba_snapshot_entry_t));
+}
+
+int64_t lba_snapshot_t::count_entries() const {
+    if (existing_first_extent_offset == 0 || !is_valid_for_any_shard()) {
+        return 0;
+    }
+    return num_blocks + num_aux_blocks;
+}
+
+void lba_snapshot_t::read(in_memory_index_t *index, int64_t *entries_applied) {
+    guarantee(coro_t::self() != nullptr);
+    rassert(extents.empty());
+    rassert(index->end_block_id() == 0);
+    if (existing_first_extent_offset == 0) {
+        return;
+    }
+    const int64_t extents_count = existing_extents_count;
+    if (extents_count < 1
+        || entries_in_first_extent(extents_count) < 0
+        || existing_first_extent_offset < 0
+        || existing_first_extent_offset % em->extent_size != 0) {
+        for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+            invalidate(i);
+        }
+        return;
+    }
+
+    // The first extent tells us where the others are.
+    extents.push_back(em->reserve_extent(existing_first_extent_offset));
+    scoped_device_block_aligned_ptr_t<char> first_buffer(em->extent_size);
+    co_read(file, existing_first_extent_offset, em->extent_size, first_buffer.get(),
+            DEFAULT_DISK_ACCOUNT);
+    em->stats->bytes_read(em->extent_size);
+
+    const lba_snapshot_extent_t *first_extent =
+        reinterpret_cast<const lba_snapshot_extent_t *>(first_buffer.get());
+    bool damaged = first_extent->extent_offsets_count != extents_count - 1
+        || !check_extent(first_extent, 0);
+    if (!damaged) {
+        const int64_t *extent_offsets = reinterpret_cast<const int64_t *>(
+            first_buffer.get() + sizeof(lba_snapshot_extent_t));
+        for (int64_t i = 0; i < extents_count - 1; ++i) {
+            if (extent_offsets[i] <= 0 || extent_offsets[i] % em->extent_size != 0) {
+                damaged = true;
+                break;
+            }
+        }
+        // The metablock keeps referring to the extents even if we don't use the
+        // snapshot, so we have to reserve them either way.
+        if (!damaged) {
+            for (int64_t i = 0; i < extents_count - 1; ++i) {
+                extents.push_back(em->reserve_extent(extent_offsets[i]));
+            }
+        }
+    }
+    if (damaged || !is_valid_for_any_shard()) {
+        for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+            invalidate(i);
+        }
+        return;
+    }
+
+    apply_extent(first_extent, index);
+    *entries_applied += first_extent->entries_count;
+    int64_t entries_count = first_extent->entries_count;
+    first_buffer.reset();
+
+    // Keep up to `max_in_flight` extents in flight and apply each one as soon as it
+    // comes in, rather than waiting for a whole batch. Unlike the LBA extents, the
+    // snapshot's extents can be applied in any order. The LBA can be read at the same
+    // time, so we only get one half of the read buffer space.
+    const int64_t max_in_flight =
+        std::max<int64_t>(LBA_READ_BUFFER_SIZE / 2 / em->extent_size, 1);
+    struct extent_read_t : public iocallback_t {
+        void on_io_complete() {
+            completed->push_back(this);
+            if (*on_completed != nullptr) {
+                (*on_completed)->pulse_if_not_already_pulsed();
+            }
+        }
+        int64_t index;
+        scoped_device_block_aligned_ptr_t<char> buffer;
+        std::vector<extent_read_t *> *completed;
+        cond_t **on_completed;
+    };
+    std::vector<extent_read_t> reads(extents_count);
+    std::vector<extent_read_t *> completed;
+    cond_t *on_completed = nullptr;
+    int64_t next_to_read = 1;
+    int64_t in_flight = 0;
+    while (in_flight > 0 || (next_to_read < extents_count && !damaged)) {
+        while (in_flight < max_in_flight && next_to_read < extents_count && !damaged) {
+            extent_read_t *read = &reads[next_to_read];
+            read->index = next_to_read;
+            read->buffer = scoped_device_block_aligned_ptr_t<char>(em->extent_size);
+            read->completed = &completed;
+            read->on_completed = &on_completed;
+            file->read_async(extents[next_to_read].offset(), em->extent_size,
+                             read->buffer.get(), DEFAULT_DISK_ACCOUNT, read);
+            em->stats->bytes_read(em->extent_size);
+            ++next_to_read;
+            ++in_flight;
+        }
+
+        if (completed.empty()) {
+            cond_t cond;
+            on_completed = &cond;
+            cond.wait();
+            on_completed = nullptr;
+        }
+
+        extent_read_t *read = completed.back();
+        completed.pop_back();
+        --in_flight;
+        if (!damaged) {
+            const lba_snapshot_extent_t *extent =
+                reinterpret_cast<const lba_snapshot_extent_t *>(read->buffer.get());
+            const int64_t first_entry = entries_in_first_extent(extents_count)
+                + (read->index - 1) * entries_per_extent();
+            if (extent->extent_offsets_count != 0
+                || !check_extent(extent, first_entry)) {
+                // We still have to wait for the reads that are in flight before we
+                // can give up.
+                damaged = true;
+            } else {
+                apply_extent(extent, index);
+                *entries_applied += extent->entries_count;
+                entries_count += extent->entries_count;
+            }
+        }
+        read->buffer.reset();
+        coro_t::yield();
+    }
+
+    if (damaged) {
+        // Some of the snapshot is already in the index, so we have to throw it out and
+        // replay the whole LBA after all.
+        index->clear();
+        for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+            invalidate(i);
+        }
+        return;
+    }
+
+    if (entries_count != static_cast<int64_t>(num_blocks + num_aux_blocks)) {
+        index->clear();
+        for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+            invalidate(i);
+        }
+    }
+}
+
+bool lba_snapshot_t::check_extent(const lba_snapshot_extent_t *extent,
+                                  int64_t first_entry) const {
+    const int64_t num_entries = num_blocks + num_aux_blocks;
+    const int64_t capacity = extent->extent_offsets_count == 0
+        ? entries_per_extent()
+        : entries_in_first_extent(extent->extent_offsets_count + 1);
+    if (memcmp(extent->magic, lba_snapshot_magic, LBA_SNAPSHOT_MAGIC_SIZE) != 0
+        || extent->snapshot_id != snapshot_id
+        || extent->first_entry != first_entry
+        || extent->entries_count < 0
+        || extent->entries_count > capacity
+        || extent->entries_count > num_entries - first_entry) {
+        return false;
+    }
+
+    const size_t size = sizeof(lba_snapshot_extent_t)
+        + sizeof(int64_t) * extent->extent_offsets_count
+        + sizeof(lba_snapshot_entry_t) * extent->entries_count;
+    CT_ASSERT(sizeof(lba_snapshot_extent_t) % serializer_checksum::word_size == 0);
+    CT_ASSERT(sizeof(lba_snapshot_entry_t) % serializer_checksum::word_size == 0);
+    lba_snapshot_extent_t header = *extent;
+    header.checksum = serializer_checksum{0};
+    serializer_checksum checksum = compute_checksum_concat(
+        compute_checksum(&header, sizeof(header) / serializer_checksum::word_size),
+        compute_checksum(extent + 1,
+                         (size - sizeof(header)) / serializer_checksum::word_size),
+        (size - sizeof(header)) / serializer_checksum::word_size);
+    return checksum.value == extent->checksum.value;
+}
+
+void lba_snapshot_t::apply_extent(const lba_snapshot_extent_t *extent,
+                                  in_memory_index_t *index) const {
+    const lba_snapshot_entry_t *entries = reinterpret_cast<const lba_snapshot_entry_t *>(
+        reinterpret_cast<const char *>(extent + 1)
+        + sizeof(int64_t) * extent->extent_offsets_count);
+    for (int64_t i = 0; i < extent->entries_count; ++i) {
+        const int64_t position = extent->first_entry + i;
+        const bool is_aux = position >= static_cast<int64_t>(num_blocks);
+        const block_id_t block_id = is_aux
+            ? FIRST_AUX_BLOCK_ID + (position - num_blocks)
+            : position;
+        if (!marks[block_id % LBA_SHARD_FACTOR].valid) {
+            continue;
+        }
+        const lba_snapshot_entry_t &e = entries[i];
+        const index_block_info_t info(e.offset,
+                                      is_aux ? repli_timestamp_t::invalid : e.recency,
+                                      e.ser_block_size,
+                                      e.ser_disk_size);
+        if (!(info == index_block_info_t())) {
+            index->set_block_info(block_id, info.recency, info.offset,
+                                  info.ser_block_size, info.ser_disk_size);
+        }
+    }
+}
+
+bool lba_snapshot_t::write(int64_t id,
+                           in_memory_index_t *index,
+                           const lba_snapshot_shard_mark_t _marks[LBA_SHARD_FACTOR],
+                           file_account_t *io_account,
+                           const signal_t *abort_signal) {
+    guarantee(coro_t::self() != nullptr);
+    rassert(extents.empty());
+    rassert(id > 0);
+    snapshot_id = id;
+
+    // Nothing may change between taking the marks and reading the end block ids.
+    num_blocks = index->end_block_id();
+    num_aux_blocks = make_aux_block_id_relative(index->end_aux_block_id());
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        marks[i] = _marks[i];
+    }
+
+    const int64_t num_entries = num_blocks + num_aux_blocks;
+    int64_t extents_count = 1;
+    while (entries_in_first_extent(extents_count)
+           + (extents_count - 1) * entries_per_extent() < num_entries) {
+        ++extents_count;
+        guarantee(entries_in_first_extent(extents_count) >= 0,
+                  "The LBA is too large to be snapshotted.");
+    }
+    for (int64_t i = 0; i < extents_count; ++i) {
+        extents.push_back(em->gen_extent());
+    }
+
+    scoped_device_block_aligned_ptr_t<char> buffer(em->extent_size);
+    int64_t next_entry = 0;
+    for (int64_t i = 0; i < extents_count; ++i) {
+        memset(buffer.get(), 0, em->extent_size);
+        lba_snapshot_extent_t *extent =
+            reinterpret_cast<lba_snapshot_extent_t *>(buffer.get());
+        memcpy(extent->magic, lba_snapshot_magic, LBA_SNAPSHOT_MAGIC_SIZE);
+        extent->snapshot_id = snapshot_id;
+        extent->first_entry = next_entry;
+        extent->entries_count = std::min(
+            i == 0 ? entries_in_first_extent(extents_count) : entries_per_extent(),
+            num_entries - next_entry);
+        extent->extent_offsets_count = i == 0 ? extents_count - 1 : 0;
+
+        int64_t *extent_offsets = reinterpret_cast<int64_t *>(extent + 1);
+        for (int64_t j = 0; j < extent->extent_offsets_count; ++j) {
+            extent_offsets[j] = extents[j + 1].offset();
+        }
+        lba_snapshot_entry_t *entries = reinterpret_cast<lba_snapshot_entry_t *>(
+            extent_offsets + extent->extent_offsets_count);
+        for (int64_t j = 0; j < extent->entries_count; ++j) {
+            const int64_t position = next_entry + j;
+            const block_id_t block_id = position < static_cast<int64_t>(num_blocks)
+                ? position
+                : FIRST_AUX_BLOCK_ID + (position - num_blocks);
+            const index_block_info_t info = index->get_block_info(block_id);
+            entries[j].offset = info.offset;
+            entries[j].recency = info.recency;
+            entries[j].ser_block_size = info.ser_block_size;
+            entries[j].ser_disk_size = info.ser_disk_size;
+            if ((j + 1) % LBA_GC_BATCH_SIZE == 0) {
+                coro_t::yield();
+            }
+        }
+        next_entry += extent->entries_count;
+
+        const size_t size = sizeof(lba_snapshot_extent_t)
+            + sizeof(int64_t) * extent->extent_offsets_count
+            + sizeof(lba_snapshot_entry_t) * extent->entries_count;
+        extent->checksum = compute_checksum(buffer.get(),
+                                            size / serializer_checksum::word_size);
+
+        // The writes are done one after the other, so a datasync after the last one
+        // makes sure that all of the snapshot is on disk before a metablock can refer
+        // to it.
+        const size_t write_size = ceil_aligned(size, DEVICE_BLOCK_SIZE);
+        co_write(file, extents[i].offset(), write_size, buffer.get(), io_account,
+                 i == extents_count - 1
+                     ? datasync_op::datasync_after
+                     : datasync_op::no_datasyncs);
+        em->stats->bytes_written(write_size);
+
+        if (abort_signal->is_pulsed()) {
+            // No metablock refers to these extents yet, so they can go right away.
+            for (auto &extent_ref : extents) {
+                em->release_extent(std::move(extent_ref));
+            }
+            extents.clear();
+            for (int j = 0; j < LBA_SHARD_FACTOR; ++j) {
+                invalidate(j);
+            }
+            return false;
+        }
+    }
+    guarantee(next_entry == num_entries);
+    return true;
+}
+
+void lba_snapshot_t::destroy(extent_transaction_t *txn) {
+    for (auto &extent_ref : extents) {
+        em->release_extent_into_transaction(std::move(extent_ref), txn);
+    }
+    extents.clear();
+}
+
+void lba_snapshot_t::shutdown() {
+    for (auto &extent_ref : extents) {
+        UNUSED int64_t extent = extent_ref.release();
+    }
+    extents.clear();
+}
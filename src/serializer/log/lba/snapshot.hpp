@@ -0,0 +1,100 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_LOG_LBA_SNAPSHOT_HPP_
+#define SERIALIZER_LOG_LBA_SNAPSHOT_HPP_
+
+#include <vector>
+
+#include "arch/types.hpp"
+#include "serializer/log/extent_manager.hpp"
+#include "serializer/log/lba/disk_format.hpp"
+#include "serializer/log/lba/in_memory_index.hpp"
+
+class signal_t;
+
+/* An `lba_snapshot_t` is a copy of the in-memory index that is written to extents of its
+own (see `lba_snapshot_extent_t` for the format). Before it starts copying the index,
+`lba_list_t` records the position of the log of each LBA shard. The snapshot might be a
+bit fuzzy because the index keeps changing while it's being copied, but every change
+after those positions is still in the log. So at startup, we can load the snapshot and
+only replay the entries after the positions, rather than the whole LBA. */
+class lba_snapshot_t {
+public:
+    // Creates a snapshot that doesn't have any extents and isn't valid for any shard.
+    lba_snapshot_t(extent_manager_t *em, file_t *file);
+    ~lba_snapshot_t();
+
+    // Zero if there is no snapshot yet.
+    int64_t get_id() const { return snapshot_id; }
+    const lba_snapshot_shard_mark_t &get_mark(int shard) const;
+    // Called when the snapshot can't be used for `shard` anymore.
+    void invalidate(int shard);
+    bool is_valid_for_any_shard() const;
+
+    void prepare_metablock(lba_snapshot_metablock_t *mb_out) const;
+
+    // Picks up the snapshot that the metablock refers to, if there is one. Afterwards,
+    // the marks can be checked (and invalidated) before calling `read()`.
+    void start_existing(const lba_snapshot_metablock_t *mb);
+
+    // How many entries `read()` would go through.
+    int64_t count_entries() const;
+
+    // Reserves the extents of the snapshot and applies its entries for the shards that
+    // it is valid for to `index`, which has to be empty. If the snapshot turns out to be
+    // damaged, `index` is left empty and the snapshot is invalidated for every shard.
+    // Adds the number of applied entries to `*entries_applied` as it goes along.
+    // Must be called in a coroutine, before `extent_manager_t::start_existing()`.
+    void read(in_memory_index_t *index, int64_t *entries_applied);
+
+    // Writes a snapshot of `index` to new extents and datasyncs them, so that a
+    // metablock can refer to them as soon as this returns. `id` has to be higher than
+    // that of the previous snapshot. `marks` are the current positions of the shards'
+    // logs; they have to be taken right before calling `write()`, which doesn't block
+    // before it has read the end block ids of `index`. Releases the extents again and
+    // returns false if `abort_signal` gets pulsed in the meantime. Must be called in a
+    // coroutine.
+    bool write(int64_t id,
+               in_memory_index_t *index,
+               const lba_snapshot_shard_mark_t marks[LBA_SHARD_FACTOR],
+               file_account_t *io_account,
+               const signal_t *abort_signal);
+
+    // Releases the extents of the snapshot into `txn`.
+    void destroy(extent_transaction_t *txn);
+    // Forgets about the extents of the snapshot without releasing them.
+    void shutdown();
+
+private:
+    // How many entries fit into an extent, and into the first extent if the snapshot has
+    // `extents_count` extents in total.
+    int64_t entries_per_extent() const;
+    int64_t entries_in_first_extent(int64_t extents_count) const;
+
+    // Checks the header and the checksum of an extent that has been read from disk,
+    // including that it belongs to this snapshot. `first_entry` is the position that
+    // its entries should start at.
+    bool check_extent(const lba_snapshot_extent_t *extent, int64_t first_entry) const;
+    // Applies the entries of a checked extent to `index`, except for those of shards
+    // that the snapshot isn't valid for.
+    void apply_extent(const lba_snapshot_extent_t *extent,
+                      in_memory_index_t *index) const;
+
+    extent_manager_t *const em;
+    file_t *const file;
+
+    int64_t snapshot_id;
+    block_id_t num_blocks;
+    block_id_t num_aux_blocks;
+    lba_snapshot_shard_mark_t marks[LBA_SHARD_FACTOR];
+
+    // The offset of the first extent as stored in the metablock, between
+    // `start_existing()` and `read()`.
+    int64_t existing_first_extent_offset;
+    int64_t existing_extents_count;
+
+    std::vector<extent_reference_t> extents;
+
+    DISABLE_COPYING(lba_snapshot_t);
+};
+
+#endif  // SERIALIZER_LOG_LBA_SNAPSHOT_HPP_
@@ -123,6 +123,8 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_block_writes(),
       pm_serializer_index_writes(secs_to_ticks(1)),
       pm_serializer_index_writes_size(secs_to_ticks(1), false),
+      pm_serializer_read_latency(secs_to_ticks(10)),
+      pm_serializer_write_latency(secs_to_ticks(10)),
       pm_serializer_read_bytes_per_sec(secs_to_ticks(1)),
       pm_serializer_read_bytes_total(),
       pm_serializer_written_bytes_per_sec(secs_to_ticks(1)),
@@ -136,6 +138,11 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_old_garbage_block_bytes(),
       pm_serializer_old_total_block_bytes(),
       pm_serializer_lba_gcs(),
+      pm_serializer_lba_snapshots(),
+      pm_serializer_compression_input_bytes(),
+      pm_serializer_compression_output_bytes(),
+      pm_serializer_compression_ratio(secs_to_ticks(1), false),
+      pm_serializer_block_decompressions(),
       parent_collection_membership(parent, &serializer_collection, "serializer"),
       stats_membership(&serializer_collection,
           &pm_serializer_block_reads, "serializer_block_reads",
@@ -143,6 +150,8 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_block_writes, "serializer_block_writes",
           &pm_serializer_index_writes, "serializer_index_writes",
           &pm_serializer_index_writes_size, "serializer_index_writes_size",
+          &pm_serializer_read_latency, "serializer_read_latency_ms",
+          &pm_serializer_write_latency, "serializer_write_latency_ms",
           &pm_serializer_read_bytes_per_sec, "serializer_read_bytes_per_sec",
           &pm_serializer_read_bytes_total, "serializer_read_bytes_total",
           &pm_serializer_written_bytes_per_sec, "serializer_written_bytes_per_sec",
@@ -155,7 +164,12 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_data_extents_gced, "serializer_data_extents_gced",
           &pm_serializer_old_garbage_block_bytes, "serializer_old_garbage_block_bytes",
           &pm_serializer_old_total_block_bytes, "serializer_old_total_block_bytes",
-          &pm_serializer_lba_gcs, "serializer_lba_gcs")
+          &pm_serializer_lba_gcs, "serializer_lba_gcs",
+          &pm_serializer_lba_snapshots, "serializer_lba_snapshots",
+          &pm_serializer_compression_input_bytes, "serializer_compression_input_bytes",
+          &pm_serializer_compression_output_bytes, "serializer_compression_output_bytes",
+          &pm_serializer_compression_ratio, "serializer_compression_ratio",
+          &pm_serializer_block_decompressions, "serializer_block_decompressions")
 { }
 
 void log_serializer_stats_t::bytes_read(size_t count) {
@@ -168,6 +182,13 @@ void log_serializer_stats_t::bytes_written(size_t count) {
     pm_serializer_written_bytes_total += count;
 }
 
+void log_serializer_stats_t::block_compressed(size_t input_bytes, size_t output_bytes) {
+    pm_serializer_compression_input_bytes += input_bytes;
+    pm_serializer_compression_output_bytes += output_bytes;
+    pm_serializer_compression_ratio.record(
+        static_cast<double>(output_bytes) / static_cast<double>(input_bytes));
+}
+
 void log_serializer_t::create(serializer_file_opener_t *file_opener,
                               static_config_t static_config) {
     log_serializer_on_disk_static_config_t *on_disk_config = &static_config;
@@ -200,8 +221,10 @@ struct ls_start_existing_fsm_t :
     public lba_list_t::ready_callback_t,
     public thread_message_t
 {
-    explicit ls_start_existing_fsm_t(log_serializer_t *serializer)
-        : ser(serializer), start_existing_state(state_start) {
+    ls_start_existing_fsm_t(log_serializer_t *serializer,
+                            log_serializer_startup_progress_t *_progress)
+        : ser(serializer), start_existing_state(state_start),
+          progress(_progress != nullptr ? _progress : &own_progress) {
     }
 
     ~ls_start_existing_fsm_t() {
@@ -259,6 +282,7 @@ struct ls_start_existing_fsm_t :
 
             ser->metablock_manager = new metablock_manager_t(ser->extent_manager);
             ser->lba_index = new lba_list_t(ser->extent_manager,
+                    ser->dynamic_config.lba_snapshot_threshold,
                     std::bind(&log_serializer_t::write_metablock_sans_pipelining,
                               ser, ph::_1, ph::_2));
             ser->data_block_manager
@@ -266,7 +290,9 @@ struct ls_start_existing_fsm_t :
                                            &ser->static_config, ser->stats.get());
 
             // STATE E
-            if (ser->metablock_manager->start_existing(ser->dbfile, &metablock_found, &metablock_buffer, this)) {
+            if (ser->metablock_manager->start_existing(ser->dbfile, &metablock_found,
+                                                       &metablock_buffer,
+                                                       &lba_snapshot_buffer, this)) {
                 crash("metablock_manager_t::start_existing always returns false");
                 // start_existing_state = state_start_lba;
             } else {
@@ -280,12 +306,23 @@ struct ls_start_existing_fsm_t :
             // STATE G
             guarantee(metablock_found, "Could not find any valid metablock.");
 
+            // The LBA is read shard by shard, and we reconstruct the data block manager's
+            // view of each shard's blocks as soon as the shard is ready, while the other
+            // shards are still being read.
+            ser->data_block_manager->start_reconstruct();
+            for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+                shard_ready[i] = false;
+                next_block_to_reconstruct[i] = i;
+            }
+            lba_ready = false;
+
             // STATE H
             if (ser->lba_index->start_existing(ser->dbfile,
                                                &metablock_buffer.lba_index_part,
+                                               &lba_snapshot_buffer,
+                                               progress,
                                                this)) {
-                start_existing_state = state_reconstruct;
-                // STATE J
+                crash("lba_list_t::start_existing always returns false");
             } else {
                 // STATE H
                 start_existing_state = state_waiting_for_lba;
@@ -294,40 +331,45 @@ struct ls_start_existing_fsm_t :
             }
         }
 
-        if (start_existing_state == state_reconstruct) {
-            ser->data_block_manager->start_reconstruct();
-            start_existing_state = state_reconstruct_ongoing;
-            next_block_to_reconstruct = 0;
-            // Fall through into state_reconstruct_ongoing
-        }
-
         if (start_existing_state == state_reconstruct_ongoing) {
             int batch = 0;
-            while (true) {
-                // Once we are done with the normal blocks, switch over to the aux
-                // blocks.
-                if (!is_aux_block_id(next_block_to_reconstruct)
-                    && next_block_to_reconstruct >= ser->lba_index->end_block_id()) {
-                    next_block_to_reconstruct = FIRST_AUX_BLOCK_ID;
-                }
-                if (next_block_to_reconstruct >= ser->lba_index->end_aux_block_id()) {
-                    break;
+            for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+                if (!shard_ready[i]) {
+                    continue;
                 }
+                while (true) {
+                    block_id_t *next = &next_block_to_reconstruct[i];
+                    // Once we are done with the normal blocks, switch over to the aux
+                    // blocks.
+                    if (!is_aux_block_id(*next) && *next >= shard_end_block_id[i]) {
+                        *next = i + FIRST_AUX_BLOCK_ID;
+                    }
+                    if (*next >= shard_end_aux_block_id[i]) {
+                        break;
+                    }
 
-                flagged_off64_t offset =
-                    ser->lba_index->get_block_offset(next_block_to_reconstruct);
-                if (offset.has_value()) {
-                    ser->data_block_manager->mark_live(offset.get_value(),
-                        ser->lba_index->get_block_size(next_block_to_reconstruct));
-                }
+                    flagged_off64_t offset = ser->lba_index->get_block_offset(*next);
+                    if (offset.has_value()) {
+                        ser->data_block_manager->mark_live(offset.get_value(),
+                            ser->lba_index->get_disk_block_size(*next),
+                            ser->lba_index->get_block_size(*next));
+                    }
 
-                ++next_block_to_reconstruct;
-                ++batch;
-                if (batch >= LBA_RECONSTRUCTION_BATCH_SIZE) {
-                    call_later_on_this_thread(this);
-                    return false;
+                    *next += LBA_SHARD_FACTOR;
+                    ++batch;
+                    if (batch >= LBA_RECONSTRUCTION_BATCH_SIZE) {
+                        call_later_on_this_thread(this);
+                        return false;
+                    }
                 }
             }
+
+            if (!lba_ready) {
+                // Wait for the next shard.
+                start_existing_state = state_waiting_for_lba;
+                return false;
+            }
+
             ser->data_block_manager->end_reconstruct();
             ser->data_block_manager->start_existing(
                     ser->dbfile, &metablock_buffer.data_block_manager_part);
@@ -342,6 +384,7 @@ struct ls_start_existing_fsm_t :
             rassert(ser->state == log_serializer_t::state_starting_up);
             ser->state = log_serializer_t::state_ready;
 
+            progress->is_ready = true;
             if (to_signal_when_done) to_signal_when_done->pulse();
 
             delete this;
@@ -367,10 +410,28 @@ struct ls_start_existing_fsm_t :
         next_starting_up_step();
     }
 
+    void on_lba_shard_ready(int shard) {
+        rassert(!shard_ready[shard]);
+        shard_ready[shard] = true;
+        // The shard's blocks can't go beyond the current end block ids. Other shards
+        // might still move them further.
+        shard_end_block_id[shard] = ser->lba_index->end_block_id();
+        shard_end_aux_block_id[shard] = ser->lba_index->end_aux_block_id();
+        continue_reconstruct();
+    }
+
     void on_lba_ready() {
-        rassert(start_existing_state == state_waiting_for_lba);
-        start_existing_state = state_reconstruct;
-        next_starting_up_step();
+        lba_ready = true;
+        continue_reconstruct();
+    }
+
+    void continue_reconstruct() {
+        // If we are in state_reconstruct_ongoing, we are already going to get to the new
+        // shard.
+        if (start_existing_state == state_waiting_for_lba) {
+            start_existing_state = state_reconstruct_ongoing;
+            next_starting_up_step();
+        }
     }
 
     void on_thread_switch() {
@@ -390,18 +451,28 @@ struct ls_start_existing_fsm_t :
         state_waiting_for_metablock,
         state_start_lba,
         state_waiting_for_lba,
-        state_reconstruct,
         state_reconstruct_ongoing,
         state_finish,
         state_done
     } start_existing_state;
 
-    // When in state_reconstruct_ongoing, we keep track of how many blocks we
-    // already have reconstructed.
-    block_id_t next_block_to_reconstruct;
+    // Used if nobody is interested in the progress
+    log_serializer_startup_progress_t own_progress;
+    log_serializer_startup_progress_t *progress;
+
+    // Which LBA shards are ready, and the end block ids at the time they got ready
+    bool shard_ready[LBA_SHARD_FACTOR];
+    block_id_t shard_end_block_id[LBA_SHARD_FACTOR];
+    block_id_t shard_end_aux_block_id[LBA_SHARD_FACTOR];
+    bool lba_ready;
+
+    // When in state_reconstruct_ongoing, we keep track of how many blocks of each
+    // shard we already have reconstructed.
+    block_id_t next_block_to_reconstruct[LBA_SHARD_FACTOR];
 
     bool metablock_found;
     log_serializer_metablock_t metablock_buffer;
+    lba_snapshot_metablock_t lba_snapshot_buffer;
 
 private:
     DISABLE_COPYING(ls_start_existing_fsm_t);
@@ -409,7 +480,8 @@ private:
 
 log_serializer_t::log_serializer_t(dynamic_config_t _dynamic_config,
                                    serializer_file_opener_t *file_opener,
-                                   perfmon_collection_t *_perfmon_collection)
+                                   perfmon_collection_t *_perfmon_collection,
+                                   log_serializer_startup_progress_t *startup_progress)
     : stats(new log_serializer_stats_t(_perfmon_collection)),  // can block in a perfmon_collection_t::add call.
       disk_stats_collection(),
       disk_stats_membership(_perfmon_collection, &disk_stats_collection, "disk"),  // can block in a perfmon_collection_t::add call.
@@ -429,7 +501,7 @@ log_serializer_t::log_serializer_t(dynamic_config_t _dynamic_config,
       active_write_count(0) {
     // STATE A
     /* This is because the serializer is not completely converted to coroutines yet. */
-    ls_start_existing_fsm_t *s = new ls_start_existing_fsm_t(this);
+    ls_start_existing_fsm_t *s = new ls_start_existing_fsm_t(this, startup_progress);
     cond_t cond;
     if (!s->run(&cond, file_opener)) cond.wait();
 }
@@ -461,10 +533,12 @@ buf_ptr_t log_serializer_t::block_read(const counted_t<block_token_t> &token,
 
     ticks_t pm_time;
     stats->pm_serializer_block_reads.begin(&pm_time);
+    const ticks_t start_time = get_ticks();
 
     buf_ptr_t ret = data_block_manager->read(token->offset_, token->block_size(),
-                                             io_account);
+                                             token->disk_block_size(), io_account);
 
+    stats->pm_serializer_read_latency.record_since(start_time);
     stats->pm_serializer_block_reads.end(&pm_time);
     return ret;
 }
@@ -476,6 +550,9 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
     ticks_t pm_time;
     stats->pm_serializer_index_writes.begin(&pm_time);
     stats->pm_serializer_index_writes_size.record(write_ops.size());
+    // Index writes are what transactions wait on to become durable, so this is the
+    // write latency that matters.
+    const ticks_t start_time = get_ticks();
 
     extent_transaction_t txn;
     index_write_prepare(&txn);
@@ -495,8 +572,10 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
              write_op_it != write_ops.end();
              ++write_op_it) {
             const index_write_op_t &op = *write_op_it;
-            flagged_off64_t offset = lba_index->get_block_offset(op.block_id);
-            uint16_t ser_block_size = lba_index->get_ser_block_size(op.block_id);
+            const index_block_info_t old_info = lba_index->get_block_info(op.block_id);
+            flagged_off64_t offset = old_info.offset;
+            uint16_t ser_block_size = old_info.ser_block_size;
+            uint16_t ser_disk_size = old_info.ser_disk_size;
 
             if (op.token) {
                 // Update the offset pointed to, and mark garbage/liveness as necessary.
@@ -511,6 +590,7 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
                 if (token.has()) {
                     offset = flagged_off64_t::make(token->offset_);
                     ser_block_size = token->block_size().ser_value();
+                    ser_disk_size = token->disk_block_size().ser_value();
 
                     if (checksums) {
                         serializer_checksum checksum = token->checksum_;
@@ -522,7 +602,7 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
                             checksums->push_back(
                                 checksum_filerange{
                                     token->offset_,
-                                    ceil_aligned<int64_t>(ser_block_size,
+                                    ceil_aligned<int64_t>(ser_disk_size,
                                                           DEVICE_BLOCK_SIZE),
                                     checksum});
                         }
@@ -530,10 +610,12 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
 
                     /* mark the life */
                     data_block_manager->mark_live(offset.get_value(),
+                                                  token->disk_block_size(),
                                                   token->block_size());
                 } else {
                     offset = flagged_off64_t::unused();
                     ser_block_size = 0;
+                    ser_disk_size = 0;
                 }
             }
 
@@ -541,7 +623,7 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
                 : lba_index->get_block_recency(op.block_id);
 
             lba_index->set_block_info(op.block_id, recency,
-                                      offset, ser_block_size,
+                                      offset, ser_block_size, ser_disk_size,
                                       index_writes_io_account.get(), &txn,
                                       &checksums);
         }
@@ -553,7 +635,10 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
     // Before we fully commit the write to disk, we must migrate the static header
     // if necessary.
     // Note that this is early enough for upgrading from the 1.13 serializer
-    // version to 2.2, since only the format of the LBA changed.
+    // version to 2.2, since only the format of the LBA changed.  It's also early
+    // enough for upgrading from 2.2 to 2.5, since blocks in the new leaf node
+    // format only become reachable through this index write, and for upgrading to
+    // 2.6, since the same holds for compressed blocks.
     // Future serializer format changes might require this step to happen earlier.
     {
         new_mutex_acq_t acq(&static_header_migration_mutex);
@@ -566,6 +651,7 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
     index_write_finish(mutex_acq, &txn, index_writes_io_account.get(),
                        std::move(checksums));
 
+    stats->pm_serializer_write_latency.record_since(start_time);
     stats->pm_serializer_index_writes.end(&pm_time);
 }
 
@@ -575,6 +661,7 @@ void log_serializer_t::index_write_prepare(extent_transaction_t *txn) {
 
     /* Just to make sure that the LBA GC gets exercised */
     lba_index->consider_gc();
+    lba_index->consider_snapshot();
 
     /* Start an extent manager transaction so we can allocate and release extents */
     extent_manager->begin_transaction(txn);
@@ -634,6 +721,7 @@ void log_serializer_t::write_metablock(
     correct metablock information for this write even if another write starts before we
     finish waiting on `safe_to_write_cond`. */
     prepare_metablock(&crc_mb->metablock);
+    lba_index->prepare_snapshot_metablock(&crc_mb->lba_snapshot);
 
     /* Get in line for the metablock manager */
     bool waiting_for_prev_write = !metablock_waiter_queue.empty();
@@ -678,9 +766,11 @@ void log_serializer_t::write_metablock_sans_pipelining(
 }
 
 counted_t<block_token_t>
-log_serializer_t::generate_block_token(int64_t offset, block_size_t block_size) {
+log_serializer_t::generate_block_token(int64_t offset, block_size_t block_size,
+                                       block_size_t disk_block_size) {
     assert_thread();
-    counted_t<block_token_t> token(new block_token_t(this, offset, block_size));
+    counted_t<block_token_t> token(new block_token_t(this, offset, block_size,
+                                                     disk_block_size));
 
     auto location = offset_tokens.find(offset);
     if (location == offset_tokens.end()) {
@@ -821,7 +911,8 @@ counted_t<block_token_t> log_serializer_t::index_read(block_id_t block_id) {
     index_block_info_t info = lba_index->get_block_info(block_id);
     if (info.offset.has_value()) {
         return generate_block_token(info.offset.get_value(),
-                                    block_size_t::unsafe_make(info.ser_block_size));
+                                    block_size_t::unsafe_make(info.ser_block_size),
+                                    block_size_t::unsafe_make(info.ser_disk_size));
     } else {
         return counted_t<block_token_t>();
     }
@@ -1016,9 +1107,11 @@ bool log_serializer_t::should_perform_read_ahead() {
 
 block_token_t::block_token_t(log_serializer_t *serializer,
                              int64_t initial_offset,
-                             block_size_t initial_block_size)
+                             block_size_t initial_block_size,
+                             block_size_t initial_disk_block_size)
     : serializer_(serializer), ref_count_(0),
       block_size_(initial_block_size),
+      disk_block_size_(initial_disk_block_size),
       checksum_(no_checksum()),
       offset_(initial_offset) {
     serializer_->assert_thread();
@@ -1034,8 +1127,10 @@ void block_token_t::do_destroy() {
 void debug_print(printf_buffer_t *buf,
                  const counted_t<block_token_t> &token) {
     if (token.has()) {
-        buf->appendf("standard_block_token{%" PRIi64 ", +%" PRIu16 "}",
-                     token->offset(), token->block_size().ser_value());
+        buf->appendf("standard_block_token{%" PRIi64 ", +%" PRIu16 " (%" PRIu16
+                     " on disk)}",
+                     token->offset(), token->block_size().ser_value(),
+                     token->disk_block_size().ser_value());
     } else {
         buf->appendf("nil");
     }
@@ -22,6 +22,7 @@
 #include "serializer/log/metablock_manager.hpp"
 #include "serializer/log/extent_manager.hpp"
 #include "serializer/log/lba/lba_list.hpp"
+#include "serializer/log/startup_progress.hpp"
 #include "serializer/log/stats.hpp"
 #include "serializer/log/types.hpp"
 
@@ -115,10 +116,12 @@ public:
     static void create(serializer_file_opener_t *file_opener,
                        static_config_t static_config);
 
-    /* Blocks. */
+    /* Blocks. `startup_progress` (if not null) is kept up to date while the serializer
+    starts up, see `log_serializer_startup_progress_t`. */
     log_serializer_t(dynamic_config_t dynamic_config,
                      serializer_file_opener_t *file_opener,
-                     perfmon_collection_t *perfmon_collection);
+                     perfmon_collection_t *perfmon_collection,
+                     log_serializer_startup_progress_t *startup_progress = nullptr);
 
     /* Blocks. */
     virtual ~log_serializer_t();
@@ -159,7 +162,8 @@ private:
     void unregister_block_token(block_token_t *token);
     void remap_block_to_new_offset(int64_t current_offset, int64_t new_offset);
     counted_t<block_token_t> generate_block_token(int64_t offset,
-                                                             block_size_t block_size);
+                                                  block_size_t block_size,
+                                                  block_size_t disk_block_size);
 
     void offer_buf_to_read_ahead_callbacks(
             block_id_t block_id,
@@ -127,10 +127,16 @@ ATTR_PACKED(struct crc_metablock_t {
     log_serializer_metablock_t metablock;
 
     // Pre-v2_5 version, this field did not exist.  The space was filled with zeros.
-    // Offset: 3760, size: 192.
+    // Offset: 3760, size: 136.
     metablock_fileranges_checksum_t fileranges_checksum_v2_5;
 
-    // Total size: 3952 bytes.
+    // Before LBA snapshots, this field did not exist.  The space was filled with zeros,
+    // which means that there is no snapshot.  It is not covered by _crc, but has a
+    // checksum of its own.
+    // Offset: 3896, size: 112.
+    lba_snapshot_metablock_t lba_snapshot;
+
+    // Total size: 4008 bytes.
 });
 
 
@@ -315,7 +315,8 @@ bool metablock_manager_t::verify_checksum_fileranges(const crc_metablock_t *mb)
 }
 
 void metablock_manager_t::co_start_existing(file_t *file, bool *mb_found_out,
-                                            log_serializer_metablock_t *mb_out) {
+                                            log_serializer_metablock_t *mb_out,
+                                            lba_snapshot_metablock_t *lba_snapshot_out) {
     rassert(state == state_unstarted);
     dbfile = file;
     rassert(dbfile != nullptr);
@@ -383,6 +384,8 @@ void metablock_manager_t::co_start_existing(file_t *file, bool *mb_found_out,
             next_mb_slot = metablock_offsets::next(extent_size, index);
             *mb_found_out = true;
             memcpy(mb_out, &latest_crc_mb->metablock, sizeof(log_serializer_metablock_t));
+            memcpy(lba_snapshot_out, &latest_crc_mb->lba_snapshot,
+                   sizeof(lba_snapshot_metablock_t));
         } else {
             if (indices_by_version.size() == 1) {
                 /* no metablock found anywhere -- the DB is toast */
@@ -402,6 +405,8 @@ void metablock_manager_t::co_start_existing(file_t *file, bool *mb_found_out,
                 next_mb_slot = metablock_offsets::next(extent_size, index);
                 *mb_found_out = true;
                 memcpy(mb_out, &latest_crc_mb->metablock, sizeof(log_serializer_metablock_t));
+                memcpy(lba_snapshot_out, &latest_crc_mb->lba_snapshot,
+                       sizeof(lba_snapshot_metablock_t));
             }
         }
 
@@ -413,20 +418,22 @@ void metablock_manager_t::co_start_existing(file_t *file, bool *mb_found_out,
 //The following two functions will go away in favor of the preceding one
 void metablock_manager_t::start_existing_callback(
         file_t *file, bool *mb_found, log_serializer_metablock_t *mb_out,
-        metablock_read_callback_t *cb) {
-    co_start_existing(file, mb_found, mb_out);
+        lba_snapshot_metablock_t *lba_snapshot_out, metablock_read_callback_t *cb) {
+    co_start_existing(file, mb_found, mb_out, lba_snapshot_out);
     cb->on_metablock_read();
 }
 
 bool metablock_manager_t::start_existing(
         file_t *file, bool *mb_found, log_serializer_metablock_t *mb_out,
-        metablock_read_callback_t *cb) {
+        lba_snapshot_metablock_t *lba_snapshot_out, metablock_read_callback_t *cb) {
     coro_t::spawn_later_ordered(std::bind(&metablock_manager_t::start_existing_callback,
-                                          this, file, mb_found, mb_out, cb));
+                                          this, file, mb_found, mb_out,
+                                          lba_snapshot_out, cb));
     return false;
 }
 
-// crc_mb.get() is zero-initialized, with crc_mb->metablock initialized.
+// crc_mb.get() is zero-initialized, with crc_mb->metablock and crc_mb->lba_snapshot
+// initialized.
 void metablock_manager_t::co_write_metablock(
         const scoped_device_block_aligned_ptr_t<crc_metablock_t> &crc_mb,
         file_account_t *io_account,
@@ -37,9 +37,11 @@ public:
     static void create(file_t *dbfile, int64_t extent_size,
                        scoped_device_block_aligned_ptr_t<crc_metablock_t> &&initial);
 
-    /* Tries to load existing metablocks */
+    /* Tries to load existing metablocks.  The reference to the LBA snapshot is
+       returned separately because it lives outside of log_serializer_metablock_t. */
     void co_start_existing(file_t *dbfile, bool *mb_found,
-                           log_serializer_metablock_t *mb_out);
+                           log_serializer_metablock_t *mb_out,
+                           lba_snapshot_metablock_t *lba_snapshot_out);
     struct metablock_read_callback_t {
         virtual void on_metablock_read() = 0;
         virtual ~metablock_read_callback_t() {}
@@ -47,13 +49,15 @@ public:
 
     bool start_existing(file_t *dbfile, bool *mb_found,
                         log_serializer_metablock_t *mb_out,
+                        lba_snapshot_metablock_t *lba_snapshot_out,
                         metablock_read_callback_t *cb);
 
     struct metablock_write_callback_t {
         virtual void on_metablock_write() = 0;
         virtual ~metablock_write_callback_t() {}
     };
-    // crc_mb->metablock must be initialized, the rest zeroed, DEVICE_BLOCK_SIZE-aligned.
+    // crc_mb->metablock and crc_mb->lba_snapshot must be initialized, the rest zeroed,
+    // DEVICE_BLOCK_SIZE-aligned.
     void write_metablock(const scoped_device_block_aligned_ptr_t<crc_metablock_t> &crc_mb,
                          file_account_t *io_account,
                          optional<std::vector<checksum_filerange>> &&checksums,
@@ -68,6 +72,7 @@ private:
     void start_existing_callback(file_t *dbfile,
                                  bool *mb_found,
                                  log_serializer_metablock_t *mb_out,
+                                 lba_snapshot_metablock_t *lba_snapshot_out,
                                  metablock_read_callback_t *cb);
     void write_metablock_callback(
             const scoped_device_block_aligned_ptr_t<crc_metablock_t> *mb,
@@ -0,0 +1,46 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_LOG_STARTUP_PROGRESS_HPP_
+#define SERIALIZER_LOG_STARTUP_PROGRESS_HPP_
+
+#include <stdint.h>
+
+#include "time.hpp"
+
+/* Starting up a `log_serializer_t` means reading the whole LBA (or a snapshot of it and
+the part of the LBA after the snapshot), which can take a while for large files. The
+serializer keeps a `log_serializer_startup_progress_t` up to date along the way so that
+the `jobs` table can show how far it has gotten. It must only be accessed on the
+serializer's thread. */
+struct log_serializer_startup_progress_t {
+    log_serializer_startup_progress_t()
+        : start_time(current_microtime()),
+          is_ready(false),
+          lba_entries_applied(0),
+          lba_entries_total(0),
+          lba_snapshot_shards(0) { }
+
+    double progress() const {
+        if (is_ready) {
+            return 1.0;
+        }
+        if (lba_entries_total <= 0) {
+            return 0.0;
+        }
+        return lba_entries_applied < lba_entries_total
+            ? static_cast<double>(lba_entries_applied) / lba_entries_total
+            : 1.0;
+    }
+
+    microtime_t start_time;
+    bool is_ready;
+    // The LBA entries (from the snapshot and from the LBA extents) that have been
+    // applied to the in-memory index so far, and how many there are in total. The
+    // total is 0 until the LBA superblocks have been read.
+    int64_t lba_entries_applied;
+    int64_t lba_entries_total;
+    // For how many of the LBA shards the snapshot could be used, so that only the
+    // entries after it had to be replayed. Set once the snapshot has been read.
+    int lba_snapshot_shards;
+};
+
+#endif  // SERIALIZER_LOG_STARTUP_PROGRESS_HPP_
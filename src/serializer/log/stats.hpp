@@ -10,12 +10,17 @@ struct log_serializer_stats_t {
 
     void bytes_read(size_t count);
     void bytes_written(size_t count);
+    // Records the (device block aligned) size of a block before and after
+    // compression.
+    void block_compressed(size_t input_bytes, size_t output_bytes);
 
     perfmon_duration_sampler_t pm_serializer_block_reads;
     perfmon_counter_t pm_serializer_index_reads;
     perfmon_counter_t pm_serializer_block_writes;
     perfmon_duration_sampler_t pm_serializer_index_writes;
     perfmon_sampler_t pm_serializer_index_writes_size;
+    perfmon_latency_histogram_t pm_serializer_read_latency;
+    perfmon_latency_histogram_t pm_serializer_write_latency;
 
     perfmon_rate_monitor_t pm_serializer_read_bytes_per_sec;
     perfmon_counter_t pm_serializer_read_bytes_total;
@@ -38,6 +43,13 @@ struct log_serializer_stats_t {
 
     /* used in serializer/log/lba/lba_list.cc */
     perfmon_counter_t pm_serializer_lba_gcs;
+    perfmon_counter_t pm_serializer_lba_snapshots;
+
+    /* used in serializer/log/data_block_manager.cc, if block compression is on */
+    perfmon_counter_t pm_serializer_compression_input_bytes;
+    perfmon_counter_t pm_serializer_compression_output_bytes;
+    perfmon_sampler_t pm_serializer_compression_ratio;
+    perfmon_counter_t pm_serializer_block_decompressions;
 
     perfmon_membership_t parent_collection_membership;
     perfmon_multi_membership_t stats_membership;
@@ -0,0 +1,109 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "random.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "serializer/log/block_compression.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+// Looks like a block full of JSON documents: compressible, but not trivially so.
+std::string make_compressible_data(rng_t *rng, size_t size) {
+    const char *fields[] = { "\"id\":", "\"name\":", "\"email\":", "\"created_at\":" };
+    std::string ret;
+    while (ret.size() < size) {
+        ret += fields[rng->randint(4)];
+        ret += std::to_string(rng->randuint64(100000));
+        ret += ',';
+    }
+    ret.resize(size);
+    return ret;
+}
+
+void check_round_trip(const std::string &data) {
+    std::vector<char> compressed(data.size() + data.size() / 255 + 16);
+    const size_t compressed_size = lz4_compress(data.data(), data.size(),
+                                                compressed.data(), compressed.size());
+    ASSERT_NE(0u, compressed_size);
+
+    std::vector<char> decompressed(data.size());
+    ASSERT_TRUE(lz4_decompress(compressed.data(), compressed_size,
+                               decompressed.data(), decompressed.size()));
+    ASSERT_EQ(data, std::string(decompressed.begin(), decompressed.end()));
+
+    // Decompressing into a buffer of the wrong size must fail.
+    std::vector<char> too_big(data.size() + 1);
+    ASSERT_FALSE(lz4_decompress(compressed.data(), compressed_size,
+                                too_big.data(), too_big.size()));
+}
+
+TEST(BlockCompressionTest, RoundTrip) {
+    rng_t rng(12345);
+    check_round_trip("");
+    check_round_trip("a");
+    check_round_trip("abcdabcdabcdabcd");
+    check_round_trip(std::string(4096, '\0'));
+    check_round_trip(std::string(65535, 'x'));
+    for (size_t size = 1; size < 9000; size = size * 3 / 2 + 1) {
+        check_round_trip(make_compressible_data(&rng, size));
+        std::string random_data;
+        for (size_t i = 0; i < size; ++i) {
+            random_data.push_back(static_cast<char>(rng.randint(256)));
+        }
+        check_round_trip(random_data);
+    }
+}
+
+TEST(BlockCompressionTest, RejectsTruncatedInput) {
+    rng_t rng(54321);
+    const std::string data = make_compressible_data(&rng, 4000);
+    std::vector<char> compressed(8192);
+    const size_t compressed_size = lz4_compress(data.data(), data.size(),
+                                                compressed.data(), compressed.size());
+    ASSERT_NE(0u, compressed_size);
+    ASSERT_LT(compressed_size, data.size());
+
+    std::vector<char> decompressed(data.size());
+    for (size_t size = 0; size < compressed_size; ++size) {
+        ASSERT_FALSE(lz4_decompress(compressed.data(), size,
+                                    decompressed.data(), decompressed.size()));
+    }
+}
+
+TEST(BlockCompressionTest, CompressBlock) {
+    rng_t rng(1);
+    const block_size_t block_size = block_size_t::make_from_cache(4096 - 8);
+
+    buf_ptr_t buf = buf_ptr_t::alloc_zeroed(block_size);
+    buf.ser_buffer()->ser_header.block_id = 17;
+    const std::string data = make_compressible_data(&rng, block_size.value());
+    memcpy(buf.cache_data(), data.data(), data.size());
+
+    scoped_device_block_aligned_ptr_t<ser_buffer_t> disk_buf;
+    block_size_t disk_block_size = block_size_t::undefined();
+    ASSERT_FALSE(compress_block(block_compression_t::none, buf.ser_buffer(),
+                                block_size, &disk_buf, &disk_block_size));
+    ASSERT_TRUE(compress_block(block_compression_t::lz4, buf.ser_buffer(),
+                               block_size, &disk_buf, &disk_block_size));
+    ASSERT_LE(buf_ptr_t::compute_aligned_block_size(disk_block_size) + DEVICE_BLOCK_SIZE,
+              buf.aligned_block_size());
+    ASSERT_EQ(17u, disk_buf->ser_header.block_id);
+
+    buf_ptr_t out = buf_ptr_t::alloc_zeroed(block_size);
+    decompress_block(disk_buf.get(), disk_block_size, out.ser_buffer(), block_size);
+    ASSERT_EQ(17u, out.ser_buffer()->ser_header.block_id);
+    ASSERT_EQ(0, memcmp(buf.cache_data(), out.cache_data(), block_size.value()));
+
+    // Incompressible blocks are left alone.
+    for (size_t i = 0; i < block_size.value(); ++i) {
+        static_cast<char *>(buf.cache_data())[i] = static_cast<char>(rng.randint(256));
+    }
+    ASSERT_FALSE(compress_block(block_compression_t::lz4, buf.ser_buffer(),
+                                block_size, &disk_buf, &disk_block_size));
+}
+
+}  // namespace unittest
@@ -2,8 +2,10 @@
 
 #include "arch/io/disk.hpp"
 #include "arch/types.hpp"
+#include "btree/bulk_load.hpp"
 #include "btree/reql_specific.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "perfmon/perfmon.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "repli_timestamp.hpp"
 #include "serializer/log/log_serializer.hpp"
@@ -71,6 +73,16 @@ public:
         }
     }
 
+    // Replaces the cache with an empty one, which reports its stats to
+    // `perfmon_collection`.
+    void reopen_cache(perfmon_collection_t *perfmon_collection) {
+        cache_conn.reset();
+        cache.reset();
+        cache = make_scoped<cache_t>(serializer.get(), &balancer, perfmon_collection,
+                                     which_cpu_shard_t{0, 1});
+        cache_conn = make_scoped<cache_conn_t>(cache.get());
+    }
+
     void run_txn_fn(bool readwrite,
         const std::function<void(scoped_ptr_t<real_superblock_t> &&)> &fn) {
 
@@ -174,6 +186,43 @@ public:
         set(key, value, repli_timestamp_t::distant_past);
     }
 
+    // Appends the pairs with `btree_bulk_loader_t`. Returns false if they can't be
+    // appended.
+    bool append(const std::vector<std::pair<store_key_t, std::string> > &pairs,
+                repli_timestamp_t timestamp) {
+        bool appended = false;
+        run_txn_fn(true, [&](scoped_ptr_t<real_superblock_t> &&superblock){
+            noop_value_deleter_t deleter;
+            const bool may_append = btree_bulk_loader_t::may_append(
+                sizer.get(), superblock.get(), pairs.front().first.btree_key());
+            btree_bulk_loader_t loader(sizer.get(), superblock.get(), timestamp);
+            EXPECT_EQ(may_append, loader.can_append(pairs.front().first.btree_key()));
+            if (!may_append) {
+                return;
+            }
+            for (const auto &pair : pairs) {
+                short_value_buffer_t buf(pair.second);
+                loader.append(pair.first.btree_key(), buf.data(), &deleter);
+            }
+            loader.finish();
+            appended = true;
+        });
+
+        if (appended) {
+            for (const auto &pair : pairs) {
+                kv[pair.first] = pair.second;
+            }
+        }
+        return appended;
+    }
+
+    store_key_t highest_key() {
+        if (is_empty()) {
+            return store_key_t();
+        }
+        return kv.rbegin()->first;
+    }
+
     void remove(const store_key_t &key, repli_timestamp_t timestamp) {
         EXPECT_TRUE(should_have(key));
 
@@ -507,4 +556,105 @@ TPTEST(BTree, RemoveRandomOrder) {
     ctx.verify();
 }
 
+// Returns `count` random pairs, sorted by key, whose keys all start with `prefix`.
+std::vector<std::pair<store_key_t, std::string> > sorted_random_pairs(
+        rng_t *rng, const std::string &prefix, size_t count) {
+    std::map<store_key_t, std::string> pairs;
+    while (pairs.size() < count) {
+        pairs[store_key_t(prefix + random_letter_string(rng, 1, 200))]
+            = random_letter_string(rng, 0, 250);
+    }
+    return std::vector<std::pair<store_key_t, std::string> >(
+        pairs.begin(), pairs.end());
+}
+
+TPTEST(BTree, BulkLoad) {
+    BTreeTestContext ctx;
+    rng_t rng;
+
+    // Enough pairs for a tree with a few levels of internal nodes.
+    ASSERT_TRUE(ctx.append(sorted_random_pairs(&rng, "", 5000),
+                           repli_timestamp_t::distant_past));
+    ctx.verify();
+    ctx.range(random_key_range(&rng));
+
+    // The tree must still work normally after being bulk loaded.
+    for (int i = 0; i < 500; i++) {
+        ctx.set(store_key_t(random_letter_string(&rng, 1, 250)),
+                random_letter_string(&rng, 0, 250));
+    }
+    ctx.verify();
+
+    while (!ctx.is_empty()) {
+        ctx.remove(ctx.pick_random_key(&rng));
+
+        if (rng.randint(500) == 0) {
+            ctx.verify();
+        }
+    }
+
+    ctx.verify();
+}
+
+double get_cache_stat(perfmon_collection_t *collection, const char *name) {
+    void *ctx = collection->begin_stats();
+    collection->visit_stats(ctx);
+    return collection->end_stats(ctx).get_field("cache").get_field(name).as_num();
+}
+
+TPTEST(BTree, ReadAhead) {
+    perfmon_collection_t collection;
+    BTreeTestContext ctx;
+    rng_t rng;
+    ASSERT_TRUE(ctx.append(sorted_random_pairs(&rng, "", 5000),
+                           repli_timestamp_t::distant_past));
+
+    // A lookup of a single key only visits one child of each internal node, so it
+    // doesn't read anything ahead.
+    ctx.reopen_cache(&collection);
+    ctx.range(key_range_t(key_range_t::bound_t::closed, ctx.lowest_key(),
+                          key_range_t::bound_t::closed, ctx.lowest_key()));
+    ASSERT_EQ(0, get_cache_stat(&collection, "prefetches_total"));
+
+    // A full scan reads ahead, and uses every node that it reads ahead.
+    ctx.verify();
+    const double prefetches = get_cache_stat(&collection, "prefetches_total");
+    ASSERT_LT(0, prefetches);
+    ASSERT_EQ(prefetches, get_cache_stat(&collection, "prefetch_hits_total"));
+}
+
+TPTEST(BTree, BulkLoadAppend) {
+    BTreeTestContext ctx;
+    rng_t rng;
+
+    for (int i = 0; i < 1000; i++) {
+        ctx.set(store_key_t(random_letter_string(&rng, 1, 250)),
+                random_letter_string(&rng, 0, 250));
+    }
+
+    // Keys that fall into the existing key range can't be appended.
+    std::vector<std::pair<store_key_t, std::string> > overlapping{
+        std::make_pair(ctx.highest_key(), std::string("x"))};
+    ASSERT_FALSE(ctx.append(overlapping, repli_timestamp_t::distant_past));
+    ctx.verify();
+
+    // Letter strings sort before "~", so each batch goes after the previous ones.
+    std::string prefix;
+    for (int i = 0; i < 5; i++) {
+        prefix += "~";
+        ASSERT_TRUE(ctx.append(sorted_random_pairs(&rng, prefix, 1000),
+                               repli_timestamp_t::distant_past));
+        ctx.verify();
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        ctx.set(store_key_t(random_letter_string(&rng, 1, 250)),
+                random_letter_string(&rng, 0, 250));
+        if (rng.randint(10) == 0) {
+            ctx.remove(ctx.pick_random_key(&rng));
+        }
+    }
+    ctx.verify();
+}
+
 } // namespace unittest
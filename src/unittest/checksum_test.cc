@@ -0,0 +1,112 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <vector>
+
+#include "random.hpp"
+#include "serializer/checksum.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+const checksum_impl_t all_checksum_impls[] = {
+    checksum_impl_t::scalar, checksum_impl_t::sse41, checksum_impl_t::avx2 };
+
+// The straightforward definition of the checksum, as documented in checksum.cc.
+serializer_checksum reference_checksum(const std::vector<uint32_t> &words) {
+    const uint64_t modulus = 0xFFFFFFFFull;
+    uint64_t a = 0;
+    uint64_t b = 0;
+    for (uint32_t word : words) {
+        a = (a + (word ^ 1)) % modulus;
+        b = (b + a) % modulus;
+    }
+    return serializer_checksum{((b == 0 ? modulus : b) << 32) | (a == 0 ? modulus : a)};
+}
+
+void check_all_impls(const std::vector<uint32_t> &words) {
+    const serializer_checksum expected = reference_checksum(words);
+    ASSERT_EQ(expected.value, compute_checksum(words.data(), words.size()).value);
+    for (checksum_impl_t impl : all_checksum_impls) {
+        if (checksum_impl_supported(impl)) {
+            ASSERT_EQ(expected.value,
+                      compute_checksum_with_impl(impl, words.data(), words.size()).value)
+                << "implementation " << static_cast<int>(impl)
+                << ", " << words.size() << " words";
+        }
+    }
+}
+
+TEST(ChecksumTest, ImplementationsAgree) {
+    rng_t rng(4321);
+    for (size_t size = 0; size < 300; ++size) {
+        std::vector<uint32_t> words(size);
+        for (uint32_t &word : words) {
+            word = static_cast<uint32_t>(rng.randuint64(UINT64_C(1) << 32));
+        }
+        check_all_impls(words);
+        check_all_impls(std::vector<uint32_t>(size, 0));
+        check_all_impls(std::vector<uint32_t>(size, 1));
+        check_all_impls(std::vector<uint32_t>(size, 0xFFFFFFFE));
+        check_all_impls(std::vector<uint32_t>(size, 0xFFFFFFFF));
+    }
+}
+
+TEST(ChecksumTest, LargeBuffers) {
+    // Large enough for the accumulators to get folded several times.
+    rng_t rng(1234);
+    for (size_t size : { 0xFFFFul, 0x10000ul, 0x10001ul, 0x12345ul, 0x40007ul }) {
+        std::vector<uint32_t> words(size);
+        for (uint32_t &word : words) {
+            word = static_cast<uint32_t>(rng.randuint64(UINT64_C(1) << 32));
+        }
+        check_all_impls(words);
+        check_all_impls(std::vector<uint32_t>(size, 0xFFFFFFFE));
+    }
+}
+
+TEST(ChecksumTest, Concat) {
+    rng_t rng(42);
+    std::vector<uint32_t> words(1000);
+    for (uint32_t &word : words) {
+        word = static_cast<uint32_t>(rng.randuint64(UINT64_C(1) << 32));
+    }
+    const serializer_checksum whole = compute_checksum(words.data(), words.size());
+    for (size_t split : { 0, 1, 7, 500, 999, 1000 }) {
+        const serializer_checksum left = compute_checksum(words.data(), split);
+        const serializer_checksum right
+            = compute_checksum(words.data() + split, words.size() - split);
+        ASSERT_EQ(whole.value,
+                  compute_checksum_concat(left, right, words.size() - split).value);
+    }
+}
+
+#ifdef NDEBUG
+TEST(ChecksumTest, Benchmark) {
+    // One default-sized block.
+    const size_t wordcount = 4096 / sizeof(uint32_t);
+    const int NUM_REPETITIONS = 200000;
+    rng_t rng(7);
+    std::vector<uint32_t> words(wordcount);
+    for (uint32_t &word : words) {
+        word = static_cast<uint32_t>(rng.randuint64(UINT64_C(1) << 32));
+    }
+
+    for (checksum_impl_t impl : all_checksum_impls) {
+        if (!checksum_impl_supported(impl)) {
+            continue;
+        }
+        uint64_t sum = 0;
+        ticks_t start_ticks = get_ticks();
+        for (int i = 0; i < NUM_REPETITIONS; ++i) {
+            sum += compute_checksum_with_impl(impl, words.data(), words.size()).value;
+        }
+        double secs = ticks_to_secs(ticks_t{get_ticks().nanos - start_ticks.nanos});
+        printf("Checksum implementation %d: %f GB/s (%" PRIu64 ")\n",
+               static_cast<int>(impl),
+               wordcount * sizeof(uint32_t) * NUM_REPETITIONS / secs / 1e9,
+               sum);
+    }
+}
+#endif  // NDEBUG
+
+}  // namespace unittest
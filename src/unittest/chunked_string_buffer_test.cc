@@ -0,0 +1,85 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include "unittest/gtest.hpp"
+
+#include "containers/chunked_string_buffer.hpp"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+namespace unittest {
+
+std::string buffer_contents(const chunked_string_buffer_t &buf) {
+    std::string res;
+    buf.append_to(&res);
+    return res;
+}
+
+TEST(ChunkedStringBufferTest, PutPushPop) {
+    chunked_string_buffer_t buf;
+    std::string expected;
+    // Enough characters to need several chunks.
+    for (size_t i = 0; i < 3 * chunked_string_buffer_t::MAX_CHUNK_SIZE; ++i) {
+        const char c = 'a' + (i % 26);
+        buf.Put(c);
+        expected += c;
+    }
+    ASSERT_EQ(expected.size(), buf.GetSize());
+    ASSERT_EQ(expected, buffer_contents(buf));
+
+    const_buffer_group_t chunks;
+    buf.get_chunks(&chunks);
+    ASSERT_LT(1u, chunks.num_buffers());
+    ASSERT_EQ(expected.size(), chunks.get_size());
+
+    // Popping across chunk boundaries and writing again.
+    const size_t pop_size = chunked_string_buffer_t::MAX_CHUNK_SIZE + 17;
+    buf.Pop(pop_size);
+    expected.resize(expected.size() - pop_size);
+    ASSERT_EQ(expected, buffer_contents(buf));
+
+    char *pushed = buf.Push(5);
+    memcpy(pushed, "hello", 5);
+    expected += "hello";
+    ASSERT_EQ(expected.size(), buf.GetSize());
+    ASSERT_EQ(expected, buffer_contents(buf));
+}
+
+TEST(ChunkedStringBufferTest, SpliceArray) {
+    rapidjson::StringBuffer expected;
+    rapidjson::Writer<rapidjson::StringBuffer> expected_writer(expected);
+    chunked_string_buffer_t buf;
+    rapidjson::Writer<chunked_string_buffer_t> writer(buf);
+    expected_writer.StartArray();
+    writer.StartArray();
+
+    const std::string long_string(chunked_string_buffer_t::INITIAL_CHUNK_SIZE * 3, 'x');
+    for (int part = 0; part < 3; ++part) {
+        chunked_string_buffer_t part_buf;
+        rapidjson::Writer<chunked_string_buffer_t> part_writer(part_buf);
+        part_writer.StartArray();
+        for (int i = 0; i < 10; ++i) {
+            part_writer.Int(part * 10 + i);
+            expected_writer.Int(part * 10 + i);
+        }
+        // The second part spans several chunks.
+        if (part == 1) {
+            part_writer.String(long_string.data(), long_string.size());
+            expected_writer.String(long_string.data(), long_string.size());
+        }
+        part_writer.EndArray();
+        writer.SpliceArray(&part_buf);
+        ASSERT_EQ(0u, part_buf.GetSize());
+    }
+    writer.Int(30);
+    expected_writer.Int(30);
+
+    writer.EndArray();
+    expected_writer.EndArray();
+    ASSERT_TRUE(writer.IsComplete());
+    ASSERT_EQ(expected.GetSize(), buf.GetSize());
+    ASSERT_EQ(std::string(expected.GetString(), expected.GetSize()),
+              buffer_contents(buf));
+}
+
+}  // namespace unittest
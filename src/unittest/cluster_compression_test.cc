@@ -0,0 +1,187 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string.h>
+#include <zlib.h>
+
+#include <string>
+#include <vector>
+
+#include "config/args.hpp"
+#include "containers/archive/varint.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "random.hpp"
+#include "rpc/connectivity/compression.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+// Looks like a serialized batch of documents, which is what most of the cluster
+// traffic is.
+static std::vector<char> make_message_body(rng_t *rng, size_t size) {
+    const char *fields[] = { "\"id\":", "\"name\":", "\"email\":", "\"created_at\":" };
+    std::string body;
+    while (body.size() < size) {
+        body += fields[rng->randint(4)];
+        body += std::to_string(rng->randuint64(100000));
+        body += ',';
+    }
+    body.resize(size);
+    return std::vector<char>(body.begin(), body.end());
+}
+
+struct test_message_t {
+    uint8_t tag;
+    std::vector<char> body;
+};
+
+TEST(ClusterCompressionTest, Negotiate) {
+    EXPECT_EQ(cluster_compression_t::none,
+              negotiate_cluster_compression(cluster_compression_t::none, 0));
+    EXPECT_EQ(cluster_compression_t::deflate,
+              negotiate_cluster_compression(cluster_compression_t::deflate, 1));
+    EXPECT_EQ(cluster_compression_t::none,
+              negotiate_cluster_compression(cluster_compression_t::deflate, 0));
+    EXPECT_EQ(cluster_compression_t::none,
+              negotiate_cluster_compression(cluster_compression_t::none, 1));
+    // A mode that we don't know about yet.
+    EXPECT_EQ(cluster_compression_t::none,
+              negotiate_cluster_compression(cluster_compression_t::deflate, 7));
+}
+
+TEST(ClusterCompressionTest, RoundTrip) {
+    rng_t rng(12345);
+    std::vector<test_message_t> messages;
+    size_t message_bytes = 0;
+    for (int i = 0; i < 200; ++i) {
+        test_message_t message;
+        message.tag = rng.randint(256);
+        // Mix messages that are too small to be compressed with large ones.
+        const size_t size = rng.randint(4) == 0
+            ? rng.randint(CLUSTER_COMPRESSION_THRESHOLD)
+            : CLUSTER_COMPRESSION_THRESHOLD + rng.randint(64 * KILOBYTE);
+        message.body = make_message_body(&rng, size);
+        message_bytes += message.body.size() + 1;
+        messages.push_back(std::move(message));
+    }
+
+    cluster_compressor_t compressor;
+    std::vector<char> frames;
+    for (const test_message_t &message : messages) {
+        compressor.frame_message(message.tag, message.body, &frames);
+    }
+    EXPECT_LT(frames.size(), message_bytes / 2);
+
+    vector_read_stream_t frames_stream(std::move(frames));
+    cluster_decompressing_stream_t decompressor(&frames_stream);
+    for (const test_message_t &message : messages) {
+        uint8_t tag;
+        ASSERT_EQ(1, force_read(&decompressor, &tag, 1));
+        ASSERT_EQ(message.tag, tag);
+        std::vector<char> body(message.body.size());
+        ASSERT_EQ(static_cast<int64_t>(body.size()),
+                  force_read(&decompressor, body.data(), body.size()));
+        ASSERT_TRUE(body == message.body);
+    }
+    char c;
+    ASSERT_EQ(0, decompressor.read(&c, 1));
+}
+
+TEST(ClusterCompressionTest, LargeMessage) {
+    rng_t rng(23456);
+    test_message_t message;
+    message.tag = 7;
+    message.body = make_message_body(&rng, 3 * CLUSTER_COMPRESSION_MAX_FRAME_SIZE + 5);
+
+    cluster_compressor_t compressor;
+    std::vector<char> frames;
+    compressor.frame_message(message.tag, message.body, &frames);
+    // The message doesn't fit into one frame, so this only works if it was split.
+    vector_read_stream_t frames_stream(std::move(frames));
+    cluster_decompressing_stream_t decompressor(&frames_stream);
+    uint8_t tag;
+    ASSERT_EQ(1, force_read(&decompressor, &tag, 1));
+    ASSERT_EQ(message.tag, tag);
+    std::vector<char> body(message.body.size());
+    ASSERT_EQ(static_cast<int64_t>(body.size()),
+              force_read(&decompressor, body.data(), body.size()));
+    ASSERT_TRUE(body == message.body);
+    char c;
+    ASSERT_EQ(0, decompressor.read(&c, 1));
+}
+
+TEST(ClusterCompressionTest, Truncated) {
+    rng_t rng(54321);
+    cluster_compressor_t compressor;
+    std::vector<char> frames;
+    compressor.frame_message(1, make_message_body(&rng, 16 * KILOBYTE), &frames);
+    frames.resize(frames.size() / 2);
+
+    vector_read_stream_t frames_stream(std::move(frames));
+    cluster_decompressing_stream_t decompressor(&frames_stream);
+    char c;
+    ASSERT_EQ(-1, decompressor.read(&c, 1));
+}
+
+TEST(ClusterCompressionTest, Corrupted) {
+    std::vector<char> frames;
+    frames.push_back(1);     // A compressed frame...
+    frames.push_back(4);     // ... with a payload of four bytes ...
+    frames.push_back(0xff);  // ... that isn't valid deflate data.
+    frames.push_back(0xff);
+    frames.push_back(0xff);
+    frames.push_back(0xff);
+
+    vector_read_stream_t frames_stream(std::move(frames));
+    cluster_decompressing_stream_t decompressor(&frames_stream);
+    char c;
+    ASSERT_EQ(-1, decompressor.read(&c, 1));
+}
+
+static void append_frame_header(uint8_t type, uint64_t size, std::vector<char> *out) {
+    uint8_t header[11];
+    header[0] = type;
+    const size_t header_size = 1 + serialize_varint_uint64_into_buf(size, header + 1);
+    out->insert(out->end(), header, header + header_size);
+}
+
+TEST(ClusterCompressionTest, OversizedFrame) {
+    // A compressed frame that claims to be far larger than any frame that a
+    // `cluster_compressor_t` makes. It must be rejected before anything gets
+    // allocated for it.
+    std::vector<char> frames;
+    append_frame_header(1, UINT64_C(1) << 60, &frames);
+    frames.resize(frames.size() + 16, 0);
+
+    vector_read_stream_t frames_stream(std::move(frames));
+    cluster_decompressing_stream_t decompressor(&frames_stream);
+    char c;
+    ASSERT_EQ(-1, decompressor.read(&c, 1));
+}
+
+TEST(ClusterCompressionTest, OversizedInflate) {
+    // A small frame that inflates to more than a frame may hold.
+    std::vector<char> zeros(4 * CLUSTER_COMPRESSION_MAX_FRAME_SIZE, 0);
+    z_stream_s stream;
+    memset(&stream, 0, sizeof(stream));
+    ASSERT_EQ(Z_OK, deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -15, 8,
+                                 Z_DEFAULT_STRATEGY));
+    std::vector<char> compressed(deflateBound(&stream, zeros.size()) + 1024);
+    stream.next_in = reinterpret_cast<Bytef *>(zeros.data());
+    stream.avail_in = zeros.size();
+    stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+    stream.avail_out = compressed.size();
+    ASSERT_EQ(Z_OK, deflate(&stream, Z_SYNC_FLUSH));
+    ASSERT_EQ(0u, stream.avail_in);
+    compressed.resize(compressed.size() - stream.avail_out);
+    deflateEnd(&stream);
+
+    std::vector<char> frames;
+    append_frame_header(1, compressed.size(), &frames);
+    frames.insert(frames.end(), compressed.begin(), compressed.end());
+
+    vector_read_stream_t frames_stream(std::move(frames));
+    cluster_decompressing_stream_t decompressor(&frames_stream);
+    char c;
+    ASSERT_EQ(-1, decompressor.read(&c, 1));
+}
+
+}  // namespace unittest
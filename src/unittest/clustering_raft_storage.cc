@@ -26,6 +26,8 @@ table_config_and_shards_t make_table_config_and_shards() {
     table_config_and_shards.config.write_ack_config = write_ack_config_t::MAJORITY;
     table_config_and_shards.config.durability = write_durability_t::HARD;
     table_config_and_shards.config.user_data = default_user_data();
+    table_config_and_shards.config.block_size = DEFAULT_BTREE_BLOCK_SIZE;
+    table_config_and_shards.config.block_compression = block_compression_t::none;
     table_config_and_shards.server_names.names[shard.primary_replica] =
         std::make_pair(0ul, name_string_t::guarantee_valid("primary"));
 
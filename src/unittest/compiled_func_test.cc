@@ -0,0 +1,74 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+
+#include "rdb_protocol/compiled_func.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/var_types.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+ql::datum_t make_doc(double a, const char *b) {
+    ql::datum_object_builder_t doc;
+    doc.overwrite("a", ql::datum_t(a));
+    doc.overwrite("b", ql::datum_t(datum_string_t(b)));
+    return std::move(doc).to_datum();
+}
+
+TEST(CompiledFuncTest, Evaluate) {
+    const ql::sym_t x(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+
+    // x['a'] > 2 && x['b'] == 'foo'
+    ql::minidriver_t::reql_t pred
+        = (r.var(x)["a"] > r.expr(2.0)) && (r.var(x)["b"] == r.expr(std::string("foo")));
+    scoped_ptr_t<ql::compiled_func_t> compiled = ql::compiled_func_t::compile(
+        ql::var_scope_t(), make_vector(x), pred.root_term());
+    ASSERT_TRUE(compiled.has());
+    EXPECT_EQ(ql::datum_t::boolean(true),
+              compiled->eval(make_vector(make_doc(3, "foo"))));
+    EXPECT_EQ(ql::datum_t::boolean(false),
+              compiled->eval(make_vector(make_doc(1, "foo"))));
+    EXPECT_EQ(ql::datum_t::boolean(false),
+              compiled->eval(make_vector(make_doc(3, "bar"))));
+
+    // (x['a'] + 1) / 2
+    ql::minidriver_t::reql_t arith = (r.var(x)["a"] + r.expr(1.0)) / r.expr(2.0);
+    compiled = ql::compiled_func_t::compile(
+        ql::var_scope_t(), make_vector(x), arith.root_term());
+    ASSERT_TRUE(compiled.has());
+    EXPECT_EQ(ql::datum_t(2.0), compiled->eval(make_vector(make_doc(3, "foo"))));
+}
+
+TEST(CompiledFuncTest, FallBack) {
+    const ql::sym_t x(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+
+    // A missing field is an error, which the term tree has to produce.
+    ql::minidriver_t::reql_t missing = r.var(x)["c"] == r.expr(1.0);
+    scoped_ptr_t<ql::compiled_func_t> compiled = ql::compiled_func_t::compile(
+        ql::var_scope_t(), make_vector(x), missing.root_term());
+    ASSERT_TRUE(compiled.has());
+    EXPECT_FALSE(compiled->eval(make_vector(make_doc(3, "foo"))).has());
+
+    // Adding strings is left to the term tree.
+    ql::minidriver_t::reql_t concat = r.var(x)["b"] + r.expr(std::string("bar"));
+    compiled = ql::compiled_func_t::compile(
+        ql::var_scope_t(), make_vector(x), concat.root_term());
+    ASSERT_TRUE(compiled.has());
+    EXPECT_FALSE(compiled->eval(make_vector(make_doc(3, "foo"))).has());
+
+    // So is division by zero.
+    ql::minidriver_t::reql_t div = r.var(x)["a"] / r.expr(0.0);
+    compiled = ql::compiled_func_t::compile(
+        ql::var_scope_t(), make_vector(x), div.root_term());
+    ASSERT_TRUE(compiled.has());
+    EXPECT_FALSE(compiled->eval(make_vector(make_doc(3, "foo"))).has());
+
+    // Terms that aren't supported aren't compiled at all.
+    ql::minidriver_t::reql_t unsupported = r.var(x).pluck(std::string("a"));
+    compiled = ql::compiled_func_t::compile(
+        ql::var_scope_t(), make_vector(x), unsupported.root_term());
+    EXPECT_FALSE(compiled.has());
+}
+
+}  // namespace unittest
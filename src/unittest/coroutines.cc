@@ -1,9 +1,14 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 
+#include <stdexcept>
+
 #include "arch/runtime/coroutines.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "arch/runtime/sampling_profiler.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/pmap.hpp"
 #include "config/args.hpp"
+#include "time.hpp"
 #include "unittest/gtest.hpp"
 #include "unittest/unittest_utils.hpp"
 #include "utils.hpp"
@@ -83,6 +88,143 @@ TEST(CoroutinesTest, OnThreadOrdering) {
     }, num_threads);
 }
 
+TEST(CoroutinesTest, OnThreadManySenders) {
+    // Tests that messages from many threads to the same thread arrive in the order
+    // in which each of the threads has sent them
+    const int num_threads = 8;
+    const int num_coros_per_thread = 200;
+    run_in_thread_pool([&]() {
+        const threadnum_t receiver = get_thread_id();
+        std::vector<int> c(num_threads, 0);
+        pmap(num_threads, [&](int sender) {
+            on_thread_t t((threadnum_t(sender)));
+            auto_drainer_t drainer;
+            for (int i = 0; i < num_coros_per_thread; ++i) {
+                auto_drainer_t::lock_t lock(&drainer);
+                coro_t::spawn_later_ordered([&c, receiver, sender, i, lock]() {
+                    on_thread_t t2(receiver);
+                    ASSERT_EQ(i, c[sender]);
+                    ++c[sender];
+                });
+            }
+            drainer.drain();
+        });
+        for (int i = 0; i < num_threads; ++i) {
+            ASSERT_EQ(num_coros_per_thread, c[i]);
+        }
+    }, num_threads);
+}
+
+TEST(CoroutinesTest, SpawnStealable) {
+    // Tests that every stealable coroutine runs exactly once, and on the thread that
+    // it starts on.
+    const int num_threads = 4;
+    const int num_coros = 1000;
+    run_in_thread_pool([&]() {
+        // Tests start on the utility thread, which doesn't steal.
+        on_thread_t db_thread((threadnum_t(0)));
+        const threadnum_t home = get_thread_id();
+        std::vector<int> ran_on(num_coros, -1);
+        int num_done = 0;
+        cond_t all_done;
+        for (int i = 0; i < num_coros; ++i) {
+            coro_t::spawn_stealable([&, i]() {
+                const threadnum_t thread = get_thread_id();
+                // Give other threads a chance to steal some of the remaining coroutines.
+                volatile int busy = 0;
+                for (int j = 0; j < 10000; ++j) {
+                    busy = busy + j;
+                }
+                coro_t::yield();
+                ASSERT_EQ(thread.threadnum, get_thread_id().threadnum);
+                ASSERT_EQ(-1, ran_on[i]);
+                ran_on[i] = thread.threadnum;
+                on_thread_t t(home);
+                ++num_done;
+                if (num_done == num_coros) {
+                    all_done.pulse();
+                }
+            });
+        }
+        all_done.wait();
+        for (int i = 0; i < num_coros; ++i) {
+            ASSERT_LE(0, ran_on[i]);
+            ASSERT_GT(num_threads, ran_on[i]);
+        }
+    }, num_threads);
+}
+
+namespace {
+
+void spin_for_micros(int64_t micros) {
+    const ticks_t start = get_ticks();
+    while (get_ticks().nanos - start.nanos < micros * 1000) { }
+}
+
+}  // namespace
+
+TEST(CoroutinesTest, StealablePmapSkewedLoad) {
+    // Keeps one thread busy with coroutines that hog it, like a hot client connection
+    // would, and tests that the idle threads take over most of the `stealable_pmap()`
+    // jobs that are spawned on it.
+    const int num_threads = 4;
+    const int num_hogs = 8;
+    const int num_jobs = 64;
+    run_in_thread_pool([&]() {
+        on_thread_t db_thread((threadnum_t(0)));
+        const threadnum_t home = get_thread_id();
+        bool stop = false;
+        int hogs_running = num_hogs;
+        cond_t hogs_done;
+        for (int i = 0; i < num_hogs; ++i) {
+            coro_t::spawn_sometime([&]() {
+                while (!stop) {
+                    spin_for_micros(1000);
+                    coro_t::yield();
+                }
+                --hogs_running;
+                if (hogs_running == 0) {
+                    hogs_done.pulse();
+                }
+            });
+        }
+
+        std::vector<int> ran_on(num_jobs, -1);
+        stealable_pmap(num_jobs, [&](int64_t i) {
+            spin_for_micros(500);
+            ran_on[i] = get_thread_id().threadnum;
+        });
+        stop = true;
+        hogs_done.wait();
+
+        int num_on_home = 0;
+        for (int i = 0; i < num_jobs; ++i) {
+            ASSERT_LE(0, ran_on[i]);
+            ASSERT_GT(num_threads, ran_on[i]);
+            if (ran_on[i] == home.threadnum) {
+                ++num_on_home;
+            }
+        }
+        EXPECT_LT(num_on_home, num_jobs / 2);
+    }, num_threads);
+}
+
+TEST(CoroutinesTest, StealablePmapException) {
+    // Tests that an exception in any of the jobs is passed on to the caller.
+    run_in_thread_pool([&]() {
+        try {
+            stealable_pmap(100, [&](int64_t i) {
+                if (i == 37 || i == 73) {
+                    throw std::runtime_error(strprintf("%" PRIi64, i));
+                }
+            });
+            ADD_FAILURE() << "stealable_pmap() didn't throw";
+        } catch (const std::runtime_error &ex) {
+            EXPECT_EQ(std::string("37"), ex.what());
+        }
+    }, 4);
+}
+
 TEST(CoroutinesTest, NotifyNow) {
     // Test that `spawn_now_dangerously` doesn't block`
     run_in_thread_pool([&]() {
@@ -130,4 +272,34 @@ TEST(CoroutinesTest, LotsOfCoroutines) {
 }
 #endif
 
+TEST(CoroutinesTest, SamplingProfiler) {
+    run_in_thread_pool([&]() {
+        sampling_profiler_t *profiler = &sampling_profiler_t::get_global_profiler();
+        profiler->set_samples_per_sec(1000);
+        ASSERT_EQ(1000u, profiler->get_samples_per_sec());
+
+        // Keep the CPU busy for about 50ms, yielding every 5ms. The first yield doesn't
+        // count because the profiler got turned on while we were running.
+        for (int i = 0; i < 10; ++i) {
+            const ticks_t start = get_ticks();
+            while (get_ticks().nanos - start.nanos < 5 * MILLION) { }
+            coro_t::yield();
+        }
+
+        // There's at most one sample per yield, even though more than one sampling
+        // interval passes in between.
+        const uint64_t num_samples = profiler->get_num_samples();
+        EXPECT_GE(num_samples, 9u);
+        EXPECT_LE(num_samples, 12u);
+        const std::string folded_stacks = profiler->get_folded_stacks();
+        EXPECT_NE(std::string::npos, folded_stacks.find(' '));
+        EXPECT_EQ('\n', folded_stacks.back());
+
+        profiler->set_samples_per_sec(0);
+        profiler->clear();
+        EXPECT_EQ(0u, profiler->get_num_samples());
+        EXPECT_EQ("", profiler->get_folded_stacks());
+    });
+}
+
 }   /* namespace unittest */
@@ -1,6 +1,7 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 
 #include "containers/archive/string_stream.hpp"
+#include "containers/chunked_string_buffer.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/datum_string.hpp"
 #include "rdb_protocol/env.hpp"
@@ -205,4 +206,48 @@ TEST(DatumTest, OffsetScaling) {
     }
 }
 
+std::string datum_cbor(const ql::datum_t &datum) {
+    chunked_string_buffer_t buffer;
+    datum.write_cbor(&buffer);
+    std::string res;
+    buffer.append_to(&res);
+    return res;
+}
+
+TEST(DatumTest, CborEncoding) {
+    // The expected encodings are from the examples in RFC 7049, Appendix A.
+    ASSERT_EQ(std::string("\x00", 1), datum_cbor(ql::datum_t(0.0)));
+    ASSERT_EQ("\x17", datum_cbor(ql::datum_t(23.0)));
+    ASSERT_EQ("\x18\x18", datum_cbor(ql::datum_t(24.0)));
+    ASSERT_EQ(std::string("\x19\x03\xe8"), datum_cbor(ql::datum_t(1000.0)));
+    ASSERT_EQ(std::string("\x1a\x00\x0f\x42\x40", 5),
+              datum_cbor(ql::datum_t(1000000.0)));
+    ASSERT_EQ("\x20", datum_cbor(ql::datum_t(-1.0)));
+    ASSERT_EQ(std::string("\x39\x03\xe7"), datum_cbor(ql::datum_t(-1000.0)));
+    ASSERT_EQ(std::string("\xfb\x3f\xf1\x99\x99\x99\x99\x99\x9a"),
+              datum_cbor(ql::datum_t(1.1)));
+    ASSERT_EQ(std::string("\xfb\x80\x00\x00\x00\x00\x00\x00\x00", 9),
+              datum_cbor(ql::datum_t(-0.0)));
+
+    ASSERT_EQ("\xf4", datum_cbor(ql::datum_t::boolean(false)));
+    ASSERT_EQ("\xf5", datum_cbor(ql::datum_t::boolean(true)));
+    ASSERT_EQ("\xf6", datum_cbor(ql::datum_t::null()));
+    ASSERT_EQ("\x64IETF", datum_cbor(ql::datum_t("IETF")));
+    ASSERT_EQ(std::string("\x44\x01\x02\x03\x04"),
+              datum_cbor(ql::datum_t::binary(
+                  datum_string_t(std::string("\x01\x02\x03\x04")))));
+
+    ql::datum_t array(std::vector<ql::datum_t>{
+            ql::datum_t(1.0),
+            ql::datum_t(std::vector<ql::datum_t>{ql::datum_t(2.0), ql::datum_t(3.0)},
+                        ql::configured_limits_t::unlimited)},
+        ql::configured_limits_t::unlimited);
+    ASSERT_EQ("\x82\x01\x82\x02\x03", datum_cbor(array));
+
+    ql::datum_t object(std::map<datum_string_t, ql::datum_t>{
+        std::make_pair(datum_string_t("a"), ql::datum_t(1.0)),
+        std::make_pair(datum_string_t("b"), ql::datum_t("c"))});
+    ASSERT_EQ("\xa2\x61\x61\x01\x61\x62\x61\x63", datum_cbor(object));
+}
+
 }  // namespace unittest
@@ -45,9 +45,11 @@ TEST(DiskBackedQueue, ManyInts) {
     unittest::run_in_thread_pool(&run_many_ints_test, 2);
 }
 
-void run_big_values_test() {
+void run_big_values_test(io_backend_t io_backend) {
     static const int NUM_BIG_ELTS_IN_QUEUE = 100;
-    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired,
+                                DEFAULT_MAX_CONCURRENT_IO_REQUESTS,
+                                io_backend);
 
     const serializer_filepath_t serializer_path = dbq_serializer_path();
 
@@ -71,7 +73,14 @@ void run_big_values_test() {
 }
 
 TEST(DiskBackedQueue, BigVals) {
-    unittest::run_in_thread_pool(&run_big_values_test, 2);
+    unittest::run_in_thread_pool(
+        std::bind(&run_big_values_test, io_backend_t::blocker_pool), 2);
+}
+
+TEST(DiskBackedQueue, BigValsIoUring) {
+    // Falls back to the blocker pool if the kernel doesn't support io_uring.
+    unittest::run_in_thread_pool(
+        std::bind(&run_big_values_test, io_backend_t::io_uring), 2);
 }
 
 static void randomly_delay(int, signal_t *) {
@@ -0,0 +1,84 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/io/disk.hpp"
+#include "random.hpp"
+#include "rdb_protocol/datum_stream/external_sort.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/rdb_env.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+namespace {
+
+const int NUM_KEYS = 50;
+const size_t ROWS_PER_RUN = 4;
+
+/* Enough runs that 16 runs of the first level get merged 16 times, those get merged
+into a run of the second level, and the final merge still has more than 16 runs to
+start with, so that they have to be reduced. */
+const size_t NUM_RUNS = 16 * 16 + 15 * 16 + 15;
+
+bool key_lt(ql::env_t *, profile::sampler_t *,
+            const ql::datum_t &a, const ql::datum_t &b) {
+    return a.get_field("k").as_num() < b.get_field("k").as_num();
+}
+
+}  // namespace
+
+TPTEST(ExternalSortTest, ManyRuns) {
+    temp_directory_t tmp_dir;
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    test_rdb_env_t test_env;
+    test_env.set_io_backender(&io_backender, tmp_dir.path());
+    scoped_ptr_t<test_rdb_env_t::instance_t> env_instance = test_env.make_env();
+    ql::env_t *env = env_instance->get_env();
+    ASSERT_TRUE(ql::external_sort_datum_stream_t::is_available(env));
+
+    counted_t<ql::external_sort_datum_stream_t> sort =
+        make_counted<ql::external_sort_datum_stream_t>(
+            env, &key_lt, ql::backtrace_id_t::empty());
+
+    // Many rows share a key, and `seq` is the order they were added in, which the
+    // sort has to keep among equal keys.
+    rng_t rng(1234);
+    int seq = 0;
+    for (size_t i = 0; i < NUM_RUNS; ++i) {
+        std::vector<ql::datum_t> run;
+        for (size_t j = 0; j < ROWS_PER_RUN; ++j) {
+            ql::datum_object_builder_t row;
+            row.overwrite("k", ql::datum_t(static_cast<double>(rng.randint(NUM_KEYS))));
+            row.overwrite("seq", ql::datum_t(static_cast<double>(seq++)));
+            run.push_back(std::move(row).to_datum());
+        }
+        sort->add_run(env, std::move(run));
+    }
+
+    std::vector<ql::datum_t> sorted;
+    for (;;) {
+        std::vector<ql::datum_t> batch = sort->next_batch(
+            env, ql::batchspec_t::user(ql::batch_type_t::NORMAL, env));
+        if (batch.empty()) {
+            break;
+        }
+        std::move(batch.begin(), batch.end(), std::back_inserter(sorted));
+    }
+    ASSERT_EQ(static_cast<size_t>(seq), sorted.size());
+    ASSERT_TRUE(sort->is_exhausted());
+
+    std::vector<bool> seen(seq, false);
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const int row_seq = static_cast<int>(sorted[i].get_field("seq").as_num());
+        ASSERT_FALSE(seen[row_seq]);
+        seen[row_seq] = true;
+        if (i > 0) {
+            const double prev_key = sorted[i - 1].get_field("k").as_num();
+            const double key = sorted[i].get_field("k").as_num();
+            ASSERT_LE(prev_key, key);
+            if (prev_key == key) {
+                ASSERT_LT(sorted[i - 1].get_field("seq").as_num(), row_seq);
+            }
+        }
+    }
+}
+
+}  // namespace unittest
@@ -0,0 +1,73 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/jobs/report.hpp"
+#include "containers/archive/string_stream.hpp"
+#include "serializer/log/startup_progress.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+table_load_job_report_t roundtrip_serialize(const table_load_job_report_t &report) {
+    write_message_t wm;
+    string_stream_t write_stream;
+    serialize<cluster_version_t::CLUSTER>(&wm, report);
+    int send_res = send_write_message(&write_stream, &wm);
+    EXPECT_EQ(0, send_res);
+
+    std::string serialized_value = write_stream.str();
+    string_read_stream_t read_stream(std::move(serialized_value), 0);
+
+    table_load_job_report_t res;
+    archive_result_t des_res =
+        deserialize<cluster_version_t::CLUSTER>(&read_stream, &res);
+    EXPECT_EQ(archive_result_t::SUCCESS, des_res);
+    return res;
+}
+
+TEST(JobsReportTest, TableLoadSerialization) {
+    const uuid_u id = generate_uuid();
+    const server_id_t server_id = server_id_t::generate_server_id();
+    const namespace_id_t table_id = generate_uuid();
+    table_load_job_report_t report =
+        roundtrip_serialize(table_load_job_report_t(id, 2.5, server_id, table_id, 0.25));
+
+    ASSERT_EQ("table_load", report.type);
+    ASSERT_EQ(id, report.id);
+    ASSERT_EQ(2.5, report.duration);
+    ASSERT_EQ(std::set<server_id_t>{server_id}, report.servers);
+    ASSERT_EQ(table_id, report.table);
+    ASSERT_EQ(0.25, report.progress_numerator / report.progress_denominator);
+}
+
+TEST(JobsReportTest, TableLoadMerge) {
+    const uuid_u id = generate_uuid();
+    const server_id_t server1 = server_id_t::generate_server_id();
+    const server_id_t server2 = server_id_t::generate_server_id();
+    const namespace_id_t table_id = generate_uuid();
+
+    // The progress of the same job on several servers is averaged.
+    table_load_job_report_t report(id, 1.0, server1, table_id, 0.25);
+    report.merge(table_load_job_report_t(id, 3.0, server2, table_id, 0.75));
+    ASSERT_EQ(3.0, report.duration);
+    ASSERT_EQ(2u, report.servers.size());
+    ASSERT_EQ(0.5, report.progress_numerator / report.progress_denominator);
+}
+
+TEST(JobsReportTest, StartupProgress) {
+    log_serializer_startup_progress_t progress;
+    // Nothing is known before the LBA superblocks have been read.
+    ASSERT_EQ(0.0, progress.progress());
+
+    progress.lba_entries_total = 200;
+    progress.lba_entries_applied = 50;
+    ASSERT_EQ(0.25, progress.progress());
+
+    // Applied entries beyond the total don't push the progress past 1.
+    progress.lba_entries_applied = 250;
+    ASSERT_EQ(1.0, progress.progress());
+
+    progress.lba_entries_applied = 0;
+    progress.is_ready = true;
+    ASSERT_EQ(1.0, progress.progress());
+}
+
+}  // namespace unittest
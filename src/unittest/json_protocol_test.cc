@@ -0,0 +1,112 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "client_protocol/json.hpp"
+#include "rapidjson/document.h"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/datum_string.hpp"
+#include "rdb_protocol/response.hpp"
+#include "threading.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+namespace {
+
+const int NUM_THREADS = 4;
+const int NUM_ROWS = 20000;
+
+std::vector<ql::datum_t> make_rows() {
+    std::vector<ql::datum_t> rows;
+    for (int i = 0; i < NUM_ROWS; ++i) {
+        ql::datum_object_builder_t row;
+        row.overwrite("id", ql::datum_t(static_cast<double>(i)));
+        row.overwrite("s", ql::datum_t(datum_string_t(strprintf("row %d", i))));
+        rows.push_back(std::move(row).to_datum());
+    }
+    return rows;
+}
+
+/* Keeps the current thread busy with coroutines that hog it, like a hot client
+connection would, while `fn` runs. The large responses are encoded in chunks that the
+other threads steal from this one. */
+template <class callable_t>
+void run_under_skewed_load(const callable_t &fn) {
+    const int num_hogs = 8;
+    bool stop = false;
+    int hogs_running = num_hogs;
+    cond_t hogs_done;
+    for (int i = 0; i < num_hogs; ++i) {
+        coro_t::spawn_sometime([&]() {
+            while (!stop) {
+                const ticks_t start = get_ticks();
+                while (get_ticks().nanos - start.nanos < 1000000) { }
+                coro_t::yield();
+            }
+            --hogs_running;
+            if (hogs_running == 0) {
+                hogs_done.pulse();
+            }
+        });
+    }
+    fn();
+    stop = true;
+    hogs_done.wait();
+}
+
+void parse_buffer(const chunked_string_buffer_t &buffer, rapidjson::Document *doc_out) {
+    std::string json;
+    buffer.append_to(&json);
+    doc_out->Parse(json.c_str());
+    ASSERT_FALSE(doc_out->HasParseError());
+}
+
+}  // namespace
+
+TEST(JsonProtocolTest, LargeResponseUnderSkewedLoad) {
+    run_in_thread_pool([&]() {
+        // Client connections run on the db threads, not on the utility thread that
+        // tests start on.
+        on_thread_t db_thread((threadnum_t(0)));
+        ql::response_t response;
+        response.set_type(Response::SUCCESS_SEQUENCE);
+        response.set_data(make_rows());
+        chunked_string_buffer_t buffer;
+        run_under_skewed_load([&]() {
+            json_protocol_t::write_response_to_buffer(&response, &buffer);
+        });
+
+        rapidjson::Document doc;
+        parse_buffer(buffer, &doc);
+        ASSERT_EQ(static_cast<int>(Response::SUCCESS_SEQUENCE), doc["t"].GetInt());
+        const rapidjson::Value &rows = doc["r"];
+        ASSERT_EQ(static_cast<rapidjson::SizeType>(NUM_ROWS), rows.Size());
+        for (int i = 0; i < NUM_ROWS; ++i) {
+            ASSERT_EQ(i, rows[i]["id"].GetInt());
+            ASSERT_EQ(strprintf("row %d", i), std::string(rows[i]["s"].GetString()));
+        }
+    }, NUM_THREADS);
+}
+
+TEST(JsonProtocolTest, LargeResponseError) {
+    // An error in any of the chunks turns the response into an error.
+    run_in_thread_pool([&]() {
+        on_thread_t db_thread((threadnum_t(0)));
+        std::vector<ql::datum_t> rows = make_rows();
+        rows[NUM_ROWS / 3] = ql::datum_t::minval();
+        ql::response_t response;
+        response.set_type(Response::SUCCESS_SEQUENCE);
+        response.set_data(std::move(rows));
+        chunked_string_buffer_t buffer;
+        json_protocol_t::write_response_to_buffer(&response, &buffer);
+
+        rapidjson::Document doc;
+        parse_buffer(buffer, &doc);
+        ASSERT_EQ(static_cast<int>(Response::RUNTIME_ERROR), doc["t"].GetInt());
+        ASSERT_EQ(static_cast<int>(Response::QUERY_LOGIC), doc["e"].GetInt());
+        ASSERT_EQ(std::string("Cannot convert `r.minval` to JSON."),
+                  std::string(doc["r"][0].GetString()));
+    }, NUM_THREADS);
+}
+
+}  // namespace unittest
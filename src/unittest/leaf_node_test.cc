@@ -1,9 +1,12 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include <map>
+#include <set>
 
+#include "arch/timing.hpp"
 #include "btree/leaf_node.hpp"
 #include "btree/node.hpp"
 #include "containers/scoped.hpp"
+#include "random.hpp"
 #include "repli_timestamp.hpp"
 #include "unittest/gtest.hpp"
 #include "unittest/unittest_utils.hpp"
@@ -346,7 +349,8 @@ scoped_ptr_t<LeafNodeTracker> test_random_out_of_order(
         int num_ops,
         bool random_tstamps,
         store_key_t low_key = store_key_t::min(),
-        store_key_t high_key = store_key_t::max()) {
+        store_key_t high_key = store_key_t::max(),
+        const std::string &key_prefix = "") {
 
     scoped_ptr_t<LeafNodeTracker> tracker(new LeafNodeTracker());
 
@@ -355,7 +359,7 @@ scoped_ptr_t<LeafNodeTracker> test_random_out_of_order(
     std::vector<store_key_t> key_pool(num_keys);
     for (int i = 0; i < num_keys; ++i) {
         do {
-            key_pool[i] = store_key_t(random_letter_string(&rng, 0, 159));
+            key_pool[i] = store_key_t(key_prefix + random_letter_string(&rng, 0, 159));
         } while (key_pool[i].compare(low_key) < 0 || key_pool[i].compare(high_key) >= 0);
     }
 
@@ -402,11 +406,12 @@ void make_node_underfull(LeafNodeTracker *tracker, rng_t *rng) {
     while (!tracker->IsUnderfull() ||
            (node->num_pairs > 0 && rng->randint(2) == 0)) {
         int chosen = rng->randint(node->num_pairs);
-        auto pair = *leaf_node_t::iterator(node, chosen);
+        // The iterator owns the key, so we need to copy it right away.
+        store_key_t key((*leaf_node_t::iterator(node, chosen)).first);
 
         // We might hit a removal entry; skip those.
-        if (tracker->ShouldHave(store_key_t(pair.first))) {
-            tracker->Remove(store_key_t(pair.first));
+        if (tracker->ShouldHave(key)) {
+            tracker->Remove(key);
         }
     }
 }
@@ -462,6 +467,84 @@ TEST(LeafNodeTest, RandomSplitting) {
     }
 }
 
+TEST(LeafNodeTest, RandomMergingWithPrefixes) {
+    rng_t rng;
+
+    for (int try_num = 0; try_num < 100; ++try_num) {
+        bool zero_timestamps = (try_num % 2) == 0;
+
+        // The nodes' prefixes differ, so one of them has to be shortened.
+        scoped_ptr_t<LeafNodeTracker> left = test_random_out_of_order(
+                40, 200, zero_timestamps, store_key_t::min(), store_key_t::max(),
+                "prefix/left/");
+        scoped_ptr_t<LeafNodeTracker> right = test_random_out_of_order(
+                40, 200, zero_timestamps, store_key_t::min(), store_key_t::max(),
+                "prefix/right/");
+
+        make_node_underfull(left.get(), &rng);
+        make_node_underfull(right.get(), &rng);
+
+        right->Merge(left.get());
+    }
+}
+
+TEST(LeafNodeTest, RandomSplittingWithPrefixes) {
+    rng_t rng;
+
+    for (int try_num = 0; try_num < 100; ++try_num) {
+        bool zero_timestamps = (try_num % 2) == 0;
+
+        scoped_ptr_t<LeafNodeTracker> node = test_random_out_of_order(
+                40, 200, zero_timestamps, store_key_t::min(), store_key_t::max(),
+                "prefix/");
+
+        while (true) {
+            store_key_t key("prefix/" + random_letter_string(&rng, 0, 160));
+            std::string value = random_letter_string(&rng, 0, 160);
+            if (node->IsFull(key, value)) {
+                break;
+            } else {
+                node->Insert(key, value);
+            }
+        }
+
+        LeafNodeTracker right;
+        node->Split(&right);
+    }
+}
+
+TEST(LeafNodeTest, RandomLevelingWithPrefixes) {
+    rng_t rng;
+
+    for (int try_num = 0; try_num < 100; ++try_num) {
+        bool zero_timestamps = (try_num % 2) == 0;
+        bool left_to_right = (try_num % 4) < 2;
+
+        scoped_ptr_t<LeafNodeTracker> node = test_random_out_of_order(
+                40, 200, zero_timestamps, store_key_t::min(), store_key_t::max(),
+                left_to_right ? "prefix/right/" : "prefix/left/");
+        make_node_underfull(node.get(), &rng);
+
+        // Fill the sibling with short keys, so that it only fits with its
+        // prefix.  The tracker expects the replacement key to be a live key,
+        // so we don't remove any.
+        const std::string sibling_prefix = left_to_right ? "prefix/left/" : "prefix/right/";
+        LeafNodeTracker sibling;
+        for (;;) {
+            store_key_t key(sibling_prefix + random_letter_string(&rng, 1, 4));
+            if (sibling.IsFull(key, "v")) {
+                break;
+            }
+            sibling.Insert(key, "v");
+        }
+        ASSERT_FALSE(sibling.IsUnderfull());
+
+        bool could_level;
+        node->Level(left_to_right ? 1 : -1, &sibling, &could_level);
+        ASSERT_TRUE(could_level);
+    }
+}
+
 TEST(LeafNodeTest, DeletionTimestamp) {
     LeafNodeTracker tracker;
 
@@ -703,12 +786,153 @@ TEST(LeafNodeTest, Splitting) {
 
 TEST(LeafNodeTest, Fullness) {
     LeafNodeTracker node;
+    // The keys have no common prefix, so the arithmetic from
+    // LevelingLeftToRight applies.
     int i;
     for (i = 0; i < 4272 / 12; ++i) {
-        node.Insert(store_key_t(strprintf("a%d", i)), strprintf("A%d", i));
+        node.Insert(store_key_t(strprintf("%c%d", 'a' + i % 2, i)), strprintf("A%d", i));
+    }
+
+    ASSERT_TRUE(node.IsFull(store_key_t(strprintf("%c%d", 'a' + i % 2, i)),
+                            strprintf("A%d", i)));
+}
+
+TEST(LeafNodeTest, PrefixCompression) {
+    LeafNodeTracker node;
+    const std::string prefix(100, 'p');
+
+    // Without prefix compression, each entry would take up more than 100
+    // bytes.
+    int i = 0;
+    while (node.Insert(store_key_t(prefix + strprintf("%d", i)), "v")) {
+        ++i;
+    }
+    ASSERT_LT(4096 / 100, i / 4);
+
+    // A key without the prefix would make every other key longer.
+    ASSERT_TRUE(node.IsFull(store_key_t("q"), "v"));
+
+    // Once most of the keys are gone, the prefix can get shorter.
+    for (int j = 0; j < i - 10; ++j) {
+        node.Remove(store_key_t(prefix + strprintf("%d", j)));
+    }
+    ASSERT_TRUE(node.Insert(store_key_t("q"), "v"));
+    ASSERT_TRUE(node.Insert(store_key_t(prefix), "v"));
+}
+
+void run_find_key_test(const std::string &prefix) {
+    rng_t rng(4321);
+    LeafNodeTracker node;
+    std::set<store_key_t> keys;
+    for (;;) {
+        store_key_t key(prefix + strprintf("%" PRIu64, rng.randuint64(1000000)));
+        if (keys.count(key) == 0 && !node.Insert(key, "v")) {
+            break;
+        }
+        keys.insert(key);
+    }
+
+    // The keys that are in the node are found at their rank, and the ones that
+    // aren't at the rank that they would have.
+    for (int i = 0; i < 2000; ++i) {
+        store_key_t key = i % 2 == 0
+            ? *std::next(keys.begin(), rng.randint(keys.size()))
+            : store_key_t(prefix + strprintf("%" PRIu64, rng.randuint64(1000000)));
+        const int rank = std::distance(keys.begin(), keys.lower_bound(key));
+        const bool present = keys.count(key) != 0;
+        int index;
+        ASSERT_EQ(present, leaf::find_key(node.node(), key.btree_key(), &index));
+        ASSERT_EQ(rank, index);
+        ASSERT_EQ(present,
+                  leaf::find_key_full_compare(node.node(), key.btree_key(), &index));
+        ASSERT_EQ(rank, index);
+    }
+    for (const store_key_t &key : {store_key_t(""), store_key_t(prefix),
+                                   store_key_t(prefix + "~"), store_key_t("~")}) {
+        int index;
+        ASSERT_FALSE(leaf::find_key(node.node(), key.btree_key(), &index));
+        ASSERT_EQ(std::distance(keys.begin(), keys.lower_bound(key)), index);
     }
+}
 
-    ASSERT_TRUE(node.IsFull(store_key_t(strprintf("a%d", i)), strprintf("A%d", i)));
+TEST(LeafNodeTest, FindKey) {
+    run_find_key_test("");
+    run_find_key_test("user:");
+}
+
+#ifdef NDEBUG
+TEST(LeafNodeTest, FindKeyBenchmark) {
+    // Far more leaf nodes than fit into the CPU caches, like in a large table, so
+    // that most probes of the binary search miss the cache.
+    const int NUM_NODES = 65536;
+    const int NUM_LOOKUPS = 200000;
+    const int NUM_ROUNDS = 5;
+    rng_t rng(8765);
+    max_block_size_t bs = max_block_size_t::unsafe_make(4096);
+    short_value_sizer_t sizer(bs);
+    short_value_buffer_t value("v");
+    std::vector<scoped_malloc_t<leaf_node_t> > nodes(NUM_NODES);
+    for (scoped_malloc_t<leaf_node_t> &node : nodes) {
+        node = scoped_malloc_t<leaf_node_t>(bs.value());
+        leaf::init(&sizer, node.get());
+        for (;;) {
+            store_key_t key(strprintf("user:%012" PRIu64, rng.randuint64(UINT64_C(1) << 40)));
+            if (leaf::is_full(&sizer, node.get(), key.btree_key(), value.data())) {
+                break;
+            }
+            leaf::insert(&sizer, node.get(), key.btree_key(), value.data(),
+                         repli_timestamp_t::distant_past, repli_timestamp_t::distant_past,
+                         key_modification_proof_t::real_proof());
+        }
+    }
+
+    // Half of the lookups are for keys that are in the node.
+    std::vector<std::pair<int, store_key_t> > lookups;
+    lookups.reserve(NUM_LOOKUPS);
+    for (int i = 0; i < NUM_LOOKUPS; ++i) {
+        const int n = rng.randint(NUM_NODES);
+        store_key_t key(strprintf("user:%012" PRIu64, rng.randuint64(UINT64_C(1) << 40)));
+        if (i % 2 == 0) {
+            std::vector<store_key_t> node_keys;
+            leaf::visit_entries(&sizer, nodes[n].get(), repli_timestamp_t::distant_past,
+                [&](const btree_key_t *k, repli_timestamp_t, const void *)
+                        -> continue_bool_t {
+                    node_keys.push_back(store_key_t(k));
+                    return continue_bool_t::CONTINUE;
+                });
+            key = node_keys[rng.randint(node_keys.size())];
+        }
+        lookups.push_back(std::make_pair(n, key));
+    }
+
+    const struct {
+        const char *name;
+        bool (*fn)(const leaf_node_t *, const btree_key_t *, int *);
+    } impls[] = {
+        { "find_key", &leaf::find_key },
+        { "find_key_full_compare", &leaf::find_key_full_compare }
+    };
+    double total_secs[2] = { 0, 0 };
+    uint64_t sum = 0;
+    // Alternate between the implementations, so that they see the same conditions.
+    for (int round = 0; round < NUM_ROUNDS; ++round) {
+        for (int i = 0; i < 2; ++i) {
+            ticks_t start_ticks = get_ticks();
+            for (const auto &lookup : lookups) {
+                int index;
+                sum += impls[i].fn(nodes[lookup.first].get(), lookup.second.btree_key(),
+                                   &index);
+                sum += index;
+            }
+            total_secs[i] += ticks_to_secs(ticks_t{get_ticks().nanos - start_ticks.nanos});
+        }
+    }
+    for (int i = 0; i < 2; ++i) {
+        printf("%s: %f ns per lookup\n", impls[i].name,
+               total_secs[i] * 1e9 / (NUM_ROUNDS * NUM_LOOKUPS));
+    }
+    printf("(%" PRIu64 ")\n", sum);
 }
+#endif  // NDEBUG
 
 }  // namespace unittest
@@ -60,6 +60,9 @@ public:
     void open_serializer_file_existing(scoped_ptr_t<file_t> *file_out);
     void unlink_serializer_file();
 
+    // The contents of the file, for tests that want to damage it.
+    std::vector<char> *file_data() { return &file_; }
+
 private:
     enum existence_state_t { no_file, temporary_file, permanent_file, unlinked_file };
     existence_state_t file_existence_state_;
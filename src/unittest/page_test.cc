@@ -1,9 +1,14 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <vector>
+
 #include "arch/runtime/coroutines.hpp"
 #include "arch/timing.hpp"
 #include "buffer_cache/page_cache.hpp"
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "buffer_cache/stats.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/pmap.hpp"
 #include "containers/scoped.hpp"
@@ -312,8 +317,11 @@ TPTEST(PageTest, WriteWaitForFlush, 4) {
 
 class bigger_test_t {
 public:
-    explicit bigger_test_t(uint64_t _memory_limit)
-        : memory_limit(_memory_limit), mock(), c(NULL),
+    explicit bigger_test_t(uint64_t _memory_limit,
+                           cache_eviction_policy_t _eviction_policy
+                               = cache_eviction_policy_t::sampled_lru)
+        : memory_limit(_memory_limit), eviction_policy(_eviction_policy),
+          mock(), c(NULL),
           txn1_ptr(NULL), txn2_ptr(NULL) {
         for (size_t i = 0; i < b_len; ++i) {
             b[i] = NULL_BLOCK_ID;
@@ -322,7 +330,7 @@ public:
 
     void run() {
         {
-            dummy_cache_balancer_t balancer(memory_limit);
+            dummy_cache_balancer_t balancer(memory_limit, eviction_policy);
             test_cache_t cache(mock.ser.get(), &balancer, mock.throttler.get());
             auto_drainer_t drain;
             c = &cache;
@@ -368,7 +376,7 @@ public:
         c = nullptr;
 
         {
-            dummy_cache_balancer_t balancer(memory_limit);
+            dummy_cache_balancer_t balancer(memory_limit, eviction_policy);
             test_cache_t cache(mock.ser.get(), &balancer, mock.throttler.get());
             auto_drainer_t drain;
             c = &cache;
@@ -380,7 +388,7 @@ public:
         c = nullptr;
 
         {
-            dummy_cache_balancer_t balancer(memory_limit);
+            dummy_cache_balancer_t balancer(memory_limit, eviction_policy);
             test_cache_t cache(mock.ser.get(), &balancer, mock.throttler.get());
             c = &cache;
             auto txn = make_scoped<test_txn_t>(c);
@@ -1127,6 +1135,7 @@ private:
     }
 
     const uint64_t memory_limit;
+    const cache_eviction_policy_t eviction_policy;
 
     mock_ser_t mock;
     test_cache_t *c;
@@ -1177,4 +1186,198 @@ TPTEST(PageTest, BiggerTestNoMemory, 4) {
     test.run();
 }
 
+TPTEST(PageTest, BiggerTestTightMemoryTwoQueue, 4) {
+    bigger_test_t test(8192, cache_eviction_policy_t::two_queue);
+    test.run();
+}
+
+TPTEST(PageTest, BiggerTestNoMemoryTwoQueue, 4) {
+    bigger_test_t test(0, cache_eviction_policy_t::two_queue);
+    test.run();
+}
+
+void read_block(page_cache_t *cache, block_id_t block_id) {
+    current_test_acq_t acq(cache, block_id, read_access_t::read);
+    test_acq_t page_acq;
+    page_acq.init(acq.current_page_for_read(), cache);
+    const char *buf = static_cast<const char *>(page_acq.get_buf_read());
+    ASSERT_EQ(static_cast<char>(block_id), buf[0]);
+}
+
+// Creates blocks that `read_block()` can check, and returns their ids.
+std::vector<block_id_t> create_blocks(mock_ser_t *mock, size_t count) {
+    std::vector<block_id_t> block_ids;
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t cache(mock->ser.get(), &balancer, mock->throttler.get());
+    auto txn = make_scoped<test_txn_t>(&cache);
+    for (size_t i = 0; i < count; ++i) {
+        current_test_acq_t acq(txn.get(), alt_create_t::create);
+        acq.write_acq_signal()->wait();
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_write(), &cache);
+        memset(page_acq.get_buf_write(), static_cast<char>(acq.block_id()),
+               cache.max_block_size().value());
+        block_ids.push_back(acq.block_id());
+    }
+    cache.flush(std::move(txn));
+    return block_ids;
+}
+
+TPTEST(PageTest, ScanResistance, 4) {
+    mock_ser_t mock;
+    const size_t num_hot = 8;
+    const size_t num_cold = 100;
+    std::vector<block_id_t> block_ids = create_blocks(&mock, num_hot + num_cold);
+
+    // Room for about twenty blocks, so the cold blocks can't all stay in memory.
+    dummy_cache_balancer_t balancer(24 * 4096, cache_eviction_policy_t::two_queue);
+    test_cache_t cache(mock.ser.get(), &balancer, mock.throttler.get());
+    for (int round = 0; round < 2; ++round) {
+        for (size_t i = 0; i < num_hot; ++i) {
+            read_block(&cache, block_ids[i]);
+        }
+    }
+    ASSERT_EQ(num_hot, cache.evicter().miss_count());
+    ASSERT_EQ(num_hot, cache.evicter().hit_count());
+
+    // A scan touches every cold block once, which shouldn't push the hot blocks out.
+    for (size_t i = num_hot; i < num_hot + num_cold; ++i) {
+        read_block(&cache, block_ids[i]);
+    }
+    ASSERT_EQ(num_hot + num_cold, cache.evicter().miss_count());
+    ASSERT_LT(0u, cache.evicter().eviction_count());
+
+    for (size_t i = 0; i < num_hot; ++i) {
+        read_block(&cache, block_ids[i]);
+    }
+    ASSERT_EQ(num_hot + num_cold, cache.evicter().miss_count());
+}
+
+// Waits until no page is being loaded (or acquired).
+void wait_for_loads(page_cache_t *cache) {
+    while (cache->evicter().unevictable_size() > 0) {
+        coro_t::yield();
+    }
+}
+
+// Prefetches blocks from `block_ids` until the prefetch budget runs out, and returns
+// how many it prefetched.
+size_t prefetch_until_full(page_cache_t *cache,
+                           const std::vector<block_id_t> &block_ids) {
+    size_t count = 0;
+    while (count < block_ids.size()
+           && cache->prefetch_block(block_ids[count], cache->default_reads_account())) {
+        ++count;
+    }
+    return count;
+}
+
+uint64_t get_stat(perfmon_t *perfmon) {
+    void *ctx = perfmon->begin_stats();
+    perfmon->visit_stats(ctx);
+    return perfmon->end_stats(ctx).as_num();
+}
+
+TPTEST(PageTest, PrefetchBudget, 4) {
+    mock_ser_t mock;
+    std::vector<block_id_t> block_ids = create_blocks(&mock, 100);
+
+    dummy_cache_balancer_t balancer(128 * 4096);
+    test_cache_t cache(mock.ser.get(), &balancer, mock.throttler.get());
+    perfmon_collection_t collection;
+    alt_cache_stats_t stats(&cache, &collection);
+
+    // Prefetched pages that nobody uses may only take up a small part of the cache.
+    const size_t num_prefetched = prefetch_until_full(&cache, block_ids);
+    ASSERT_LT(0u, num_prefetched);
+    ASSERT_LE(num_prefetched * cache.max_block_size().ser_value(),
+              cache.evicter().memory_limit() / 8);
+    ASSERT_FALSE(cache.evicter().prefetch_budget_available());
+    ASSERT_EQ(num_prefetched, cache.evicter().prefetch_count());
+    ASSERT_EQ(num_prefetched, get_stat(&stats.prefetches_total));
+    wait_for_loads(&cache);
+
+    // Using a prefetched page is a hit, and makes room for another prefetch.
+    const uint64_t misses = cache.evicter().miss_count();
+    read_block(&cache, block_ids[0]);
+    ASSERT_EQ(misses, cache.evicter().miss_count());
+    ASSERT_EQ(1u, cache.evicter().prefetch_hit_count());
+    ASSERT_EQ(1u, get_stat(&stats.prefetch_hits_total));
+    ASSERT_TRUE(cache.evicter().prefetch_budget_available());
+
+    // Prefetching a page that's in memory already doesn't do anything.
+    ASSERT_FALSE(cache.prefetch_block(block_ids[0], cache.default_reads_account()));
+    ASSERT_TRUE(cache.prefetch_block(block_ids[num_prefetched],
+                                     cache.default_reads_account()));
+    ASSERT_EQ(num_prefetched + 1, get_stat(&stats.prefetches_total));
+
+    // Using it again doesn't count as another prefetch hit.
+    read_block(&cache, block_ids[0]);
+    ASSERT_EQ(1u, get_stat(&stats.prefetch_hits_total));
+
+    // Block ids that aren't in use can't be prefetched.
+    ASSERT_FALSE(cache.prefetch_block(block_ids.back() + 1,
+                                      cache.default_reads_account()));
+    ASSERT_EQ(num_prefetched + 1, cache.evicter().prefetch_count());
+}
+
+TPTEST(PageTest, PrefetchEvicted, 4) {
+    mock_ser_t mock;
+    std::vector<block_id_t> block_ids = create_blocks(&mock, 1000);
+
+    dummy_cache_balancer_t balancer(128 * 4096);
+    test_cache_t cache(mock.ser.get(), &balancer, mock.throttler.get());
+    const size_t num_prefetched = prefetch_until_full(&cache, block_ids);
+    ASSERT_LT(0u, num_prefetched);
+    wait_for_loads(&cache);
+
+    // A scan through many more blocks than fit in the cache evicts the prefetched
+    // pages, which gives their share of the cache back.
+    for (size_t i = num_prefetched; i < block_ids.size(); ++i) {
+        read_block(&cache, block_ids[i]);
+    }
+    ASSERT_LT(0u, cache.evicter().eviction_count());
+    ASSERT_EQ(0u, cache.evicter().prefetch_hit_count());
+    ASSERT_TRUE(cache.evicter().prefetch_budget_available());
+
+    // So the blocks can be prefetched again.
+    ASSERT_EQ(num_prefetched, prefetch_until_full(&cache, block_ids));
+    ASSERT_EQ(2 * num_prefetched, cache.evicter().prefetch_count());
+    wait_for_loads(&cache);
+    for (size_t i = 0; i < num_prefetched; ++i) {
+        read_block(&cache, block_ids[i]);
+    }
+    ASSERT_EQ(num_prefetched, cache.evicter().prefetch_hit_count());
+}
+
+TPTEST(PageTest, PrefetchDeleted, 4) {
+    mock_ser_t mock;
+    std::vector<block_id_t> block_ids = create_blocks(&mock, 100);
+
+    dummy_cache_balancer_t balancer(128 * 4096);
+    test_cache_t cache(mock.ser.get(), &balancer, mock.throttler.get());
+    const size_t num_prefetched = prefetch_until_full(&cache, block_ids);
+    ASSERT_LT(0u, num_prefetched);
+    wait_for_loads(&cache);
+
+    // Deleting a prefetched block gives its share of the cache back...
+    {
+        auto txn = make_scoped<test_txn_t>(&cache);
+        {
+            current_test_acq_t acq(txn.get(), block_ids[0], access_t::write);
+            acq.write_acq_signal()->wait();
+            acq.mark_deleted();
+        }
+        cache.flush(std::move(txn));
+    }
+    ASSERT_EQ(0u, cache.evicter().prefetch_hit_count());
+    ASSERT_TRUE(cache.evicter().prefetch_budget_available());
+
+    // ... and the deleted block can't be prefetched anymore.
+    ASSERT_FALSE(cache.prefetch_block(block_ids[0], cache.default_reads_account()));
+    ASSERT_TRUE(cache.prefetch_block(block_ids[num_prefetched],
+                                     cache.default_reads_account()));
+    ASSERT_EQ(num_prefetched + 1, cache.evicter().prefetch_count());
+}
+
 }  // namespace unittest
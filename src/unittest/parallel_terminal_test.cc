@@ -0,0 +1,96 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/parallel_terminal.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/rdb_env.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+namespace {
+
+const int NUM_ROWS = 1000;
+const int NUM_GROUPS = 7;
+
+ql::datum_t make_row(int i) {
+    ql::datum_object_builder_t row;
+    row.overwrite("g", ql::datum_t(static_cast<double>(i % NUM_GROUPS)));
+    row.overwrite("v", ql::datum_t(static_cast<double>(i)));
+    return std::move(row).to_datum();
+}
+
+ql::transform_variant_t make_group_by_g() {
+    const ql::sym_t x(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    std::vector<counted_t<const ql::func_t> > funcs;
+    funcs.push_back(ql::map_wire_func_t(r.var(x)["g"].root_term(), make_vector(x))
+        .compile_wire_func());
+    return ql::group_wire_func_t(std::move(funcs), false, false);
+}
+
+}  // namespace
+
+TPTEST_MULTITHREAD(ParallelTerminalTest, GroupCount, 4) {
+    test_rdb_env_t test_env;
+    scoped_ptr_t<test_rdb_env_t::instance_t> env_instance = test_env.make_env();
+    ql::env_t *env = env_instance->get_env();
+
+    const std::vector<ql::transform_variant_t> transforms{make_group_by_g()};
+    const ql::terminal_variant_t terminal = ql::count_wire_func_t();
+    scoped_ptr_t<ql::parallel_terminal_t> parallel =
+        ql::parallel_terminal_t::make(env, transforms, terminal);
+    ASSERT_TRUE(parallel.has());
+
+    for (int i = 0; i < NUM_ROWS; ++i) {
+        ASSERT_TRUE(parallel->add(make_row(i), 1));
+    }
+    scoped_ptr_t<ql::accumulator_t> acc = ql::make_terminal(terminal);
+    ql::result_t result;
+    parallel->finish(acc.get(), continue_bool_t::CONTINUE, &result);
+
+    ql::grouped_t<uint64_t> *counts = boost::get<ql::grouped_t<uint64_t> >(&result);
+    ASSERT_TRUE(counts != nullptr);
+    ASSERT_EQ(static_cast<size_t>(NUM_GROUPS), counts->size());
+    for (int g = 0; g < NUM_GROUPS; ++g) {
+        const uint64_t expected =
+            NUM_ROWS / NUM_GROUPS + (g < NUM_ROWS % NUM_GROUPS ? 1 : 0);
+        EXPECT_EQ(expected, (*counts)[ql::datum_t(static_cast<double>(g))]);
+    }
+}
+
+TPTEST_MULTITHREAD(ParallelTerminalTest, Error, 4) {
+    test_rdb_env_t test_env;
+    scoped_ptr_t<test_rdb_env_t::instance_t> env_instance = test_env.make_env();
+    ql::env_t *env = env_instance->get_env();
+
+    // Summing up a string fails, and the error has to make it into the result.
+    const ql::sym_t x(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    const ql::terminal_variant_t terminal = ql::sum_wire_func_t(
+        ql::backtrace_id_t::empty(), r.var(x)["v"].root_term(), make_vector(x));
+    scoped_ptr_t<ql::parallel_terminal_t> parallel = ql::parallel_terminal_t::make(
+        env, std::vector<ql::transform_variant_t>{make_group_by_g()}, terminal);
+    ASSERT_TRUE(parallel.has());
+
+    for (int i = 0; i < NUM_ROWS; ++i) {
+        ql::datum_t row = make_row(i);
+        if (i == NUM_ROWS / 2) {
+            ql::datum_object_builder_t bad_row;
+            bad_row.overwrite("g", ql::datum_t(0.0));
+            bad_row.overwrite("v", ql::datum_t("not a number"));
+            row = std::move(bad_row).to_datum();
+        }
+        if (!parallel->add(std::move(row), 1)) {
+            break;
+        }
+    }
+    scoped_ptr_t<ql::accumulator_t> acc = ql::make_terminal(terminal);
+    ql::result_t result;
+    parallel->finish(acc.get(), continue_bool_t::CONTINUE, &result);
+    EXPECT_TRUE(boost::get<ql::exc_t>(&result) != nullptr);
+}
+
+}  // namespace unittest
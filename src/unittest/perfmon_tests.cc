@@ -57,4 +57,36 @@ TEST(PerfmonTest, StddevComputation) {
     }
 }
 
+TEST(PerfmonTest, LatencyHistogram) {
+    latency_histogram_t histogram;
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ(0u, histogram.percentile_micros(0.5));
+
+    // One duration for every millisecond from 1 to 1000
+    for (int64_t ms = 1; ms <= 1000; ++ms) {
+        histogram.record(ticks_t{ms * 1000000});
+    }
+    EXPECT_EQ(1000u, histogram.count());
+    // The buckets are at most 12.5% wide, and we report their upper bound.
+    EXPECT_GE(histogram.percentile_micros(0.5), 500000u);
+    EXPECT_LE(histogram.percentile_micros(0.5), 562500u);
+    EXPECT_GE(histogram.percentile_micros(0.99), 990000u);
+    EXPECT_EQ(1000000u, histogram.percentile_micros(1.0));
+
+    // Small durations are exact
+    latency_histogram_t small;
+    small.record(ticks_t{3000});
+    EXPECT_EQ(3u, small.percentile_micros(0.5));
+
+    histogram.merge(small);
+    EXPECT_EQ(1001u, histogram.count());
+
+    latency_histogram_t parsed;
+    ASSERT_TRUE(latency_histogram_t::from_datum(histogram.to_datum(true), &parsed));
+    EXPECT_EQ(histogram.count(), parsed.count());
+    EXPECT_EQ(histogram.percentile_micros(0.5), parsed.percentile_micros(0.5));
+    EXPECT_EQ(histogram.percentile_micros(0.999), parsed.percentile_micros(0.999));
+    EXPECT_FALSE(latency_histogram_t::from_datum(histogram.to_datum(false), &parsed));
+}
+
 }  // namespace unittest
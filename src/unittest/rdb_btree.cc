@@ -286,6 +286,50 @@ TPTEST(RDBBtree, SindexPostConstruct) {
     check_keys_are_present(&store, sindex_name);
 }
 
+TPTEST(RDBBtree, SindexPostConstructLargeBlocks) {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    log_serializer_t::create(
+        &file_opener,
+        log_serializer_t::static_config_t(MAX_BTREE_BLOCK_SIZE));
+
+    log_serializer_t serializer(
+        log_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+    ASSERT_EQ(MAX_BTREE_BLOCK_SIZE,
+              static_cast<int64_t>(serializer.max_block_size().ser_value()));
+
+    store_t store(
+            region_t::universe(),
+            &serializer,
+            &balancer,
+            "unit_test_store",
+            true,
+            &get_global_perfmon_collection(),
+            nullptr,
+            &io_backender,
+            base_path_t("."),
+            generate_uuid(),
+            update_sindexes_t::UPDATE,
+            which_cpu_shard_t{0, 1});
+
+    insert_rows(0, (TOTAL_KEYS_TO_INSERT * 9) / 10, &store);
+
+    sindex_name_t sindex_name = create_sindex(&store);
+
+    cond_t background_inserts_done;
+    spawn_writes(&store, &background_inserts_done);
+    background_inserts_done.wait();
+
+    check_keys_are_present(&store, sindex_name);
+}
+
 TPTEST(RDBBtree, SindexEraseRange) {
     recreate_temporary_directory(base_path_t("."));
     temp_file_t temp_file;
@@ -253,10 +253,16 @@ mock_namespace_interface_t::write_visitor_t::write_visitor_t(
     // Do nothing
 }
 
-test_rdb_env_t::test_rdb_env_t() { }
+test_rdb_env_t::test_rdb_env_t() : io_backender(nullptr) { }
 
 test_rdb_env_t::~test_rdb_env_t() { }
 
+void test_rdb_env_t::set_io_backender(io_backender_t *_io_backender,
+                                      const base_path_t &_base_path) {
+    io_backender = _io_backender;
+    base_path = _base_path;
+}
+
 void test_rdb_env_t::add_table(const std::string &db_name,
                                const std::string &table_name,
                                const std::string &primary_key) {
@@ -295,7 +301,14 @@ scoped_ptr_t<test_rdb_env_t::instance_t> test_rdb_env_t::make_env() {
 test_rdb_env_t::instance_t::instance_t(test_rdb_env_t &&test_env) :
     extproc_pool(2),
     auth_manager(auth_semilattice_metadata_t("")),
-    rdb_ctx(&extproc_pool, this, auth_manager.get_view())
+    rdb_ctx(&extproc_pool,
+            nullptr,
+            test_env.io_backender,
+            test_env.base_path,
+            this,
+            auth_manager.get_view(),
+            &get_global_perfmon_collection(),
+            std::string())
 {
     env.init(
         new ql::env_t(
@@ -419,6 +432,8 @@ bool test_rdb_env_t::instance_t::table_create(
         UNUSED const table_generate_config_params_t &config_params,
         UNUSED const std::string &primary_key,
         UNUSED write_durability_t durability,
+        UNUSED uint64_t block_size,
+        UNUSED block_compression_t block_compression,
         UNUSED signal_t *local_interruptor,
         UNUSED ql::datum_t *result_out,
         admin_err_t *error_out) {
@@ -131,6 +131,9 @@ public:
     test_rdb_env_t();
     ~test_rdb_env_t();
 
+    // Lets queries spill large sorts to temporary files in `base_path`.
+    void set_io_backender(io_backender_t *io_backender, const base_path_t &base_path);
+
     void add_database(const std::string &db_name);
     void add_table(const std::string &db_name,
                    const std::string &table_name,
@@ -191,6 +194,8 @@ public:
                 const table_generate_config_params_t &config_params,
                 const std::string &primary_key,
                 write_durability_t durability,
+                uint64_t block_size,
+                block_compression_t block_compression,
                 signal_t *interruptor,
                 ql::datum_t *result_out,
                 admin_err_t *error_out);
@@ -373,6 +378,9 @@ public:
 private:
     extproc_spawner_t extproc_spawner;
 
+    io_backender_t *io_backender;
+    base_path_t base_path;
+
     struct table_data_t {
         datum_string_t primary_key;
         std::map<store_key_t, ql::datum_t> initial_data;
@@ -9,6 +9,7 @@
 
 #include "arch/runtime/thread_pool.hpp"
 #include "arch/timing.hpp"
+#include "concurrency/pmap.hpp"
 #include "containers/scoped.hpp"
 #include "containers/archive/socket_stream.hpp"
 #include "unittest/clustering_utils.hpp"
@@ -32,16 +33,16 @@ public:
         cluster_message_handler_t(cm, _tag),
         sequence_number(0)
         { }
-    void send(int message, peer_id_t peer) {
+    void send(int message, peer_id_t peer, uint64_t ordering_key = 0) {
         auto_drainer_t::lock_t connection_keepalive;
         connectivity_cluster_t::connection_t *connection =
             get_connectivity_cluster()->get_connection(peer, &connection_keepalive);
         if (connection) {
-            send(message, connection, connection_keepalive);
+            send(message, connection, connection_keepalive, ordering_key);
         }
     }
     void send(int message, connectivity_cluster_t::connection_t *connection,
-            auto_drainer_t::lock_t connection_keepalive) {
+            auto_drainer_t::lock_t connection_keepalive, uint64_t ordering_key = 0) {
         class writer_t : public cluster_send_message_write_callback_t {
         public:
             explicit writer_t(int _data) : data(_data) { }
@@ -60,7 +61,7 @@ public:
             int32_t data;
         } writer(message);
         get_connectivity_cluster()->send_message(connection, connection_keepalive,
-            get_message_tag(), &writer);
+            get_message_tag(), &writer, ordering_key);
     }
     void expect(int message, peer_id_t peer) {
         expect_delivered(message);
@@ -241,6 +242,41 @@ TPTEST_MULTITHREAD(RPCConnectivityTest, Ordering, 3) {
     }
 }
 
+/* `LaneOrdering` checks that messages sent with the same ordering key arrive in order
+when they are spread over several lanes, including when the two servers ask for
+different numbers of lanes. */
+
+TPTEST_MULTITHREAD(RPCConnectivityTest, LaneOrdering, 3) {
+    connectivity_cluster_t c1, c2, c3;
+    recording_test_application_t a1(&c1, 'T'), a2(&c2, 'T'), a3(&c3, 'T');
+    test_cluster_run_t cr1(&c1, peer_address_t(), 4);
+    test_cluster_run_t cr2(&c2, peer_address_t(), 4);
+    test_cluster_run_t cr3(&c3, peer_address_t(), 2);
+
+    cr1.join(get_cluster_local_address(&c2), 0);
+    cr3.join(get_cluster_local_address(&c1), 0);
+
+    let_stuff_happen();
+
+    const int num_keys = 7;
+    const int num_rounds = 20;
+    for (int i = 0; i < num_rounds; i++) {
+        for (int key = 0; key < num_keys; key++) {
+            a1.send(i * num_keys + key, c2.get_me(), key);
+            a1.send(i * num_keys + key, c3.get_me(), key);
+        }
+    }
+
+    let_stuff_happen();
+
+    for (int i = 0; i < num_rounds - 1; i++) {
+        for (int key = 0; key < num_keys; key++) {
+            a2.expect_order(i * num_keys + key, (i + 1) * num_keys + key);
+            a3.expect_order(i * num_keys + key, (i + 1) * num_keys + key);
+        }
+    }
+}
+
 /* `GetConnections` confirms that the behavior of `cluster_t::get_connections()` is
 correct. */
 
@@ -452,6 +488,63 @@ TPTEST_MULTITHREAD(RPCConnectivityTest, BinaryData, 3) {
     EXPECT_TRUE(a2.got_spectrum);
 }
 
+// Adds up a stat of the connection to `peer` over all threads.
+static double get_connection_stat(connectivity_cluster_t *cluster, peer_id_t peer,
+                                  const char *name) {
+    perfmon_collection_t *collection = cluster->get_connectivity_collection();
+    void *ctx = collection->begin_stats();
+    pmap(get_num_threads(), [&](int thread) {
+        on_thread_t thread_switcher((threadnum_t(thread)));
+        collection->visit_stats(ctx);
+    });
+    return collection->end_stats(ctx)
+        .get_field(uuid_to_str(peer.get_uuid()).c_str()).get_field(name).as_num();
+}
+
+/* `Compression` sends messages between servers that compress their connection and
+servers that don't. The spectrum is large enough to be compressed, while the integers
+go into uncompressed frames. */
+
+TPTEST_MULTITHREAD(RPCConnectivityTest, Compression, 3) {
+    connectivity_cluster_t c1, c2, c3;
+    binary_test_application_t b1(&c1), b2(&c2), b3(&c3);
+    recording_test_application_t a1(&c1, 'T'), a2(&c2, 'T'), a3(&c3, 'T');
+    test_cluster_run_t cr1(&c1, peer_address_t(), 2, cluster_compression_t::deflate);
+    test_cluster_run_t cr2(&c2, peer_address_t(), 2, cluster_compression_t::deflate);
+    test_cluster_run_t cr3(&c3, peer_address_t(), 2, cluster_compression_t::none);
+    cr1.join(get_cluster_local_address(&c2), 0);
+    cr3.join(get_cluster_local_address(&c1), 0);
+
+    let_stuff_happen();
+
+    for (int i = 0; i < 10; i++) {
+        a1.send(i, c2.get_me());
+        a1.send(i, c3.get_me());
+        a2.send(100 + i, c1.get_me());
+    }
+    b1.send_spectrum(c2.get_me());
+    b1.send_spectrum(c3.get_me());
+    b2.send_spectrum(c1.get_me());
+
+    let_stuff_happen();
+
+    EXPECT_TRUE(b1.got_spectrum);
+    EXPECT_TRUE(b2.got_spectrum);
+    EXPECT_TRUE(b3.got_spectrum);
+    for (int i = 0; i < 9; i++) {
+        a2.expect_order(i, i + 1);
+        a3.expect_order(i, i + 1);
+        a1.expect_order(100 + i, 100 + i + 1);
+    }
+
+    // Only the connection between the two servers that both asked for it went
+    // through the compressor.
+    EXPECT_GT(get_connection_stat(&c1, c2.get_me(), "compression_input_bytes"), 0);
+    EXPECT_GT(get_connection_stat(&c1, c2.get_me(), "compression_output_bytes"), 0);
+    EXPECT_GT(get_connection_stat(&c2, c1.get_me(), "compression_output_bytes"), 0);
+    EXPECT_EQ(0, get_connection_stat(&c1, c3.get_me(), "compression_output_bytes"));
+}
+
 /* `PeerIDSemantics` makes sure that `peer_id_t::is_nil()` works as expected. */
 TPTEST_MULTITHREAD(RPCConnectivityTest, PeerIDSemantics, 3) {
     peer_id_t nil_peer;
@@ -3,6 +3,7 @@
 
 #include "arch/timing.hpp"
 #include "clustering/administration/metadata.hpp"
+#include "containers/archive/vector_stream.hpp"
 #include "unittest/clustering_utils.hpp"
 #include "unittest/dummy_metadata_controller.hpp"
 #include "unittest/unittest_utils.hpp"
@@ -177,4 +178,55 @@ TPTEST_MULTITHREAD(RPCMailboxTest, TypedMailbox, 3) {
     }
 }
 
+/* `TypedMailboxSendWrite` makes sure that a `mailbox_t<>` can receive messages from a
+`send_write()` whose callback serializes the arguments itself. */
+
+TPTEST_MULTITHREAD(RPCMailboxTest, TypedMailboxSendWrite, 3) {
+    connectivity_cluster_t c;
+    mailbox_manager_t m(&c, 'M');
+    test_cluster_run_t r(&c);
+
+    std::vector<std::pair<std::string, uint64_t> > inbox;
+    mailbox_t<std::string, uint64_t> mbox(&m,
+        [&](signal_t *, const std::string &str, uint64_t n) {
+            inbox.push_back(std::make_pair(str, n));
+        });
+
+    // Serializes the string only once, like `changefeed::server_t::send_all()`.
+    write_message_t str_wm;
+    serialize<cluster_version_t::CLUSTER>(&str_wm, std::string("foo"));
+    vector_stream_t serialized_str;
+    ASSERT_EQ(0, send_write_message(&serialized_str, &str_wm));
+
+    class writer_t : public mailbox_write_callback_t {
+    public:
+        writer_t(const std::vector<char> *_str, uint64_t _n) : str(_str), n(_n) { }
+        void write(cluster_version_t, write_message_t *wm) {
+            wm->append(str->data(), str->size());
+            serialize<cluster_version_t::CLUSTER>(wm, n);
+        }
+#ifdef ENABLE_MESSAGE_PROFILER
+        const char *message_profiler_tag() const {
+            return "unittest";
+        }
+#endif
+    private:
+        const std::vector<char> *str;
+        uint64_t n;
+    };
+
+    for (uint64_t i = 0; i < 3; ++i) {
+        writer_t writer(&serialized_str.vector(), i);
+        send_write(&m, mbox.get_address(), &writer);
+    }
+
+    let_stuff_happen();
+
+    ASSERT_EQ(3u, inbox.size());
+    for (uint64_t i = 0; i < 3; ++i) {
+        EXPECT_EQ("foo", inbox[i].first);
+        EXPECT_EQ(i, inbox[i].second);
+    }
+}
+
 }   /* namespace unittest */
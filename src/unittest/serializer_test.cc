@@ -2,7 +2,10 @@
 
 #include "arch/runtime/starter.hpp"
 #include "concurrency/new_mutex.hpp"
+#include "perfmon/perfmon.hpp"
+#include "random.hpp"
 #include "serializer/buf_ptr.hpp"
+#include "serializer/log/lba/disk_format.hpp"
 #include "serializer/log/log_serializer.hpp"
 #include "unittest/mock_file.hpp"
 #include "unittest/gtest.hpp"
@@ -90,5 +93,493 @@ TEST(SerializerTest, AddDeleteRepeatedlyWithIndex) {
     run_in_thread_pool(std::bind(run_AddDeleteRepeatedly, true), 4);
 }
 
+void run_CompressedBlocks() {
+    mock_file_opener_t file_opener;
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+    log_serializer_t::dynamic_config_t dynamic_config;
+    dynamic_config.block_compression = block_compression_t::lz4;
+    log_serializer_t ser(dynamic_config,
+                         &file_opener,
+                         &get_global_perfmon_collection());
+
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+
+    // Block 0 compresses well, block 1 doesn't compress at all.
+    std::vector<buf_ptr_t> bufs;
+    bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+    bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+    for (size_t i = 0; i < ser.max_block_size().value(); ++i) {
+        static_cast<char *>(bufs[0].cache_data())[i] = "compressible"[i % 12];
+        static_cast<char *>(bufs[1].cache_data())[i] = static_cast<char>(randint(256));
+    }
+
+    std::vector<buf_write_info_t> infos;
+    for (block_id_t id = 0; id < bufs.size(); ++id) {
+        infos.push_back(buf_write_info_t(bufs[id].ser_buffer(), bufs[id].block_size(), id));
+    }
+
+    struct : public iocallback_t, public cond_t {
+        void on_io_complete() {
+            pulse();
+        }
+    } cb;
+    std::vector<counted_t<block_token_t>> tokens
+        = ser.block_writes(infos.data(), infos.size(), account.get(), &cb);
+    cb.wait();
+
+    ASSERT_EQ(ser.max_block_size(), tokens[0]->block_size());
+    ASSERT_LT(tokens[0]->disk_block_size().ser_value(), tokens[0]->block_size().ser_value());
+    ASSERT_EQ(tokens[1]->block_size(), tokens[1]->disk_block_size());
+
+    {
+        std::vector<index_write_op_t> write_ops;
+        for (block_id_t id = 0; id < tokens.size(); ++id) {
+            write_ops.push_back(index_write_op_t(id, make_optional(tokens[id]), make_optional(repli_timestamp_t::distant_past)));
+        }
+        new_mutex_in_line_t dummy_acq;
+        ser.index_write(&dummy_acq, []{ }, write_ops);
+    }
+    tokens.clear();
+
+    for (block_id_t id = 0; id < bufs.size(); ++id) {
+        counted_t<block_token_t> token = ser.index_read(id);
+        ASSERT_TRUE(token.has());
+        buf_ptr_t read_buf = ser.block_read(token, account.get());
+        ASSERT_EQ(bufs[id].block_size(), read_buf.block_size());
+        ASSERT_EQ(id, read_buf.ser_buffer()->ser_header.block_id);
+        ASSERT_EQ(0, memcmp(bufs[id].cache_data(), read_buf.cache_data(),
+                            bufs[id].block_size().value()));
+    }
+}
+
+TEST(SerializerTest, CompressedBlocks) {
+    run_in_thread_pool(run_CompressedBlocks, 4);
+}
+
+double get_serializer_stat(perfmon_collection_t *collection, const char *name) {
+    void *ctx = collection->begin_stats();
+    collection->visit_stats(ctx);
+    return collection->end_stats(ctx).get_field("serializer").get_field(name).as_num();
+}
+
+void run_LbaSnapshot() {
+    mock_file_opener_t file_opener;
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+    log_serializer_t::dynamic_config_t dynamic_config;
+    // Low enough that we write several snapshots.
+    dynamic_config.lba_snapshot_threshold = 256;
+
+    const block_id_t num_blocks = 300;
+    const int num_rounds = 4;
+    {
+        perfmon_collection_t collection;
+        log_serializer_t ser(dynamic_config, &file_opener, &collection);
+        scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+
+        for (int round = 0; round < num_rounds; ++round) {
+            // Every round rewrites all blocks, with the round number as their contents.
+            std::vector<buf_ptr_t> bufs;
+            std::vector<buf_write_info_t> infos;
+            for (block_id_t id = 0; id < num_blocks; ++id) {
+                bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+                static_cast<char *>(bufs.back().cache_data())[0] = round;
+            }
+            for (block_id_t id = 0; id < num_blocks; ++id) {
+                infos.push_back(buf_write_info_t(bufs[id].ser_buffer(),
+                                                 bufs[id].block_size(), id));
+            }
+            struct : public iocallback_t, public cond_t {
+                void on_io_complete() {
+                    pulse();
+                }
+            } cb;
+            std::vector<counted_t<block_token_t>> tokens
+                = ser.block_writes(infos.data(), infos.size(), account.get(), &cb);
+            cb.wait();
+
+            // Lots of small index writes, so the LBA grows quickly. In the last round,
+            // every third block gets deleted instead.
+            for (block_id_t id = 0; id < num_blocks; ++id) {
+                std::vector<index_write_op_t> write_ops;
+                if (round == num_rounds - 1 && id % 3 == 0) {
+                    write_ops.push_back(index_write_op_t(id, make_optional(counted_t<block_token_t>())));
+                } else {
+                    write_ops.push_back(index_write_op_t(id, make_optional(tokens[id]), make_optional(repli_timestamp_t::distant_past)));
+                }
+                new_mutex_in_line_t dummy_acq;
+                ser.index_write(&dummy_acq, []{ }, write_ops);
+            }
+        }
+        ASSERT_LT(0, get_serializer_stat(&collection, "serializer_lba_snapshots"));
+    }
+
+    // Starting up again goes through the last snapshot that got written before the
+    // serializer shut down, and the LBA entries after it.
+    log_serializer_startup_progress_t startup_progress;
+    log_serializer_t ser(dynamic_config,
+                         &file_opener,
+                         &get_global_perfmon_collection(),
+                         &startup_progress);
+    ASSERT_TRUE(startup_progress.is_ready);
+    ASSERT_EQ(LBA_SHARD_FACTOR, startup_progress.lba_snapshot_shards);
+    ASSERT_LT(0, startup_progress.lba_entries_applied);
+    ASSERT_EQ(1.0, startup_progress.progress());
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+    for (block_id_t id = 0; id < num_blocks; ++id) {
+        counted_t<block_token_t> token = ser.index_read(id);
+        if (id % 3 == 0) {
+            ASSERT_FALSE(token.has());
+            continue;
+        }
+        ASSERT_TRUE(token.has());
+        buf_ptr_t read_buf = ser.block_read(token, account.get());
+        ASSERT_EQ(id, read_buf.ser_buffer()->ser_header.block_id);
+        ASSERT_EQ(num_rounds - 1, static_cast<char *>(read_buf.cache_data())[0]);
+    }
+}
+
+TEST(SerializerTest, LbaSnapshot) {
+    run_in_thread_pool(run_LbaSnapshot, 4);
+}
+
+void run_LbaSnapshotGc() {
+    mock_file_opener_t file_opener;
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+    log_serializer_t::dynamic_config_t dynamic_config;
+    dynamic_config.lba_snapshot_threshold = 256;
+
+    const block_id_t num_blocks = 300;
+    {
+        log_serializer_t ser(dynamic_config,
+                             &file_opener,
+                             &get_global_perfmon_collection());
+        scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+        std::vector<buf_ptr_t> bufs;
+        std::vector<buf_write_info_t> infos;
+        for (block_id_t id = 0; id < num_blocks; ++id) {
+            bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+        }
+        for (block_id_t id = 0; id < num_blocks; ++id) {
+            infos.push_back(buf_write_info_t(bufs[id].ser_buffer(),
+                                             bufs[id].block_size(), id));
+        }
+        struct : public iocallback_t, public cond_t {
+            void on_io_complete() {
+                pulse();
+            }
+        } cb;
+        std::vector<counted_t<block_token_t>> tokens
+            = ser.block_writes(infos.data(), infos.size(), account.get(), &cb);
+        cb.wait();
+
+        // Enough single index writes for a snapshot to be written.
+        for (block_id_t id = 0; id < num_blocks; ++id) {
+            std::vector<index_write_op_t> write_ops;
+            write_ops.push_back(index_write_op_t(id, make_optional(tokens[id]), make_optional(repli_timestamp_t::distant_past)));
+            new_mutex_in_line_t dummy_acq;
+            ser.index_write(&dummy_acq, []{ }, write_ops);
+        }
+    }
+
+    // Without new snapshots, churn the LBA until the GC has discarded the extents
+    // that the snapshot's marks point into. Only the recencies change, so the LBA
+    // grows without writing any blocks.
+    dynamic_config.lba_snapshot_threshold = 0;
+    repli_timestamp_t recency = repli_timestamp_t::distant_past;
+    {
+        log_serializer_startup_progress_t startup_progress;
+        perfmon_collection_t collection;
+        log_serializer_t ser(dynamic_config, &file_opener, &collection,
+                             &startup_progress);
+        ASSERT_EQ(LBA_SHARD_FACTOR, startup_progress.lba_snapshot_shards);
+
+        for (int round = 0;
+             get_serializer_stat(&collection, "serializer_lba_gcs") < LBA_SHARD_FACTOR;
+             ++round) {
+            ASSERT_LT(round, 10000);
+            recency = recency.next();
+            std::vector<index_write_op_t> write_ops;
+            for (block_id_t id = 0; id < num_blocks; ++id) {
+                write_ops.push_back(index_write_op_t(id, r_nullopt, make_optional(recency)));
+            }
+            new_mutex_in_line_t dummy_acq;
+            ser.index_write(&dummy_acq, []{ }, write_ops);
+        }
+    }
+
+    // The GC has invalidated the marks of the shards that it went through, so those
+    // have to be replayed in full.
+    log_serializer_startup_progress_t startup_progress;
+    log_serializer_t ser(dynamic_config,
+                         &file_opener,
+                         &get_global_perfmon_collection(),
+                         &startup_progress);
+    ASSERT_GT(LBA_SHARD_FACTOR, startup_progress.lba_snapshot_shards);
+    segmented_vector_t<repli_timestamp_t> recencies = ser.get_all_recencies(0, 1);
+    ASSERT_LE(static_cast<size_t>(num_blocks), recencies.size());
+    for (block_id_t id = 0; id < num_blocks; ++id) {
+        ASSERT_EQ(recency, recencies[id]);
+        ASSERT_TRUE(ser.index_read(id).has());
+    }
+}
+
+TEST(SerializerTest, LbaSnapshotGc) {
+    run_in_thread_pool(run_LbaSnapshotGc, 4);
+}
+
+std::vector<counted_t<block_token_t>> write_blocks(
+        log_serializer_t *ser,
+        file_account_t *account,
+        const std::vector<block_id_t> &block_ids,
+        char contents) {
+    std::vector<buf_ptr_t> bufs;
+    std::vector<buf_write_info_t> infos;
+    for (size_t i = 0; i < block_ids.size(); ++i) {
+        bufs.push_back(buf_ptr_t::alloc_zeroed(ser->max_block_size()));
+        static_cast<char *>(bufs.back().cache_data())[0] = contents;
+    }
+    for (size_t i = 0; i < block_ids.size(); ++i) {
+        infos.push_back(buf_write_info_t(bufs[i].ser_buffer(),
+                                         bufs[i].block_size(), block_ids[i]));
+    }
+    struct : public iocallback_t, public cond_t {
+        void on_io_complete() {
+            pulse();
+        }
+    } cb;
+    std::vector<counted_t<block_token_t>> tokens
+        = ser->block_writes(infos.data(), infos.size(), account, &cb);
+    cb.wait();
+    return tokens;
+}
+
+void write_index(log_serializer_t *ser, const std::vector<index_write_op_t> &write_ops) {
+    new_mutex_in_line_t dummy_acq;
+    ser->index_write(&dummy_acq, []{ }, write_ops);
+}
+
+// Writes the blocks and then keeps updating their recencies until a snapshot of the
+// LBA has been written, and a few more times after that, so that the LBA has entries
+// on top of the snapshot. The sparse block id makes the snapshot span several extents.
+void make_lba_snapshot(mock_file_opener_t *file_opener,
+                       std::vector<block_id_t> *block_ids_out,
+                       repli_timestamp_t *recency_out) {
+    for (block_id_t id = 0; id < 300; ++id) {
+        block_ids_out->push_back(id);
+    }
+    block_ids_out->push_back(150000);
+
+    log_serializer_t::create(file_opener, log_serializer_t::static_config_t());
+    log_serializer_t::dynamic_config_t dynamic_config;
+    dynamic_config.lba_snapshot_threshold = 256;
+    perfmon_collection_t collection;
+    log_serializer_t ser(dynamic_config, file_opener, &collection);
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+
+    repli_timestamp_t recency = repli_timestamp_t::distant_past;
+    {
+        std::vector<counted_t<block_token_t>> tokens
+            = write_blocks(&ser, account.get(), *block_ids_out, 1);
+        std::vector<index_write_op_t> write_ops;
+        for (size_t i = 0; i < block_ids_out->size(); ++i) {
+            write_ops.push_back(index_write_op_t((*block_ids_out)[i], make_optional(tokens[i]), make_optional(recency)));
+        }
+        write_index(&ser, write_ops);
+    }
+
+    int rounds_after_snapshot = 0;
+    for (int round = 0; rounds_after_snapshot < 5; ++round) {
+        ASSERT_LT(round, 10000);
+        if (get_serializer_stat(&collection, "serializer_lba_snapshots") > 0) {
+            ++rounds_after_snapshot;
+        }
+        recency = recency.next();
+        std::vector<index_write_op_t> write_ops;
+        for (block_id_t id : *block_ids_out) {
+            write_ops.push_back(index_write_op_t(id, r_nullopt, make_optional(recency)));
+        }
+        write_index(&ser, write_ops);
+    }
+    *recency_out = recency;
+}
+
+void check_recencies(log_serializer_t *ser,
+                     const std::vector<block_id_t> &block_ids,
+                     repli_timestamp_t recency) {
+    segmented_vector_t<repli_timestamp_t> recencies = ser->get_all_recencies(0, 1);
+    for (block_id_t id : block_ids) {
+        ASSERT_TRUE(ser->index_read(id).has());
+        ASSERT_LT(id, recencies.size());
+        ASSERT_EQ(recency, recencies[id]);
+    }
+}
+
+void run_LbaSnapshotHeldBack() {
+    mock_file_opener_t file_opener;
+    std::vector<block_id_t> block_ids;
+    repli_timestamp_t recency;
+    make_lba_snapshot(&file_opener, &block_ids, &recency);
+
+    // Watch the progress that the `jobs` table would show while the LBA is loading.
+    log_serializer_startup_progress_t startup_progress;
+    std::vector<double> progress;
+    cond_t started, stop_watching, stopped_watching;
+    coro_t::spawn_sometime([&]() {
+        while (!stop_watching.is_pulsed()) {
+            progress.push_back(startup_progress.progress());
+            started.pulse_if_not_already_pulsed();
+            coro_t::yield();
+        }
+        stopped_watching.pulse();
+    });
+    started.wait();
+
+    {
+        log_serializer_t::dynamic_config_t dynamic_config;
+        log_serializer_t ser(dynamic_config,
+                             &file_opener,
+                             &get_global_perfmon_collection(),
+                             &startup_progress);
+        stop_watching.pulse();
+        stopped_watching.wait();
+
+        // The shards' entries after the snapshot are read while the snapshot is being
+        // applied. If they weren't held back, the snapshot's older recencies would
+        // overwrite them.
+        ASSERT_EQ(LBA_SHARD_FACTOR, startup_progress.lba_snapshot_shards);
+        check_recencies(&ser, block_ids, recency);
+    }
+
+    ASSERT_EQ(0.0, progress.front());
+    for (size_t i = 1; i < progress.size(); ++i) {
+        ASSERT_LE(progress[i - 1], progress[i]);
+    }
+    ASSERT_EQ(1.0, progress.back());
+}
+
+TEST(SerializerTest, LbaSnapshotHeldBack) {
+    run_in_thread_pool(run_LbaSnapshotHeldBack, 4);
+}
+
+void run_LbaSnapshotDamaged() {
+    mock_file_opener_t file_opener;
+    std::vector<block_id_t> block_ids;
+    repli_timestamp_t recency;
+    make_lba_snapshot(&file_opener, &block_ids, &recency);
+
+    // Damage every snapshot extent except for the first ones, so that the damage only
+    // shows after some of the snapshot has already been applied.
+    std::vector<char> *data = file_opener.file_data();
+    int damaged = 0;
+    for (size_t offset = DEFAULT_EXTENT_SIZE;
+         offset + DEFAULT_EXTENT_SIZE <= data->size();
+         offset += DEFAULT_EXTENT_SIZE) {
+        lba_snapshot_extent_t header;
+        memcpy(&header, data->data() + offset, sizeof(header));
+        if (memcmp(header.magic, lba_snapshot_magic, LBA_SNAPSHOT_MAGIC_SIZE) == 0
+            && header.extent_offsets_count == 0
+            && header.first_entry > 0) {
+            (*data)[offset + sizeof(header)] ^= 0xff;
+            ++damaged;
+        }
+    }
+    ASSERT_LT(0, damaged);
+
+    // The shards have to be read again from the start.
+    log_serializer_startup_progress_t startup_progress;
+    log_serializer_t::dynamic_config_t dynamic_config;
+    log_serializer_t ser(dynamic_config,
+                         &file_opener,
+                         &get_global_perfmon_collection(),
+                         &startup_progress);
+    ASSERT_EQ(0, startup_progress.lba_snapshot_shards);
+    ASSERT_EQ(1.0, startup_progress.progress());
+    check_recencies(&ser, block_ids, recency);
+}
+
+TEST(SerializerTest, LbaSnapshotDamaged) {
+    run_in_thread_pool(run_LbaSnapshotDamaged, 4);
+}
+
+void check_blocks(log_serializer_t *ser,
+                  file_account_t *account,
+                  block_id_t num_blocks,
+                  const std::function<char(block_id_t)> &contents) {
+    for (block_id_t id = 0; id < num_blocks; ++id) {
+        counted_t<block_token_t> token = ser->index_read(id);
+        ASSERT_TRUE(token.has());
+        buf_ptr_t read_buf = ser->block_read(token, account);
+        ASSERT_EQ(id, read_buf.ser_buffer()->ser_header.block_id);
+        ASSERT_EQ(contents(id), static_cast<char *>(read_buf.cache_data())[0]);
+    }
+}
+
+// The data block manager learns which blocks are live shard by shard at startup. If it
+// missed some, the data GC would throw them away.
+void run_ReconstructByShard() {
+    mock_file_opener_t file_opener;
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+    log_serializer_t::dynamic_config_t dynamic_config;
+
+    const block_id_t num_blocks = 2048;
+    std::vector<block_id_t> block_ids;
+    for (block_id_t id = 0; id < num_blocks; ++id) {
+        block_ids.push_back(id);
+    }
+    {
+        log_serializer_t ser(dynamic_config,
+                             &file_opener,
+                             &get_global_perfmon_collection());
+        scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+        std::vector<counted_t<block_token_t>> tokens
+            = write_blocks(&ser, account.get(), block_ids, 1);
+        std::vector<index_write_op_t> write_ops;
+        for (block_id_t id = 0; id < num_blocks; ++id) {
+            write_ops.push_back(index_write_op_t(id, make_optional(tokens[id]), make_optional(repli_timestamp_t::distant_past)));
+        }
+        write_index(&ser, write_ops);
+    }
+
+    // Overwrite two thirds of the blocks, which are spread over all shards, until the
+    // GC has moved the other blocks out of the old extents, and then a little more so
+    // that the freed extents get reused.
+    auto contents = [](block_id_t id) -> char { return id % 3 == 0 ? 1 : 2; };
+    std::vector<block_id_t> overwritten_ids;
+    for (block_id_t id = 0; id < num_blocks; ++id) {
+        if (contents(id) == 2) {
+            overwritten_ids.push_back(id);
+        }
+    }
+    {
+        perfmon_collection_t collection;
+        log_serializer_t ser(dynamic_config, &file_opener, &collection);
+        scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+        int rounds_after_gc = 0;
+        for (int round = 0; rounds_after_gc < 3; ++round) {
+            ASSERT_LT(round, 100);
+            if (get_serializer_stat(&collection, "serializer_data_extents_gced") > 0) {
+                ++rounds_after_gc;
+            }
+            std::vector<counted_t<block_token_t>> tokens
+                = write_blocks(&ser, account.get(), overwritten_ids, 2);
+            std::vector<index_write_op_t> write_ops;
+            for (size_t i = 0; i < overwritten_ids.size(); ++i) {
+                write_ops.push_back(index_write_op_t(overwritten_ids[i], make_optional(tokens[i]), make_optional(repli_timestamp_t::distant_past)));
+            }
+            write_index(&ser, write_ops);
+        }
+        check_blocks(&ser, account.get(), num_blocks, contents);
+    }
+
+    log_serializer_t ser(dynamic_config,
+                         &file_opener,
+                         &get_global_perfmon_collection());
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+    check_blocks(&ser, account.get(), num_blocks, contents);
+}
+
+TEST(SerializerTest, ReconstructByShard) {
+    run_in_thread_pool(run_ReconstructByShard, 4);
+}
 
 }  // namespace unittest
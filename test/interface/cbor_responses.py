@@ -0,0 +1,199 @@
+#!/usr/bin/env python
+# Copyright 2016 RethinkDB, all rights reserved.
+
+'''Drives raw client connections to check the `response_format` field of the V1_0 handshake and the framing of CBOR responses.'''
+
+import json, os, socket, struct, sys
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'common')))
+import driver, scenario_common, utils, vcoptparse
+
+op = vcoptparse.OptParser()
+scenario_common.prepare_option_parser_mode_flags(op)
+_, command_prefix, serve_options = scenario_common.parse_mode_flags(op.parse(sys.argv))
+
+r = utils.import_python_driver()
+handshake = sys.modules[r.__name__ + '.handshake']
+
+V1_0 = 0x34c2bdc3
+START, CONTINUE = 1, 2
+SUCCESS_ATOM, SUCCESS_SEQUENCE, SUCCESS_PARTIAL = 1, 2, 3
+RESPONSE_PREFIX_SIZE = 12 # int64_t token followed by uint32_t size
+
+class HandshakeEncoder(json.JSONEncoder):
+    '''Adds `response_format` to the first message of the handshake, which is the only one with `protocol_version`.'''
+
+    def __init__(self, response_format):
+        super(HandshakeEncoder, self).__init__()
+        self.response_format = response_format
+
+    def encode(self, obj):
+        if 'protocol_version' in obj and self.response_format is not None:
+            obj = dict(obj, response_format=self.response_format)
+        return super(HandshakeEncoder, self).encode(obj)
+
+def recv_exactly(sock, size):
+    data = b''
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise Exception('Connection closed after %d of %d bytes' % (len(data), size))
+        data += chunk
+    return data
+
+def recv_null_terminated(sock):
+    data = b''
+    while True:
+        c = recv_exactly(sock, 1)
+        if c == b'\0':
+            return data
+        data += c
+
+def cbor_loads(data):
+    '''A minimal CBOR decoder that covers what the server writes.'''
+
+    data = bytearray(data)
+
+    def read_argument(info, pos):
+        if info < 24:
+            return info, pos
+        fmt = {24: '>B', 25: '>H', 26: '>I', 27: '>Q'}[info]
+        size = struct.calcsize(fmt)
+        return struct.unpack(fmt, bytes(data[pos:pos + size]))[0], pos + size
+
+    def read(pos):
+        major, info = data[pos] >> 5, data[pos] & 0x1f
+        pos += 1
+        if major == 7:
+            if info == 20: return False, pos
+            if info == 21: return True, pos
+            if info == 22: return None, pos
+            if info == 27: return struct.unpack('>d', bytes(data[pos:pos + 8]))[0], pos + 8
+            raise ValueError('Unexpected simple value %d' % info)
+        argument, pos = read_argument(info, pos)
+        if major == 0:
+            return argument, pos
+        if major == 1:
+            return -1 - argument, pos
+        if major == 2:
+            return bytes(data[pos:pos + argument]), pos + argument
+        if major == 3:
+            return bytes(data[pos:pos + argument]).decode('utf-8'), pos + argument
+        if major == 4:
+            items = []
+            for _ in range(argument):
+                item, pos = read(pos)
+                items.append(item)
+            return items, pos
+        if major == 5:
+            items = {}
+            for _ in range(argument):
+                key, pos = read(pos)
+                items[key], pos = read(pos)
+            return items, pos
+        raise ValueError('Unexpected major type %d' % major)
+
+    value, pos = read(0)
+    if pos != len(data):
+        raise ValueError('%d trailing bytes after the CBOR value' % (len(data) - pos))
+    return value
+
+def connect(server, response_format):
+    '''Runs the V1_0 handshake as `admin` and returns the socket and the server's reply to the first client message.'''
+
+    sock = socket.create_connection((server.host, server.driver_port))
+    shake = handshake.HandshakeV1_0(json.JSONDecoder(), HandshakeEncoder(response_format), server.host, server.driver_port, 'admin', '')
+    shake.reset()
+    reply = None
+    response = None
+    while True:
+        request = shake.next_message(response)
+        if request is None:
+            break
+        if request:
+            sock.sendall(request)
+        response = recv_null_terminated(sock)
+        if reply is None and 'authentication' in response.decode('utf-8'):
+            reply = json.loads(response.decode('utf-8'))
+    return sock, reply
+
+def handshake_error(server, response_format):
+    '''Sends a first message with the given `response_format` and returns the server's error.'''
+
+    sock = socket.create_connection((server.host, server.driver_port))
+    try:
+        sock.sendall(struct.pack('<L', V1_0) + json.dumps({
+            'protocol_version': 0,
+            'authentication_method': 'SCRAM-SHA-256',
+            'authentication': 'n,,n=admin,r=cbortestnonce',
+            'response_format': response_format}).encode('utf-8') + b'\0')
+        hello = json.loads(recv_null_terminated(sock).decode('utf-8'))
+        assert hello['success'] is True, hello
+        return json.loads(recv_null_terminated(sock).decode('utf-8'))
+    finally:
+        sock.close()
+
+def run_query(sock, token, query):
+    sock.sendall(struct.pack('<qL', token, len(query)) + query)
+    prefix = recv_exactly(sock, RESPONSE_PREFIX_SIZE)
+    response_token, size = struct.unpack('<qL', prefix)
+    assert response_token == token, 'Expected token %d, got %d' % (token, response_token)
+    return recv_exactly(sock, size)
+
+utils.print_with_time("Spinning up a server")
+with driver.Process(name='.', command_prefix=command_prefix, extra_options=serve_options) as server:
+    server.check()
+
+    utils.print_with_time("Checking the handshake")
+
+    sock, reply = connect(server, None)
+    assert 'response_format' not in reply, reply
+    sock.close()
+
+    for response_format in ('json', 'cbor'):
+        sock, reply = connect(server, response_format)
+        assert reply.get('response_format') == response_format, reply
+        sock.close()
+
+    error = handshake_error(server, 1)
+    assert error['success'] is False and error['error_code'] == 23, error
+    error = handshake_error(server, 'xml')
+    assert error['success'] is False and error['error_code'] == 24, error
+
+    # r.expr([1, -2, 2.5, "x", r.binary("abc"), true, null])
+    datum_query = json.dumps([START, [2, [1, -2, 2.5, "x", [155, ["abc"]], True, None]], {}]).encode('utf-8')
+
+    utils.print_with_time("Checking JSON responses")
+
+    sock, _ = connect(server, 'json')
+    response = json.loads(run_query(sock, 1, datum_query).decode('utf-8'))
+    assert response['t'] == SUCCESS_ATOM, response
+    assert response['r'] == [[1, -2, 2.5, "x", {'$reql_type$': 'BINARY', 'data': 'YWJj'}, True, None]], response
+    sock.close()
+
+    utils.print_with_time("Checking CBOR responses")
+
+    sock, _ = connect(server, 'cbor')
+    response = cbor_loads(run_query(sock, 1, datum_query))
+    assert response == {'t': SUCCESS_ATOM, 'r': [[1, -2, 2.5, "x", b"abc", True, None]]}, response
+    assert isinstance(response['r'][0][0], int), response
+
+    # A long stream, so that some batches are large enough to be encoded on several threads
+    values = []
+    response = cbor_loads(run_query(sock, 2, json.dumps([START, [173, [5000]], {}]).encode('utf-8')))
+    while True:
+        assert response['t'] in (SUCCESS_PARTIAL, SUCCESS_SEQUENCE), response
+        assert 'n' in response, response
+        values.extend(response['r'])
+        if response['t'] == SUCCESS_SEQUENCE:
+            break
+        response = cbor_loads(run_query(sock, 2, json.dumps([CONTINUE]).encode('utf-8')))
+    assert values == list(range(5000)), 'Got %d values, expected 0 to 4999' % len(values)
+
+    # Errors are CBOR too
+    response = cbor_loads(run_query(sock, 3, json.dumps([START, [12, ["oops"]], {}]).encode('utf-8')))
+    assert response['t'] == 18 and response['r'] == ['oops'], response
+    sock.close()
+
+    utils.print_with_time("Cleaning up")
+utils.print_with_time("Done.")